@@ -45,6 +45,14 @@
 #include "hex_utils.h"
 #endif
 
+#ifdef ENABLE_LIVE_WATCH
+#include "live_watch.h"
+#endif
+
+#ifdef ENABLE_PERF
+#include "perf.h"
+#endif
+
 #ifdef PLATFORM_HAS_TRACESWO
 #include "serialno.h"
 #include "swo.h"
@@ -77,6 +85,12 @@ static bool cmd_heapinfo(target_s *target, int argc, const char **argv);
 #ifdef ENABLE_RTT
 static bool cmd_rtt(target_s *target, int argc, const char **argv);
 #endif
+#ifdef ENABLE_LIVE_WATCH
+static bool cmd_live_watch(target_s *target, int argc, const char **argv);
+#endif
+#ifdef ENABLE_PERF
+static bool cmd_perf(target_s *target, int argc, const char **argv);
+#endif
 #if defined(PLATFORM_HAS_DEBUG) && CONFIG_BMDA == 0
 static bool cmd_debug_bmp(target_s *target, int argc, const char **argv);
 #endif
@@ -114,6 +128,17 @@ const command_s cmd_list[] = {
 		"[enable|disable|status|channel [0..15 ...]|ident [STR]|cblock|ram [RAM_START RAM_END]|poll [MAXMS MINMS "
 		"MAXERR]]"},
 #endif
+#ifdef ENABLE_LIVE_WATCH
+	{"live_watch", cmd_live_watch,
+#if CONFIG_BMDA == 1
+		"Stream memory sampled while running: [enable|disable|status|add ADDR LEN|clear|rate HZ|file [PATH]]"},
+#else
+		"Stream memory sampled while running to aux serial: [enable|disable|status|add ADDR LEN|clear|rate HZ]"},
+#endif
+#endif
+#ifdef ENABLE_PERF
+	{"perf", cmd_perf, "Display or reset the performance counters: [reset]"},
+#endif
 #ifdef PLATFORM_HAS_TRACESWO
 #if SWO_ENCODING == 1
 	{"swo", cmd_swo, "Start SWO capture, Manchester mode: <enable|disable> [decode [CHANNEL_NR ...]]"},
@@ -629,6 +654,115 @@ static bool cmd_rtt(target_s *target, int argc, const char **argv)
 }
 #endif
 
+#ifdef ENABLE_LIVE_WATCH
+/* Let the user know if the rate asked for can't actually be reached */
+static void live_watch_check_rate(void)
+{
+#if CONFIG_BMDA == 1
+	/* BMDA waits between polls of a running target unless run with -F, so can't sample faster than it polls */
+	const uint32_t pace_ms = bmda_pace_poll_ms();
+	if (pace_ms && live_watch_rate_hz > 1000U / pace_ms)
+		gdb_outf("live_watch: polling every %" PRIu32 "ms limits sampling to %" PRIu32
+				 "Hz, run BMDA with -F to sample faster\n",
+			pace_ms, 1000U / pace_ms);
+#endif
+}
+
+static bool cmd_live_watch(target_s *target, int argc, const char **argv)
+{
+	const size_t command_len = argc > 1 ? strlen(argv[1]) : 0;
+	if (argc == 1 || (argc == 2 && strncmp(argv[1], "enable", command_len) == 0)) {
+		/* Sampling must not disturb the target, so only allow it where memory can be read while running */
+		if (target && target_mem_access_needs_halt(target)) {
+			gdb_out("live_watch: target memory cannot be read without halting\n");
+			return false;
+		}
+		live_watch_restart();
+		live_watch_enabled = true;
+		live_watch_check_rate();
+	} else if (argc == 2 && strncmp(argv[1], "disable", command_len) == 0)
+		live_watch_enabled = false;
+	else if (argc == 2 && strncmp(argv[1], "status", command_len) == 0) {
+		gdb_outf("live_watch: %s rate: %" PRIu32 "Hz samples: %" PRIu32 " overruns: %" PRIu32 " errors: %" PRIu32 "\n",
+			live_watch_enabled ? "on" : "off", live_watch_rate_hz, live_watch_samples, live_watch_overruns,
+			live_watch_errors);
+		for (size_t i = 0; i < live_watch_range_count; ++i)
+			gdb_outf("%2" PRIu32 " 0x%08" PRIx32 " %2" PRIu32 "\n", (uint32_t)i, live_watch_ranges[i].addr,
+				(uint32_t)live_watch_ranges[i].length);
+	} else if (argc == 4 && strncmp(argv[1], "add", command_len) == 0) {
+		uint32_t addr = 0;
+		if (!read_hex32(argv[2], NULL, &addr, READ_HEX_NO_FOLLOW) ||
+			!live_watch_add(addr, strtoul(argv[3], NULL, 0))) {
+			gdb_outf("live_watch: up to %u ranges of 1 to %u bytes can be watched\n", LIVE_WATCH_MAX_RANGES,
+				LIVE_WATCH_MAX_LENGTH);
+			return false;
+		}
+	} else if (argc == 2 && strncmp(argv[1], "clear", command_len) == 0)
+		live_watch_clear();
+	else if (argc == 3 && strncmp(argv[1], "rate", command_len) == 0) {
+		const uint32_t rate = strtoul(argv[2], NULL, 0);
+		if (!rate || rate > LIVE_WATCH_MAX_RATE_HZ) {
+			gdb_outf("live_watch: rate must be between 1 and %uHz\n", LIVE_WATCH_MAX_RATE_HZ);
+			return false;
+		}
+		live_watch_rate_hz = rate;
+		live_watch_check_rate();
+	}
+#if CONFIG_BMDA == 1
+	else if ((argc == 2 || argc == 3) && strncmp(argv[1], "file", command_len) == 0) {
+		if (!live_watch_set_file(argc == 3 ? argv[2] : NULL)) {
+			gdb_outf("live_watch: could not open %s\n", argv[2]);
+			return false;
+		}
+	}
+#endif
+	else {
+		gdb_out("what?\n");
+		return false;
+	}
+	return true;
+}
+#endif
+
+#ifdef ENABLE_PERF
+static bool cmd_perf(target_s *target, int argc, const char **argv)
+{
+	(void)target;
+	if (argc == 2 && strncmp(argv[1], "reset", strlen(argv[1])) == 0) {
+		perf_reset();
+		return true;
+	}
+	if (argc != 1) {
+		gdb_out("what?\n");
+		return false;
+	}
+	for (size_t metric = 0; metric < PERF_METRIC_COUNT; ++metric) {
+		const perf_metric_data_s *const data = &perf_metrics[metric];
+		if (!data->count)
+			continue;
+		gdb_outf("%-17s %10" PRIu32, perf_metric_names[metric], data->count);
+		if (data->amount)
+			gdb_outf(" %" PRIu32 "KiB", (uint32_t)(data->amount >> 10U));
+		uint32_t timed = 0;
+		for (size_t bucket = 0; bucket < PERF_HISTOGRAM_BUCKETS; ++bucket)
+			timed += data->histogram[bucket];
+		if (timed)
+			gdb_outf(" avg %" PRIu32 "us", (uint32_t)(data->time_us / timed));
+		/* Then the non-empty histogram buckets, labelled by their upper bound */
+		for (size_t bucket = 0; bucket < PERF_HISTOGRAM_BUCKETS; ++bucket) {
+			if (!data->histogram[bucket])
+				continue;
+			if (bucket + 1U < PERF_HISTOGRAM_BUCKETS)
+				gdb_outf(" <%" PRIu32 "us:%" PRIu32, UINT32_C(1) << bucket, data->histogram[bucket]);
+			else
+				gdb_outf(" >=%" PRIu32 "us:%" PRIu32, UINT32_C(1) << (bucket - 1U), data->histogram[bucket]);
+		}
+		gdb_out("\n");
+	}
+	return true;
+}
+#endif
+
 #ifdef PLATFORM_HAS_TRACESWO
 static bool cmd_swo_enable(int argc, const char **argv)
 {
@@ -164,7 +164,10 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 		const size_t reg_size = target_regs_size(cur_target);
 		if (reg_size) {
 			uint8_t *gp_regs = alloca(reg_size);
-			unhexify(gp_regs, packet->data + 1, reg_size);
+			if (packet->size < 1U + (reg_size * 2U) || !unhexify_checked(gp_regs, packet->data + 1, reg_size)) {
+				gdb_put_packet_error(0xffU);
+				break;
+			}
 			target_regs_write(cur_target, gp_regs);
 		}
 		gdb_put_packet_ok();
@@ -181,8 +184,9 @@ int32_t gdb_main_loop(target_controller_s *const tc, const gdb_packet_s *const p
 			}
 			DEBUG_GDB("M packet: addr = %" PRIx32 ", len = %" PRIx32 "\n", addr, len);
 			uint8_t *mem = alloca(len);
-			unhexify(mem, rest, len);
-			if (target_mem32_write(cur_target, addr, mem, len))
+			if (!unhexify_checked(mem, rest, len))
+				gdb_put_packet_error(0xffU);
+			else if (target_mem32_write(cur_target, addr, mem, len))
 				gdb_put_packet_error(1U);
 			else
 				gdb_put_packet_ok();
@@ -418,7 +422,10 @@ static void exec_q_rcmd(const char *packet, const size_t length)
 	// It should be pinging -Wvla among other things, and it failing is straight-up UB
 	char *data = alloca(datalen + 1U);
 	/* dehexify command */
-	unhexify(data, packet, datalen);
+	if (!unhexify_checked(data, packet, datalen)) {
+		gdb_put_packet_error(0xffU);
+		return;
+	}
 	data[datalen] = 0; /* add terminating null */
 
 	const int result = command_process(cur_target, data);
@@ -819,7 +826,8 @@ static void exec_v_flash_erase(const char *packet, const size_t length)
 			return;
 		}
 
-		if (target_flash_erase(cur_target, addr, len))
+		/* The vFlashWrite packets and vFlashDone that follow wait on the erase, so it can run behind them */
+		if (target_flash_erase_deferred(cur_target, addr, len))
 			gdb_put_packet_ok();
 		else {
 			target_flash_complete(cur_target);
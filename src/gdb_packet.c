@@ -121,7 +121,6 @@ static uint8_t gdb_packet_checksum(const gdb_packet_s *const packet)
 
 packet_state_e consume_remote_packet(char *const packet, const size_t size)
 {
-#if CONFIG_BMDA == 0
 	/* We got what looks like probably a remote control packet */
 	size_t offset = 0;
 	while (true) {
@@ -146,6 +145,9 @@ packet_state_e consume_remote_packet(char *const packet, const size_t size)
 			packet[offset] = '\0';
 			/* Handle packet */
 			remote_packet_process(packet, offset);
+#if CONFIG_BMDA == 1
+			gdb_if_count_remote_packet();
+#endif
 
 			/* Restart packet capture */
 			packet[0] = '\0';
@@ -165,13 +167,6 @@ packet_state_e consume_remote_packet(char *const packet, const size_t size)
 			}
 		}
 	}
-#else
-	(void)packet;
-	(void)size;
-
-	/* Hosted builds ignore remote control packets */
-	return PACKET_IDLE;
-#endif
 }
 
 gdb_packet_s *gdb_packet_receive(void)
@@ -192,7 +187,6 @@ gdb_packet_s *gdb_packet_receive(void)
 				packet->size = 0;
 				packet->notification = false;
 			}
-#if CONFIG_BMDA == 0
 			else if (rx_char == REMOTE_SOM) {
 				/* Start of BMP remote packet */
 				/*
@@ -202,7 +196,6 @@ gdb_packet_s *gdb_packet_receive(void)
 				state = consume_remote_packet(packet->data, GDB_PACKET_BUFFER_SIZE);
 				packet->size = 0;
 			}
-#endif
 			/* EOT (end of transmission) - connection was closed */
 			else if (rx_char == '\x04') {
 				packet->data[1U] = '\0'; /* Null terminate */
@@ -375,20 +368,17 @@ void gdb_put_packet(const char *preamble, size_t preamble_size, const char *data
 
 	/* Add the data to the packet buffer and transform it if needed */
 	if (data != NULL && data_size > 0) {
-		/* Hex data doubles in size */
-		if (hex_data)
-			data_size *= 2U;
-
 		/* Limit the data size to the remaining space in the packet buffer */
 		const size_t remaining_size = GDB_PACKET_BUFFER_SIZE - packet->size;
-		data_size = MIN(data_size, remaining_size);
 
-		/* Copy the data into the packet buffer */
+		/* Copy the data into the packet buffer, hex data doubles in size */
 		if (hex_data)
-			hexify(packet->data + packet->size, data, data_size / 2U);
-		else
+			packet->size += hexify_bulk(packet->data + packet->size, remaining_size, data, data_size);
+		else {
+			data_size = MIN(data_size, remaining_size);
 			memcpy(packet->data + packet->size, data, data_size);
-		packet->size += data_size;
+			packet->size += data_size;
+		}
 	}
 
 	/* Transmit the packet */
@@ -25,55 +25,269 @@
 #include "general.h"
 #include "hex_utils.h"
 
+#if CONFIG_BMDA == 1
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HEX_UTILS_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HEX_UTILS_NEON
+#endif
+#endif
+
+/*
+ * Lookup tables for the codec. The encode table maps a byte to its two hex digits (high nibble first
+ * in memory), and the decode table maps an ASCII character to its nibble value or HEX_DIGIT_INVALID.
+ * Together these take 768 bytes of flash, and remove all the per-nibble branching.
+ */
+#define HEX_NIBBLE(value)   (char)((value) > 9U ? (value) + 'A' - 10U : (value) + '0')
+#define HEX_ENCODE2(value)  HEX_NIBBLE((value) >> 4U), HEX_NIBBLE((value) & 0xfU)
+#define HEX_ENCODE4(value) \
+	HEX_ENCODE2(value), HEX_ENCODE2((value) + 1U), HEX_ENCODE2((value) + 2U), HEX_ENCODE2((value) + 3U)
+#define HEX_ENCODE16(value) \
+	HEX_ENCODE4(value), HEX_ENCODE4((value) + 4U), HEX_ENCODE4((value) + 8U), HEX_ENCODE4((value) + 12U)
+#define HEX_ENCODE64(value) \
+	HEX_ENCODE16(value), HEX_ENCODE16((value) + 16U), HEX_ENCODE16((value) + 32U), HEX_ENCODE16((value) + 48U)
+
+static const char hex_encode_table[512U] = {
+	HEX_ENCODE64(0U),
+	HEX_ENCODE64(64U),
+	HEX_ENCODE64(128U),
+	HEX_ENCODE64(192U),
+};
+
+#define X HEX_DIGIT_INVALID
+static const uint8_t hex_decode_table[256U] = {
+	/* 0x00 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0x10 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0x20 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0x30 */ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, X, X, X, X, X, X,
+	/* 0x40 */ X, 10, 11, 12, 13, 14, 15, X, X, X, X, X, X, X, X, X,
+	/* 0x50 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0x60 */ X, 10, 11, 12, 13, 14, 15, X, X, X, X, X, X, X, X, X,
+	/* 0x70 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0x80 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0x90 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0xa0 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0xb0 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0xc0 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0xd0 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0xe0 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+	/* 0xf0 */ X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+};
+#undef X
+
 char hex_digit(const uint8_t value)
 {
-	char digit = (char)value;
-	if (value > 9U)
-		digit += 'A' - '0' - 10U;
-	digit += '0';
-	return digit;
+	return hex_encode_table[((value & 0xfU) << 1U) + 1U];
 }
 
+#if defined(HEX_UTILS_SSE2)
+/* Converts 16 nibbles (one per byte lane) to their ASCII hex digits */
+static inline __m128i hex_encode_nibbles_sse2(const __m128i nibbles)
+{
+	/* Lanes holding 10-15 need an extra 7 adding to go from ':'..'?' to 'A'..'F' */
+	const __m128i alpha = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+	return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), _mm_and_si128(alpha, _mm_set1_epi8(7)));
+}
+
+/*
+ * Converts 16 ASCII characters to their nibble values, accumulating into valid
+ * a mask of which lanes held a hex digit
+ */
+static inline __m128i hex_decode_chars_sse2(const __m128i chars, __m128i *const valid)
+{
+	/* SSE2 has no unsigned byte compare, so use min(x, n) == x to test x <= n */
+	const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+	const __m128i alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+	const __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+	*valid = _mm_and_si128(*valid, _mm_or_si128(is_digit, is_alpha));
+	return _mm_or_si128(
+		_mm_and_si128(is_digit, digit), _mm_andnot_si128(is_digit, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+/* Encodes blocks of 16 bytes to 32 characters, returning how many bytes were consumed */
+static size_t hexify_simd(char *const dst, const uint8_t *const src, const size_t size)
+{
+	const __m128i low_mask = _mm_set1_epi8(0x0f);
+	size_t offset = 0U;
+	for (; offset + 16U <= size; offset += 16U) {
+		const __m128i value = _mm_loadu_si128((const __m128i *)(src + offset));
+		const __m128i high = hex_encode_nibbles_sse2(_mm_and_si128(_mm_srli_epi16(value, 4), low_mask));
+		const __m128i low = hex_encode_nibbles_sse2(_mm_and_si128(value, low_mask));
+		/* Interleave so the high nibble's digit comes first for each byte */
+		_mm_storeu_si128((__m128i *)(dst + (offset * 2U)), _mm_unpacklo_epi8(high, low));
+		_mm_storeu_si128((__m128i *)(dst + (offset * 2U) + 16U), _mm_unpackhi_epi8(high, low));
+	}
+	return offset;
+}
+
+/*
+ * Decodes blocks of 32 characters to 16 bytes, returning how many bytes were produced.
+ * Stops early at the first block containing a non-hex character so the scalar path can deal with it.
+ */
+static size_t unhexify_simd(uint8_t *const dst, const char *const hex, const size_t size)
+{
+	size_t offset = 0U;
+	for (; offset + 16U <= size; offset += 16U) {
+		__m128i valid = _mm_set1_epi8(-1);
+		const __m128i first = hex_decode_chars_sse2(_mm_loadu_si128((const __m128i *)(hex + (offset * 2U))), &valid);
+		const __m128i second =
+			hex_decode_chars_sse2(_mm_loadu_si128((const __m128i *)(hex + (offset * 2U) + 16U)), &valid);
+		if (_mm_movemask_epi8(valid) != 0xffff)
+			break;
+		/*
+		 * Each 16-bit lane now holds the high nibble in its low byte and the low nibble in its high byte,
+		 * so recombine them into one byte per lane and then narrow the two halves together
+		 */
+		const __m128i first_bytes = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(first, _mm_set1_epi16(0x00ff)), 4),
+			_mm_srli_epi16(first, 8));
+		const __m128i second_bytes = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(second, _mm_set1_epi16(0x00ff)), 4),
+			_mm_srli_epi16(second, 8));
+		_mm_storeu_si128((__m128i *)(dst + offset), _mm_packus_epi16(first_bytes, second_bytes));
+	}
+	return offset;
+}
+#elif defined(HEX_UTILS_NEON)
+/* Converts 16 nibbles (one per byte lane) to their ASCII hex digits */
+static inline uint8x16_t hex_encode_nibbles_neon(const uint8x16_t nibbles)
+{
+	const uint8x16_t alpha = vandq_u8(vcgtq_u8(nibbles, vdupq_n_u8(9U)), vdupq_n_u8(7U));
+	return vaddq_u8(vaddq_u8(nibbles, vdupq_n_u8('0')), alpha);
+}
+
+/*
+ * Converts 16 ASCII characters to their nibble values, accumulating into valid
+ * a mask of which lanes held a hex digit
+ */
+static inline uint8x16_t hex_decode_chars_neon(const uint8x16_t chars, uint8x16_t *const valid)
+{
+	const uint8x16_t digit = vsubq_u8(chars, vdupq_n_u8('0'));
+	const uint8x16_t alpha = vsubq_u8(vorrq_u8(chars, vdupq_n_u8(0x20U)), vdupq_n_u8('a'));
+	const uint8x16_t is_digit = vcltq_u8(digit, vdupq_n_u8(10U));
+	const uint8x16_t is_alpha = vcltq_u8(alpha, vdupq_n_u8(6U));
+	*valid = vandq_u8(*valid, vorrq_u8(is_digit, is_alpha));
+	return vbslq_u8(is_digit, digit, vaddq_u8(alpha, vdupq_n_u8(10U)));
+}
+
+/* Encodes blocks of 16 bytes to 32 characters, returning how many bytes were consumed */
+static size_t hexify_simd(char *const dst, const uint8_t *const src, const size_t size)
+{
+	size_t offset = 0U;
+	for (; offset + 16U <= size; offset += 16U) {
+		const uint8x16_t value = vld1q_u8(src + offset);
+		uint8x16x2_t digits;
+		digits.val[0] = hex_encode_nibbles_neon(vshrq_n_u8(value, 4));
+		digits.val[1] = hex_encode_nibbles_neon(vandq_u8(value, vdupq_n_u8(0x0fU)));
+		/* The interleaving store puts the high nibble's digit first for each byte */
+		vst2q_u8((uint8_t *)dst + (offset * 2U), digits);
+	}
+	return offset;
+}
+
+/*
+ * Decodes blocks of 32 characters to 16 bytes, returning how many bytes were produced.
+ * Stops early at the first block containing a non-hex character so the scalar path can deal with it.
+ */
+static size_t unhexify_simd(uint8_t *const dst, const char *const hex, const size_t size)
+{
+	size_t offset = 0U;
+	for (; offset + 16U <= size; offset += 16U) {
+		/* The de-interleaving load splits the high nibble digits from the low nibble digits */
+		const uint8x16x2_t chars = vld2q_u8((const uint8_t *)hex + (offset * 2U));
+		uint8x16_t valid = vdupq_n_u8(0xffU);
+		const uint8x16_t high = hex_decode_chars_neon(chars.val[0], &valid);
+		const uint8x16_t low = hex_decode_chars_neon(chars.val[1], &valid);
+		/* Reduce the validity mask down to a single lane to check every character was a hex digit */
+		uint8x8_t valid_min = vpmin_u8(vget_low_u8(valid), vget_high_u8(valid));
+		valid_min = vpmin_u8(valid_min, valid_min);
+		valid_min = vpmin_u8(valid_min, valid_min);
+		valid_min = vpmin_u8(valid_min, valid_min);
+		if (vget_lane_u8(valid_min, 0) != 0xffU)
+			break;
+		vst1q_u8(dst + offset, vorrq_u8(vshlq_n_u8(high, 4), low));
+	}
+	return offset;
+}
+#else
+static inline size_t hexify_simd(char *const dst, const uint8_t *const src, const size_t size)
+{
+	(void)dst;
+	(void)src;
+	(void)size;
+	return 0U;
+}
+
+static inline size_t unhexify_simd(uint8_t *const dst, const char *const hex, const size_t size)
+{
+	(void)dst;
+	(void)hex;
+	(void)size;
+	return 0U;
+}
+#endif
+
 char *hexify(char *const dst, const void *const buf, const size_t size)
 {
 	/*
-	 * Convert the source buffer to something we can work with and define a
-	 * counter for the destination buffer indexing
+	 * Convert the source buffer to something we can work with, and let the vector
+	 * implementation (if any) chew through as much of the buffer as it can
 	 */
 	const uint8_t *const src = (const uint8_t *)buf;
-	size_t dst_idx = 0U;
+	size_t src_idx = hexify_simd(dst, src, size);
 
 	/*
-	 * Loop through each byte in the input buffer and convert it to hex,
+	 * Loop through each remaining byte in the input buffer and convert it to hex,
 	 * writing it to consecutive pairs of bytes in the destination
 	 */
-	for (size_t src_idx = 0U; src_idx < size; ++src_idx) {
-		dst[dst_idx++] = hex_digit(src[src_idx] >> 4U);
-		dst[dst_idx++] = hex_digit(src[src_idx] & 0xfU);
-	}
+	for (; src_idx < size; ++src_idx)
+		memcpy(dst + (src_idx * 2U), hex_encode_table + (src[src_idx] * 2U), 2U);
 
-	/* The hexifued string is *NOT* NUL terminated */
+	/* The hexified string is *NOT* NUL terminated */
 	return dst;
 }
 
+size_t hexify_bulk(char *const dst, const size_t dst_size, const void *const buf, const size_t size)
+{
+	/* Only convert as many whole bytes as will fit in the destination */
+	const size_t count = MIN(size, dst_size / 2U);
+	hexify(dst, buf, count);
+	return count * 2U;
+}
+
 uint8_t unhex_digit(const char hex)
 {
-	uint8_t tmp = hex - '0';
-	if (tmp > 9U)
-		tmp -= 'A' - '0' - 10U;
-	if (tmp > 16U)
-		tmp -= 'a' - 'A';
-	return tmp;
+	return hex_decode_table[(uint8_t)hex];
 }
 
-char *unhexify(void *const buf, const char *hex, const size_t size)
+char *unhexify(void *const buf, const char *const hex, const size_t size)
 {
-	uint8_t *const dst = buf;
-	for (size_t idx = 0; idx < size; ++idx, hex += 2U)
-		dst[idx] = (unhex_digit(hex[0]) << 4U) | unhex_digit(hex[1]);
+	uint8_t *const dst = (uint8_t *)buf;
+	size_t idx = unhexify_simd(dst, hex, size);
+	/* Deal with any remainder and any block the vector implementation rejected */
+	for (; idx < size; ++idx) {
+		const uint8_t high = hex_decode_table[(uint8_t)hex[idx * 2U]];
+		const uint8_t low = hex_decode_table[(uint8_t)hex[(idx * 2U) + 1U]];
+		dst[idx] = (uint8_t)(high << 4U) | (low & 0xfU);
+	}
 	return buf;
 }
 
+bool unhexify_checked(void *const buf, const char *const hex, const size_t size)
+{
+	uint8_t *const dst = (uint8_t *)buf;
+	for (size_t idx = unhexify_simd(dst, hex, size); idx < size; ++idx) {
+		const uint8_t high = hex_decode_table[(uint8_t)hex[idx * 2U]];
+		const uint8_t low = hex_decode_table[(uint8_t)hex[(idx * 2U) + 1U]];
+		/* Both nibbles being valid means neither can have the top bit set */
+		if ((high | low) & 0xf0U)
+			return false;
+		dst[idx] = (uint8_t)(high << 4U) | low;
+	}
+	return true;
+}
+
 uint64_t hex_string_to_num(const size_t max_digits, const char *const str)
 {
 	uint64_t ret = 0;
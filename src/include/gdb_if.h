@@ -34,4 +34,9 @@ char gdb_if_getchar_to(uint32_t timeout);
 void gdb_if_putchar(char c, bool flush);
 void gdb_if_flush(bool force);
 
+#if CONFIG_BMDA == 1
+/* Account for a BMP remote protocol packet having been served on the current connection */
+void gdb_if_count_remote_packet(void);
+#endif
+
 #endif /* INCLUDE_GDB_IF_H */
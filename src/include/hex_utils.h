@@ -25,10 +25,22 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+/* Value returned by unhex_digit() for characters that are not hex digits */
+#define HEX_DIGIT_INVALID 0xffU
 
 char *hexify(char *hex, const void *buf, size_t size);
 char *unhexify(void *buf, const char *hex, size_t size);
 
+/*
+ * Bulk variant of hexify() for writing straight into a bounded packet buffer.
+ * Converts as many whole bytes as fit in hex_size characters and returns the number of characters written.
+ */
+size_t hexify_bulk(char *hex, size_t hex_size, const void *buf, size_t size);
+/* Like unhexify(), but returns false if any of the 2 * size input characters is not a hex digit */
+bool unhexify_checked(void *buf, const char *hex, size_t size);
+
 char hex_digit(uint8_t value);
 uint8_t unhex_digit(char hex);
 
@@ -36,7 +48,7 @@ uint64_t hex_string_to_num(size_t max_digits, const char *str);
 
 static inline bool is_hex(const char x)
 {
-	return (x >= '0' && x <= '9') || (x >= 'A' && x <= 'F') || (x >= 'a' && x <= 'f');
+	return unhex_digit(x) != HEX_DIGIT_INVALID;
 }
 
 #define READ_HEX_NO_FOLLOW '\xff'
@@ -0,0 +1,66 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INCLUDE_LIVE_WATCH_H
+#define INCLUDE_LIVE_WATCH_H
+
+#include "target.h"
+
+#define LIVE_WATCH_MAX_RANGES  8U
+#define LIVE_WATCH_MAX_LENGTH  64U
+#define LIVE_WATCH_MAX_RATE_HZ 1000U
+
+typedef struct live_watch_range {
+	uint32_t addr;
+	uint8_t length;
+	bool valid;                            /* Whether shadow holds the data from a previous sample */
+	uint8_t shadow[LIVE_WATCH_MAX_LENGTH]; /* Last values sent, so only changes need sending */
+} live_watch_range_s;
+
+extern bool live_watch_enabled;                                     // sampling on/off
+extern uint32_t live_watch_rate_hz;                                 // samples per second
+extern size_t live_watch_range_count;                               // number of ranges configured
+extern live_watch_range_s live_watch_ranges[LIVE_WATCH_MAX_RANGES]; // ranges to sample
+extern uint32_t live_watch_samples;                                 // number of samples taken
+extern uint32_t live_watch_overruns;                                // number of sample periods missed
+extern uint32_t live_watch_errors;                                  // number of failed range reads
+
+bool live_watch_add(uint32_t addr, size_t length);
+void live_watch_clear(void);
+void live_watch_restart(void);
+#if CONFIG_BMDA == 1
+bool live_watch_set_file(const char *path);
+#endif
+
+void poll_live_watch(target_s *cur_target);
+
+#endif /* INCLUDE_LIVE_WATCH_H */
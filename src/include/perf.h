@@ -0,0 +1,102 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef INCLUDE_PERF_H
+#define INCLUDE_PERF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Bucket 0 of a latency histogram counts operations that took under 1µs, bucket n those that took
+ * from 2^(n-1) up to 2^n µs, and the last bucket everything slower than that.
+ */
+#define PERF_HISTOGRAM_BUCKETS 20U
+
+typedef enum perf_metric {
+	PERF_SWD_TRANSACTION,  /* SWD transactions at the wire level, WAIT retries counting as part of them */
+	PERF_SWD_WAIT,         /* SWD WAIT acknowledgements */
+	PERF_SWD_FAULT,        /* SWD FAULT acknowledgements */
+	PERF_JTAG_TRANSACTION, /* JTAG-DP DPACC/APACC transactions, WAIT retries counting as part of them */
+	PERF_JTAG_WAIT,        /* JTAG-DP WAIT acknowledgements */
+	PERF_DP_ACCESS,        /* ADIv5 DP register accesses */
+	PERF_AP_ACCESS,        /* ADIv5 AP register accesses */
+	PERF_MEM_READ,         /* Target memory reads, amount in bytes */
+	PERF_MEM_WRITE,        /* Target memory writes, amount in bytes */
+	PERF_PROBE_ROUND_TRIP, /* Requests to a probe over USB or serial and the wait for its response */
+	PERF_FLASH_ERASE,      /* Flash block erases, amount in bytes */
+	PERF_FLASH_WRITE,      /* Flash program operations, amount in bytes */
+	PERF_METRIC_COUNT,
+} perf_metric_e;
+
+typedef struct perf_metric_data {
+	uint32_t count;                             /* Number of operations */
+	uint64_t amount;                            /* Total of the amounts recorded, such as bytes moved */
+	uint64_t time_us;                           /* Total time spent in the operations that were timed */
+	uint32_t histogram[PERF_HISTOGRAM_BUCKETS]; /* log2 latency histogram of the timed operations */
+} perf_metric_data_s;
+
+#ifdef ENABLE_PERF
+extern perf_metric_data_s perf_metrics[PERF_METRIC_COUNT];
+extern const char *const perf_metric_names[PERF_METRIC_COUNT];
+
+/* Returns a free-running microsecond timestamp to pass to perf_record() */
+uint32_t perf_now(void);
+void perf_count(perf_metric_e metric, uint32_t amount);
+void perf_record(perf_metric_e metric, uint32_t start, uint32_t amount);
+void perf_reset(void);
+#if CONFIG_BMDA == 1
+bool perf_write_json(const char *path);
+#endif
+#else
+/* With the counters compiled out these all become no-ops so the call sites need no conditionals */
+static inline uint32_t perf_now(void)
+{
+	return 0U;
+}
+
+static inline void perf_count(const perf_metric_e metric, const uint32_t amount)
+{
+	(void)metric;
+	(void)amount;
+}
+
+static inline void perf_record(const perf_metric_e metric, const uint32_t start, const uint32_t amount)
+{
+	(void)metric;
+	(void)start;
+	(void)amount;
+}
+#endif
+
+#endif /* INCLUDE_PERF_H */
@@ -25,6 +25,21 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+/* The RnW bit of an SWD packet request */
+#define SWD_REQUEST_RNW 0x04U
+
+/* A single SWD transaction, as run by swd_proc.batch */
+typedef struct swd_transaction {
+	/* The packet request to send, as built by make_packet_request() */
+	uint8_t request;
+	/* The ACK the target responded with */
+	uint8_t ack;
+	/* For reads, whether the data phase passed its parity check */
+	bool parity_ok;
+	/* The data to write, or the data read back */
+	uint32_t data;
+} swd_transaction_s;
+
 /* Functions interface talking SWD */
 typedef struct swd_proc {
 	/* Perform a clock_cycles read */
@@ -35,6 +50,13 @@ typedef struct swd_proc {
 	void (*seq_out)(uint32_t tms_states, size_t clock_cycles);
 	/* Perform a clock_cycles write + parity with the provided data */
 	void (*seq_out_parity)(uint32_t tms_states, size_t clock_cycles);
+	/*
+	 * Optionally, perform count transactions back to back filling in their ACKs and read data.
+	 * This assumes the DP has CTRL/STAT.ORUNDETECT set, so every transaction has a data phase
+	 * regardless of its ACK and no per-transaction decisions need to be made. Returns false
+	 * if the adaptor failed to perform the transactions.
+	 */
+	bool (*batch)(swd_transaction_s *transactions, size_t count);
 } swd_proc_s;
 
 extern swd_proc_s swd_proc;
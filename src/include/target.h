@@ -68,6 +68,7 @@ bool target_mem64_write(target_s *target, target_addr64_t dest, const void *src,
 bool target_mem_access_needs_halt(target_s *target);
 /* Flash memory access functions */
 bool target_flash_erase(target_s *target, target_addr_t addr, size_t len);
+bool target_flash_erase_deferred(target_s *target, target_addr_t addr, size_t len);
 bool target_flash_write(target_s *target, target_addr_t dest, const void *src, size_t len);
 bool target_flash_complete(target_s *target);
 bool target_flash_mass_erase(target_s *target);
@@ -0,0 +1,240 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements live watch, which samples a set of address ranges on a running target at a fixed
+ * rate using memory accesses that do not halt the core, and streams whatever changed out over the aux
+ * serial channel (or, under BMDA, to a file) so the values can be plotted as the target runs.
+ *
+ * The aux channel is shared with other output (RTT text on the probe, debug messages under BMDA), so the
+ * records from each sample are sent as a frame that a reader can pick out of the surrounding bytes:
+ *  0xa5 0x5a length(u16) records checksum(u8)       checksum is the 8-bit sum of the length and record bytes
+ *
+ * The records are, with all multi-byte values being little endian:
+ *  'D' index(u8) address(u32) length(u8)            describes a range, sent whenever sampling (re)starts
+ *  'S' time(u32) index(u8) offset(u8) count(u8) data  the bytes of a range that changed, time in ms
+ *  'E' time(u32) index(u8)                          reading the range failed
+ * A range's first sample after its description always includes all of its bytes.
+ */
+
+#include "general.h"
+#include "platform.h"
+#include "target.h"
+#include "buffer_utils.h"
+#include "rtt_if.h"
+#include "live_watch.h"
+
+#define LIVE_WATCH_RECORD_DESCRIBE 'D'
+#define LIVE_WATCH_RECORD_SAMPLE   'S'
+#define LIVE_WATCH_RECORD_ERROR    'E'
+
+#define LIVE_WATCH_DESCRIBE_LENGTH 7U
+#define LIVE_WATCH_SAMPLE_LENGTH   8U
+#define LIVE_WATCH_ERROR_LENGTH    6U
+
+#define LIVE_WATCH_FRAME_SYNC0   0xa5U
+#define LIVE_WATCH_FRAME_SYNC1   0x5aU
+#define LIVE_WATCH_FRAME_HEADER  4U
+#define LIVE_WATCH_FRAME_TRAILER 1U
+
+bool live_watch_enabled = false;
+uint32_t live_watch_rate_hz = 100U;
+size_t live_watch_range_count = 0U;
+live_watch_range_s live_watch_ranges[LIVE_WATCH_MAX_RANGES];
+uint32_t live_watch_samples = 0U;
+uint32_t live_watch_overruns = 0U;
+uint32_t live_watch_errors = 0U;
+
+/* When the next sample is due, and the fraction of a millisecond the sampling grid is behind that by */
+static uint32_t next_sample_ms = 0U;
+static uint32_t next_sample_fraction = 0U;
+static bool describe_ranges = true;
+/* Large enough for a frame holding a description and a full sample for every range */
+static uint8_t record_buffer[LIVE_WATCH_FRAME_HEADER +
+	(LIVE_WATCH_MAX_RANGES * (LIVE_WATCH_DESCRIBE_LENGTH + LIVE_WATCH_SAMPLE_LENGTH + LIVE_WATCH_MAX_LENGTH)) +
+	LIVE_WATCH_FRAME_TRAILER];
+
+#if CONFIG_BMDA == 1
+static FILE *live_watch_file = NULL;
+
+bool live_watch_set_file(const char *const path)
+{
+	if (live_watch_file)
+		fclose(live_watch_file);
+	live_watch_file = NULL;
+	/* An empty path switches back to the aux channel (stdout) */
+	if (path && path[0] != '\0') {
+		live_watch_file = fopen(path, "wb");
+		if (!live_watch_file)
+			return false;
+	}
+	live_watch_restart();
+	return true;
+}
+#endif
+
+/* Frame up the records in record_buffer and send them */
+static void live_watch_write(const size_t records_length)
+{
+	if (!records_length)
+		return;
+	uint8_t *const data = record_buffer;
+	data[0] = LIVE_WATCH_FRAME_SYNC0;
+	data[1] = LIVE_WATCH_FRAME_SYNC1;
+	write_le2(data, 2U, (uint16_t)records_length);
+	uint8_t checksum = 0U;
+	for (size_t i = 2U; i < LIVE_WATCH_FRAME_HEADER + records_length; ++i)
+		checksum += data[i];
+	data[LIVE_WATCH_FRAME_HEADER + records_length] = checksum;
+	const size_t length = LIVE_WATCH_FRAME_HEADER + records_length + LIVE_WATCH_FRAME_TRAILER;
+#if CONFIG_BMDA == 1
+	if (live_watch_file) {
+		fwrite(data, 1U, length, live_watch_file);
+		fflush(live_watch_file);
+		return;
+	}
+#endif
+	rtt_write(0U, (const char *)data, length);
+}
+
+bool live_watch_add(const uint32_t addr, const size_t length)
+{
+	if (live_watch_range_count == LIVE_WATCH_MAX_RANGES || !length || length > LIVE_WATCH_MAX_LENGTH)
+		return false;
+	live_watch_range_s *const range = &live_watch_ranges[live_watch_range_count++];
+	range->addr = addr;
+	range->length = (uint8_t)length;
+	live_watch_restart();
+	return true;
+}
+
+void live_watch_clear(void)
+{
+	live_watch_range_count = 0U;
+	live_watch_restart();
+}
+
+/* Make the next poll describe all the ranges again and send their values in full */
+void live_watch_restart(void)
+{
+	for (size_t i = 0U; i < live_watch_range_count; ++i)
+		live_watch_ranges[i].valid = false;
+	describe_ranges = true;
+	live_watch_samples = 0U;
+	live_watch_overruns = 0U;
+	live_watch_errors = 0U;
+}
+
+static size_t live_watch_sample_range(
+	target_s *const target, const size_t index, const uint32_t now, uint8_t *const record)
+{
+	live_watch_range_s *const range = &live_watch_ranges[index];
+	uint8_t data[LIVE_WATCH_MAX_LENGTH];
+	if (target_mem32_read(target, data, range->addr, range->length)) {
+		++live_watch_errors;
+		record[0] = LIVE_WATCH_RECORD_ERROR;
+		write_le4(record, 1U, now);
+		record[5] = (uint8_t)index;
+		return LIVE_WATCH_ERROR_LENGTH;
+	}
+
+	/* Find the span of bytes that changed since the last sample, if any */
+	size_t start = 0U;
+	size_t end = range->length;
+	if (range->valid) {
+		while (start < end && data[start] == range->shadow[start])
+			++start;
+		while (end > start && data[end - 1U] == range->shadow[end - 1U])
+			--end;
+		if (start == end)
+			return 0U;
+	}
+	memcpy(range->shadow + start, data + start, end - start);
+	range->valid = true;
+
+	record[0] = LIVE_WATCH_RECORD_SAMPLE;
+	write_le4(record, 1U, now);
+	record[5] = (uint8_t)index;
+	record[6] = (uint8_t)start;
+	record[7] = (uint8_t)(end - start);
+	memcpy(record + LIVE_WATCH_SAMPLE_LENGTH, data + start, end - start);
+	return LIVE_WATCH_SAMPLE_LENGTH + (end - start);
+}
+
+void poll_live_watch(target_s *const cur_target)
+{
+	/* Only sample targets whose memory can be read without halting them, so their timing isn't disturbed */
+	if (!cur_target || !live_watch_enabled || !live_watch_range_count || target_mem_access_needs_halt(cur_target))
+		return;
+
+	const uint32_t now = platform_time_ms();
+	const uint32_t rate = MIN(MAX(live_watch_rate_hz, 1U), LIVE_WATCH_MAX_RATE_HZ);
+	if (!live_watch_samples) {
+		next_sample_ms = now;
+		next_sample_fraction = 0U;
+	} else if ((int32_t)(now - next_sample_ms) < 0)
+		return;
+	/*
+	 * Move the grid on a period, which is 1000 / rate ms. The remainder of that division is carried in
+	 * next_sample_fraction (in units of 1 / rate ms) so that the average rate is exactly what was asked for.
+	 */
+	next_sample_ms += 1000U / rate;
+	next_sample_fraction = (next_sample_fraction % rate) + (1000U % rate);
+	if (next_sample_fraction >= rate) {
+		next_sample_fraction -= rate;
+		++next_sample_ms;
+	}
+	/* If we've fallen behind the grid by a whole period or more, note the missed samples and resync */
+	if ((int32_t)(now - next_sample_ms) >= 0) {
+		live_watch_overruns += (((now - next_sample_ms) * rate) / 1000U) + 1U;
+		next_sample_ms = now + (1000U / rate);
+		next_sample_fraction = 0U;
+	}
+	++live_watch_samples;
+
+	size_t offset = LIVE_WATCH_FRAME_HEADER;
+	if (describe_ranges) {
+		for (size_t i = 0U; i < live_watch_range_count; ++i) {
+			uint8_t *const record = record_buffer + offset;
+			record[0] = LIVE_WATCH_RECORD_DESCRIBE;
+			record[1] = (uint8_t)i;
+			write_le4(record, 2U, live_watch_ranges[i].addr);
+			record[6] = live_watch_ranges[i].length;
+			offset += LIVE_WATCH_DESCRIBE_LENGTH;
+		}
+		describe_ranges = false;
+	}
+	for (size_t i = 0U; i < live_watch_range_count; ++i)
+		offset += live_watch_sample_range(cur_target, i, now, record_buffer + offset);
+	/* Send everything from this sample in one go */
+	live_watch_write(offset - LIVE_WATCH_FRAME_HEADER);
+}
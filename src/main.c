@@ -32,6 +32,9 @@
 #ifdef ENABLE_RTT
 #include "rtt.h"
 #endif
+#ifdef ENABLE_LIVE_WATCH
+#include "live_watch.h"
+#endif
 
 static void bmp_poll_loop(void)
 {
@@ -50,6 +53,10 @@ static void bmp_poll_loop(void)
 #ifdef ENABLE_RTT
 		if (rtt_enabled)
 			poll_rtt(cur_target);
+#endif
+#ifdef ENABLE_LIVE_WATCH
+		if (live_watch_enabled)
+			poll_live_watch(cur_target);
 #endif
 	}
 
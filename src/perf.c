@@ -0,0 +1,127 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements the performance counters, which count the operations done at each layer of the
+ * stack (the SWD/JTAG wire, DP/AP accesses, target memory, probe round trips and Flash) and keep a log2
+ * histogram of how long they took. They are read out with `monitor perf` and, under BMDA, can be written
+ * out as JSON on exit. In the firmware timestamps come from the millisecond system tick, so only the
+ * slower operations such as Flash erases get anything other than the first histogram bucket.
+ */
+
+#include "general.h"
+#include "platform.h"
+#include "perf.h"
+
+#if CONFIG_BMDA == 1
+#include <stdio.h>
+#include <inttypes.h>
+#include "timeofday.h"
+#include "bmp_hosted.h"
+#endif
+
+perf_metric_data_s perf_metrics[PERF_METRIC_COUNT];
+
+const char *const perf_metric_names[PERF_METRIC_COUNT] = {
+	"swd_transactions",
+	"swd_waits",
+	"swd_faults",
+	"jtag_transactions",
+	"jtag_waits",
+	"dp_accesses",
+	"ap_accesses",
+	"mem_reads",
+	"mem_writes",
+	"probe_round_trips",
+	"flash_erases",
+	"flash_writes",
+};
+
+uint32_t perf_now(void)
+{
+#if CONFIG_BMDA == 1
+	timeval_s now;
+	gettimeofday(&now, NULL);
+	return ((uint32_t)now.tv_sec * 1000000U) + (uint32_t)now.tv_usec;
+#else
+	return platform_time_ms() * 1000U;
+#endif
+}
+
+void perf_count(const perf_metric_e metric, const uint32_t amount)
+{
+	perf_metric_data_s *const data = &perf_metrics[metric];
+	++data->count;
+	data->amount += amount;
+}
+
+void perf_record(const perf_metric_e metric, const uint32_t start, const uint32_t amount)
+{
+	const uint32_t elapsed = perf_now() - start;
+	perf_count(metric, amount);
+	perf_metric_data_s *const data = &perf_metrics[metric];
+	data->time_us += elapsed;
+	size_t bucket = 0U;
+	while (bucket + 1U < PERF_HISTOGRAM_BUCKETS && elapsed >= (1U << bucket))
+		++bucket;
+	++data->histogram[bucket];
+}
+
+void perf_reset(void)
+{
+	memset(perf_metrics, 0, sizeof(perf_metrics));
+}
+
+#if CONFIG_BMDA == 1
+bool perf_write_json(const char *const path)
+{
+	FILE *const file = fopen(path, "w");
+	if (!file) {
+		DEBUG_ERROR("Failed to open %s for writing the performance counters\n", path);
+		return false;
+	}
+	fprintf(file, "{\n");
+	for (size_t metric = 0U; metric < PERF_METRIC_COUNT; ++metric) {
+		const perf_metric_data_s *const data = &perf_metrics[metric];
+		fprintf(file,
+			"\t\"%s\": {\"count\": %" PRIu32 ", \"amount\": %" PRIu64 ", \"time_us\": %" PRIu64 ", \"histogram\": [",
+			perf_metric_names[metric], data->count, data->amount, data->time_us);
+		for (size_t bucket = 0U; bucket < PERF_HISTOGRAM_BUCKETS; ++bucket)
+			fprintf(file, "%s%" PRIu32, bucket ? ", " : "", data->histogram[bucket]);
+		fprintf(file, "]}%s\n", metric + 1U < PERF_METRIC_COUNT ? "," : "");
+	}
+	fprintf(file, "}\n");
+	const bool result = !ferror(file);
+	fclose(file);
+	return result;
+}
+#endif
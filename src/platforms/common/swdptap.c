@@ -45,6 +45,7 @@ static uint32_t swdptap_seq_in(size_t clock_cycles) __attribute__((optimize(3)))
 static bool swdptap_seq_in_parity(uint32_t *ret, size_t clock_cycles) __attribute__((optimize(3)));
 static void swdptap_seq_out(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
 static void swdptap_seq_out_parity(uint32_t tms_states, size_t clock_cycles) __attribute__((optimize(3)));
+static bool swdptap_batch(swd_transaction_s *transactions, size_t count);
 
 /*
  * Overall strategy for timing consistency:
@@ -64,6 +65,7 @@ void swdptap_init(void)
 	swd_proc.seq_in_parity = swdptap_seq_in_parity;
 	swd_proc.seq_out = swdptap_seq_out;
 	swd_proc.seq_out_parity = swdptap_seq_out_parity;
+	swd_proc.batch = swdptap_batch;
 }
 
 static void swdptap_turnaround(const swdio_status_t dir)
@@ -265,3 +267,23 @@ static void swdptap_seq_out_parity(const uint32_t tms_states, const size_t clock
 		continue;
 	gpio_clear(SWCLK_PORT, SWCLK_PIN);
 }
+
+/*
+ * Run a batch of transactions with overrun detection on, which means each one has a data phase
+ * no matter the ACK, so we don't have to inspect the ACKs until the batch is done
+ */
+static bool swdptap_batch(swd_transaction_s *const transactions, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		swd_transaction_s *const transaction = &transactions[i];
+		swdptap_seq_out(transaction->request, 8U);
+		transaction->ack = swdptap_seq_in(3U);
+		if (transaction->request & SWD_REQUEST_RNW)
+			transaction->parity_ok = swdptap_seq_in_parity(&transaction->data, 32U);
+		else
+			swdptap_seq_out_parity(transaction->data, 32U);
+		/* Finish the transaction with 8 idle cycles as adiv5_swd_raw_access() does */
+		swdptap_seq_out(0U, 8U);
+	}
+	return true;
+}
@@ -0,0 +1,265 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements BMDA's debug link benchmark, which measures the throughput of the
+ * memory, Flash, CRC and register access paths against an attached target. When run against
+ * the simulated probe, it also reports how many DP/AP transactions and probe round trips
+ * each operation took, which is independent of the host and so suitable for comparisons.
+ */
+
+#include "general.h"
+#include <string.h>
+#include <sys/time.h>
+
+#include "target_internal.h"
+#include "crc32.h"
+#include "bmp_hosted.h"
+#include "platform.h"
+#include "benchmark.h"
+#include "sim.h"
+
+#define BENCHMARK_MAX_LENGTH  (16U * 1024U)
+#define BENCHMARK_CHUNK_SIZE  1024U
+#define BENCHMARK_RAM_ROUNDS  8U
+#define BENCHMARK_REGS_ROUNDS 64U
+
+typedef struct benchmark_sample {
+	timeval_s time;
+	sim_stats_s stats;
+} benchmark_sample_s;
+
+static void benchmark_sample(benchmark_sample_s *const sample)
+{
+	if (bmda_probe_info.type == PROBE_TYPE_SIM)
+		sim_stats_read(&sample->stats);
+	else
+		memset(&sample->stats, 0, sizeof(sample->stats));
+	gettimeofday(&sample->time, NULL);
+}
+
+static void benchmark_report(
+	const char *const name, const size_t bytes, const size_t ops, const benchmark_sample_s *const start)
+{
+	benchmark_sample_s end;
+	benchmark_sample(&end);
+	const uint64_t elapsed_us = (uint64_t)(end.time.tv_sec - start->time.tv_sec) * 1000000U +
+		(uint64_t)(end.time.tv_usec - start->time.tv_usec);
+	/* Throughput and per-op counts are worked out in tenths so they can be displayed to one decimal place */
+	const uint64_t rate = ((uint64_t)bytes * 10000000U) / (1024U * (elapsed_us ? elapsed_us : 1U));
+	DEBUG_WARN("%-12s %7zu bytes in %5" PRIu64 ".%03" PRIu64 "ms: %8" PRIu64 ".%" PRIu64 "kiB/s", name, bytes,
+		elapsed_us / 1000U, elapsed_us % 1000U, rate / 10U, rate % 10U);
+	if (bmda_probe_info.type == PROBE_TYPE_SIM) {
+		const uint64_t divisor = ops ? ops : 1U;
+		const uint64_t transactions = ((end.stats.transactions - start->stats.transactions) * 10U) / divisor;
+		const uint64_t requests = ((end.stats.requests - start->stats.requests) * 10U) / divisor;
+		DEBUG_WARN(", %6" PRIu64 ".%" PRIu64 " transactions/op, %4" PRIu64 ".%" PRIu64 " requests/op",
+			transactions / 10U, transactions % 10U, requests / 10U, requests % 10U);
+	}
+	DEBUG_WARN("\n");
+}
+
+static void benchmark_fill(uint8_t *const data, const size_t length, uint32_t seed)
+{
+	/* xorshift32, so the data is not trivially compressible but is reproducible */
+	for (size_t i = 0; i < length; ++i) {
+		seed ^= seed << 13U;
+		seed ^= seed >> 17U;
+		seed ^= seed << 5U;
+		data[i] = (uint8_t)seed;
+	}
+}
+
+static bool benchmark_ram(target_s *const target, uint8_t *const pattern, uint8_t *const buffer)
+{
+	const target_ram_s *const ram = target->ram;
+	if (!ram) {
+		DEBUG_WARN("No RAM regions, skipping memory benchmarks\n");
+		return true;
+	}
+	const size_t length = MIN(ram->length, BENCHMARK_MAX_LENGTH);
+	benchmark_fill(pattern, length, 0x12345678U);
+
+	benchmark_sample_s start;
+	benchmark_sample(&start);
+	for (size_t round = 0; round < BENCHMARK_RAM_ROUNDS; ++round) {
+		for (size_t offset = 0; offset < length; offset += BENCHMARK_CHUNK_SIZE) {
+			if (target_mem32_write(
+					target, ram->start + offset, pattern + offset, MIN(length - offset, BENCHMARK_CHUNK_SIZE))) {
+				DEBUG_ERROR("RAM write failed at 0x%08" PRIx32 "\n", (uint32_t)(ram->start + offset));
+				return false;
+			}
+		}
+	}
+	const size_t chunks = BENCHMARK_RAM_ROUNDS * ((length + BENCHMARK_CHUNK_SIZE - 1U) / BENCHMARK_CHUNK_SIZE);
+	benchmark_report("mem write", BENCHMARK_RAM_ROUNDS * length, chunks, &start);
+
+	benchmark_sample(&start);
+	for (size_t round = 0; round < BENCHMARK_RAM_ROUNDS; ++round) {
+		for (size_t offset = 0; offset < length; offset += BENCHMARK_CHUNK_SIZE) {
+			if (target_mem32_read(
+					target, buffer + offset, ram->start + offset, MIN(length - offset, BENCHMARK_CHUNK_SIZE))) {
+				DEBUG_ERROR("RAM read failed at 0x%08" PRIx32 "\n", (uint32_t)(ram->start + offset));
+				return false;
+			}
+		}
+	}
+	benchmark_report("mem read", BENCHMARK_RAM_ROUNDS * length, chunks, &start);
+	if (memcmp(pattern, buffer, length) != 0) {
+		DEBUG_ERROR("RAM read back does not match what was written\n");
+		return false;
+	}
+
+	/* Unaligned accesses take the byte and halfword paths */
+	if (length <= 4U) {
+		DEBUG_WARN("RAM region too small, skipping unaligned memory benchmark\n");
+		return true;
+	}
+	benchmark_sample(&start);
+	if (target_mem32_write(target, ram->start + 1U, pattern, length - 4U) ||
+		target_mem32_read(target, buffer, ram->start + 1U, length - 4U)) {
+		DEBUG_ERROR("Unaligned RAM access failed\n");
+		return false;
+	}
+	benchmark_report("mem unalign", 2U * (length - 4U), 2U, &start);
+	if (memcmp(pattern, buffer, length - 4U) != 0) {
+		DEBUG_ERROR("Unaligned RAM read back does not match what was written\n");
+		return false;
+	}
+	return true;
+}
+
+static target_flash_s *benchmark_lowest_flash(target_s *const target)
+{
+	target_flash_s *lowest = target->flash;
+	for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
+		if (flash->start < lowest->start)
+			lowest = flash;
+	}
+	return lowest;
+}
+
+static bool benchmark_flash(target_s *const target, uint8_t *const pattern, uint8_t *const buffer)
+{
+	const target_flash_s *const flash = benchmark_lowest_flash(target);
+	if (!flash) {
+		DEBUG_WARN("No Flash regions, skipping Flash and CRC benchmarks\n");
+		return true;
+	}
+	const size_t length = MIN(flash->length, MAX(BENCHMARK_MAX_LENGTH, flash->blocksize));
+	uint8_t *const data = length > BENCHMARK_MAX_LENGTH ? malloc(length) : pattern;
+	if (!data) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	benchmark_fill(data, length, 0x9abcdef0U);
+
+	benchmark_sample_s start;
+	benchmark_sample(&start);
+	bool result = target_flash_erase(target, flash->start, length);
+	if (result)
+		benchmark_report("flash erase", length, 1U, &start);
+
+	benchmark_sample(&start);
+	result = result && target_flash_write(target, flash->start, data, length) && target_flash_complete(target);
+	if (!result) {
+		DEBUG_ERROR("Flash erase/write failed\n");
+		if (data != pattern)
+			free(data);
+		return false;
+	}
+	benchmark_report("flash write", length, 1U, &start);
+
+	uint8_t *const readback = data != pattern ? malloc(length) : buffer;
+	result = readback && !target_mem32_read(target, readback, flash->start, length) &&
+		memcmp(data, readback, length) == 0;
+	if (!result)
+		DEBUG_ERROR("Flash read back does not match what was written\n");
+	if (data != pattern) {
+		free(readback);
+		free(data);
+	}
+	if (!result)
+		return false;
+
+	uint32_t crc = 0;
+	benchmark_sample(&start);
+	if (!bmd_crc32(target, &crc, flash->start, length)) {
+		DEBUG_ERROR("CRC calculation failed\n");
+		return false;
+	}
+	benchmark_report("crc32", length, 1U, &start);
+	return true;
+}
+
+static bool benchmark_registers(target_s *const target)
+{
+	const size_t regs_size = target_regs_size(target);
+	if (!regs_size)
+		return true;
+	uint8_t *const regs = malloc(regs_size);
+	if (!regs) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	benchmark_sample_s start;
+	benchmark_sample(&start);
+	for (size_t round = 0; round < BENCHMARK_REGS_ROUNDS; ++round)
+		target_regs_read(target, regs);
+	benchmark_report("reg dump", BENCHMARK_REGS_ROUNDS * regs_size, BENCHMARK_REGS_ROUNDS, &start);
+	free(regs);
+	return true;
+}
+
+int bmda_benchmark(target_s *const target)
+{
+	uint8_t *const pattern = malloc(BENCHMARK_MAX_LENGTH);
+	uint8_t *const buffer = malloc(BENCHMARK_MAX_LENGTH);
+	if (!pattern || !buffer) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		free(pattern);
+		free(buffer);
+		return -1;
+	}
+
+	DEBUG_WARN("Benchmarking %s using %s\n", target->driver, bmda_adaptor_ident());
+	const bool result = benchmark_ram(target, pattern, buffer) && benchmark_flash(target, pattern, buffer) &&
+		benchmark_registers(target);
+	if (result && bmda_probe_info.type == PROBE_TYPE_SIM) {
+		sim_stats_s stats;
+		sim_stats_read(&stats);
+		DEBUG_WARN("Injected %" PRIu64 " WAIT and %" PRIu64 " FAULT responses\n", stats.waits, stats.faults);
+	}
+	free(pattern);
+	free(buffer);
+	return result ? 0 : -1;
+}
@@ -0,0 +1,214 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_BMDA_THREAD_H
+#define PLATFORMS_HOSTED_BMDA_THREAD_H
+
+/*
+ * Threads, locks and atomics for BMDA's helper threads. MSVC has neither pthreads nor, short of experimental
+ * switches, C11 atomics, so there these are built on the Win32 equivalents instead.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void *(*bmda_thread_func)(void *context);
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#include <process.h>
+#include <stdlib.h>
+
+typedef HANDLE bmda_thread_t;
+typedef SRWLOCK bmda_mutex_t;
+typedef CONDITION_VARIABLE bmda_cond_t;
+/* Pointer sized, so the Interlocked pointer operations can be used on it */
+typedef void *volatile bmda_atomic_size_t;
+
+typedef struct bmda_thread_start {
+	bmda_thread_func func;
+	void *context;
+} bmda_thread_start_s;
+
+static inline unsigned __stdcall bmda_thread_trampoline(void *const arg)
+{
+	const bmda_thread_start_s start = *(bmda_thread_start_s *)arg;
+	free(arg);
+	start.func(start.context);
+	return 0U;
+}
+
+static inline bool bmda_thread_create(bmda_thread_t *const thread, const bmda_thread_func func, void *const context)
+{
+	bmda_thread_start_s *const start = malloc(sizeof(*start));
+	if (!start)
+		return false;
+	start->func = func;
+	start->context = context;
+	*thread = (HANDLE)_beginthreadex(NULL, 0U, bmda_thread_trampoline, start, 0U, NULL);
+	if (!*thread) {
+		free(start);
+		return false;
+	}
+	return true;
+}
+
+static inline void bmda_thread_join(const bmda_thread_t thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+static inline void bmda_mutex_init(bmda_mutex_t *const mutex)
+{
+	InitializeSRWLock(mutex);
+}
+
+static inline void bmda_mutex_destroy(bmda_mutex_t *const mutex)
+{
+	/* SRW locks hold no resources */
+	(void)mutex;
+}
+
+static inline void bmda_mutex_lock(bmda_mutex_t *const mutex)
+{
+	AcquireSRWLockExclusive(mutex);
+}
+
+static inline void bmda_mutex_unlock(bmda_mutex_t *const mutex)
+{
+	ReleaseSRWLockExclusive(mutex);
+}
+
+static inline void bmda_cond_init(bmda_cond_t *const cond)
+{
+	InitializeConditionVariable(cond);
+}
+
+static inline void bmda_cond_destroy(bmda_cond_t *const cond)
+{
+	/* Condition variables hold no resources */
+	(void)cond;
+}
+
+static inline void bmda_cond_wait(bmda_cond_t *const cond, bmda_mutex_t *const mutex)
+{
+	SleepConditionVariableSRW(cond, mutex, INFINITE, 0U);
+}
+
+static inline void bmda_cond_broadcast(bmda_cond_t *const cond)
+{
+	WakeAllConditionVariable(cond);
+}
+
+/* The Interlocked operations are full barriers, which covers the acquire/release ordering needed */
+static inline size_t bmda_atomic_load(bmda_atomic_size_t *const value)
+{
+	return (size_t)InterlockedCompareExchangePointer(value, NULL, NULL);
+}
+
+static inline void bmda_atomic_store(bmda_atomic_size_t *const value, const size_t new_value)
+{
+	InterlockedExchangePointer(value, (void *)new_value);
+}
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef pthread_t bmda_thread_t;
+typedef pthread_mutex_t bmda_mutex_t;
+typedef pthread_cond_t bmda_cond_t;
+typedef atomic_size_t bmda_atomic_size_t;
+
+static inline bool bmda_thread_create(bmda_thread_t *const thread, const bmda_thread_func func, void *const context)
+{
+	return pthread_create(thread, NULL, func, context) == 0;
+}
+
+static inline void bmda_thread_join(const bmda_thread_t thread)
+{
+	pthread_join(thread, NULL);
+}
+
+static inline void bmda_mutex_init(bmda_mutex_t *const mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+static inline void bmda_mutex_destroy(bmda_mutex_t *const mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+static inline void bmda_mutex_lock(bmda_mutex_t *const mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+static inline void bmda_mutex_unlock(bmda_mutex_t *const mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+static inline void bmda_cond_init(bmda_cond_t *const cond)
+{
+	pthread_cond_init(cond, NULL);
+}
+
+static inline void bmda_cond_destroy(bmda_cond_t *const cond)
+{
+	pthread_cond_destroy(cond);
+}
+
+static inline void bmda_cond_wait(bmda_cond_t *const cond, bmda_mutex_t *const mutex)
+{
+	pthread_cond_wait(cond, mutex);
+}
+
+static inline void bmda_cond_broadcast(bmda_cond_t *const cond)
+{
+	pthread_cond_broadcast(cond);
+}
+
+/* Loads acquire and stores release, which is what passing data between two threads needs */
+static inline size_t bmda_atomic_load(bmda_atomic_size_t *const value)
+{
+	return atomic_load_explicit(value, memory_order_acquire);
+}
+
+static inline void bmda_atomic_store(bmda_atomic_size_t *const value, const size_t new_value)
+{
+	atomic_store_explicit(value, new_value, memory_order_release);
+}
+#endif
+
+#endif /* PLATFORMS_HOSTED_BMDA_THREAD_H */
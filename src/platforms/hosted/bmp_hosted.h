@@ -59,6 +59,8 @@ typedef struct libusb_interface libusb_interface_s;
 typedef enum libusb_error libusb_error_e;
 
 typedef struct ftdi_context ftdi_context_s;
+typedef struct bmda_usb_async bmda_usb_async_s;
+typedef struct bmda_usb_request bmda_usb_request_s;
 
 typedef struct usb_link {
 	libusb_context *context;
@@ -67,6 +69,8 @@ typedef struct usb_link {
 	uint8_t ep_tx;
 	uint8_t ep_rx;
 	void *priv;
+	/* Asynchronous transfer engine state, see bmda_usb_async_start() */
+	bmda_usb_async_s *async;
 } usb_link_s;
 #endif
 
@@ -102,6 +106,11 @@ void libusb_exit_function(bmda_probe_s *info);
 #if HOSTED_BMP_ONLY == 1
 bool device_is_bmp_gdb_port(const char *device);
 #else
+bool bmda_usb_async_start(usb_link_s *link);
+void bmda_usb_async_stop(usb_link_s *link);
+bmda_usb_request_s *bmda_usb_submit(
+	usb_link_s *link, const void *tx_buffer, size_t tx_len, void *rx_buffer, size_t rx_len, uint16_t timeout);
+int bmda_usb_await(bmda_usb_request_s *request);
 int bmda_usb_transfer(
 	usb_link_s *link, const void *tx_buffer, size_t tx_len, void *rx_buffer, size_t rx_len, uint16_t timeout);
 #endif
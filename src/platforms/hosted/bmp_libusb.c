@@ -47,6 +47,8 @@ typedef int_least16_t char16_t;
 #include "probe_info.h"
 #include "utils.h"
 #include "hex_utils.h"
+#include "bmda_thread.h"
+#include "perf.h"
 
 #define NO_SERIAL_NUMBER          "<no serial number>"
 #define BMP_PRODUCT_STRING        "Black Magic Probe"
@@ -129,6 +131,7 @@ void libusb_exit_function(bmda_probe_s *info)
 {
 	if (!info->usb_link)
 		return;
+	bmda_usb_async_stop(info->usb_link);
 	if (info->usb_link->device_handle) {
 		libusb_release_interface(info->usb_link->device_handle, 0);
 		libusb_close(info->usb_link->device_handle);
@@ -567,6 +570,42 @@ static const probe_info_s *scan_for_devices(bmda_probe_s *info)
 	return probe_info_correct_order(probe_list);
 }
 
+/* Fill out bmda_probe_s for the probe chosen to be used, doing any adaptor specific lookups it needs */
+static bool select_probe(bmda_cli_options_s *const cl_opts, bmda_probe_s *const info, const probe_info_s *const probe)
+{
+	probe_info_to_bmda_probe(probe, info);
+	/* If the selected probe is an FTDI adapter try to resolve the adaptor type */
+	if (probe->type == PROBE_TYPE_FTDI && !ftdi_lookup_adaptor_descriptor(cl_opts, probe)) {
+		// Don't know the cable type, ask user to specify with "-c"
+		DEBUG_WARN("Multiple FTDI adapters match Vendor and Product ID.\n");
+		DEBUG_WARN("Please specify adapter type on command line using \"-c\" option.\n");
+		return false;
+	}
+	/* If the selected probe is CMSIS-DAP, check for v2 interfaces */
+	if (probe->type == PROBE_TYPE_CMSIS_DAP)
+		check_cmsis_interface_type(probe->device, info);
+	return true;
+}
+
+/* Call the callback for each probe on the system, using a libusb context of our own for the scan */
+size_t bmda_probe_foreach(void (*const callback)(const probe_info_s *probe, void *context), void *const context)
+{
+	bmda_probe_s info = {0};
+	const int result = libusb_init(&info.libusb_ctx);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_ERROR("Failed to initialise libusb (%d): %s\n", result, libusb_error_name(result));
+		return 0;
+	}
+
+	const probe_info_s *const probe_list = scan_for_devices(&info);
+	size_t probes = 0;
+	for (const probe_info_s *probe = probe_list; probe; probe = probe->next, ++probes)
+		callback(probe, context);
+	probe_info_list_free(probe_list);
+	libusb_exit(info.libusb_ctx);
+	return probes;
+}
+
 bool find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 {
 	if (cl_opts->opt_device)
@@ -607,87 +646,354 @@ bool find_debuggers(bmda_cli_options_s *cl_opts, bmda_probe_s *info)
 	}
 
 	/* We found a matching probe, populate bmda_probe_s and signal success */
-	probe_info_to_bmda_probe(probe, info);
-	/* If the selected probe is an FTDI adapter try to resolve the adaptor type */
-	if (probe->type == PROBE_TYPE_FTDI && !ftdi_lookup_adaptor_descriptor(cl_opts, probe)) {
-		// Don't know the cable type, ask user to specify with "-c"
-		DEBUG_WARN("Multiple FTDI adapters match Vendor and Product ID.\n");
-		DEBUG_WARN("Please specify adapter type on command line using \"-c\" option.\n");
-		probe_info_list_free(probe_list);
+	const bool selected = select_probe(cl_opts, info, probe);
+	probe_info_list_free(probe_list);
+	return selected;
+}
+
+/*
+ * Use a probe found by an earlier scan, such as the one done by the gang programming parent process,
+ * without scanning the whole system again. libusb state can't be carried across a fork(), so the
+ * device is looked up afresh by its bus number and address, which needs no descriptor reads.
+ */
+bool bmda_probe_attach(bmda_cli_options_s *const cl_opts, bmda_probe_s *const info, const probe_info_s *const probe,
+	const uint8_t bus, const uint8_t address)
+{
+	const int result = libusb_init(&info->libusb_ctx);
+	if (result != LIBUSB_SUCCESS) {
+		DEBUG_ERROR("Failed to initialise libusb (%d): %s\n", result, libusb_error_name(result));
 		return false;
 	}
-	/* If the selected probe is CMSIS-DAP, check for v2 interfaces */
-	if (probe->type == PROBE_TYPE_CMSIS_DAP)
-		check_cmsis_interface_type(probe->device, info);
 
-	probe_info_list_free(probe_list);
+	libusb_device **device_list;
+	const ssize_t cnt = libusb_get_device_list(info->libusb_ctx, &device_list);
+	if (cnt <= 0)
+		return false;
+	probe_info_s located = *probe;
+	located.device = NULL;
+	for (size_t device_index = 0; device_list[device_index]; ++device_index) {
+		libusb_device *const device = device_list[device_index];
+		if (libusb_get_bus_number(device) == bus && libusb_get_device_address(device) == address) {
+			located.device = device;
+			break;
+		}
+	}
+	bool attached = false;
+	if (located.device)
+		attached = select_probe(cl_opts, info, &located);
+	else
+		DEBUG_ERROR("Probe %s is no longer at %u:%u\n", probe->serial, bus, address);
+	libusb_free_device_list(device_list, (int)cnt);
+	return attached;
+}
+
+/* How many requests may be in flight on a link at any one time */
+#define BMDA_USB_ASYNC_REQUESTS 16U
+/* How long the event thread blocks waiting for events, which bounds how long stopping it takes */
+#define BMDA_USB_ASYNC_EVENT_TIMEOUT_US 100000
+
+/* Which of a request's transfers have been submitted but not yet completed */
+#define BMDA_USB_TX_PENDING (1U << 0U)
+#define BMDA_USB_RX_PENDING (1U << 1U)
+
+struct bmda_usb_request {
+	bmda_usb_async_s *async;
+	struct libusb_transfer *tx_transfer;
+	struct libusb_transfer *rx_transfer;
+	void *rx_buffer;
+	uint8_t pending;
+	bool in_use;
+	/* The error from libusb_submit_transfer() if the request could not be started */
+	int submit_result;
+	enum libusb_transfer_status tx_status;
+	enum libusb_transfer_status rx_status;
+	int rx_length;
+};
+
+struct bmda_usb_async {
+	usb_link_s *link;
+	bmda_thread_t event_thread;
+	bmda_mutex_t lock;
+	bmda_cond_t completed;
+	volatile bool running;
+	bmda_usb_request_s requests[BMDA_USB_ASYNC_REQUESTS];
+};
+
+static void *bmda_usb_async_events(void *const arg)
+{
+	const bmda_usb_async_s *const async = (const bmda_usb_async_s *)arg;
+	struct timeval timeout = {.tv_sec = 0, .tv_usec = BMDA_USB_ASYNC_EVENT_TIMEOUT_US};
+	/* Keep libusb's event handling going so transfers complete without anyone having to block on them */
+	while (async->running)
+		libusb_handle_events_timeout_completed(async->link->context, &timeout, NULL);
+	return NULL;
+}
+
+static void LIBUSB_CALL bmda_usb_async_callback(struct libusb_transfer *const transfer)
+{
+	bmda_usb_request_s *const request = (bmda_usb_request_s *)transfer->user_data;
+	bmda_usb_async_s *const async = request->async;
+	bmda_mutex_lock(&async->lock);
+	if (transfer == request->tx_transfer) {
+		request->tx_status = transfer->status;
+		/* If the request didn't make it to the adaptor, there will be no response to wait for */
+		if (transfer->status != LIBUSB_TRANSFER_COMPLETED && (request->pending & BMDA_USB_RX_PENDING))
+			libusb_cancel_transfer(request->rx_transfer);
+		request->pending &= ~BMDA_USB_TX_PENDING;
+	} else {
+		request->rx_status = transfer->status;
+		request->rx_length = transfer->actual_length;
+		request->pending &= ~BMDA_USB_RX_PENDING;
+	}
+	bmda_cond_broadcast(&async->completed);
+	bmda_mutex_unlock(&async->lock);
+}
+
+/*
+ * Start the asynchronous transfer engine for a link. This allocates the pool of transfers
+ * requests are run with, and starts a thread dedicated to handling libusb events so
+ * transfers progress (and complete) while the caller gets on with other work.
+ */
+bool bmda_usb_async_start(usb_link_s *const link)
+{
+	bmda_usb_async_s *const async = calloc(1U, sizeof(*async));
+	if (!async) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	async->link = link;
+	for (size_t idx = 0U; idx < BMDA_USB_ASYNC_REQUESTS; ++idx) {
+		bmda_usb_request_s *const request = &async->requests[idx];
+		request->async = async;
+		request->tx_transfer = libusb_alloc_transfer(0);
+		request->rx_transfer = libusb_alloc_transfer(0);
+		if (!request->tx_transfer || !request->rx_transfer) {
+			DEBUG_ERROR("libusb_alloc_transfer: failed in %s\n", __func__);
+			for (size_t i = 0U; i <= idx; ++i) {
+				libusb_free_transfer(async->requests[i].tx_transfer);
+				libusb_free_transfer(async->requests[i].rx_transfer);
+			}
+			free(async);
+			return false;
+		}
+	}
+	bmda_mutex_init(&async->lock);
+	bmda_cond_init(&async->completed);
+	async->running = true;
+	if (!bmda_thread_create(&async->event_thread, bmda_usb_async_events, async)) {
+		DEBUG_ERROR("Failed to start USB event handling thread\n");
+		async->running = false;
+		link->async = async;
+		bmda_usb_async_stop(link);
+		return false;
+	}
+	link->async = async;
 	return true;
 }
 
+/* Wait out any requests still in flight, then stop the event thread and release the transfer pool */
+void bmda_usb_async_stop(usb_link_s *const link)
+{
+	bmda_usb_async_s *const async = link->async;
+	if (!async)
+		return;
+	if (async->running) {
+		bmda_mutex_lock(&async->lock);
+		for (size_t idx = 0U; idx < BMDA_USB_ASYNC_REQUESTS; ++idx) {
+			bmda_usb_request_s *const request = &async->requests[idx];
+			if (request->pending & BMDA_USB_TX_PENDING)
+				libusb_cancel_transfer(request->tx_transfer);
+			if (request->pending & BMDA_USB_RX_PENDING)
+				libusb_cancel_transfer(request->rx_transfer);
+			while (request->pending)
+				bmda_cond_wait(&async->completed, &async->lock);
+		}
+		bmda_mutex_unlock(&async->lock);
+		async->running = false;
+		bmda_thread_join(async->event_thread);
+	}
+	for (size_t idx = 0U; idx < BMDA_USB_ASYNC_REQUESTS; ++idx) {
+		libusb_free_transfer(async->requests[idx].tx_transfer);
+		libusb_free_transfer(async->requests[idx].rx_transfer);
+	}
+	bmda_cond_destroy(&async->completed);
+	bmda_mutex_destroy(&async->lock);
+	free(async);
+	link->async = NULL;
+}
+
 /*
- * Transfer data back and forth with the debug adaptor.
+ * Submit a request to the adaptor without waiting for it to complete, returning a handle to pass to
+ * bmda_usb_await() for the result. If tx_len is non-zero, the data in tx_buffer is sent to the adaptor,
+ * and if rx_len is non-zero, a response is read back into rx_buffer. Both buffers must remain valid
+ * until the request has been awaited.
  *
- * If tx_len is non-zero, then send the data in tx_buffer to the adaptor.
- * If rx_len is non-zero, then receive data from the adaptor into rx_buffer.
- * The result is either the number of bytes received, or a libusb error code indicating what went wrong
- *
- * NB: The lengths represent the maximum number of expected bytes and the actual amount
- *   sent/received may be less (per libusb's documentation). If used, rx_buffer must be
- *   suitably initialised up front to avoid UB reads when accessed.
+ * Requests on a link are sent, and their responses read, in the order they are submitted, so several
+ * commands can be kept in flight to an adaptor that will process them in turn.
  */
-int bmda_usb_transfer(
-	usb_link_s *link, const void *tx_buffer, size_t tx_len, void *rx_buffer, size_t rx_len, uint16_t timeout)
+bmda_usb_request_s *bmda_usb_submit(usb_link_s *const link, const void *const tx_buffer, const size_t tx_len,
+	void *const rx_buffer, const size_t rx_len, const uint16_t timeout)
 {
-	/* If there's data to send */
+	bmda_usb_async_s *const async = link->async;
+	if (!async) {
+		DEBUG_ERROR("%s: Asynchronous transfers not started for this adaptor\n", __func__);
+		return NULL;
+	}
+	/* Find a free request to use */
+	bmda_usb_request_s *request = NULL;
+	bmda_mutex_lock(&async->lock);
+	for (size_t idx = 0U; idx < BMDA_USB_ASYNC_REQUESTS; ++idx) {
+		if (!async->requests[idx].in_use) {
+			request = &async->requests[idx];
+			break;
+		}
+	}
+	if (!request) {
+		bmda_mutex_unlock(&async->lock);
+		DEBUG_ERROR("%s: Too many requests in flight\n", __func__);
+		return NULL;
+	}
+	request->in_use = true;
+	request->pending = 0U;
+	request->submit_result = LIBUSB_SUCCESS;
+	request->tx_status = LIBUSB_TRANSFER_COMPLETED;
+	request->rx_status = LIBUSB_TRANSFER_COMPLETED;
+	request->rx_length = 0;
+	request->rx_buffer = rx_len ? rx_buffer : NULL;
+
+	/* If there's data to send, queue it up first */
 	if (tx_len) {
-		const uint8_t *tx_data = (const uint8_t *)tx_buffer;
-		/* Display the request */
-		DEBUG_WIRE(" request:");
-		for (size_t i = 0; i < tx_len && i < 32U; ++i)
-			DEBUG_WIRE(" %02x", tx_data[i]);
-		if (tx_len > 32U)
-			DEBUG_WIRE(" ...");
-		DEBUG_WIRE("\n");
-
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
-		/* Perform the transfer - NB, libusb has a miserably const-and-signed-incorrect API, hence some the casts here */
-		const int result = libusb_bulk_transfer(
-			link->device_handle, link->ep_tx | LIBUSB_ENDPOINT_OUT, (uint8_t *)tx_data, (int)tx_len, NULL, timeout);
+		/* NB, libusb has a miserably const-and-signed-incorrect API, hence some the casts here */
+		libusb_fill_bulk_transfer(request->tx_transfer, link->device_handle, link->ep_tx | LIBUSB_ENDPOINT_OUT,
+			(uint8_t *)tx_buffer, (int)tx_len, bmda_usb_async_callback, request, timeout);
 #pragma GCC diagnostic pop
-		/* Then decode the result value - if its anything other than LIBUSB_SUCCESS, something went horribly wrong */
+		request->submit_result = libusb_submit_transfer(request->tx_transfer);
+		if (request->submit_result == LIBUSB_SUCCESS)
+			request->pending |= BMDA_USB_TX_PENDING;
+	}
+	/* Then queue the read for the response behind it */
+	if (rx_len && request->submit_result == LIBUSB_SUCCESS) {
+		libusb_fill_bulk_transfer(request->rx_transfer, link->device_handle, link->ep_rx | LIBUSB_ENDPOINT_IN,
+			(uint8_t *)rx_buffer, (int)rx_len, bmda_usb_async_callback, request, timeout);
+		request->submit_result = libusb_submit_transfer(request->rx_transfer);
+		if (request->submit_result == LIBUSB_SUCCESS)
+			request->pending |= BMDA_USB_RX_PENDING;
+		/* If the response read couldn't be submitted, don't leave the request half done */
+		else if (request->pending)
+			libusb_cancel_transfer(request->tx_transfer);
+	}
+	bmda_mutex_unlock(&async->lock);
+	return request;
+}
+
+static int bmda_usb_transfer_status_to_error(const enum libusb_transfer_status status)
+{
+	switch (status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		return LIBUSB_SUCCESS;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		return LIBUSB_ERROR_TIMEOUT;
+	case LIBUSB_TRANSFER_STALL:
+		return LIBUSB_ERROR_PIPE;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		return LIBUSB_ERROR_NO_DEVICE;
+	case LIBUSB_TRANSFER_OVERFLOW:
+		return LIBUSB_ERROR_OVERFLOW;
+	case LIBUSB_TRANSFER_CANCELLED:
+		return LIBUSB_ERROR_INTERRUPTED;
+	default:
+		return LIBUSB_ERROR_IO;
+	}
+}
+
+/*
+ * Wait for a request submitted with bmda_usb_submit() to complete and release it.
+ * The result is either the number of bytes received, or a libusb error code indicating what went wrong
+ */
+int bmda_usb_await(bmda_usb_request_s *const request)
+{
+	/* If the request couldn't even be allocated, bmda_usb_submit() already said why */
+	if (!request)
+		return LIBUSB_ERROR_NO_MEM;
+	bmda_usb_async_s *const async = request->async;
+	const usb_link_s *const link = async->link;
+	bmda_mutex_lock(&async->lock);
+	while (request->pending)
+		bmda_cond_wait(&async->completed, &async->lock);
+	bmda_mutex_unlock(&async->lock);
+
+	int result = request->submit_result;
+	if (result == LIBUSB_SUCCESS) {
+		result = bmda_usb_transfer_status_to_error(request->tx_status);
 		if (result != LIBUSB_SUCCESS) {
 			DEBUG_ERROR(
 				"%s: Sending request to adaptor failed (%d): %s\n", __func__, result, libusb_error_name(result));
 			if (result == LIBUSB_ERROR_PIPE)
 				libusb_clear_halt(link->device_handle, link->ep_tx | LIBUSB_ENDPOINT_OUT);
-			return result;
 		}
+	} else {
+		DEBUG_ERROR(
+			"%s: Submitting request to adaptor failed (%d): %s\n", __func__, result, libusb_error_name(result));
 	}
-	/* If there's data to receive */
-	if (rx_len) {
-		uint8_t *rx_data = (uint8_t *)rx_buffer;
-		int rx_bytes = 0;
-		/* Perform the transfer */
-		const int result = libusb_bulk_transfer(
-			link->device_handle, link->ep_rx | LIBUSB_ENDPOINT_IN, rx_data, (int)rx_len, &rx_bytes, timeout);
-		/* Then decode the result value - if its anything other than LIBUSB_SUCCESS, something went horribly wrong */
-		if (result != LIBUSB_SUCCESS) {
+	if (result == LIBUSB_SUCCESS && request->rx_buffer) {
+		result = bmda_usb_transfer_status_to_error(request->rx_status);
+		if (result == LIBUSB_SUCCESS)
+			result = request->rx_length;
+		else {
 			DEBUG_ERROR(
 				"%s: Receiving response from adaptor failed (%d): %s\n", __func__, result, libusb_error_name(result));
 			if (result == LIBUSB_ERROR_PIPE)
 				libusb_clear_halt(link->device_handle, link->ep_rx | LIBUSB_ENDPOINT_IN);
-			return result;
 		}
+	}
+
+	bmda_mutex_lock(&async->lock);
+	request->in_use = false;
+	bmda_mutex_unlock(&async->lock);
+	return result;
+}
+
+/*
+ * Transfer data back and forth with the debug adaptor.
+ *
+ * If tx_len is non-zero, then send the data in tx_buffer to the adaptor.
+ * If rx_len is non-zero, then receive data from the adaptor into rx_buffer.
+ * The result is either the number of bytes received, or a libusb error code indicating what went wrong
+ *
+ * NB: The lengths represent the maximum number of expected bytes and the actual amount
+ *   sent/received may be less (per libusb's documentation). If used, rx_buffer must be
+ *   suitably initialised up front to avoid UB reads when accessed.
+ */
+int bmda_usb_transfer(usb_link_s *const link, const void *const tx_buffer, const size_t tx_len,
+	void *const rx_buffer, const size_t rx_len, const uint16_t timeout)
+{
+	/* If there's data to send, display the request */
+	if (tx_len) {
+		const uint8_t *const tx_data = (const uint8_t *)tx_buffer;
+		DEBUG_WIRE(" request:");
+		for (size_t i = 0; i < tx_len && i < 32U; ++i)
+			DEBUG_WIRE(" %02x", tx_data[i]);
+		if (tx_len > 32U)
+			DEBUG_WIRE(" ...");
+		DEBUG_WIRE("\n");
+	}
 
-		/* Display the response */
+	/* Perform the transfer and wait for it to complete */
+	const uint32_t start = perf_now();
+	const int result = bmda_usb_await(bmda_usb_submit(link, tx_buffer, tx_len, rx_buffer, rx_len, timeout));
+	perf_record(PERF_PROBE_ROUND_TRIP, start, tx_len + (result > 0 ? (size_t)result : 0U));
+
+	/* If there was data received, display the response */
+	if (rx_len && result >= 0) {
+		const uint8_t *const rx_data = (const uint8_t *)rx_buffer;
 		DEBUG_WIRE("response:");
-		for (size_t i = 0; i < (size_t)rx_bytes && i < 32U; ++i)
+		for (size_t i = 0; i < (size_t)result && i < 32U; ++i)
 			DEBUG_WIRE(" %02x", rx_data[i]);
-		if (rx_bytes > 32)
+		if (result > 32)
 			DEBUG_WIRE(" ...");
 		DEBUG_WIRE("\n");
-		return rx_bytes;
 	}
-	return LIBUSB_SUCCESS;
+	return result;
 }
@@ -196,6 +196,13 @@ void remote_target_clk_output_enable(const bool enable)
 		DEBUG_WARN("Please update probe firmware to enable high impedance clock feature\n");
 }
 
+/* Send anything the protocol layer is holding back on to the probe */
+void remote_buffer_flush(void)
+{
+	if (remote_funcs.buffer_flush)
+		remote_funcs.buffer_flush();
+}
+
 bool remote_jtag_init(void)
 {
 	return remote_funcs.jtag_init();
@@ -214,6 +221,11 @@ void remote_adiv5_dp_init(adiv5_debug_port_s *const dp)
 
 void remote_adiv6_dp_init(adiv5_debug_port_s *const dp)
 {
+	/* The memory polling, stub and PC sampling commands only know how to address ADIv5 APs, so stop using them */
+	dp->mem_poll = NULL;
+	dp->run_stub = NULL;
+	dp->pc_profile = NULL;
+	dp->mem_txn = NULL;
 	/* Try to initialise ADIv6 acceleration */
 	if (remote_funcs.adiv6_init)
 		remote_funcs.adiv6_init(dp);
@@ -43,6 +43,7 @@ typedef struct bmp_remote_protocol {
 	uint32_t (*get_comms_frequency)(void);
 	bool (*set_comms_frequency)(uint32_t freq);
 	void (*target_clk_output_enable)(bool enable);
+	void (*buffer_flush)(void);
 } bmp_remote_protocol_s;
 
 extern bmp_remote_protocol_s remote_funcs;
@@ -61,6 +62,7 @@ bool remote_nrst_get_val(void);
 void remote_max_frequency_set(uint32_t freq);
 uint32_t remote_max_frequency_get(void);
 void remote_target_clk_output_enable(bool enable);
+void remote_buffer_flush(void);
 
 void remote_adiv5_dp_init(adiv5_debug_port_s *dp);
 void remote_adiv6_dp_init(adiv5_debug_port_s *dp);
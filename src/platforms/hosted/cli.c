@@ -49,6 +49,10 @@
 #include "command.h"
 #include "cli.h"
 #include "bmp_hosted.h"
+#include "benchmark.h"
+#include "profile.h"
+#include "image.h"
+#include "multi_flash.h"
 
 typedef struct option getopt_option_s;
 
@@ -144,9 +148,9 @@ static void cl_help(char **argv)
 	bmp_ident(NULL);
 	/* clang-format off */
 	DEBUG_INFO("\n"
-			   "Usage: %s [-h | -l | [-v BITMASK] [-O] [-d PATH | -P NUMBER | -s SERIAL | -c TYPE]\n"
-			   "\t[-n NUMBER] [-j | -A] [-C] [-t | -T] [-e] [-p] [-R[h]] [-H] [-M STRING ...]\n"
-			   "\t[-f | -m] [-E | -w | -V | -r] [-a ADDR] [-S number] [file]]\n"
+			   "Usage: %s [-h | -l | [-v BITMASK] [-O] [-d PATH | -P NUMBER | -s SERIAL | -G PATTERN | -c TYPE |\n"
+			   "\t-x[MODEL]] [-n NUMBER | -N LIST] [-j | -A] [-C] [-t | -T | -B | -Q MS] [-e] [-p] [-R[h]]\n"
+			   "\t[-H] [-M STRING ...] [-f | -m] [-E | -w | -V | -r] [-a ADDR] [-S number] [file ...]]\n"
 			   "\n"
 			   "The default is to start a debug server at localhost:2000\n\n"
 			   "Single-shot and verbosity options [-h | -l | -v BITMASK]:\n"
@@ -157,19 +161,34 @@ static void cl_help(char **argv)
 			   "\t-O, --no-stdout  Don't use stdout for debugging output, making it available\n"
 			   "\t                   for use by RTT, Semihosting, or other target output\n"
 			   "\n"
-			   "Probe selection arguments [-d PATH | -P NUMBER | -s SERIAL | -c TYPE" GPIOD_PROBE_SELECTION "]:\n"
+			   "Probe selection arguments [-d PATH | -P NUMBER | -s SERIAL | -G PATTERN | -c TYPE |\n"
+			   "\t\t-x[MODEL] | -Z FILE" GPIOD_PROBE_SELECTION "]:\n"
 			   "\t-d, --device     Use a serial device at the given path\n"
 			   "\t-P, --probe      Use the <number>th debug probe found while scanning the\n"
 			   "\t                   system, see the output from list for the order\n"
 			   "\t-s, --serial     Select the debug probe with the given serial number\n"
+			   "\t-G, --gang       Run the requested Flash or other operation on every debug\n"
+			   "\t                   probe with a serial number matching the given pattern\n"
+			   "\t                   (such as 'E2C0*') at once, with a worker per probe, and\n"
+			   "\t                   summarise the results for each\n"
 			   "\t-c, --ftdi-type  Select the FTDI-based debug probe with of the given\n"
 			   "\t                   type (cable)\n"
+			   "\t-x, --sim        Use a simulated target instead of a debug probe. The model\n"
+			   "\t                   (stm32f1 or stm32f4) may be followed by latency=US, wait=N,\n"
+			   "\t                   fault=N and busy=N to inject probe latency, a WAIT or FAULT\n"
+			   "\t                   every N AP accesses and N Flash busy polls, comma separated\n"
+			   "\t-Z, --replay     Replay a wire trace recorded with -X instead of using a debug\n"
+			   "\t                   probe, reporting where the accesses made differ from it\n"
 			   GPIOD_PROBE_SELECTION_HELP
 			   "\n"
-			   "General configuration options: [-n NUMBER] [-j] [-C] [-t | -T] [-e] [-p] [-R[h]]\n"
-			   "\t\t[-H] [-M STRING ...]\n"
+			   "General configuration options: [-n NUMBER | -N LIST] [-j] [-C] [-t | -T | -B | -Q MS] [-e] [-p]\n"
+			   "\t\t[-R[h]] [-H] [-M STRING ...] [-y FILE] [-J FILE] [-X FILE]\n"
 			   "\t-n, --number     Select the target device at the given position in the\n"
 			   "\t                   scan chain (use the -t option to get a scan chain listing)\n"
+			   "\t-N, --targets    Erase, write or verify all the target devices at the given\n"
+			   "\t                   positions (such as 1,3-5 or all) together, interleaving\n"
+			   "\t                   the work on each. Takes one file for all of them or one\n"
+			   "\t                   file per target in the order listed\n"
 			   "\t-j, --jtag       Use JTAG instead of SWD\n"
 			   "\t-A, --auto-scan  Automatic scanning - try JTAG first, then SWD\n"
 			   "\t-C, --hw-reset   Connect to target under hardware reset\n"
@@ -179,6 +198,11 @@ static void cl_help(char **argv)
 			   "\t                   connected devices\n"
 			   "\t-T, --timing     Perform continues read- or write-back of a value to allow\n"
 			   "\t                   measurement of protocol timing. Aborted by ^C\n"
+			   "\t-B, --benchmark  Measure memory, Flash, CRC and register access throughput.\n"
+			   "\t                   This overwrites the start of RAM and of the lowest Flash region\n"
+			   "\t-Q, --profile    Let a Cortex-M target run for the given number of milliseconds,\n"
+			   "\t                   sampling its PC, then write a gprof gmon.out to the file given\n"
+			   "\t                   or list the PCs seen if none is\n"
 			   "\t-e, --ext-res    Assume external resistors for FTDI devices, that is having the\n"
 			   "\t                   FTDI chip connected through resistors to TMS, TDI and TDO\n"
 			   "\t-p, --power      Power the target from the probe (if possible)\n"
@@ -190,6 +214,14 @@ static void cl_help(char **argv)
 			   "\t                   If the command contains spaces, use quotes around the\n"
 			   "\t                   complete command\n"
 			   "\t-f, --freq       Set an operating frequency for the debug interface\n"
+			   "\t-y, --scan-cache Record the AP layout and target drivers found in the given\n"
+			   "\t                   file, and use them to skip rediscovery on later runs\n"
+			   "\t-J, --perf-json  Write the performance counters (see `monitor perf`) to the\n"
+			   "\t                   given file as JSON on exit. In gang mode the probe's serial\n"
+			   "\t                   number is added to the name\n"
+			   "\t-X, --wire-trace Record every DP, AP and memory access made through the probe\n"
+			   "\t                   to the given file as a binary wire trace, for use with -Z.\n"
+			   "\t                   In gang mode the probe's serial number is added to the name\n"
 			   "\n"
 			   "SWD-specific configuration options [-f FREQUENCY | -m TARGET]:\n"
 			   "\t-m, --multi-drop  Use the given target ID for selection in SWD multi-drop\n"
@@ -207,7 +239,9 @@ static void cl_help(char **argv)
 			   "\t                   the start of Flash)\n"
 			   "\t-S, --byte-count Number of bytes to work on in the Flash operation (default\n"
 			   "\t                   is till the operation fails or is complete)\n"
-			   "\t<file>           Binary file to use in Flash operations\n",
+			   "\t<file>           Binary, ELF, Intel HEX or S-record file to use in Flash\n"
+			   "\t                   operations, one per target with -N. Only the populated\n"
+			   "\t                   parts of ELF, HEX and S-record images are programmed\n",
 		argv[0]);
 	/* clang-format on */
 	exit(0);
@@ -221,9 +255,11 @@ static const getopt_option_s long_options[] = {
 	{"device", required_argument, NULL, 'd'},
 	{"probe", required_argument, NULL, 'P'},
 	{"serial", required_argument, NULL, 's'},
+	{"gang", required_argument, NULL, 'G'},
 	{"ftdi-type", required_argument, NULL, 'c'},
 	{"fast-poll", no_argument, NULL, 'F'},
 	{"number", required_argument, NULL, 'n'},
+	{"targets", required_argument, NULL, 'N'},
 	{"jtag", no_argument, NULL, 'j'},
 	{"auto-scan", no_argument, NULL, 'A'},
 	{"hw-reset", no_argument, NULL, 'C'},
@@ -246,6 +282,13 @@ static const getopt_option_s long_options[] = {
 	{"gpiod", required_argument, NULL, 'g'},
 #endif
 	{"allow-fallback", no_argument, NULL, 'k'},
+	{"sim", optional_argument, NULL, 'x'},
+	{"benchmark", no_argument, NULL, 'B'},
+	{"profile", required_argument, NULL, 'Q'},
+	{"scan-cache", required_argument, NULL, 'y'},
+	{"perf-json", required_argument, NULL, 'J'},
+	{"wire-trace", required_argument, NULL, 'X'},
+	{"replay", required_argument, NULL, 'Z'},
 	{NULL, 0, NULL, 0},
 };
 
@@ -264,8 +307,8 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 	opt->opt_scanmode = BMP_SCAN_SWD;
 	opt->opt_mode = BMP_MODE_DEBUG;
 	while (true) {
-		const int option =
-			getopt_long(argc, argv, "eEFhHv:Od:f:s:I:c:Cln:m:M:wVtTa:S:jApP:rR::k" GPIOD_ARG_STR, long_options, NULL);
+		const int option = getopt_long(argc, argv,
+			"eEFhHv:Od:f:s:G:I:c:Cln:N:m:M:wVtTa:S:jApP:rR::kx::BQ:y:J:X:Z:" GPIOD_ARG_STR, long_options, NULL);
 		if (option == -1)
 			break;
 
@@ -341,6 +384,10 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 			if (optarg)
 				opt->opt_serial = optarg;
 			break;
+		case 'G':
+			if (optarg)
+				opt->opt_gang_pattern = optarg;
+			break;
 		case 'I':
 			if (optarg)
 				opt->opt_ident_string = optarg;
@@ -387,6 +434,10 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 			if (optarg)
 				opt->opt_target_dev = strtol(optarg, NULL, 0);
 			break;
+		case 'N':
+			if (optarg)
+				opt->opt_targets = optarg;
+			break;
 		case 'm':
 			if (optarg)
 				opt->opt_targetid = strtol(optarg, NULL, 0);
@@ -426,21 +477,46 @@ void cl_init(bmda_cli_options_s *opt, int argc, char **argv)
 		case 'k':
 			opt->opt_cmsisdap_allow_fallback = true;
 			break;
+		case 'x':
+			opt->opt_sim_model = optarg ? optarg : "";
+			break;
+		case 'B':
+			opt->opt_mode = BMP_MODE_BENCHMARK;
+			break;
+		case 'Q':
+			opt->opt_mode = BMP_MODE_PROFILE;
+			opt->opt_profile_duration = strtoul(optarg, NULL, 0);
+			break;
+		case 'y':
+			opt->opt_scan_cache = optarg;
+			break;
+		case 'J':
+			opt->opt_perf_file = optarg;
+			break;
+		case 'X':
+			opt->opt_wire_trace = optarg;
+			break;
+		case 'Z':
+			opt->opt_replay_file = optarg;
+			break;
 		}
 	}
 	if (optind && argv[optind]) {
 		if (opt->opt_mode == BMP_MODE_DEBUG)
 			opt->opt_mode = BMP_MODE_FLASH_WRITE;
 		opt->opt_flash_file = argv[optind];
+		opt->opt_flash_files = argv + optind;
+		opt->opt_flash_file_count = (size_t)(argc - optind);
 	} else if (opt->opt_mode == BMP_MODE_DEBUG && opt->opt_monitor)
 		opt->opt_mode = BMP_MODE_MONITOR; // To avoid DEBUG mode
 
 	/* Checks */
 	if (opt->opt_flash_file &&
 		(opt->opt_mode == BMP_MODE_TEST || opt->opt_mode == BMP_MODE_SWJ_TEST || opt->opt_mode == BMP_MODE_RESET ||
-			opt->opt_mode == BMP_MODE_RESET_HW)) {
+			opt->opt_mode == BMP_MODE_RESET_HW || opt->opt_mode == BMP_MODE_BENCHMARK)) {
 		DEBUG_WARN("Ignoring filename in reset/test mode\n");
 		opt->opt_flash_file = NULL;
+		opt->opt_flash_file_count = 0;
 	}
 }
 
@@ -493,6 +569,11 @@ int cl_execute(bmda_cli_options_s *opt)
 	}
 
 	const size_t num_targets = target_foreach(display_target, NULL);
+	if (opt->opt_targets) {
+		const int res = bmda_multi_flash(opt, num_targets, &cl_controller);
+		target_list_free();
+		return res;
+	}
 	if (opt->opt_target_dev > num_targets) {
 		DEBUG_ERROR("Given target number %" PRIu32 " not available max %zu\n", opt->opt_target_dev, num_targets);
 		return -1;
@@ -570,8 +651,17 @@ int cl_execute(bmda_cli_options_s *opt)
 	}
 	if (opt->opt_mode == BMP_MODE_TEST || opt->opt_mode == BMP_MODE_SWJ_TEST)
 		goto target_detach;
+	if (opt->opt_mode == BMP_MODE_BENCHMARK) {
+		res = bmda_benchmark(target);
+		goto target_detach;
+	}
+	if (opt->opt_mode == BMP_MODE_PROFILE) {
+		res = bmda_profile(target, opt);
+		goto target_detach;
+	}
 
 	mmap_data_s map = {0};
+	bmda_image_s image = {0};
 	if (opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_VERIFY ||
 		opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
 		if (!bmp_mmap(opt->opt_flash_file, &map)) {
@@ -579,6 +669,13 @@ int cl_execute(bmda_cli_options_s *opt)
 			res = -1;
 			goto target_detach;
 		}
+		if (!bmda_image_parse(&image, opt->opt_flash_file, map.data, map.size)) {
+			DEBUG_ERROR("Can not parse file %s. Aborting!\n", opt->opt_flash_file);
+			res = -1;
+			goto free_map;
+		}
+		if (image.format)
+			DEBUG_INFO("Loaded %s image with %zu segments\n", image.format, image.count);
 	} else if (opt->opt_mode == BMP_MODE_FLASH_READ) {
 		/* Open as binary */
 		read_file = open(opt->opt_flash_file, O_TRUNC | O_CREAT | O_RDWR | O_BINARY, BMDA_NORMAL_MODE);
@@ -606,10 +703,19 @@ int cl_execute(bmda_cli_options_s *opt)
 			goto free_map;
 		}
 		target_reset(target);
+	} else if (image.format) {
+		/* Structured images carry their own addresses, so program and verify them segment by segment */
+		if ((opt->opt_mode != BMP_MODE_FLASH_VERIFY && !bmda_image_flash(target, &image)) ||
+			(opt->opt_mode != BMP_MODE_FLASH_WRITE && !bmda_image_verify(target, &image))) {
+			res = -1;
+			goto free_map;
+		}
+		target_reset(target);
+		goto free_map;
 	} else if (opt->opt_mode == BMP_MODE_FLASH_WRITE || opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
 		DEBUG_INFO("Erasing %zu bytes at 0x%08" PRIx32 "\n", map.size, opt->opt_flash_start);
 		const uint32_t start_time = platform_time_ms();
-		if (!target_flash_erase(target, opt->opt_flash_start, map.size)) {
+		if (!target_flash_erase_deferred(target, opt->opt_flash_start, map.size)) {
 			DEBUG_ERROR("Flash erase failed!\n");
 			res = -1;
 			goto free_map;
@@ -683,6 +789,7 @@ int cl_execute(bmda_cli_options_s *opt)
 			target_reset(target);
 	}
 free_map:
+	bmda_image_free(&image);
 	if (map.size)
 		bmp_munmap(&map);
 target_detach:
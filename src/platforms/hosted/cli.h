@@ -38,6 +38,8 @@ typedef enum bmda_cli_mode {
 	BMP_MODE_FLASH_VERIFY,
 	BMP_MODE_SWJ_TEST,
 	BMP_MODE_MONITOR,
+	BMP_MODE_BENCHMARK,
+	BMP_MODE_PROFILE,
 } bmda_cli_mode_e;
 
 typedef enum bmp_scan_mode {
@@ -56,8 +58,12 @@ typedef struct bmda_cli_options {
 	bool fast_poll;
 	bool opt_no_hl;
 	char *opt_flash_file;
+	char **opt_flash_files;
+	size_t opt_flash_file_count;
+	char *opt_targets;
 	char *opt_device;
 	char *opt_serial;
+	char *opt_gang_pattern;
 	uint32_t opt_targetid;
 	char *opt_ident_string;
 	size_t opt_position;
@@ -66,9 +72,15 @@ typedef struct bmda_cli_options {
 	uint32_t opt_target_dev;
 	uint32_t opt_flash_start;
 	uint32_t opt_max_frequency;
+	uint32_t opt_profile_duration;
 	size_t opt_flash_size;
 	char *opt_gpio_map;
 	bool opt_cmsisdap_allow_fallback;
+	const char *opt_sim_model;
+	const char *opt_scan_cache;
+	const char *opt_perf_file;
+	const char *opt_wire_trace;
+	const char *opt_replay_file;
 } bmda_cli_options_s;
 
 void cl_init(bmda_cli_options_s *opt, int argc, char **argv);
@@ -72,6 +72,7 @@
 #include "cmsis_dap.h"
 
 #include "target.h"
+#include "perf.h"
 
 #define TRANSFER_TIMEOUT_MS (100)
 
@@ -96,9 +97,7 @@ dap_cap_e dap_mode;
 uint8_t dap_quirks;
 
 static cmsis_type_e type;
-static libusb_device_handle *usb_handle = NULL;
-static uint8_t in_ep;
-static uint8_t out_ep;
+static usb_link_s usb_link;
 static hid_device *handle = NULL;
 /* Provide enough space for up to a HS USB HID payload + the HID report ID byte */
 static uint8_t buffer[1025U];
@@ -246,19 +245,30 @@ static bool dap_init_hid(void)
 static bool dap_init_bulk(void)
 {
 	DEBUG_INFO("Using bulk transfer\n");
-	int res = libusb_open(bmda_probe_info.libusb_dev, &usb_handle);
+	usb_link.context = bmda_probe_info.libusb_ctx;
+	int res = libusb_open(bmda_probe_info.libusb_dev, &usb_link.device_handle);
 	if (res != LIBUSB_SUCCESS) {
 		DEBUG_ERROR("libusb_open() failed (%d): %s\n", res, libusb_error_name(res));
 		return false;
 	}
-	if (libusb_claim_interface(usb_handle, bmda_probe_info.interface_num) < 0) {
+	if (libusb_claim_interface(usb_link.device_handle, bmda_probe_info.interface_num) < 0) {
 		DEBUG_ERROR("libusb_claim_interface() failed\n");
+		libusb_close(usb_link.device_handle);
+		usb_link.device_handle = NULL;
 		return false;
 	}
+	usb_link.interface = bmda_probe_info.interface_num;
 	/* Base the packet size on the one retrieved from the device descriptors */
 	dap_packet_size = bmda_probe_info.max_packet_length;
-	in_ep = bmda_probe_info.in_ep;
-	out_ep = bmda_probe_info.out_ep;
+	usb_link.ep_rx = bmda_probe_info.in_ep;
+	usb_link.ep_tx = bmda_probe_info.out_ep;
+	if (!bmda_usb_async_start(&usb_link)) {
+		/* Give the interface back so the HID fallback (or anything else) can have the adaptor */
+		libusb_release_interface(usb_link.device_handle, usb_link.interface);
+		libusb_close(usb_link.device_handle);
+		usb_link.device_handle = NULL;
+		return false;
+	}
 	return true;
 }
 
@@ -461,9 +471,10 @@ void dap_exit_function(void)
 			hid_close(handle);
 		}
 	} else if (type == CMSIS_TYPE_BULK) {
-		if (usb_handle) {
+		if (usb_link.device_handle) {
 			dap_disconnect();
-			libusb_close(usb_handle);
+			bmda_usb_async_stop(&usb_link);
+			libusb_close(usb_link.device_handle);
 		}
 	}
 }
@@ -505,32 +516,29 @@ ssize_t dbg_dap_cmd_hid(const uint8_t *const request_data, const size_t request_
 ssize_t dbg_dap_cmd_bulk(const uint8_t *const request_data, const size_t request_length, uint8_t *const response_data,
 	const size_t response_length)
 {
-	int transferred = 0;
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-qual"
-	const int request_result = libusb_bulk_transfer(
-		usb_handle, out_ep, (uint8_t *)request_data, (int)request_length, &transferred, TRANSFER_TIMEOUT_MS);
-#pragma GCC diagnostic push
-	if (request_result < 0) {
-		DEBUG_ERROR("CMSIS-DAP write error: %s (%d)\n", libusb_strerror(request_result), request_result);
-		return request_result;
+	/* Put the request and the read for its response in flight together */
+	int transferred = bmda_usb_await(bmda_usb_submit(
+		&usb_link, request_data, request_length, response_data, response_length, TRANSFER_TIMEOUT_MS));
+	if (transferred < 0) {
+		DEBUG_ERROR("CMSIS-DAP transfer error: %s (%d)\n", libusb_strerror(transferred), transferred);
+		return transferred;
 	}
 
 	/* We repeat the read in case we're out of step with the transmitter */
-	do {
-		const int response_result = libusb_bulk_transfer(
-			usb_handle, in_ep, response_data, (int)response_length, &transferred, TRANSFER_TIMEOUT_MS);
-		if (response_result < 0) {
-			DEBUG_ERROR("CMSIS-DAP read error: %s (%d)\n", libusb_strerror(response_result), response_result);
-			return response_result;
+	while (response_data[0] != request_data[0]) {
+		transferred = bmda_usb_await(
+			bmda_usb_submit(&usb_link, NULL, 0U, response_data, response_length, TRANSFER_TIMEOUT_MS));
+		if (transferred < 0) {
+			DEBUG_ERROR("CMSIS-DAP read error: %s (%d)\n", libusb_strerror(transferred), transferred);
+			return transferred;
 		}
-	} while (response_data[0] != request_data[0]);
+	}
 
 	/* If the response requested is the size of the packet size for the adaptor, generate a ZLP read to clean state */
 	if ((dap_quirks & DAP_QUIRK_NEEDS_EXTRA_ZLP_READ) && transferred == (int)dap_packet_size) {
 		uint8_t zlp;
-		int zlp_read = 0;
-		libusb_bulk_transfer(usb_handle, in_ep, &zlp, sizeof(zlp), &zlp_read, TRANSFER_TIMEOUT_MS);
+		const int zlp_read =
+			bmda_usb_await(bmda_usb_submit(&usb_link, NULL, 0U, &zlp, sizeof(zlp), TRANSFER_TIMEOUT_MS));
 		assert(zlp_read == 0);
 	}
 	return transferred;
@@ -553,10 +561,12 @@ static ssize_t dap_run_cmd_raw(const uint8_t *const request_data, const size_t r
 	}
 
 	ssize_t response = -1;
+	const uint32_t start = perf_now();
 	if (type == CMSIS_TYPE_HID)
 		response = dbg_dap_cmd_hid(request_data, request_length, data, dap_packet_size);
 	else if (type == CMSIS_TYPE_BULK)
 		response = dbg_dap_cmd_bulk(request_data, request_length, data, dap_packet_size);
+	perf_record(PERF_PROBE_ROUND_TRIP, start, request_length + (response > 0 ? (size_t)response : 0U));
 	if (response < 0)
 		return response;
 	const size_t result = (size_t)response;
@@ -771,6 +781,7 @@ void dap_adiv5_dp_init(adiv5_debug_port_s *target_dp)
 	target_dp->ap_write = dap_adiv5_ap_write;
 	target_dp->mem_read = dap_adiv5_mem_read;
 	target_dp->mem_write = dap_adiv5_mem_write;
+	target_dp->mem_txn = dap_adiv5_mem_txn;
 }
 
 void dap_adiv6_dp_init(adiv5_debug_port_s *target_dp)
@@ -780,4 +791,5 @@ void dap_adiv6_dp_init(adiv5_debug_port_s *target_dp)
 	target_dp->ap_write = dap_adiv6_ap_write;
 	target_dp->mem_read = dap_adiv6_mem_read;
 	target_dp->mem_write = dap_adiv6_mem_write;
+	target_dp->mem_txn = NULL;
 }
@@ -32,6 +32,7 @@
 #include <string.h>
 #include "general.h"
 #include "exception.h"
+#include "target_internal.h"
 #include "cmsis_dap.h"
 #include "dap.h"
 #include "dap_command.h"
@@ -521,6 +522,57 @@ void dap_adiv5_mem_write_single(
 		DEBUG_ERROR("dap_write_single failed (fault = %u)\n", target_dp->fault);
 }
 
+/*
+ * Perform a sequence of 32-bit memory accesses, packing as many into each DAP_Transfer as will fit. Each transfer
+ * starts with the SELECT, CSW and TAR writes for its first access, then needs a TAR write and DRW access for each
+ * further access.
+ */
+bool dap_adiv5_mem_txn(adiv5_access_port_s *const target_ap, const target_txn_op_s *const ops, const size_t count)
+{
+	adiv5_debug_port_s *const target_dp = target_ap->dp;
+	const bool wide_tar = target_ap->flags & ADIV5_AP_FLAGS_64BIT;
+	for (size_t begin = 0U; begin < count;) {
+		dap_transfer_request_s requests[12];
+		uint32_t *results[12];
+		size_t requests_count = dap_adiv5_mem_access_build(target_ap, requests, ops[begin].addr, ALIGN_32BIT);
+		size_t reads = 0U;
+		size_t end = begin;
+		for (; end < count; ++end) {
+			const target_txn_op_s *const op = &ops[end];
+			/* Work out if there's room for this access, including its TAR write if it's not the first */
+			const size_t needed = end == begin ? 1U : (wide_tar ? 3U : 2U);
+			if (requests_count + needed > 12U)
+				break;
+			if (end != begin) {
+				if (wide_tar) {
+					requests[requests_count].request = SWD_AP_TAR_HIGH;
+					requests[requests_count++].data = (uint32_t)(op->addr >> 32U);
+				}
+				requests[requests_count].request = SWD_AP_TAR_LOW;
+				requests[requests_count++].data = (uint32_t)op->addr;
+			}
+			if (op->write) {
+				requests[requests_count].request = SWD_AP_DRW;
+				requests[requests_count++].data = op->value;
+			} else {
+				/* AP_DRW access implies an RDBUFF in CMSIS-DAP, so each read's data comes back in order */
+				requests[requests_count].request = SWD_AP_DRW | DAP_TRANSFER_RnW;
+				requests[requests_count++].data = 0U;
+				results[reads++] = op->result;
+			}
+		}
+		uint32_t values[12];
+		if (!perform_dap_transfer_recoverable(target_dp, requests, requests_count, values, reads)) {
+			DEBUG_ERROR("%s failed (fault = %u)\n", __func__, target_dp->fault);
+			return false;
+		}
+		for (size_t i = 0U; i < reads; ++i)
+			*results[i] = values[i];
+		begin = end;
+	}
+	return true;
+}
+
 void dap_adiv6_mem_read_single(
 	adiv6_access_port_s *const target_ap, void *const dest, const target_addr64_t src, const align_e align)
 {
@@ -36,6 +36,24 @@
 #include "debug.h"
 
 uint16_t bmda_debug_flags = BMD_DEBUG_ERROR | BMD_DEBUG_WARNING;
+const char *bmda_debug_prefix = NULL;
+
+/* Print a message with bmda_debug_prefix put at the start of each of its lines */
+static void debug_print_prefixed(FILE *const where, const char *const format, va_list args)
+{
+	static bool line_start = true;
+	char message[1024];
+	(void)vsnprintf(message, sizeof(message), format, args);
+	for (const char *line = message; *line;) {
+		const char *const newline = strchr(line, '\n');
+		const size_t length = newline ? (size_t)(newline - line) + 1U : strlen(line);
+		if (line_start)
+			(void)fputs(bmda_debug_prefix, where);
+		(void)fwrite(line, 1, length, where);
+		line_start = newline != NULL;
+		line += length;
+	}
+}
 
 static void debug_print(const uint16_t level, const char *format, va_list args)
 {
@@ -44,6 +62,10 @@ static void debug_print(const uint16_t level, const char *format, va_list args)
 		return;
 	/* Check to see which of stderr and stdout the message should go to */
 	FILE *const where = bmda_debug_flags & BMD_DEBUG_USE_STDERR ? stderr : stdout;
+	if (bmda_debug_prefix) {
+		debug_print_prefixed(where, format, args);
+		return;
+	}
 	/* And shoot the message to the correct place */
 	(void)vfprintf(where, format, args);
 	/* Note: we have no useful way to use the output of the above call, so we ignore it. */
@@ -66,6 +66,8 @@ typedef const char *debug_str_t;
 #define BMD_DEBUG_LEVEL_SHIFT 2U
 
 extern uint16_t bmda_debug_flags;
+/* If set, put at the start of every line of debug output to tell several BMDA processes apart */
+extern const char *bmda_debug_prefix;
 
 void debug_error(const char *format, ...) DEBUG_FORMAT_ATTR;
 void debug_warning(const char *format, ...) DEBUG_FORMAT_ATTR;
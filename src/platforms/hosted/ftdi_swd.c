@@ -51,6 +51,7 @@ static bool ftdi_swd_seq_in_parity(uint32_t *res, size_t clock_cycles);
 static uint32_t ftdi_swd_seq_in(size_t clock_cycles);
 static void ftdi_swd_seq_out(uint32_t tms_states, size_t clock_cycles);
 static void ftdi_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles);
+static bool ftdi_swd_batch(swd_transaction_s *transactions, size_t count);
 
 bool ftdi_swd_possible(void)
 {
@@ -132,6 +133,8 @@ bool ftdi_swd_init(void)
 	swd_proc.seq_in_parity = ftdi_swd_seq_in_parity;
 	swd_proc.seq_out = ftdi_swd_seq_out;
 	swd_proc.seq_out_parity = ftdi_swd_seq_out_parity;
+	/* Batching needs the reads to be queueable, which is only the case with genuine MPSSE */
+	swd_proc.batch = do_mpsse ? ftdi_swd_batch : NULL;
 	return true;
 }
 
@@ -446,3 +449,51 @@ static void ftdi_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles)
 	else
 		ftdi_swd_seq_out_parity_raw(tms_states, parity, clock_cycles);
 }
+
+/*
+ * Run a batch of transactions with overrun detection on. Every transaction then has a data phase
+ * regardless of its ACK, so all the commands for the batch can be queued up and sent to the adaptor
+ * in one go, and all the ACKs and read data collected afterwards.
+ */
+static bool ftdi_swd_batch(swd_transaction_s *const transactions, const size_t count)
+{
+	for (size_t i = 0U; i < count; ++i) {
+		const swd_transaction_s *const transaction = &transactions[i];
+		ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+		ftdi_swd_seq_out_mpsse(transaction->request, 8U);
+		ftdi_swd_turnaround(SWDIO_STATUS_FLOAT);
+		/* Queue reading the 3 ACK bits */
+		const ftdi_mpsse_cmd_bits_s ack_cmd = {MPSSE_DO_READ | MPSSE_LSB | MPSSE_BITMODE, 2U};
+		ftdi_buffer_write_val(ack_cmd);
+		if (transaction->request & SWD_REQUEST_RNW) {
+			/* Queue reading the 32 data bits then the parity bit */
+			ftdi_mpsse_cmd_s data_cmd = {MPSSE_DO_READ | MPSSE_LSB};
+			write_le2(data_cmd.length, 0, 3U);
+			ftdi_buffer_write_val(data_cmd);
+			const ftdi_mpsse_cmd_bits_s parity_cmd = {MPSSE_DO_READ | MPSSE_LSB | MPSSE_BITMODE, 0U};
+			ftdi_buffer_write_val(parity_cmd);
+			ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+		} else {
+			ftdi_swd_turnaround(SWDIO_STATUS_DRIVE);
+			ftdi_swd_seq_out_parity_mpsse(transaction->data, calculate_odd_parity(transaction->data), 32U);
+		}
+		/* Finish the transaction with 8 idle cycles as adiv5_swd_raw_access() does */
+		ftdi_swd_seq_out_mpsse(0U, 8U);
+	}
+
+	/* Now collect the results, which also sends everything queued above */
+	for (size_t i = 0U; i < count; ++i) {
+		swd_transaction_s *const transaction = &transactions[i];
+		uint8_t ack = 0U;
+		ftdi_buffer_read_val(ack);
+		/* Bitwise reads come back MSb aligned, so shift them down */
+		transaction->ack = ack >> 5U;
+		if (transaction->request & SWD_REQUEST_RNW) {
+			uint8_t data[5U] = {0};
+			ftdi_buffer_read(data, sizeof(data));
+			transaction->data = read_le4(data, 0);
+			transaction->parity_ok = (data[4] >> 7U) == calculate_odd_parity(transaction->data);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,265 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements BMDA's gang programming mode. The probes to use are found with a single
+ * scan of the system, then a worker process is forked off per probe. Each worker is handed the
+ * probe the scan found for it and continues through BMDA's normal start up without scanning again,
+ * so it gets its own probe state and target list, and the workers' Flash operations all run in parallel. Once they
+ * have all finished, a pass/fail and throughput summary for each board is printed.
+ */
+
+#include "general.h"
+#include <errno.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32) || defined(__CYGWIN__)
+#include <fnmatch.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "bmp_hosted.h"
+#include "probe_info.h"
+#include "gang.h"
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+void bmda_gang_run(bmda_cli_options_s *const opt)
+{
+	(void)opt;
+	DEBUG_ERROR("Gang programming is not supported on this platform\n");
+	exit(1);
+}
+#else
+#define GANG_MAX_WORKERS 64U
+#define GANG_PATH_MAX    512U
+
+typedef struct gang_worker {
+	char serial[64];
+	char product[64];
+	char manufacturer[64];
+	char version[64];
+	probe_type_e type;
+	uint16_t vid;
+	uint16_t pid;
+	/* Where the probe sits on the USB bus, bus numbers start at 1 so 0 means unknown */
+	uint8_t bus;
+	uint8_t address;
+	pid_t worker_pid;
+	bool running;
+	/* Exit status of the worker, or -1 if it never started or was killed */
+	int status;
+	uint32_t elapsed;
+} gang_worker_s;
+
+typedef struct gang {
+	const char *pattern;
+	size_t count;
+	gang_worker_s workers[GANG_MAX_WORKERS];
+} gang_s;
+
+static gang_s gang;
+static char gang_debug_prefix[80];
+static char gang_wire_trace_path[GANG_PATH_MAX];
+static char gang_perf_path[GANG_PATH_MAX];
+
+/* Give a worker its own copy of an output file by putting its probe's serial number before the extension */
+static const char *gang_worker_path(
+	char *const buffer, const size_t size, const char *const path, const char *const serial)
+{
+	const char *const slash = strrchr(path, '/');
+	const char *const name = slash ? slash + 1U : path;
+	const char *extension = strrchr(name, '.');
+	/* A name that only starts with a dot (or has none) has no extension to keep */
+	if (extension == name)
+		extension = NULL;
+	const int stem_length = extension ? (int)(extension - path) : (int)strlen(path);
+	snprintf(buffer, size, "%.*s-%s%s", stem_length, path, serial, extension ? extension : "");
+	return buffer;
+}
+
+static void gang_add_probe(const probe_info_s *const probe, void *const context)
+{
+	gang_s *const probes = (gang_s *)context;
+	if (!probe->serial || fnmatch(probes->pattern, probe->serial, 0) != 0)
+		return;
+	if (probes->count == GANG_MAX_WORKERS) {
+		DEBUG_WARN("Too many matching probes, ignoring %s\n", probe->serial);
+		return;
+	}
+	gang_worker_s *const worker = &probes->workers[probes->count++];
+	snprintf(worker->serial, sizeof(worker->serial), "%s", probe->serial);
+	snprintf(worker->product, sizeof(worker->product), "%s", probe->product ? probe->product : "");
+	snprintf(worker->manufacturer, sizeof(worker->manufacturer), "%s", probe->manufacturer ? probe->manufacturer : "");
+	snprintf(worker->version, sizeof(worker->version), "%s", probe->version ? probe->version : "");
+	worker->type = probe->type;
+	worker->vid = probe->vid;
+	worker->pid = probe->pid;
+	if (probe->device) {
+		worker->bus = libusb_get_bus_number(probe->device);
+		worker->address = libusb_get_device_address(probe->device);
+	}
+	worker->status = -1;
+}
+
+/* Set a freshly forked worker up to carry on through start up driving just its own probe */
+static void gang_worker_setup(bmda_cli_options_s *const opt, gang_worker_s *const worker)
+{
+	opt->opt_serial = worker->serial;
+	opt->opt_position = 0;
+	opt->opt_gang_pattern = NULL;
+	snprintf(gang_debug_prefix, sizeof(gang_debug_prefix), "[%s] ", worker->serial);
+	bmda_debug_prefix = gang_debug_prefix;
+	/* The workers would otherwise all record their wire traces over the top of each other in the one file */
+	if (opt->opt_wire_trace)
+		opt->opt_wire_trace =
+			gang_worker_path(gang_wire_trace_path, sizeof(gang_wire_trace_path), opt->opt_wire_trace, worker->serial);
+	/* Likewise for the performance counters, which are each worker's own */
+	if (opt->opt_perf_file)
+		opt->opt_perf_file =
+			gang_worker_path(gang_perf_path, sizeof(gang_perf_path), opt->opt_perf_file, worker->serial);
+	/* Make sure the workers' output can only get interleaved a whole line at a time */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	/* If we know where the probe is, take it on directly rather than have start up scan for it again */
+	if (!worker->bus)
+		return;
+	const probe_info_s probe = {
+		.type = worker->type,
+		.vid = worker->vid,
+		.pid = worker->pid,
+		.manufacturer = worker->manufacturer,
+		.product = worker->product,
+		.serial = worker->serial,
+		.version = worker->version,
+	};
+	if (!bmda_probe_attach(opt, &bmda_probe_info, &probe, worker->bus, worker->address))
+		exit(1);
+}
+
+/* Work out how many bytes each worker handles so a throughput can be given for it */
+static size_t gang_operation_size(const bmda_cli_options_s *const opt)
+{
+	if (opt->opt_mode == BMP_MODE_FLASH_ERASE || opt->opt_mode == BMP_MODE_FLASH_READ)
+		return opt->opt_flash_size == UINT32_MAX ? 0U : opt->opt_flash_size;
+	if (!opt->opt_flash_file)
+		return 0U;
+	struct stat file_stat;
+	if (stat(opt->opt_flash_file, &file_stat) != 0)
+		return 0U;
+	return MIN((size_t)file_stat.st_size, opt->opt_flash_size);
+}
+
+static bool gang_summary(const bmda_cli_options_s *const opt, const uint32_t elapsed)
+{
+	const size_t size = gang_operation_size(opt);
+	size_t passed = 0;
+	DEBUG_WARN("     %-25s %-20s %-6s %10s %s\n", "Serial #", "Name", "Result", "Time", "Throughput");
+	for (size_t idx = 0; idx < gang.count; ++idx) {
+		const gang_worker_s *const worker = &gang.workers[idx];
+		const bool pass = worker->status == 0;
+		DEBUG_WARN(" %2zu. %-25s %-20s %-6s %8" PRIu32 "ms", idx + 1U, worker->serial, worker->product,
+			pass ? "PASS" : "FAIL", worker->elapsed);
+		if (pass && size)
+			DEBUG_WARN(" %8.3fkiB/s", (double)size / MAX(worker->elapsed, 1U));
+		DEBUG_WARN("\n");
+		passed += pass ? 1U : 0U;
+	}
+	DEBUG_WARN("%zu of %zu boards passed in %" PRIu32 "ms\n", passed, gang.count, elapsed);
+	return passed == gang.count;
+}
+
+/*
+ * Fork off a worker per matching probe. This returns only in the workers, with the options set up
+ * for their probe, while the parent waits for them all, prints the summary and exits.
+ */
+void bmda_gang_run(bmda_cli_options_s *const opt)
+{
+	if (opt->opt_mode == BMP_MODE_DEBUG) {
+		DEBUG_ERROR("Gang programming needs a Flash operation or other command line mode\n");
+		exit(1);
+	}
+	gang.pattern = opt->opt_gang_pattern;
+	bmda_probe_foreach(gang_add_probe, &gang);
+	if (!gang.count) {
+		DEBUG_ERROR("No probes with a serial number matching '%s' found\n", gang.pattern);
+		exit(1);
+	}
+	DEBUG_WARN("Starting workers for %zu probes\n", gang.count);
+	/* Don't let the workers inherit anything still waiting to be written out */
+	fflush(stdout);
+	fflush(stderr);
+
+	const uint32_t start_time = platform_time_ms();
+	size_t running = 0;
+	for (size_t idx = 0; idx < gang.count; ++idx) {
+		gang_worker_s *const worker = &gang.workers[idx];
+		const pid_t pid = fork();
+		if (pid == 0) {
+			gang_worker_setup(opt, worker);
+			return;
+		}
+		if (pid < 0) {
+			DEBUG_ERROR("Failed to start worker for %s: %s\n", worker->serial, strerror(errno));
+			continue;
+		}
+		worker->worker_pid = pid;
+		worker->running = true;
+		++running;
+	}
+	/* The parent drives no probe, so it has no counters of its own to write out on exit */
+	opt->opt_perf_file = NULL;
+
+	/* Wait for the workers to finish, noting how long each took */
+	while (running) {
+		int status = 0;
+		const pid_t pid = wait(&status);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			DEBUG_ERROR("Failed waiting for workers: %s\n", strerror(errno));
+			break;
+		}
+		for (size_t idx = 0; idx < gang.count; ++idx) {
+			gang_worker_s *const worker = &gang.workers[idx];
+			if (!worker->running || worker->worker_pid != pid)
+				continue;
+			worker->running = false;
+			worker->status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+			worker->elapsed = platform_time_ms() - start_time;
+			--running;
+			break;
+		}
+	}
+
+	exit(gang_summary(opt, platform_time_ms() - start_time) ? 0 : 1);
+}
+#endif
@@ -21,6 +21,10 @@
 /* This file implements a transparent channel over which the GDB Remote
  * Serial Debugging protocol is implemented.  This implementation for Linux
  * uses a TCP server on port 2000.
+ *
+ * As with the firmware's GDB interface, the BMP remote protocol is also served
+ * on this channel, backed by whichever probe BMDA is driving. Only one client
+ * is served at a time, anyone else trying to connect is turned away.
  */
 
 #ifndef __CYGWIN__
@@ -95,6 +99,23 @@ bool shutdown_bmda = false;
 static size_t gdb_buffer_used = 0U;
 static char gdb_buffer[GDB_BUFFER_LEN];
 
+/* Data received from GDB but not yet handed out by gdb_if_getchar() */
+#define GDB_RX_BUFFER_LEN 2048U
+static size_t gdb_rx_buffer_used = 0U;
+static size_t gdb_rx_buffer_next = 0U;
+static char gdb_rx_buffer[GDB_RX_BUFFER_LEN];
+
+/* Statistics for the current connection, reported when it closes */
+typedef struct gdb_if_stats {
+	uint32_t connected_at;
+	size_t bytes_in;
+	size_t bytes_out;
+	size_t remote_packets;
+	size_t clients_rejected;
+} gdb_if_stats_s;
+
+static gdb_if_stats_s gdb_if_stats;
+
 typedef struct sockaddr sockaddr_s;
 typedef struct sockaddr_in sockaddr_in_s;
 typedef struct sockaddr_in6 sockaddr_in6_s;
@@ -280,6 +301,57 @@ int gdb_if_init(void)
 	return -1;
 }
 
+static void gdb_if_reject_client(void)
+{
+	/* The listening socket is readable, so there should be a connection waiting, but don't block if it went away */
+	const int flags = socket_get_flags(gdb_if_serv);
+	socket_set_flags(gdb_if_serv, flags | O_NONBLOCK);
+	const socket_t client = accept(gdb_if_serv, NULL, NULL);
+	socket_set_flags(gdb_if_serv, flags);
+	if (client == INVALID_SOCKET)
+		return;
+	closesocket(client);
+	++gdb_if_stats.clients_rejected;
+	DEBUG_WARN("Rejected connection, another client is already connected\n");
+}
+
+static void gdb_if_wait_for_data(void)
+{
+	/* Don't leave anything sat in the probe backend's buffers while we could be blocked for a long time */
+	platform_buffer_flush();
+	/* Wait for data on the current connection, turning away any other clients that try to connect meanwhile */
+	while (true) {
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(gdb_if_conn, &fds);
+		FD_SET(gdb_if_serv, &fds);
+		if (select(FD_SETSIZE, &fds, NULL, NULL, NULL) < 0) {
+			if (socket_error() == op_needs_retry)
+				continue;
+			/* Let recv() deal with and report whatever went wrong */
+			return;
+		}
+		if (FD_ISSET(gdb_if_serv, &fds))
+			gdb_if_reject_client();
+		if (FD_ISSET(gdb_if_conn, &fds))
+			return;
+	}
+}
+
+static void gdb_if_report_stats(void)
+{
+	const uint32_t duration = platform_time_ms() - gdb_if_stats.connected_at;
+	DEBUG_INFO("Connection closed after %" PRIu32 "ms: %zu bytes in, %zu bytes out, %zu remote packets served, "
+			   "%zu clients rejected\n",
+		duration, gdb_if_stats.bytes_in, gdb_if_stats.bytes_out, gdb_if_stats.remote_packets,
+		gdb_if_stats.clients_rejected);
+}
+
+void gdb_if_count_remote_packet(void)
+{
+	++gdb_if_stats.remote_packets;
+}
+
 char gdb_if_getchar(void)
 {
 	if (gdb_if_conn == INVALID_SOCKET) {
@@ -303,35 +375,50 @@ char gdb_if_getchar(void)
 			}
 		}
 		DEBUG_INFO("Got connection\n");
+		gdb_if_stats = (gdb_if_stats_s){.connected_at = platform_time_ms()};
+		gdb_rx_buffer_used = 0U;
+		gdb_rx_buffer_next = 0U;
 		socket_set_flags(gdb_if_serv, flags);
 		socket_set_flags(gdb_if_conn, socket_get_flags(gdb_if_conn) & ~O_NONBLOCK);
 	}
 
-	char value = '\0';
+	/* Only go back to the socket once everything from the last recv() has been handed out */
+	if (gdb_rx_buffer_next < gdb_rx_buffer_used)
+		return gdb_rx_buffer[gdb_rx_buffer_next++];
+
 	int error = op_needs_retry;
 	while (error == op_needs_retry) {
-		const ssize_t result = recv(gdb_if_conn, &value, 1, 0);
+		gdb_if_wait_for_data();
+		const ssize_t result = recv(gdb_if_conn, gdb_rx_buffer, GDB_RX_BUFFER_LEN, 0);
 		if (result < 0) {
 			error = socket_error();
 			if (error == op_needs_retry)
 				continue;
-		} else
+		} else {
 			error = 0;
+			gdb_if_stats.bytes_in += (size_t)result;
+		}
 
 		if (result <= 0) {
 			handle_error(gdb_if_conn, "on socket");
 			gdb_if_conn = INVALID_SOCKET;
+			gdb_if_report_stats();
 			/* Return '+' in case we were waiting for an ACK */
 			return '+';
 		}
+		gdb_rx_buffer_used = (size_t)result;
 	}
-	return value;
+	gdb_rx_buffer_next = 1U;
+	return gdb_rx_buffer[0];
 }
 
 char gdb_if_getchar_to(uint32_t timeout)
 {
 	if (gdb_if_conn == INVALID_SOCKET)
 		return -1;
+	/* If there's data left over from the last recv(), there's no need to wait */
+	if (gdb_rx_buffer_next < gdb_rx_buffer_used)
+		return gdb_if_getchar();
 
 #ifndef __CYGWIN__
 	timeval_s select_timeout;
@@ -374,7 +461,9 @@ void gdb_if_flush(const bool force)
 	}
 
 	/* Send the data */
-	send(gdb_if_conn, gdb_buffer, gdb_buffer_used, 0);
+	const ssize_t result = send(gdb_if_conn, gdb_buffer, gdb_buffer_used, 0);
+	if (result > 0)
+		gdb_if_stats.bytes_out += (size_t)result;
 
 	/* Reset the buffer */
 	gdb_buffer_used = 0;
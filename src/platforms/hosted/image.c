@@ -0,0 +1,520 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements loading of ELF, Intel HEX and Motorola S-record images for BMDA's command line
+ * Flash operations. Rather than flattening an image into one padded binary, the populated ranges are kept
+ * as a sorted list of segments so that only the erase blocks an image actually touches get erased and
+ * written, and an image spanning several Flash regions can be programmed in a single session.
+ */
+
+#include "general.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "target_internal.h"
+#include "image.h"
+
+#define ELF_HEADER_LENGTH  52U
+#define ELF_PHDR_LENGTH    32U
+#define ELF_CLASS_32       1U
+#define ELF_DATA_LSB       1U
+#define ELF_DATA_MSB       2U
+#define ELF_PHDR_OFFSET    28U
+#define ELF_PHDR_SIZE      42U
+#define ELF_PHDR_COUNT     44U
+#define ELF_PT_LOAD        1U
+#define ELF_P_TYPE         0U
+#define ELF_P_OFFSET       4U
+#define ELF_P_PADDR        12U
+#define ELF_P_FILESZ       16U
+
+#define IHEX_DATA          0x00U
+#define IHEX_EOF           0x01U
+#define IHEX_EXT_SEGMENT   0x02U
+#define IHEX_START_SEGMENT 0x03U
+#define IHEX_EXT_LINEAR    0x04U
+#define IHEX_START_LINEAR  0x05U
+
+/* The longest record either text format can hold, an Intel HEX record with 255 data bytes */
+#define RECORD_MAX_LENGTH 260U
+
+#define IMAGE_VERIFY_CHUNK 0x1000U
+
+/* Add data at addr to the image, growing the last segment when the new data follows straight on from it */
+static bool image_append(bmda_image_s *const image, const uint32_t addr, const uint8_t *const data, const size_t size)
+{
+	if (!size)
+		return true;
+	if ((uint64_t)addr + size > UINT64_C(0x100000000)) {
+		DEBUG_ERROR("Image data at 0x%08" PRIx32 " runs past the end of the address space\n", addr);
+		return false;
+	}
+	if (image->count) {
+		bmda_image_segment_s *const last = &image->segments[image->count - 1U];
+		if ((uint64_t)last->addr + last->size == addr) {
+			uint8_t *const new_data = realloc(last->data, last->size + size);
+			if (!new_data)
+				return false;
+			memcpy(new_data + last->size, data, size);
+			last->data = new_data;
+			last->size += size;
+			return true;
+		}
+	}
+	bmda_image_segment_s *const segments = realloc(image->segments, sizeof(*segments) * (image->count + 1U));
+	if (!segments)
+		return false;
+	image->segments = segments;
+	bmda_image_segment_s *const segment = &segments[image->count];
+	segment->data = malloc(size);
+	if (!segment->data)
+		return false;
+	memcpy(segment->data, data, size);
+	segment->addr = addr;
+	segment->size = size;
+	++image->count;
+	return true;
+}
+
+static int image_segment_compare(const void *const lhs, const void *const rhs)
+{
+	const bmda_image_segment_s *const a = (const bmda_image_segment_s *)lhs;
+	const bmda_image_segment_s *const b = (const bmda_image_segment_s *)rhs;
+	return a->addr < b->addr ? -1 : a->addr > b->addr;
+}
+
+/* Sort the segments by address and merge any that touch or overlap, later data taking precedence */
+static bool image_coalesce(bmda_image_s *const image)
+{
+	if (image->count < 2U)
+		return true;
+	qsort(image->segments, image->count, sizeof(*image->segments), image_segment_compare);
+	size_t result = 0U;
+	for (size_t idx = 1U; idx < image->count; ++idx) {
+		bmda_image_segment_s *const current = &image->segments[result];
+		bmda_image_segment_s *const next = &image->segments[idx];
+		const uint64_t current_end = (uint64_t)current->addr + current->size;
+		if (next->addr > current_end) {
+			image->segments[++result] = *next;
+			continue;
+		}
+		const uint64_t next_end = (uint64_t)next->addr + next->size;
+		const size_t size = (size_t)(MAX(current_end, next_end) - current->addr);
+		uint8_t *const data = realloc(current->data, size);
+		if (!data)
+			return false;
+		memcpy(data + (next->addr - current->addr), next->data, next->size);
+		free(next->data);
+		current->data = data;
+		current->size = size;
+	}
+	image->count = result + 1U;
+	return true;
+}
+
+static uint32_t image_read(const uint8_t *const data, const size_t offset, const size_t width, const bool big_endian)
+{
+	uint32_t value = 0U;
+	for (size_t idx = 0U; idx < width; ++idx) {
+		const size_t byte = big_endian ? idx : width - idx - 1U;
+		value = (value << 8U) | data[offset + byte];
+	}
+	return value;
+}
+
+static bool image_parse_elf(bmda_image_s *const image, const uint8_t *const data, const size_t size)
+{
+	if (size < ELF_HEADER_LENGTH || data[4] != ELF_CLASS_32 || (data[5] != ELF_DATA_LSB && data[5] != ELF_DATA_MSB)) {
+		DEBUG_ERROR("Only 32-bit ELF files are supported\n");
+		return false;
+	}
+	const bool big_endian = data[5] == ELF_DATA_MSB;
+	const uint32_t phdr_offset = image_read(data, ELF_PHDR_OFFSET, 4U, big_endian);
+	const uint16_t phdr_size = image_read(data, ELF_PHDR_SIZE, 2U, big_endian);
+	const uint16_t phdr_count = image_read(data, ELF_PHDR_COUNT, 2U, big_endian);
+	if (phdr_size < ELF_PHDR_LENGTH || (uint64_t)phdr_offset + (uint64_t)phdr_size * phdr_count > size) {
+		DEBUG_ERROR("ELF program header table is invalid\n");
+		return false;
+	}
+
+	/* Program the load segments at their physical (load) addresses, skipping those that are only zero-filled */
+	for (uint16_t idx = 0U; idx < phdr_count; ++idx) {
+		const size_t phdr = phdr_offset + (size_t)idx * phdr_size;
+		if (image_read(data, phdr + ELF_P_TYPE, 4U, big_endian) != ELF_PT_LOAD)
+			continue;
+		const uint32_t offset = image_read(data, phdr + ELF_P_OFFSET, 4U, big_endian);
+		const uint32_t addr = image_read(data, phdr + ELF_P_PADDR, 4U, big_endian);
+		const uint32_t file_size = image_read(data, phdr + ELF_P_FILESZ, 4U, big_endian);
+		if ((uint64_t)offset + file_size > size) {
+			DEBUG_ERROR("ELF segment %u lies outside the file\n", idx);
+			return false;
+		}
+		if (!image_append(image, addr, data + offset, file_size))
+			return false;
+	}
+	return true;
+}
+
+static bool image_hex_byte(const char *const text, uint8_t *const value)
+{
+	if (!isxdigit((unsigned char)text[0]) || !isxdigit((unsigned char)text[1]))
+		return false;
+	char digits[3] = {text[0], text[1], '\0'};
+	*value = (uint8_t)strtoul(digits, NULL, 16);
+	return true;
+}
+
+/* Decode the hex digit pairs of a record into bytes, returning how many were decoded or 0 on error */
+static size_t image_decode_record(const char *const text, const size_t length, uint8_t *const record)
+{
+	if (length & 1U || length / 2U > RECORD_MAX_LENGTH)
+		return 0U;
+	for (size_t idx = 0U; idx < length / 2U; ++idx) {
+		if (!image_hex_byte(text + idx * 2U, record + idx))
+			return 0U;
+	}
+	return length / 2U;
+}
+
+/* Find the next line in a text image, returning its length without the line ending, or 0 at the end of the file */
+static size_t image_next_line(const char *const text, const size_t size, size_t *const offset, const char **const line)
+{
+	while (*offset < size && (text[*offset] == '\r' || text[*offset] == '\n' || text[*offset] == ' '))
+		++*offset;
+	*line = text + *offset;
+	size_t length = 0U;
+	while (*offset < size && text[*offset] != '\r' && text[*offset] != '\n') {
+		++*offset;
+		++length;
+	}
+	/* Drop any trailing whitespace so it does not get mistaken for record data */
+	while (length && isspace((unsigned char)(*line)[length - 1U]))
+		--length;
+	return length;
+}
+
+static bool image_parse_ihex(bmda_image_s *const image, const char *const text, const size_t size)
+{
+	uint8_t record[RECORD_MAX_LENGTH];
+	uint32_t base = 0U;
+	size_t offset = 0U;
+	size_t line_number = 0U;
+	const char *line;
+	while (true) {
+		const size_t length = image_next_line(text, size, &offset, &line);
+		if (!length)
+			break;
+		++line_number;
+		/* A record is ':' followed by the length, 16-bit address, type, data and checksum */
+		const size_t decoded = line[0] == ':' ? image_decode_record(line + 1U, length - 1U, record) : 0U;
+		if (decoded < 5U || decoded != record[0] + 5U) {
+			DEBUG_ERROR("Invalid Intel HEX record on line %zu\n", line_number);
+			return false;
+		}
+		uint8_t checksum = 0U;
+		for (size_t idx = 0U; idx < decoded; ++idx)
+			checksum += record[idx];
+		if (checksum) {
+			DEBUG_ERROR("Intel HEX checksum mismatch on line %zu\n", line_number);
+			return false;
+		}
+
+		const uint8_t count = record[0];
+		const uint16_t addr = image_read(record, 1U, 2U, true);
+		switch (record[3]) {
+		case IHEX_DATA:
+			if (!image_append(image, base + addr, record + 4U, count))
+				return false;
+			break;
+		case IHEX_EOF:
+			return true;
+		case IHEX_EXT_SEGMENT:
+		case IHEX_EXT_LINEAR:
+			if (count != 2U) {
+				DEBUG_ERROR("Invalid Intel HEX address record on line %zu\n", line_number);
+				return false;
+			}
+			base = image_read(record, 4U, 2U, true) << (record[3] == IHEX_EXT_LINEAR ? 16U : 4U);
+			break;
+		case IHEX_START_SEGMENT:
+		case IHEX_START_LINEAR:
+			/* Entry point records are of no use for programming */
+			break;
+		default:
+			DEBUG_ERROR("Unknown Intel HEX record type %02x on line %zu\n", record[3], line_number);
+			return false;
+		}
+	}
+	DEBUG_WARN("Intel HEX file has no end of file record\n");
+	return true;
+}
+
+static bool image_parse_srec(bmda_image_s *const image, const char *const text, const size_t size)
+{
+	uint8_t record[RECORD_MAX_LENGTH];
+	size_t offset = 0U;
+	size_t line_number = 0U;
+	const char *line;
+	while (true) {
+		const size_t length = image_next_line(text, size, &offset, &line);
+		if (!length)
+			break;
+		++line_number;
+		/* A record is 'S', the type digit, then the length, address, data and checksum */
+		const size_t decoded =
+			length > 2U && line[0] == 'S' ? image_decode_record(line + 2U, length - 2U, record) : 0U;
+		if (decoded < 2U || decoded != record[0] + 1U || !isdigit((unsigned char)line[1])) {
+			DEBUG_ERROR("Invalid S-record on line %zu\n", line_number);
+			return false;
+		}
+		uint8_t checksum = 0U;
+		for (size_t idx = 0U; idx < decoded; ++idx)
+			checksum += record[idx];
+		if (checksum != 0xffU) {
+			DEBUG_ERROR("S-record checksum mismatch on line %zu\n", line_number);
+			return false;
+		}
+
+		/* Only S1, S2 and S3 carry data, with a 2, 3 or 4 byte address respectively */
+		const uint8_t type = line[1] - '0';
+		if (type < 1U || type > 3U)
+			continue;
+		const size_t addr_length = type + 1U;
+		if (decoded < addr_length + 2U) {
+			DEBUG_ERROR("Invalid S-record on line %zu\n", line_number);
+			return false;
+		}
+		uint32_t addr = 0U;
+		for (size_t idx = 0U; idx < addr_length; ++idx)
+			addr = (addr << 8U) | record[1U + idx];
+		if (!image_append(image, addr, record + 1U + addr_length, decoded - addr_length - 2U))
+			return false;
+	}
+	return true;
+}
+
+static bool image_is_raw(const char *const file_name)
+{
+	const char *const extension = strrchr(file_name, '.');
+	if (!extension || strlen(extension) != 4U)
+		return false;
+	return tolower((unsigned char)extension[1]) == 'b' && tolower((unsigned char)extension[2]) == 'i' &&
+		tolower((unsigned char)extension[3]) == 'n';
+}
+
+bool bmda_image_parse(
+	bmda_image_s *const image, const char *const file_name, const uint8_t *const data, const size_t size)
+{
+	image->segments = NULL;
+	image->count = 0U;
+	image->format = NULL;
+	/* Files named .bin are always raw, otherwise work out the format from the content */
+	if (image_is_raw(file_name) || size < 4U)
+		return true;
+
+	bool result;
+	if (data[0] == 0x7fU && data[1] == 'E' && data[2] == 'L' && data[3] == 'F') {
+		image->format = "ELF";
+		result = image_parse_elf(image, data, size);
+	} else if (data[0] == ':' && isxdigit(data[1])) {
+		image->format = "Intel HEX";
+		result = image_parse_ihex(image, (const char *)data, size);
+	} else if (data[0] == 'S' && isdigit(data[1]) && isxdigit(data[2])) {
+		image->format = "S-record";
+		result = image_parse_srec(image, (const char *)data, size);
+	} else
+		return true;
+
+	if (result)
+		result = image_coalesce(image);
+	if (result && !image->count) {
+		DEBUG_ERROR("%s file contains no data to program\n", image->format);
+		result = false;
+	}
+	if (!result)
+		bmda_image_free(image);
+	return result;
+}
+
+void bmda_image_free(bmda_image_s *const image)
+{
+	for (size_t idx = 0U; idx < image->count; ++idx)
+		free(image->segments[idx].data);
+	free(image->segments);
+	image->segments = NULL;
+	image->count = 0U;
+}
+
+/*
+ * Work out how much of the range [addr, end) starting at addr lies in a single Flash region, returning
+ * that region in flash. If addr is not in Flash, flash is set to NULL and the length returned is how far
+ * it is to the next region that is (or to end if there is none).
+ */
+static size_t image_flash_extent(
+	target_s *const target, const uint64_t addr, const uint64_t end, target_flash_s **const flash)
+{
+	*flash = target_flash_for_addr(target, (uint32_t)addr);
+	if (*flash)
+		return (size_t)(MIN(end, (uint64_t)(*flash)->start + (*flash)->length) - addr);
+	uint64_t next = end;
+	for (target_flash_s *region = target->flash; region; region = region->next) {
+		if (region->start > addr && region->start < next)
+			next = region->start;
+	}
+	return (size_t)(next - addr);
+}
+
+static bool image_erase(target_s *const target, const uint64_t start, const uint64_t end, size_t *const erased)
+{
+	DEBUG_INFO("Erasing %" PRIu64 " bytes at 0x%08" PRIx64 "\n", end - start, start);
+	if (!target_flash_erase_deferred(target, (target_addr_t)start, (size_t)(end - start))) {
+		DEBUG_ERROR("Flash erase failed!\n");
+		return false;
+	}
+	*erased += (size_t)(end - start);
+	return true;
+}
+
+bool bmda_image_flash(target_s *const target, const bmda_image_s *const image)
+{
+	/*
+	 * Erase every block the image touches before writing anything, merging runs of neighbouring blocks
+	 * in the same region into one request and making sure a block shared by two segments is only erased once
+	 */
+	const uint32_t start_time = platform_time_ms();
+	size_t populated = 0U;
+	size_t erased = 0U;
+	uint64_t lowest = UINT64_MAX;
+	uint64_t highest = 0U;
+	target_flash_s *pending_flash = NULL;
+	uint64_t pending_start = 0U;
+	uint64_t pending_end = 0U;
+	for (size_t idx = 0U; idx < image->count; ++idx) {
+		const bmda_image_segment_s *const segment = &image->segments[idx];
+		const uint64_t end = (uint64_t)segment->addr + segment->size;
+		for (uint64_t addr = segment->addr; addr < end;) {
+			target_flash_s *flash;
+			const size_t length = image_flash_extent(target, addr, end, &flash);
+			if (!flash) {
+				DEBUG_WARN("Skipping 0x%08" PRIx64 "+%zu as it is not in Flash\n", addr, length);
+				addr += length;
+				continue;
+			}
+			const uint64_t block_mask = ~(uint64_t)(flash->blocksize - 1U);
+			const uint64_t block_start = addr & block_mask;
+			const uint64_t block_end =
+				MIN((addr + length + flash->blocksize - 1U) & block_mask, (uint64_t)flash->start + flash->length);
+			if (flash == pending_flash && block_start <= pending_end)
+				pending_end = MAX(pending_end, block_end);
+			else {
+				if (pending_flash && !image_erase(target, pending_start, pending_end, &erased))
+					return false;
+				pending_flash = flash;
+				pending_start = block_start;
+				pending_end = block_end;
+			}
+			populated += length;
+			lowest = MIN(lowest, addr);
+			highest = MAX(highest, addr + length);
+			addr += length;
+		}
+	}
+	if (!pending_flash) {
+		DEBUG_ERROR("Nothing in the image lies in the target's Flash\n");
+		return false;
+	}
+	if (!image_erase(target, pending_start, pending_end, &erased))
+		return false;
+
+	/* Now write the segments out in address order, letting the buffered write take care of padding */
+	for (size_t idx = 0U; idx < image->count; ++idx) {
+		const bmda_image_segment_s *const segment = &image->segments[idx];
+		const uint64_t end = (uint64_t)segment->addr + segment->size;
+		for (uint64_t addr = segment->addr; addr < end;) {
+			target_flash_s *flash;
+			const size_t length = image_flash_extent(target, addr, end, &flash);
+			if (flash) {
+				DEBUG_INFO("Flashing %zu bytes at 0x%08" PRIx64 "\n", length, addr);
+				if (!target_flash_write(target, addr, segment->data + (addr - segment->addr), length)) {
+					DEBUG_ERROR("Flashing failed!\n");
+					return false;
+				}
+			}
+			addr += length;
+		}
+	}
+	if (!target_flash_complete(target)) {
+		DEBUG_ERROR("Flashing failed!\n");
+		return false;
+	}
+	const uint32_t end_time = platform_time_ms();
+	DEBUG_WARN("Flash Write succeeded for %zu bytes in %zu segments (%zu bytes erased, image spans %" PRIu64
+			   " bytes), %8.3fkiB/s\n",
+		populated, image->count, erased, highest - lowest, (double)populated / (end_time - start_time));
+	return true;
+}
+
+bool bmda_image_verify(target_s *const target, const bmda_image_s *const image)
+{
+	uint8_t data[IMAGE_VERIFY_CHUNK];
+	size_t verified = 0U;
+	const uint32_t start_time = platform_time_ms();
+	for (size_t idx = 0U; idx < image->count; ++idx) {
+		const bmda_image_segment_s *const segment = &image->segments[idx];
+		const uint64_t end = (uint64_t)segment->addr + segment->size;
+		for (uint64_t addr = segment->addr; addr < end;) {
+			target_flash_s *flash;
+			const size_t length = image_flash_extent(target, addr, end, &flash);
+			/* Only check what was written, as anything outside Flash was skipped */
+			for (size_t offset = 0U; flash && offset < length; offset += IMAGE_VERIFY_CHUNK) {
+				const size_t chunk = MIN(length - offset, IMAGE_VERIFY_CHUNK);
+				const uint32_t chunk_addr = (uint32_t)(addr + offset);
+				if (target_mem32_read(target, data, chunk_addr, chunk)) {
+					DEBUG_ERROR("Read failed at flash address 0x%08" PRIx32 "\n", chunk_addr);
+					return false;
+				}
+				if (memcmp(data, segment->data + (chunk_addr - segment->addr), chunk) != 0) {
+					DEBUG_ERROR("Verify failed at flash region 0x%08" PRIx32 "\n", chunk_addr);
+					return false;
+				}
+				verified += chunk;
+			}
+			addr += length;
+		}
+	}
+	const uint32_t end_time = platform_time_ms();
+	DEBUG_WARN(
+		"Verify succeeded for %zu bytes, %8.3fkiB/s\n", verified, (double)verified / (end_time - start_time));
+	return true;
+}
@@ -624,7 +624,7 @@ bool jlink_init(void)
 		libusb_close(bmda_probe_info.usb_link->device_handle);
 		return false;
 	}
-	if (!link->ep_tx || !link->ep_rx) {
+	if (!link->ep_tx || !link->ep_rx || !bmda_usb_async_start(link)) {
 		DEBUG_ERROR("Device setup failed\n");
 		libusb_release_interface(bmda_probe_info.usb_link->device_handle, bmda_probe_info.usb_link->interface);
 		libusb_close(bmda_probe_info.usb_link->device_handle);
@@ -632,6 +632,7 @@ bool jlink_init(void)
 	}
 	if (!jlink_get_capabilities() || !jlink_get_version() || !jlink_get_interfaces()) {
 		DEBUG_ERROR("Failed to read J-Link information\n");
+		bmda_usb_async_stop(link);
 		libusb_release_interface(bmda_probe_info.usb_link->device_handle, bmda_probe_info.usb_link->interface);
 		libusb_close(bmda_probe_info.usb_link->device_handle);
 		return false;
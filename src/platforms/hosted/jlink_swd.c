@@ -48,6 +48,18 @@
 static const uint8_t jlink_adiv5_request[2] = {0xffU, 0xf0U};
 static const uint8_t jlink_adiv5_out_turnaround = 0x2U;
 
+/*
+ * Transactions run as part of a batch use the same cycle layout as jlink_adiv5_raw_access():
+ * 8 OUT cycles for the request, then 4 IN cycles for the turn-around and ACK (which the adaptor
+ * samples such that the ACK lands in bits 8-10), followed by either 33 IN cycles for the data and
+ * parity and 2 OUT cycles to turn around and idle (reads), or 1 OUT cycle to turn around, 33 for
+ * the data and parity and 8 idle cycles (writes). The data read back lands in bits 11-43.
+ */
+#define JLINK_SWD_BATCH_READ_CYCLES  46U
+#define JLINK_SWD_BATCH_WRITE_CYCLES 54U
+/* jlink_transfer() is limited to 512 bytes of cycles per transfer */
+#define JLINK_SWD_BATCH_MAX_CYCLES 4096U
+
 /* Direction sequence for the data phase of a write transaction */
 static const uint8_t jlink_adiv5_write_request[6] = {
 	/* clang-format off */
@@ -73,6 +85,8 @@ static bool jlink_swd_seq_in_parity(uint32_t *result, size_t clock_cycles);
 static void jlink_swd_seq_out(uint32_t tms_states, size_t clock_cycles);
 static void jlink_swd_seq_out_parity(uint32_t tms_states, size_t clock_cycles);
 
+static bool jlink_swd_batch(swd_transaction_s *transactions, size_t count);
+
 static bool jlink_adiv5_raw_write_no_check(uint16_t addr, uint32_t data);
 static uint32_t jlink_adiv5_raw_read_no_check(uint16_t addr);
 static uint32_t jlink_adiv5_raw_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t request_value);
@@ -92,11 +106,13 @@ bool jlink_swd_init(adiv5_debug_port_s *dp)
 	swd_proc.seq_in_parity = jlink_swd_seq_in_parity;
 	swd_proc.seq_out = jlink_swd_seq_out;
 	swd_proc.seq_out_parity = jlink_swd_seq_out_parity;
+	swd_proc.batch = jlink_swd_batch;
 
 	/* Set up the accelerated SWD functions for basic target operations */
 	dp->write_no_check = jlink_adiv5_raw_write_no_check;
 	dp->read_no_check = jlink_adiv5_raw_read_no_check;
 	dp->low_access = jlink_adiv5_raw_access;
+	adiv5_swd_batch_init(dp);
 	return true;
 }
 
@@ -334,3 +350,86 @@ static uint32_t jlink_adiv5_raw_access(
 	DEBUG_PROBE("%s: addr %04x <- %08" PRIx32 "\n", __func__, addr, request_value);
 	return result_value;
 }
+
+static void jlink_swd_batch_set_bits(
+	uint8_t *const buffer, const size_t offset, const uint32_t value, const size_t bits)
+{
+	for (size_t bit = 0U; bit < bits; ++bit) {
+		if (value & (1U << bit))
+			buffer[(offset + bit) >> 3U] |= 1U << ((offset + bit) & 7U);
+	}
+}
+
+static uint32_t jlink_swd_batch_get_bits(const uint8_t *const buffer, const size_t offset, const size_t bits)
+{
+	uint32_t value = 0U;
+	for (size_t bit = 0U; bit < bits; ++bit)
+		value |= (uint32_t)((buffer[(offset + bit) >> 3U] >> ((offset + bit) & 7U)) & 1U) << bit;
+	return value;
+}
+
+/* Run as many of the transactions as will fit in a single jlink_transfer(), returning how many that was */
+static size_t jlink_swd_batch_transfer(swd_transaction_s *const transactions, const size_t count)
+{
+	uint8_t direction[JLINK_SWD_BATCH_MAX_CYCLES / 8U] = {0};
+	uint8_t data_in[JLINK_SWD_BATCH_MAX_CYCLES / 8U] = {0};
+	uint8_t data_out[JLINK_SWD_BATCH_MAX_CYCLES / 8U] = {0};
+
+	/* Lay out the cycles for as many transactions as will fit */
+	size_t cycles = 0U;
+	size_t batched = 0U;
+	for (; batched < count; ++batched) {
+		const swd_transaction_s *const transaction = &transactions[batched];
+		const bool read = transaction->request & SWD_REQUEST_RNW;
+		const size_t length = read ? JLINK_SWD_BATCH_READ_CYCLES : JLINK_SWD_BATCH_WRITE_CYCLES;
+		if (cycles + length > JLINK_SWD_BATCH_MAX_CYCLES)
+			break;
+		/* Request, OUT */
+		jlink_swd_batch_set_bits(direction, cycles, 0xffU, 8U);
+		jlink_swd_batch_set_bits(data_in, cycles, transaction->request, 8U);
+		if (read)
+			/* Turn-around and ACK then data and parity are IN, leaving the final turn-around and idle OUT */
+			jlink_swd_batch_set_bits(direction, cycles + 44U, 0x3U, 2U);
+		else {
+			/* Turn-around and ACK are IN, then everything after is OUT */
+			jlink_swd_batch_set_bits(direction, cycles + 12U, UINT32_MAX, 32U);
+			jlink_swd_batch_set_bits(direction, cycles + 44U, 0x3ffU, 10U);
+			jlink_swd_batch_set_bits(data_in, cycles + 13U, transaction->data, 32U);
+			jlink_swd_batch_set_bits(data_in, cycles + 45U, calculate_odd_parity(transaction->data), 1U);
+		}
+		cycles += length;
+	}
+
+	if (!jlink_transfer(cycles, direction, data_in, data_out))
+		return 0U;
+
+	/* Now unpack the ACKs and any data read back */
+	cycles = 0U;
+	for (size_t i = 0U; i < batched; ++i) {
+		swd_transaction_s *const transaction = &transactions[i];
+		transaction->ack = jlink_swd_batch_get_bits(data_out, cycles + 8U, 3U);
+		if (transaction->request & SWD_REQUEST_RNW) {
+			transaction->data = jlink_swd_batch_get_bits(data_out, cycles + 11U, 32U);
+			transaction->parity_ok =
+				jlink_swd_batch_get_bits(data_out, cycles + 43U, 1U) == calculate_odd_parity(transaction->data);
+			cycles += JLINK_SWD_BATCH_READ_CYCLES;
+		} else
+			cycles += JLINK_SWD_BATCH_WRITE_CYCLES;
+		DEBUG_PROBE("%s: request %02x ack %u data %08" PRIx32 "\n", __func__, transaction->request, transaction->ack,
+			transaction->data);
+	}
+	return batched;
+}
+
+static bool jlink_swd_batch(swd_transaction_s *const transactions, const size_t count)
+{
+	for (size_t offset = 0U; offset < count;) {
+		const size_t batched = jlink_swd_batch_transfer(transactions + offset, count - offset);
+		if (!batched) {
+			DEBUG_ERROR("jlink_swd_batch failed\n");
+			return false;
+		}
+		offset += batched;
+	}
+	return true;
+}
@@ -0,0 +1,362 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements BMDA's multi-target Flash mode, which erases, writes and verifies several
+ * targets found in the same scan (a JTAG chain or SWD multi-drop bus) in one session. Each target
+ * is driven by a small state machine and the targets are stepped round-robin, so while one target's
+ * Flash controller is busy erasing a block, the others get written to or verified.
+ */
+
+#include "general.h"
+#include <errno.h>
+
+#include "target_internal.h"
+#include "multi_flash.h"
+
+/* How much of an image to write or verify in one step before moving on to the next target */
+#define MULTI_FLASH_CHUNK_SIZE 0x1000U
+
+typedef enum multi_flash_state {
+	MULTI_FLASH_ERASE,
+	MULTI_FLASH_WRITE,
+	MULTI_FLASH_VERIFY,
+	MULTI_FLASH_DONE,
+	MULTI_FLASH_FAILED,
+} multi_flash_state_e;
+
+typedef struct multi_flash_job {
+	size_t number; /* Position of the target in the scan */
+	target_s *target;
+	const char *file_name;
+	uint8_t *image;
+	bool owns_image;
+	size_t size;
+	target_addr32_t start;
+	multi_flash_state_e state;
+	const char *failed_in; /* Name of the step that failed if state is MULTI_FLASH_FAILED */
+	target_flash_erase_s erase;
+	size_t offset; /* How far through the image the current write or verify has got */
+	uint32_t start_time;
+	uint32_t end_time;
+} multi_flash_job_s;
+
+/* Parse a target list such as "1,3-5" or "all" into a flag per scan position */
+static bool multi_flash_parse_targets(const char *const list, bool *const selected, const size_t num_targets)
+{
+	if (!strcmp(list, "all")) {
+		for (size_t idx = 0; idx < num_targets; ++idx)
+			selected[idx] = true;
+		return true;
+	}
+	for (const char *pos = list; *pos;) {
+		char *end = NULL;
+		const unsigned long first = strtoul(pos, &end, 10);
+		unsigned long last = first;
+		if (end != pos && *end == '-')
+			last = strtoul(end + 1, &end, 10);
+		if (end == pos || first < 1U || last < first || last > num_targets || (*end && *end != ',')) {
+			DEBUG_ERROR("Invalid target list '%s', there are %zu targets available\n", list, num_targets);
+			return false;
+		}
+		for (unsigned long number = first; number <= last; ++number)
+			selected[number - 1U] = true;
+		pos = *end ? end + 1 : end;
+	}
+	return true;
+}
+
+static uint8_t *multi_flash_load(const char *const file_name, size_t *const size)
+{
+	FILE *const file = fopen(file_name, "rb");
+	if (!file) {
+		DEBUG_ERROR("Open file %s failed: %s\n", file_name, strerror(errno));
+		return NULL;
+	}
+	uint8_t *data = NULL;
+	if (fseek(file, 0, SEEK_END) == 0) {
+		const long length = ftell(file);
+		if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+			data = malloc(length ? (size_t)length : 1U);
+			if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+				free(data);
+				data = NULL;
+			}
+			*size = (size_t)length;
+		}
+	}
+	if (!data)
+		DEBUG_ERROR("Reading file %s failed\n", file_name);
+	fclose(file);
+	return data;
+}
+
+static void multi_flash_fail(multi_flash_job_s *const job, const char *const step)
+{
+	DEBUG_ERROR("Target %zu: %s failed\n", job->number, step);
+	/* Don't leave the target's Flash controller part way through an operation */
+	if (job->target && job->target->flash_mode)
+		target_flash_complete(job->target);
+	job->state = MULTI_FLASH_FAILED;
+	job->failed_in = step;
+	job->end_time = platform_time_ms();
+}
+
+static void multi_flash_finish(multi_flash_job_s *const job)
+{
+	/* An erase on its own leaves the target in Flash mode, so finish that off before resetting */
+	if (job->target->flash_mode && !target_flash_complete(job->target)) {
+		multi_flash_fail(job, "Erase");
+		return;
+	}
+	target_reset(job->target);
+	job->state = MULTI_FLASH_DONE;
+	job->end_time = platform_time_ms();
+}
+
+/* Attach to the job's target and work out where in its Flash the operation goes */
+static bool multi_flash_setup(const bmda_cli_options_s *const opt, multi_flash_job_s *const job,
+	target_controller_s *const controller)
+{
+	job->target = target_attach_n(job->number, controller);
+	if (!job->target) {
+		multi_flash_fail(job, "Attach");
+		return false;
+	}
+
+	/* Default to the lowest Flash region like the single target modes do */
+	target_addr32_t lowest_flash_start = UINT32_MAX;
+	size_t lowest_flash_size = 0;
+	for (target_flash_s *flash = job->target->flash; flash; flash = flash->next) {
+		if (flash->start < lowest_flash_start) {
+			lowest_flash_start = flash->start;
+			lowest_flash_size = flash->length;
+		}
+	}
+	job->start = opt->opt_flash_start == UINT32_MAX ? lowest_flash_start : opt->opt_flash_start;
+	if (opt->opt_mode == BMP_MODE_FLASH_ERASE)
+		job->size = opt->opt_flash_size == UINT32_MAX ? lowest_flash_size : opt->opt_flash_size;
+	else if (opt->opt_flash_size < job->size)
+		/* restrict to size given on command line */
+		job->size = opt->opt_flash_size;
+
+	if (opt->opt_mode == BMP_MODE_FLASH_VERIFY) {
+		job->state = MULTI_FLASH_VERIFY;
+		return true;
+	}
+	job->state = MULTI_FLASH_ERASE;
+	if (!target_flash_erase_begin(&job->erase, job->target, job->start, job->size)) {
+		multi_flash_fail(job, "Erase");
+		return false;
+	}
+	return true;
+}
+
+/* Do the next piece of work for a job, which should only take as long as one chunk of Flash I/O */
+static void multi_flash_step(const bmda_cli_options_s *const opt, multi_flash_job_s *const job)
+{
+	switch (job->state) {
+	case MULTI_FLASH_ERASE: {
+		const flash_poll_result_e result = target_flash_erase_step(&job->erase);
+		if (result == FLASH_POLL_ERROR)
+			multi_flash_fail(job, "Erase");
+		else if (result == FLASH_POLL_DONE) {
+			if (opt->opt_mode == BMP_MODE_FLASH_ERASE)
+				multi_flash_finish(job);
+			else
+				job->state = MULTI_FLASH_WRITE;
+		}
+		break;
+	}
+	case MULTI_FLASH_WRITE:
+		if (job->offset < job->size) {
+			const size_t chunk = MIN(job->size - job->offset, MULTI_FLASH_CHUNK_SIZE);
+			if (!target_flash_write(job->target, job->start + job->offset, job->image + job->offset, chunk)) {
+				multi_flash_fail(job, "Write");
+				break;
+			}
+			job->offset += chunk;
+		}
+		if (job->offset == job->size) {
+			if (!target_flash_complete(job->target))
+				multi_flash_fail(job, "Write");
+			else if (opt->opt_mode == BMP_MODE_FLASH_WRITE_VERIFY) {
+				job->state = MULTI_FLASH_VERIFY;
+				job->offset = 0;
+			} else
+				multi_flash_finish(job);
+		}
+		break;
+	case MULTI_FLASH_VERIFY:
+		if (job->offset < job->size) {
+			uint8_t data[MULTI_FLASH_CHUNK_SIZE];
+			const size_t chunk = MIN(job->size - job->offset, MULTI_FLASH_CHUNK_SIZE);
+			if (target_mem32_read(job->target, data, job->start + job->offset, chunk) ||
+				memcmp(data, job->image + job->offset, chunk) != 0) {
+				DEBUG_ERROR("Target %zu: verify failed at flash region 0x%08" PRIx32 "\n", job->number,
+					(uint32_t)(job->start + job->offset));
+				multi_flash_fail(job, "Verify");
+				break;
+			}
+			job->offset += chunk;
+		}
+		if (job->offset == job->size)
+			multi_flash_finish(job);
+		break;
+	default:
+		break;
+	}
+}
+
+static void multi_flash_summary(const multi_flash_job_s *const jobs, const size_t count, const uint32_t start_time)
+{
+	size_t total_bytes = 0;
+	size_t passed = 0;
+	for (size_t idx = 0; idx < count; ++idx) {
+		const multi_flash_job_s *const job = &jobs[idx];
+		const char *const driver = job->target ? job->target->driver : "(not attached)";
+		if (job->state != MULTI_FLASH_DONE) {
+			DEBUG_WARN("*** %2zu %-24s FAILED in %s\n", job->number, driver, job->failed_in);
+			continue;
+		}
+		const uint32_t elapsed = MAX(job->end_time - job->start_time, 1U);
+		DEBUG_WARN("*** %2zu %-24s OK     %8zu bytes in %6" PRIu32 "ms, %8.3fkiB/s\n", job->number, driver, job->size,
+			elapsed, (double)job->size / elapsed);
+		total_bytes += job->size;
+		++passed;
+	}
+	const uint32_t elapsed = MAX(platform_time_ms() - start_time, 1U);
+	DEBUG_WARN("%zu of %zu targets succeeded, %zu bytes in %" PRIu32 "ms, %8.3fkiB/s overall\n", passed, count,
+		total_bytes, elapsed, (double)total_bytes / elapsed);
+}
+
+int bmda_multi_flash(
+	const bmda_cli_options_s *const opt, const size_t num_targets, target_controller_s *const controller)
+{
+	const bmda_cli_mode_e mode = opt->opt_mode;
+	if (mode != BMP_MODE_FLASH_ERASE && mode != BMP_MODE_FLASH_WRITE && mode != BMP_MODE_FLASH_WRITE_VERIFY &&
+		mode != BMP_MODE_FLASH_VERIFY) {
+		DEBUG_ERROR("Multiple targets can only be erased, written or verified\n");
+		return -1;
+	}
+
+	bool *const selected = calloc(num_targets, sizeof(*selected));
+	if (!selected) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return -1;
+	}
+	if (!multi_flash_parse_targets(opt->opt_targets, selected, num_targets)) {
+		free(selected);
+		return -1;
+	}
+	size_t count = 0;
+	for (size_t idx = 0; idx < num_targets; ++idx)
+		count += selected[idx] ? 1U : 0U;
+	if (!count) {
+		DEBUG_ERROR("No targets selected\n");
+		free(selected);
+		return -1;
+	}
+
+	/* Either one image goes to all the targets, or each gets its own in the order they're listed */
+	const size_t files = mode == BMP_MODE_FLASH_ERASE ? 0U : opt->opt_flash_file_count;
+	if (mode != BMP_MODE_FLASH_ERASE && files != 1U && files != count) {
+		DEBUG_ERROR("Give either one file for all targets or one per target, got %zu for %zu targets\n", files, count);
+		free(selected);
+		return -1;
+	}
+	multi_flash_job_s *const jobs = calloc(count, sizeof(*jobs));
+	if (!jobs) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(selected);
+		return -1;
+	}
+
+	int result = 0;
+	for (size_t number = 1, idx = 0; number <= num_targets; ++number) {
+		if (!selected[number - 1U])
+			continue;
+		multi_flash_job_s *const job = &jobs[idx];
+		job->number = number;
+		if (files) {
+			job->owns_image = files > 1U || idx == 0U;
+			job->file_name = opt->opt_flash_files[files > 1U ? idx : 0U];
+			if (job->owns_image)
+				job->image = multi_flash_load(job->file_name, &job->size);
+			else {
+				job->image = jobs[0].image;
+				job->size = jobs[0].size;
+			}
+			if (!job->image) {
+				result = -1;
+				goto free_jobs;
+			}
+		}
+		++idx;
+	}
+
+	/* Attach to and set up all the targets before any of them get started on */
+	const uint32_t start_time = platform_time_ms();
+	for (size_t idx = 0; idx < count; ++idx) {
+		jobs[idx].start_time = start_time;
+		multi_flash_setup(opt, &jobs[idx], controller);
+	}
+
+	/* Step the targets round-robin until they've all either finished or failed */
+	for (bool active = true; active;) {
+		active = false;
+		for (size_t idx = 0; idx < count; ++idx) {
+			multi_flash_job_s *const job = &jobs[idx];
+			if (job->state >= MULTI_FLASH_DONE)
+				continue;
+			multi_flash_step(opt, job);
+			active |= job->state < MULTI_FLASH_DONE;
+		}
+	}
+
+	multi_flash_summary(jobs, count, start_time);
+	for (size_t idx = 0; idx < count; ++idx) {
+		if (jobs[idx].state != MULTI_FLASH_DONE)
+			result = -1;
+		if (jobs[idx].target)
+			target_detach(jobs[idx].target);
+	}
+
+free_jobs:
+	for (size_t idx = 0; idx < count; ++idx) {
+		if (jobs[idx].owns_image)
+			free(jobs[idx].image);
+	}
+	free(jobs);
+	free(selected);
+	return result;
+}
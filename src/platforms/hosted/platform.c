@@ -47,6 +47,11 @@
 
 #include "bmp_remote.h"
 #include "bmp_hosted.h"
+#include "sim.h"
+#include "wire_trace.h"
+#include "scan_cache.h"
+#include "gang.h"
+#include "perf.h"
 #if HOSTED_BMP_ONLY == 0
 #include "stlinkv2.h"
 #include "ftdi_bmp.h"
@@ -58,6 +63,9 @@
 #include "bmda_gpiod.h"
 #endif
 
+/* How long to wait between polls of a running target unless asked to poll at full speed */
+#define BMDA_PACE_POLL_MS 8U
+
 bmda_probe_s bmda_probe_info;
 
 #ifndef ENABLE_GPIOD
@@ -97,6 +105,10 @@ static void exit_function(void)
 #ifdef ENABLE_RTT
 	rtt_if_exit();
 #endif
+	bmda_wire_trace_close();
+	bmda_wire_replay_close();
+	if (cl_opts.opt_perf_file)
+		perf_write_json(cl_opts.opt_perf_file);
 #if HOSTED_BMP_ONLY == 0
 	if (bmda_probe_info.libusb_ctx)
 		libusb_exit(bmda_probe_info.libusb_ctx);
@@ -122,14 +134,25 @@ void platform_init(int argc, char **argv)
 #endif
 	cl_init(&cl_opts, argc, argv);
 	atexit(exit_function);
+	if (cl_opts.opt_scan_cache)
+		bmda_scan_cache_load(cl_opts.opt_scan_cache);
 	signal(SIGTERM, sigterm_handler);
 	signal(SIGINT, sigterm_handler);
 
+	/* In gang programming mode this only returns in the workers, each already set up with its one probe */
+	if (cl_opts.opt_gang_pattern)
+		bmda_gang_run(&cl_opts);
+
 	if (cl_opts.opt_device)
 		bmda_probe_info.type = PROBE_TYPE_BMP;
 	else if (cl_opts.opt_gpio_map)
 		bmda_probe_info.type = PROBE_TYPE_GPIOD;
-	else if (!find_debuggers(&cl_opts, &bmda_probe_info))
+	else if (cl_opts.opt_sim_model)
+		bmda_probe_info.type = PROBE_TYPE_SIM;
+	else if (cl_opts.opt_replay_file)
+		bmda_probe_info.type = PROBE_TYPE_REPLAY;
+	/* Gang workers are normally handed their probe, so only need to scan if they weren't */
+	else if (bmda_probe_info.type == PROBE_TYPE_NONE && !find_debuggers(&cl_opts, &bmda_probe_info))
 		exit(1);
 
 	if (cl_opts.opt_list_only)
@@ -172,10 +195,23 @@ void platform_init(int argc, char **argv)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		if (!sim_init(&cl_opts))
+			exit(1);
+		break;
+
+	case PROBE_TYPE_REPLAY:
+		if (!bmda_wire_replay_init(cl_opts.opt_replay_file))
+			exit(1);
+		break;
+
 	default:
 		exit(1);
 	}
 
+	if (cl_opts.opt_wire_trace && !bmda_wire_trace_open(cl_opts.opt_wire_trace))
+		exit(1);
+
 	if (cl_opts.opt_max_frequency)
 		max_frequency = cl_opts.opt_max_frequency;
 
@@ -200,6 +236,8 @@ bool bmda_swd_scan(const uint32_t targetid)
 	case PROBE_TYPE_FTDI:
 	case PROBE_TYPE_CMSIS_DAP:
 	case PROBE_TYPE_JLINK:
+	case PROBE_TYPE_SIM:
+	case PROBE_TYPE_REPLAY:
 #ifdef ENABLE_GPIOD
 	case PROBE_TYPE_GPIOD:
 #endif
@@ -215,7 +253,7 @@ bool bmda_swd_scan(const uint32_t targetid)
 	}
 }
 
-bool bmda_swd_dp_init(adiv5_debug_port_s *dp)
+static bool bmda_probe_swd_dp_init(adiv5_debug_port_s *const dp)
 {
 #if HOSTED_BMP_ONLY == 1
 	(void)dp;
@@ -235,19 +273,43 @@ bool bmda_swd_dp_init(adiv5_debug_port_s *dp)
 		return jlink_swd_init(dp);
 
 	case PROBE_TYPE_FTDI:
-		return ftdi_swd_init();
+		if (!ftdi_swd_init())
+			return false;
+		/* FTDI adaptors are driven at the SWD bit level, so can make use of batched DP accesses */
+		adiv5_swd_batch_init(dp);
+		return true;
 #endif
 
 #ifdef ENABLE_GPIOD
 	case PROBE_TYPE_GPIOD:
-		return bmda_gpiod_swd_init();
+		if (!bmda_gpiod_swd_init())
+			return false;
+		adiv5_swd_batch_init(dp);
+		return true;
 #endif
 
+	case PROBE_TYPE_SIM:
+		if (!sim_swd_init())
+			return false;
+		adiv5_swd_batch_init(dp);
+		return true;
+
+	case PROBE_TYPE_REPLAY:
+		return bmda_wire_replay_swd_init(dp);
+
 	default:
 		return false;
 	}
 }
 
+bool bmda_swd_dp_init(adiv5_debug_port_s *const dp)
+{
+	if (!bmda_probe_swd_dp_init(dp))
+		return false;
+	bmda_wire_trace_dp_init(dp);
+	return true;
+}
+
 void bmda_add_jtag_dev(const uint32_t dev_index, const jtag_dev_s *const jtag_dev)
 {
 	if (bmda_probe_info.type == PROBE_TYPE_BMP)
@@ -264,6 +326,7 @@ bool bmda_jtag_scan(void)
 	case PROBE_TYPE_FTDI:
 	case PROBE_TYPE_JLINK:
 	case PROBE_TYPE_CMSIS_DAP:
+	case PROBE_TYPE_SIM:
 #ifdef ENABLE_GPIOD
 	case PROBE_TYPE_GPIOD:
 #endif
@@ -304,6 +367,9 @@ bool bmda_jtag_init(void)
 		return bmda_gpiod_jtag_init();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_jtag_init();
+
 	default:
 		return false;
 	}
@@ -330,9 +396,22 @@ void bmda_adiv5_dp_init(adiv5_debug_port_s *const dp)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		if (cl_opts.opt_no_hl) {
+			DEBUG_WARN("Not using ADIv5 acceleration commands\n");
+			break;
+		}
+		sim_adiv5_dp_init(dp);
+		break;
+
+	case PROBE_TYPE_REPLAY:
+		bmda_wire_replay_dp_init(dp);
+		break;
+
 	default:
 		break;
 	}
+	bmda_wire_trace_dp_init(dp);
 }
 
 void bmda_adiv6_dp_init(adiv5_debug_port_s *const dp)
@@ -351,9 +430,14 @@ void bmda_adiv6_dp_init(adiv5_debug_port_s *const dp)
 		break;
 #endif
 
+	case PROBE_TYPE_REPLAY:
+		bmda_wire_replay_dp_init(dp);
+		break;
+
 	default:
 		break;
 	}
+	bmda_wire_trace_dp_init(dp);
 }
 
 void bmda_jtag_dp_init(adiv5_debug_port_s *const dp)
@@ -369,9 +453,8 @@ void bmda_jtag_dp_init(adiv5_debug_port_s *const dp)
 	default:
 		break;
 	}
-#else
-	(void)dp;
 #endif
+	bmda_wire_trace_dp_init(dp);
 }
 
 void bmda_riscv_jtag_dtm_init(riscv_dmi_s *const dmi)
@@ -414,6 +497,12 @@ char *bmda_adaptor_ident(void)
 	case PROBE_TYPE_GPIOD:
 		return "GPIOD";
 
+	case PROBE_TYPE_SIM:
+		return "Simulator";
+
+	case PROBE_TYPE_REPLAY:
+		return "Replay";
+
 	default:
 		return NULL;
 	}
@@ -436,6 +525,9 @@ const char *platform_target_voltage(void)
 		return jlink_target_voltage_string();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_target_voltage();
+
 	default:
 		return "Unknown";
 	}
@@ -466,12 +558,21 @@ void platform_nrst_set_val(const bool assert)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		sim_nrst_set_val(assert);
+		break;
+
+	case PROBE_TYPE_REPLAY:
+		bmda_wire_replay_nrst_set_val(assert);
+		break;
+
 	default:
 		break;
 	}
+	bmda_wire_trace_nrst_set(assert);
 }
 
-bool platform_nrst_get_val(void)
+static bool bmda_nrst_get_val(void)
 {
 	switch (bmda_probe_info.type) {
 	case PROBE_TYPE_BMP:
@@ -491,11 +592,24 @@ bool platform_nrst_get_val(void)
 		return dap_nrst_get_val();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_nrst_get_val();
+
+	case PROBE_TYPE_REPLAY:
+		return bmda_wire_replay_nrst_get_val();
+
 	default:
 		return false;
 	}
 }
 
+bool platform_nrst_get_val(void)
+{
+	const bool asserted = bmda_nrst_get_val();
+	bmda_wire_trace_nrst_get(asserted);
+	return asserted;
+}
+
 void platform_max_frequency_set(const uint32_t freq)
 {
 	if (!freq)
@@ -528,6 +642,13 @@ void platform_max_frequency_set(const uint32_t freq)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		sim_max_frequency_set(freq);
+		break;
+
+	case PROBE_TYPE_REPLAY:
+		break;
+
 	default:
 		DEBUG_WARN("Setting max debug interface frequency not available or not yet implemented\n");
 		break;
@@ -563,6 +684,12 @@ uint32_t platform_max_frequency_get(void)
 		return jlink_max_frequency_get();
 #endif
 
+	case PROBE_TYPE_SIM:
+		return sim_max_frequency_get();
+
+	case PROBE_TYPE_REPLAY:
+		return FREQ_FIXED;
+
 	default:
 		DEBUG_WARN("Reading max debug interface frequency not available or not yet implemented\n");
 		return 0;
@@ -624,6 +751,10 @@ uint32_t platform_target_voltage_sense(void)
 		break;
 #endif
 
+	case PROBE_TYPE_SIM:
+		target_voltage = 33U;
+		break;
+
 	default:
 		break;
 	}
@@ -634,6 +765,10 @@ uint32_t platform_target_voltage_sense(void)
 void platform_buffer_flush(void)
 {
 	switch (bmda_probe_info.type) {
+	case PROBE_TYPE_BMP:
+		remote_buffer_flush();
+		break;
+
 #if HOSTED_BMP_ONLY == 0
 	case PROBE_TYPE_FTDI:
 		ftdi_buffer_flush();
@@ -648,7 +783,13 @@ void platform_buffer_flush(void)
 void platform_pace_poll(void)
 {
 	if (!cl_opts.fast_poll)
-		platform_delay(8);
+		platform_delay(BMDA_PACE_POLL_MS);
+}
+
+/* How long platform_pace_poll() waits for, which limits how often anything done per poll can happen */
+uint32_t bmda_pace_poll_ms(void)
+{
+	return cl_opts.fast_poll ? 0U : BMDA_PACE_POLL_MS;
 }
 
 void platform_target_clk_output_enable(const bool enable)
@@ -85,9 +85,12 @@ typedef enum probe_type {
 	PROBE_TYPE_CMSIS_DAP,
 	PROBE_TYPE_JLINK,
 	PROBE_TYPE_GPIOD,
+	PROBE_TYPE_SIM,
+	PROBE_TYPE_REPLAY,
 } probe_type_e;
 
 void bmda_display_probe(void);
+uint32_t bmda_pace_poll_ms(void);
 
 #ifdef ENABLE_GPIOD
 #include "bmda_gpiod_platform.h"
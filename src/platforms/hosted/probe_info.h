@@ -68,4 +68,10 @@ const probe_info_s *probe_info_correct_order(probe_info_s *list);
 const probe_info_s *probe_info_filter(const probe_info_s *list, const char *serial, size_t position);
 void probe_info_to_bmda_probe(const probe_info_s *probe, bmda_probe_s *info);
 
+#if HOSTED_BMP_ONLY == 0
+size_t bmda_probe_foreach(void (*callback)(const probe_info_s *probe, void *context), void *context);
+bool bmda_probe_attach(
+	bmda_cli_options_s *cl_opts, bmda_probe_s *info, const probe_info_s *probe, uint8_t bus, uint8_t address);
+#endif
+
 #endif /* PLATFORMS_HOSTED_PROBE_INFO_H */
@@ -0,0 +1,185 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements BMDA's statistical profiler, which samples the PC of a running Cortex-M core
+ * through the DWT's PC sample register (so no SWO connection is needed) and writes the resulting
+ * histogram out as a gprof gmon.out file for use with `arm-none-eabi-gprof firmware.elf gmon.out`.
+ * Where the probe supports it, the sampling is done by the probe itself, which hands back a histogram.
+ */
+
+#include "general.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "target_internal.h"
+#include "cortexm.h"
+#include "buffer_utils.h"
+#include "profile.h"
+
+/* gmon.out is made of a header followed by tagged records, the one we use being a PC histogram */
+#define GMON_VERSION        1U
+#define GMON_TAG_TIME_HIST  0U
+#define GMON_HEADER_LENGTH  20U
+#define GMON_HIST_LENGTH    32U
+/* gprof's histogram bins are 16-bit, and we cap how many we write to keep the file sensible */
+#define GMON_MAX_BINS       (1U << 20U)
+#define GMON_MAX_BIN_COUNT  0xffffU
+
+static int profile_compare(const void *const lhs, const void *const rhs)
+{
+	const cortexm_pc_bucket_s *const a = (const cortexm_pc_bucket_s *)lhs;
+	const cortexm_pc_bucket_s *const b = (const cortexm_pc_bucket_s *)rhs;
+	/* Order by count, most frequent first, with the empty buckets at the end */
+	if (a->count != b->count)
+		return a->count > b->count ? -1 : 1;
+	return a->pc < b->pc ? -1 : a->pc > b->pc;
+}
+
+static bool profile_write_gmon(
+	const char *const file_name, const cortexm_pc_profile_s *const profile, const size_t used)
+{
+	/* Work out the PC range covered and a bin size that keeps the histogram a reasonable size */
+	uint32_t low_pc = UINT32_MAX;
+	uint32_t high_pc = 0U;
+	for (size_t i = 0U; i < used; ++i) {
+		low_pc = MIN(low_pc, profile->buckets[i].pc & ~1U);
+		high_pc = MAX(high_pc, (profile->buckets[i].pc & ~1U) + 2U);
+	}
+	uint32_t bin_size = 2U;
+	while ((high_pc - low_pc) / bin_size > GMON_MAX_BINS)
+		bin_size <<= 1U;
+	low_pc &= ~(bin_size - 1U);
+	const uint32_t bins = (high_pc - low_pc + bin_size - 1U) / bin_size;
+	high_pc = low_pc + bins * bin_size;
+
+	uint16_t *const histogram = calloc(bins, sizeof(uint16_t));
+	if (!histogram) {
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+	for (size_t i = 0U; i < used; ++i) {
+		const size_t bin = ((profile->buckets[i].pc & ~1U) - low_pc) / bin_size;
+		histogram[bin] = MIN(histogram[bin] + profile->buckets[i].count, GMON_MAX_BIN_COUNT);
+	}
+
+	FILE *const file = fopen(file_name, "wb");
+	if (!file) {
+		DEBUG_ERROR("Failed to open %s for writing\n", file_name);
+		free(histogram);
+		return false;
+	}
+
+	/* The header is the "gmon" cookie and version followed by padding, all in the target's (little) endianness */
+	uint8_t header[GMON_HEADER_LENGTH + 1U + GMON_HIST_LENGTH] = {'g', 'm', 'o', 'n'};
+	write_le4(header, 4U, GMON_VERSION);
+	/* Then the histogram record header: tag, PC range, bin count, sample rate and the dimension sampled in */
+	header[GMON_HEADER_LENGTH] = GMON_TAG_TIME_HIST;
+	uint8_t *const hist_header = header + GMON_HEADER_LENGTH + 1U;
+	write_le4(hist_header, 0U, low_pc);
+	write_le4(hist_header, 4U, high_pc);
+	write_le4(hist_header, 8U, bins);
+	write_le4(hist_header, 12U,
+		profile->duration_ms ? (uint32_t)(((uint64_t)profile->samples * 1000U) / profile->duration_ms) : 1U);
+	memcpy(hist_header + 16U, "seconds", 7U);
+	hist_header[31U] = 's';
+
+	bool result = fwrite(header, sizeof(header), 1U, file) == 1U;
+	for (uint32_t bin = 0U; result && bin < bins; ++bin) {
+		uint8_t count[2U];
+		write_le2(count, 0U, histogram[bin]);
+		result = fwrite(count, sizeof(count), 1U, file) == 1U;
+	}
+	result = fclose(file) == 0 && result;
+	free(histogram);
+	if (!result)
+		DEBUG_ERROR("Failed to write %s\n", file_name);
+	else
+		DEBUG_WARN("Wrote %" PRIu32 " bins of %" PRIu32 " bytes covering 0x%08" PRIx32 "-0x%08" PRIx32 " to %s\n",
+			bins, bin_size, low_pc, high_pc, file_name);
+	return result;
+}
+
+int bmda_profile(target_s *const target, const bmda_cli_options_s *const opt)
+{
+	if (!target_is_cortexm(target)) {
+		DEBUG_ERROR("Profiling is only supported on Cortex-M targets\n");
+		return -1;
+	}
+
+	cortexm_pc_profile_s profile = {
+		.buckets = calloc(CORTEXM_PROFILE_BUCKETS, sizeof(cortexm_pc_bucket_s)),
+		.bucket_count = CORTEXM_PROFILE_BUCKETS,
+	};
+	if (!profile.buckets) {
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return -1;
+	}
+
+	DEBUG_WARN("Profiling %s for %" PRIu32 "ms\n", target->driver, opt->opt_profile_duration);
+	/* Attaching halted the core, so let it run while we sample it */
+	target_halt_resume(target, false);
+	if (!cortexm_pc_profile(target, &profile, opt->opt_profile_duration)) {
+		DEBUG_ERROR("PC sampling failed or is not implemented on this core\n");
+		free(profile.buckets);
+		return -1;
+	}
+	/* Work the sample rate out in tenths of a sample per second */
+	const uint64_t rate = profile.duration_ms ? ((uint64_t)profile.samples * 10000U) / profile.duration_ms : 0U;
+	DEBUG_WARN("%" PRIu32 " samples in %" PRIu32 "ms (%" PRIu64 ".%" PRIu64 " samples/s), %" PRIu32 " idle, %" PRIu32
+			   " dropped\n",
+		profile.samples, profile.duration_ms, rate / 10U, rate % 10U, profile.idle, profile.dropped);
+
+	/* Pack the used buckets to the front, most frequently seen first */
+	qsort(profile.buckets, profile.bucket_count, sizeof(*profile.buckets), profile_compare);
+	size_t used = 0U;
+	while (used < profile.bucket_count && profile.buckets[used].count)
+		++used;
+
+	bool result = true;
+	if (!used)
+		DEBUG_WARN("No samples taken while the core was running\n");
+	else if (opt->opt_flash_file)
+		result = profile_write_gmon(opt->opt_flash_file, &profile, used);
+	else {
+		const uint32_t running = MAX(profile.samples - profile.idle, 1U);
+		for (size_t i = 0U; i < used; ++i) {
+			/* Each PC's share of the samples taken while the core was running, in tenths of a percent */
+			const uint64_t share = ((uint64_t)profile.buckets[i].count * 1000U) / running;
+			DEBUG_WARN("0x%08" PRIx32 " %8" PRIu32 " %3" PRIu64 ".%" PRIu64 "%%\n", profile.buckets[i].pc,
+				profile.buckets[i].count, share / 10U, share % 10U);
+		}
+	}
+	free(profile.buckets);
+	return result ? 0 : -1;
+}
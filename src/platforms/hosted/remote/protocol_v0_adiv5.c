@@ -171,8 +171,12 @@ void remote_v0_adiv5_mem_read_bytes(
 			DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)src + offset);
 			return;
 		}
-		/* If the response indicates all's OK, decode the data read */
-		unhexify(data + offset, buffer + 1, amount);
+		/* If the response indicates all's OK, decode the data read, checking it's all there and valid */
+		if ((size_t)length < 1U + (amount * 2U) || !unhexify_checked(data + offset, buffer + 1, amount)) {
+			DEBUG_ERROR("%s malformed response around 0x%08zx\n", __func__, (size_t)src + offset);
+			ap->dp->fault = 1U;
+			return;
+		}
 	}
 }
 
@@ -45,6 +45,11 @@
 #include "protocol_v4_adiv6.h"
 #include "protocol_v4_riscv.h"
 
+static bool remote_v4_have_mem_poll = false;
+static bool remote_v4_have_run_stub = false;
+static bool remote_v4_have_mem_batch = false;
+static bool remote_v4_have_pc_profile = false;
+
 bool remote_v4_init(void)
 {
 	/* Before we initialise the remote functions structure, determine what accelerations are available */
@@ -75,6 +80,12 @@ bool remote_v4_init(void)
 		remote_funcs.adiv5_init = remote_v4_adiv5_init;
 	if (accelerations & REMOTE_ACCEL_ADIV6)
 		remote_funcs.adiv6_init = remote_v4_adiv6_init;
+	remote_v4_have_mem_poll = accelerations & REMOTE_ACCEL_MEM_POLL;
+	remote_v4_have_run_stub = accelerations & REMOTE_ACCEL_RUN_STUB;
+	remote_v4_have_mem_batch = accelerations & REMOTE_ACCEL_MEM_BATCH;
+	remote_v4_have_pc_profile = accelerations & REMOTE_ACCEL_PC_PROFILE;
+	if (remote_v4_have_mem_batch)
+		remote_funcs.buffer_flush = remote_v4_adiv5_batch_flush;
 	if (accelerations & REMOTE_ACCEL_RISCV) {
 		/* For RISC-V we have to ask the acceleration backend what protocols it supports */
 		platform_buffer_write(REMOTE_RISCV_PROTOCOLS_STR, sizeof(REMOTE_RISCV_PROTOCOLS_STR));
@@ -103,6 +114,17 @@ bool remote_v4_adiv5_init(adiv5_debug_port_s *const dp)
 	dp->ap_write = remote_v4_adiv5_ap_write;
 	dp->mem_read = remote_v4_adiv5_mem_read_bytes;
 	dp->mem_write = remote_v4_adiv5_mem_write_bytes;
+	if (remote_v4_have_mem_poll)
+		dp->mem_poll = remote_v4_adiv5_mem_poll;
+	if (remote_v4_have_run_stub)
+		dp->run_stub = remote_v4_adiv5_run_stub;
+	if (remote_v4_have_pc_profile)
+		dp->pc_profile = remote_v4_adiv5_pc_profile;
+	if (remote_v4_have_mem_batch) {
+		dp->mem_read = remote_v4_adiv5_mem_read_batched;
+		dp->mem_write = remote_v4_adiv5_mem_write_batched;
+		dp->mem_txn = remote_v4_adiv5_mem_txn;
+	}
 	return true;
 }
 
@@ -36,14 +36,39 @@
 #include "protocol_v3_adiv5.h"
 #include "protocol_v4_defs.h"
 #include "protocol_v4_adiv5.h"
+#include "target_internal.h"
 #include "hex_utils.h"
 #include "exception.h"
+#include "cortexm.h"
 
 static bool remote_v4_have_dp_version_command = true;
 static bool remote_v4_have_dp_targetsel_command = true;
 static uint8_t remote_v4_current_dp_version = UINT8_MAX;
 static uint32_t remote_v4_current_dp_targetsel = UINT32_MAX;
 
+/* Longest we ask the firmware to poll for in one go, kept well inside the link's read timeout */
+#define REMOTE_V4_MEM_POLL_SLICE_MS 500U
+/* Longest we let a stub run on the firmware before taking over waiting for it ourselves */
+#define REMOTE_V4_RUN_STUB_TIMEOUT_MS 1000U
+/* Longest we ask the firmware to sample the PC for in one go, also kept well inside the link's read timeout */
+#define REMOTE_V4_PC_PROFILE_SLICE_MS 500U
+
+/*
+ * Small memory accesses recorded for sending to the firmware as a single batch request. Writes are held back
+ * here until either a read needs its result, the batch fills, or something else needs to talk to the probe.
+ */
+typedef struct remote_v4_adiv5_batch {
+	adiv5_access_port_s *ap;
+	uint32_t csw;
+	size_t count;
+	size_t length;
+	size_t reads;
+	char ops[(REMOTE_MEM_BATCH_MAX_OPS * REMOTE_MEM_BATCH_WRITE_OP_LENGTH) + 1U];
+	uint32_t *results[REMOTE_MEM_BATCH_MAX_OPS];
+} remote_v4_adiv5_batch_s;
+
+static remote_v4_adiv5_batch_s remote_v4_batch;
+
 static void remote_v4_adiv5_dp_version(adiv5_debug_port_s *const dp)
 {
 	/*
@@ -150,8 +175,12 @@ void remote_v4_adiv5_mem_read_bytes(
 			DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)src + offset);
 			return;
 		}
-		/* If the response indicates all's OK, decode the data read */
-		unhexify(data + offset, buffer + 1, amount);
+		/* If the response indicates all's OK, decode the data read, checking it's all there and valid */
+		if ((size_t)length < 1U + (amount * 2U) || !unhexify_checked(data + offset, buffer + 1, amount)) {
+			DEBUG_ERROR("%s malformed response around 0x%08zx\n", __func__, (size_t)src + offset);
+			ap->dp->fault = 1U;
+			return;
+		}
 	}
 }
 
@@ -194,3 +223,235 @@ void remote_v4_adiv5_mem_write_bytes(adiv5_access_port_s *const ap, const target
 		}
 	}
 }
+
+/* Send the recorded batch to the firmware, decoding the values of any reads into their result locations */
+static bool remote_v4_adiv5_batch_run(void)
+{
+	adiv5_access_port_s *const ap = remote_v4_batch.ap;
+	/* Build the request from the recorded operations and empty the batch before anything else can use it */
+	char buffer[REMOTE_MAX_MSG_SIZE];
+	ssize_t length = snprintf(buffer, REMOTE_MAX_MSG_SIZE, REMOTE_ADIV5_MEM_BATCH_STR, ap->dp->dev_index, ap->apsel,
+		remote_v4_batch.csw, (uint8_t)remote_v4_batch.count);
+	memcpy(buffer + length, remote_v4_batch.ops, remote_v4_batch.length);
+	length += (ssize_t)remote_v4_batch.length;
+	buffer[length++] = REMOTE_EOM;
+	buffer[length++] = '\0';
+	DEBUG_PROBE("%s: %zu operations\n", __func__, remote_v4_batch.count);
+	const size_t reads = remote_v4_batch.reads;
+	remote_v4_batch.count = 0U;
+	remote_v4_batch.length = 0U;
+	remote_v4_batch.reads = 0U;
+	platform_buffer_write(buffer, length);
+
+	/* Read back the answer and check for errors */
+	length = platform_buffer_read(buffer, REMOTE_MAX_MSG_SIZE);
+	if (!remote_v3_adiv5_check_error(__func__, ap->dp, buffer, length))
+		return false;
+	if ((size_t)length < 1U + (reads * 8U)) {
+		DEBUG_ERROR("%s: short response, expected %zu values\n", __func__, reads);
+		return false;
+	}
+	/* If the response indicates all's OK, decode the values read into where they were asked for */
+	for (size_t idx = 0; idx < reads; ++idx)
+		unhexify(remote_v4_batch.results[idx], buffer + 1U + (idx * 8U), 4);
+	return true;
+}
+
+/* Add a memory access to the batch, sending what's already recorded first if it can't go in the same request */
+static void remote_v4_adiv5_batch_add(adiv5_access_port_s *const ap, const uint8_t flags,
+	const target_addr64_t address, const uint32_t value, uint32_t *const result)
+{
+	if (remote_v4_batch.count &&
+		(remote_v4_batch.ap != ap || remote_v4_batch.csw != ap->csw ||
+			remote_v4_batch.count == REMOTE_MEM_BATCH_MAX_OPS))
+		remote_v4_adiv5_batch_run();
+	/* Starting a new batch, make sure the firmware is talking to the right DP for it */
+	if (!remote_v4_batch.count) {
+		remote_v4_adiv5_dp_version(ap->dp);
+		remote_v4_adiv5_dp_targetsel(ap->dp);
+		remote_v4_batch.ap = ap;
+		remote_v4_batch.csw = ap->csw;
+	}
+	char *const op = remote_v4_batch.ops + remote_v4_batch.length;
+	const size_t space = sizeof(remote_v4_batch.ops) - remote_v4_batch.length;
+	if (flags & REMOTE_MEM_BATCH_WRITE)
+		remote_v4_batch.length += (size_t)snprintf(op, space, REMOTE_MEM_BATCH_WRITE_OP_STR, flags, address, value);
+	else {
+		remote_v4_batch.length += (size_t)snprintf(op, space, REMOTE_MEM_BATCH_READ_OP_STR, flags, address);
+		remote_v4_batch.results[remote_v4_batch.reads++] = result;
+	}
+	++remote_v4_batch.count;
+}
+
+/* Check if an access is a single suitably aligned transfer of at most 32 bits, so it can go into a batch */
+static bool remote_v4_adiv5_batch_fits(const target_addr64_t address, const size_t length, const align_e align)
+{
+	return align <= ALIGN_32BIT && length == (1U << align) && (address & (length - 1U)) == 0U;
+}
+
+void remote_v4_adiv5_batch_flush(void)
+{
+	if (remote_v4_batch.count)
+		remote_v4_adiv5_batch_run();
+}
+
+void remote_v4_adiv5_mem_read_batched(
+	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t read_length)
+{
+	/* Reads that don't fit a batch go out on their own once whatever is recorded has been sent */
+	if (!remote_v4_adiv5_batch_fits(src, read_length, ALIGN_OF(read_length))) {
+		remote_v4_adiv5_mem_read_bytes(ap, dest, src, read_length);
+		return;
+	}
+	/* Otherwise the read ends the batch, so record it and send everything to get its result */
+	uint32_t value = 0U;
+	remote_v4_adiv5_batch_add(ap, ALIGN_OF(read_length), src, 0U, &value);
+	if (remote_v4_adiv5_batch_run())
+		memcpy(dest, &value, read_length);
+}
+
+void remote_v4_adiv5_mem_write_batched(adiv5_access_port_s *const ap, const target_addr64_t dest,
+	const void *const src, const size_t write_length, const align_e align)
+{
+	if (!remote_v4_adiv5_batch_fits(dest, write_length, align)) {
+		remote_v4_adiv5_mem_write_bytes(ap, dest, src, write_length, align);
+		return;
+	}
+	/* Small writes get recorded for later, any fault they cause shows up when the batch is sent */
+	uint32_t value = 0U;
+	memcpy(&value, src, write_length);
+	remote_v4_adiv5_batch_add(ap, REMOTE_MEM_BATCH_WRITE | align, dest, value, NULL);
+}
+
+bool remote_v4_adiv5_mem_txn(adiv5_access_port_s *const ap, const target_txn_op_s *const ops, const size_t count)
+{
+	/* Record every operation as a word access, letting the batch split itself if it fills, then send it all */
+	for (size_t idx = 0; idx < count; ++idx) {
+		const target_txn_op_s *const op = &ops[idx];
+		if (op->write)
+			remote_v4_adiv5_batch_add(ap, REMOTE_MEM_BATCH_WRITE | ALIGN_32BIT, op->addr, op->value, NULL);
+		else
+			remote_v4_adiv5_batch_add(ap, ALIGN_32BIT, op->addr, 0U, op->result);
+	}
+	return remote_v4_adiv5_batch_run();
+}
+
+/*
+ * Ask the firmware to poll a word for us. Long timeouts are split into several requests so we don't
+ * run into the link's own read timeout while the firmware is busy polling.
+ */
+bool remote_v4_adiv5_mem_poll(adiv5_access_port_s *const ap, const target_addr64_t src, const uint32_t mask,
+	const uint32_t expected, const uint32_t timeout, uint32_t *const value)
+{
+	remote_v4_adiv5_dp_version(ap->dp);
+	remote_v4_adiv5_dp_targetsel(ap->dp);
+	DEBUG_PROBE("%s: @%08" PRIx64 " & %08" PRIx32 " == %08" PRIx32 " in %" PRIu32 "ms\n", __func__, src, mask,
+		expected, timeout);
+	char buffer[REMOTE_MAX_MSG_SIZE];
+	platform_timeout_s poll_timeout;
+	platform_timeout_set(&poll_timeout, timeout);
+	uint32_t remaining = timeout;
+	while (true) {
+		const uint32_t slice = MIN(remaining, REMOTE_V4_MEM_POLL_SLICE_MS);
+		/* Create the request and send it to the remote */
+		ssize_t length = snprintf(buffer, REMOTE_MAX_MSG_SIZE, REMOTE_ADIV5_MEM_POLL_STR, ap->dp->dev_index,
+			ap->apsel, ap->csw, src, mask, expected, slice);
+		platform_buffer_write(buffer, length);
+
+		/* Read back the answer and check for errors */
+		length = platform_buffer_read(buffer, REMOTE_MAX_MSG_SIZE);
+		if (!remote_v3_adiv5_check_error(__func__, ap->dp, buffer, length))
+			return false;
+		/* If the response indicates all's OK, decode the last value read and check if it matched */
+		unhexify(value, buffer + 1, 4);
+		if ((*value & mask) == expected)
+			return true;
+		if (slice == remaining || platform_timeout_is_expired(&poll_timeout))
+			return false;
+		remaining -= slice;
+	}
+}
+
+/*
+ * Ask the firmware to load the core registers, run a stub and wait for it to halt, all in one exchange.
+ * Returns false if the stub is still running when the firmware gives up waiting, or something went wrong.
+ */
+bool remote_v4_adiv5_run_stub(adiv5_access_port_s *const ap, const uint32_t loadaddr, const uint32_t *const args,
+	const bool invalidate_icache, uint32_t *const dfsr, uint16_t *const instruction)
+{
+	remote_v4_adiv5_dp_version(ap->dp);
+	remote_v4_adiv5_dp_targetsel(ap->dp);
+	DEBUG_PROBE("%s: @%08" PRIx32 "(%08" PRIx32 ", %08" PRIx32 ", %08" PRIx32 ", %08" PRIx32 ")\n", __func__, loadaddr,
+		args[0], args[1], args[2], args[3]);
+	/* Create the request and send it to the remote */
+	char buffer[REMOTE_MAX_MSG_SIZE];
+	ssize_t length = snprintf(buffer, REMOTE_MAX_MSG_SIZE, REMOTE_ADIV5_RUN_STUB_STR, ap->dp->dev_index, ap->apsel,
+		ap->csw, loadaddr, args[0], args[1], args[2], args[3],
+		invalidate_icache ? REMOTE_RUN_STUB_INVALIDATE_ICACHE : 0U, REMOTE_V4_RUN_STUB_TIMEOUT_MS);
+	platform_buffer_write(buffer, length);
+
+	/* Read back the answer, checking first if the stub is simply still running */
+	length = platform_buffer_read(buffer, REMOTE_MAX_MSG_SIZE);
+	if (length > 1 && buffer[0] == REMOTE_RESP_ERR &&
+		(remote_decode_response(buffer + 1, (size_t)length - 1U) & 0xffU) == REMOTE_ERROR_TIMEOUT)
+		return false;
+	if (!remote_v3_adiv5_check_error(__func__, ap->dp, buffer, length))
+		return false;
+	/* The response is the DFSR value packed above the instruction the core halted on */
+	uint64_t result = 0U;
+	unhexify(&result, buffer + 1, sizeof(result));
+	*dfsr = (uint32_t)(result >> 16U);
+	*instruction = (uint16_t)result;
+	return true;
+}
+
+/*
+ * Have the firmware sample the PC of the core behind the AP, merging the histogram it sends back into the
+ * profile. The firmware stops early if it sees more distinct PCs than fit in a response, so this keeps asking
+ * for more until the time is up.
+ */
+bool remote_v4_adiv5_pc_profile(
+	adiv5_access_port_s *const ap, cortexm_pc_profile_s *const profile, const uint32_t duration_ms)
+{
+	remote_v4_adiv5_dp_version(ap->dp);
+	remote_v4_adiv5_dp_targetsel(ap->dp);
+	DEBUG_PROBE("%s: for %" PRIu32 "ms\n", __func__, duration_ms);
+	char buffer[REMOTE_MAX_MSG_SIZE];
+	const uint32_t start = platform_time_ms();
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, duration_ms);
+	while (!platform_timeout_is_expired(&timeout)) {
+		const uint32_t elapsed = platform_time_ms() - start;
+		const uint32_t slice = elapsed < duration_ms ? MIN(duration_ms - elapsed, REMOTE_V4_PC_PROFILE_SLICE_MS) : 1U;
+		/* Create the request and send it to the remote */
+		ssize_t length = snprintf(
+			buffer, REMOTE_MAX_MSG_SIZE, REMOTE_ADIV5_PC_PROFILE_STR, ap->dp->dev_index, ap->apsel, ap->csw, slice);
+		platform_buffer_write(buffer, length);
+
+		/* Read back the answer and check for errors */
+		length = platform_buffer_read(buffer, REMOTE_MAX_MSG_SIZE);
+		if (!remote_v3_adiv5_check_error(__func__, ap->dp, buffer, length))
+			return false;
+		/* The response is 4 totals followed by PC and count pairs, each value 8 hex digits */
+		const size_t values = ((size_t)length - 1U) / 8U;
+		uint32_t totals[4];
+		if (values < 4U || (values & 1U) || !unhexify_checked(totals, buffer + 1, sizeof(totals))) {
+			DEBUG_ERROR("%s: malformed response\n", __func__);
+			return false;
+		}
+		profile->samples += totals[0];
+		profile->idle += totals[1];
+		profile->dropped += totals[2];
+		profile->duration_ms += totals[3];
+		for (size_t idx = 4U; idx < values; idx += 2U) {
+			uint32_t bucket[2];
+			if (!unhexify_checked(bucket, buffer + 1U + (idx * 8U), sizeof(bucket))) {
+				DEBUG_ERROR("%s: malformed response\n", __func__);
+				return false;
+			}
+			if (!cortexm_pc_profile_add(profile, bucket[0], bucket[1]))
+				profile->dropped += bucket[1];
+		}
+	}
+	return true;
+}
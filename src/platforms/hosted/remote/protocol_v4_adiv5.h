@@ -50,5 +50,15 @@ void remote_v4_adiv5_ap_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t v
 void remote_v4_adiv5_mem_read_bytes(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t read_length);
 void remote_v4_adiv5_mem_write_bytes(
 	adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t write_length, align_e align);
+void remote_v4_adiv5_mem_read_batched(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t read_length);
+void remote_v4_adiv5_mem_write_batched(
+	adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t write_length, align_e align);
+void remote_v4_adiv5_batch_flush(void);
+bool remote_v4_adiv5_mem_txn(adiv5_access_port_s *ap, const target_txn_op_s *ops, size_t count);
+bool remote_v4_adiv5_run_stub(adiv5_access_port_s *ap, uint32_t loadaddr, const uint32_t *args, bool invalidate_icache,
+	uint32_t *dfsr, uint16_t *instruction);
+bool remote_v4_adiv5_mem_poll(adiv5_access_port_s *ap, target_addr64_t src, uint32_t mask, uint32_t expected,
+	uint32_t timeout, uint32_t *value);
+bool remote_v4_adiv5_pc_profile(adiv5_access_port_s *ap, cortexm_pc_profile_s *profile, uint32_t duration_ms);
 
 #endif /*PLATFORMS_HOSTED_REMOTE_PROTOCOL_V4_ADIV5_H*/
@@ -103,8 +103,12 @@ void remote_v4_adiv6_mem_read_bytes(
 			DEBUG_ERROR("%s error around 0x%08zx\n", __func__, (size_t)src + offset);
 			return;
 		}
-		/* If the response indicates all's OK, decode the data read */
-		unhexify(data + offset, buffer + 1, amount);
+		/* If the response indicates all's OK, decode the data read, checking it's all there and valid */
+		if ((size_t)length < 1U + (amount * 2U) || !unhexify_checked(data + offset, buffer + 1, amount)) {
+			DEBUG_ERROR("%s malformed response around 0x%08zx\n", __func__, (size_t)src + offset);
+			ap->base.dp->fault = 1U;
+			return;
+		}
 	}
 }
 
@@ -53,10 +53,14 @@
 	}
 
 /* Remote protocol enabled acceleration bit values */
-#define REMOTE_ACCEL_ADIV5     (1U << 0U)
-#define REMOTE_ACCEL_CORTEX_AR (1U << 1U)
-#define REMOTE_ACCEL_RISCV     (1U << 2U)
-#define REMOTE_ACCEL_ADIV6     (1U << 3U)
+#define REMOTE_ACCEL_ADIV5      (1U << 0U)
+#define REMOTE_ACCEL_CORTEX_AR  (1U << 1U)
+#define REMOTE_ACCEL_RISCV      (1U << 2U)
+#define REMOTE_ACCEL_ADIV6      (1U << 3U)
+#define REMOTE_ACCEL_MEM_POLL   (1U << 4U)
+#define REMOTE_ACCEL_RUN_STUB   (1U << 5U)
+#define REMOTE_ACCEL_MEM_BATCH  (1U << 6U)
+#define REMOTE_ACCEL_PC_PROFILE (1U << 7U)
 
 /*
  * This version of the protocol introduces ADIv5 commands for setting the version of the DP being talked to,
@@ -101,6 +105,63 @@
 		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_DP_TARGETSEL, REMOTE_ADIV5_DATA, REMOTE_EOM, 0 \
 	}
 
+/* Firmware reporting REMOTE_ACCEL_MEM_POLL can run memory polling loops on our behalf */
+#define REMOTE_MEM_POLL 'P'
+
+#define REMOTE_ADIV5_MEM_POLL_STR                                                                      \
+	(char[])                                                                                           \
+	{                                                                                                  \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_MEM_POLL, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL, \
+			REMOTE_ADIV5_CSW, REMOTE_ADIV5_ADDR64, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA,               \
+			REMOTE_UINT32, REMOTE_EOM, 0                                                               \
+	}
+
+/* Firmware reporting REMOTE_ACCEL_RUN_STUB can run Cortex-M stubs to completion on our behalf */
+#define REMOTE_ERROR_TIMEOUT 5
+#define REMOTE_RUN_STUB      'X'
+
+#define REMOTE_ADIV5_RUN_STUB_STR                                                                         \
+	(char[])                                                                                              \
+	{                                                                                                     \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_RUN_STUB, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL,    \
+			REMOTE_ADIV5_CSW, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA, \
+			REMOTE_ADIV5_DATA, REMOTE_UINT8, REMOTE_UINT32, REMOTE_EOM, 0                                 \
+	}
+#define REMOTE_RUN_STUB_INVALIDATE_ICACHE 1U
+
+/* Firmware reporting REMOTE_ACCEL_MEM_BATCH can perform a list of small memory accesses in one request */
+#define REMOTE_MEM_BATCH 'B'
+
+#define REMOTE_ADIV5_MEM_BATCH_STR                                                                      \
+	(char[])                                                                                            \
+	{                                                                                                   \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_MEM_BATCH, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL, \
+			REMOTE_ADIV5_CSW, REMOTE_UINT8, 0                                                           \
+	}
+#define REMOTE_MEM_BATCH_READ_OP_STR         \
+	(char[])                                 \
+	{                                        \
+		REMOTE_UINT8, REMOTE_ADIV5_ADDR64, 0 \
+	}
+#define REMOTE_MEM_BATCH_WRITE_OP_STR                           \
+	(char[])                                                    \
+	{                                                           \
+		REMOTE_UINT8, REMOTE_ADIV5_ADDR64, REMOTE_ADIV5_DATA, 0 \
+	}
+#define REMOTE_MEM_BATCH_WRITE_OP_LENGTH 26U
+#define REMOTE_MEM_BATCH_WRITE           0x80U
+#define REMOTE_MEM_BATCH_MAX_OPS         32U
+
+/* Firmware reporting REMOTE_ACCEL_PC_PROFILE can sample a Cortex-M core's PC on our behalf */
+#define REMOTE_PC_PROFILE 'S'
+
+#define REMOTE_ADIV5_PC_PROFILE_STR                                                                      \
+	(char[])                                                                                             \
+	{                                                                                                    \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_PC_PROFILE, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL, \
+			REMOTE_ADIV5_CSW, REMOTE_UINT32, REMOTE_EOM, 0                                               \
+	}
+
 /* ADIv6 acceleration protocol elements */
 #define REMOTE_ADIV6_PACKET '6'
 
@@ -0,0 +1,302 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements the on-disk scan cache, which records the AP layout, core component locations
+ * and matched target drivers of each DP found, keyed by its DPIDR and TARGETID. On later runs this lets
+ * adiv5_dp_init() check the recorded layout with a handful of ID register reads and go straight to
+ * probing the cores, rather than enumerating every AP, walking every ROM table and trying every driver.
+ *
+ * The cache is a text file with one record per line:
+ *   dp <dev index> <DPIDR> <TARGETID>
+ *   ap <APSEL> <IDR> <designer code> <part number> <flags>
+ *   core <architecture> <base address> <CIDR> <CPUID> <probe routine, or - for none>
+ * where ap records belong to the dp record before them, and core records to the ap record before them.
+ */
+
+#include "general.h"
+#include <stdio.h>
+#include <errno.h>
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+#include "scan_cache.h"
+
+static const char *scan_cache_path = NULL;
+static bmda_scan_cache_dp_s scan_cache_dps[BMDA_SCAN_CACHE_MAX_DPS];
+static size_t scan_cache_dp_count = 0U;
+static bool scan_cache_dirty = false;
+/* The DP presently being replayed or recorded, and the core component on it presently being probed */
+static bmda_scan_cache_dp_s *scan_cache_dp = NULL;
+static bmda_scan_cache_core_s *scan_cache_core = NULL;
+
+static bool scan_cache_parse_line(const char *const line, bmda_scan_cache_dp_s **const dp, bmda_scan_cache_ap_s **ap)
+{
+	unsigned int index = 0U;
+	uint32_t values[3U] = {0U};
+	uint16_t codes[2U] = {0U};
+	uint64_t base = 0U;
+	char probe[32U] = {0};
+
+	if (line[0] == '#' || line[0] == '\n' || line[0] == '\0')
+		return true;
+	if (sscanf(line, "dp %u %" SCNx32 " %" SCNx32, &index, &values[0], &values[1]) == 3) {
+		if (scan_cache_dp_count == BMDA_SCAN_CACHE_MAX_DPS)
+			return false;
+		*dp = &scan_cache_dps[scan_cache_dp_count++];
+		*ap = NULL;
+		(*dp)->dev_index = (uint8_t)index;
+		(*dp)->dpidr = values[0];
+		(*dp)->targetid = values[1];
+		(*dp)->ap_count = 0U;
+		return true;
+	}
+	if (sscanf(line, "ap %u %" SCNx32 " %" SCNx16 " %" SCNx16 " %" SCNx32, &index, &values[0], &codes[0], &codes[1],
+			&values[1]) == 5) {
+		if (!*dp || (*dp)->ap_count == BMDA_SCAN_CACHE_MAX_APS)
+			return false;
+		*ap = &(*dp)->aps[(*dp)->ap_count++];
+		(*ap)->apsel = (uint8_t)index;
+		(*ap)->idr = values[0];
+		(*ap)->designer_code = codes[0];
+		(*ap)->partno = codes[1];
+		(*ap)->flags = values[1];
+		(*ap)->core_count = 0U;
+		return true;
+	}
+	if (sscanf(line, "core %u %" SCNx64 " %" SCNx32 " %" SCNx32 " %31s", &index, &base, &values[0], &values[1],
+			probe) == 5) {
+		if (!*ap || (*ap)->core_count == BMDA_SCAN_CACHE_MAX_CORES)
+			return false;
+		bmda_scan_cache_core_s *const core = &(*ap)->cores[(*ap)->core_count++];
+		core->arch = (uint8_t)index;
+		core->base = base;
+		core->cidr = values[0];
+		core->cpuid = values[1];
+		memcpy(core->probe, probe, sizeof(core->probe));
+		if (!strcmp(core->probe, "-"))
+			core->probe[0] = '\0';
+		return true;
+	}
+	return false;
+}
+
+void bmda_scan_cache_load(const char *const path)
+{
+	scan_cache_path = path;
+	FILE *const file = fopen(path, "r");
+	if (!file) {
+		/* A missing cache just means this is the first run using it */
+		DEBUG_INFO("Scan cache %s not found, it will be created\n", path);
+		return;
+	}
+
+	char line[128U];
+	bmda_scan_cache_dp_s *dp = NULL;
+	bmda_scan_cache_ap_s *ap = NULL;
+	bool valid = true;
+	while (valid && fgets(line, sizeof(line), file))
+		valid = scan_cache_parse_line(line, &dp, &ap);
+	fclose(file);
+
+	if (!valid) {
+		DEBUG_WARN("Scan cache %s is malformed, ignoring its contents\n", path);
+		scan_cache_dp_count = 0U;
+	}
+}
+
+/*
+ * Write the cache out to a file of our own first and then move it into place, so several BMDA
+ * processes sharing a cache (such as gang programming workers) can't leave it half written
+ */
+static void scan_cache_save(void)
+{
+	char temp_path[4096];
+	snprintf(temp_path, sizeof(temp_path), "%s.%ld", scan_cache_path, (long)getpid());
+	FILE *const file = fopen(temp_path, "w");
+	if (!file) {
+		DEBUG_WARN("Failed to write scan cache %s: %s\n", scan_cache_path, strerror(errno));
+		return;
+	}
+
+	fprintf(file, "# Black Magic Debug App scan cache, delete this file to force a full scan\n");
+	for (size_t i = 0U; i < scan_cache_dp_count; ++i) {
+		const bmda_scan_cache_dp_s *const dp = &scan_cache_dps[i];
+		fprintf(file, "dp %u %08" PRIx32 " %08" PRIx32 "\n", dp->dev_index, dp->dpidr, dp->targetid);
+		for (size_t j = 0U; j < dp->ap_count; ++j) {
+			const bmda_scan_cache_ap_s *const ap = &dp->aps[j];
+			fprintf(file, "ap %u %08" PRIx32 " %03x %03x %08" PRIx32 "\n", ap->apsel, ap->idr, ap->designer_code,
+				ap->partno, ap->flags);
+			for (size_t k = 0U; k < ap->core_count; ++k) {
+				const bmda_scan_cache_core_s *const core = &ap->cores[k];
+				fprintf(file, "core %u %016" PRIx64 " %08" PRIx32 " %08" PRIx32 " %s\n", core->arch, core->base,
+					core->cidr, core->cpuid, core->probe[0] ? core->probe : "-");
+			}
+		}
+	}
+	fclose(file);
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	/* rename() won't replace an existing file here */
+	remove(scan_cache_path);
+#endif
+	if (rename(temp_path, scan_cache_path) != 0) {
+		DEBUG_WARN("Failed to write scan cache %s: %s\n", scan_cache_path, strerror(errno));
+		remove(temp_path);
+		return;
+	}
+	scan_cache_dirty = false;
+}
+
+static bmda_scan_cache_dp_s *scan_cache_find_dp(const uint8_t dev_index, const uint32_t dpidr, const uint32_t targetid)
+{
+	for (size_t i = 0U; i < scan_cache_dp_count; ++i) {
+		bmda_scan_cache_dp_s *const dp = &scan_cache_dps[i];
+		if (dp->dev_index == dev_index && dp->dpidr == dpidr && dp->targetid == targetid)
+			return dp;
+	}
+	return NULL;
+}
+
+static bmda_scan_cache_ap_s *scan_cache_find_ap(const uint8_t apsel)
+{
+	for (size_t i = 0U; i < scan_cache_dp->ap_count; ++i) {
+		if (scan_cache_dp->aps[i].apsel == apsel)
+			return &scan_cache_dp->aps[i];
+	}
+	return NULL;
+}
+
+/* Look up the recorded layout for a DP, making it the one being replayed if found */
+bmda_scan_cache_dp_s *bmda_scan_cache_lookup(const uint8_t dev_index, const uint32_t dpidr, const uint32_t targetid)
+{
+	if (!scan_cache_path)
+		return NULL;
+	scan_cache_dp = scan_cache_find_dp(dev_index, dpidr, targetid);
+	scan_cache_core = NULL;
+	return scan_cache_dp;
+}
+
+/* Select which of the replayed DP's core components is about to be probed */
+void bmda_scan_cache_select_core(bmda_scan_cache_core_s *const core)
+{
+	scan_cache_core = core;
+}
+
+/* Get the name of the probe routine that matched the core being probed last time, if it's still the same core */
+const char *bmda_scan_cache_probe_name(const uint32_t cpuid)
+{
+	if (!scan_cache_core || scan_cache_core->cpuid != cpuid || !scan_cache_core->probe[0])
+		return NULL;
+	return scan_cache_core->probe;
+}
+
+/* Start recording a DP afresh, replacing anything previously recorded for it */
+void bmda_scan_cache_begin(const uint8_t dev_index, const uint32_t dpidr, const uint32_t targetid)
+{
+	if (!scan_cache_path)
+		return;
+	bmda_scan_cache_dp_s *dp = scan_cache_find_dp(dev_index, dpidr, targetid);
+	if (!dp) {
+		if (scan_cache_dp_count == BMDA_SCAN_CACHE_MAX_DPS) {
+			DEBUG_WARN("Scan cache full, not recording DP with DPIDR 0x%08" PRIx32 "\n", dpidr);
+			return;
+		}
+		dp = &scan_cache_dps[scan_cache_dp_count++];
+	}
+	memset(dp, 0, sizeof(*dp));
+	dp->dev_index = dev_index;
+	dp->dpidr = dpidr;
+	dp->targetid = targetid;
+	scan_cache_dp = dp;
+	scan_cache_core = NULL;
+	scan_cache_dirty = true;
+}
+
+/* Record (or update the record of) an AP, called both as it's found and once its ROM tables are walked */
+void bmda_scan_cache_record_ap(const adiv5_access_port_s *const ap)
+{
+	if (!scan_cache_dp)
+		return;
+	bmda_scan_cache_ap_s *record = scan_cache_find_ap(ap->apsel);
+	if (!record) {
+		if (scan_cache_dp->ap_count == BMDA_SCAN_CACHE_MAX_APS)
+			return;
+		record = &scan_cache_dp->aps[scan_cache_dp->ap_count++];
+		record->apsel = ap->apsel;
+	}
+	record->idr = ap->idr;
+	record->designer_code = ap->designer_code;
+	record->partno = ap->partno;
+	record->flags = ap->flags;
+	scan_cache_dirty = true;
+}
+
+/* Record a core component about to be handed to a CPU-generic probe routine */
+void bmda_scan_cache_record_core(
+	const adiv5_access_port_s *const ap, const uint8_t arch, const target_addr64_t base, const uint32_t cidr)
+{
+	scan_cache_core = NULL;
+	if (!scan_cache_dp)
+		return;
+	bmda_scan_cache_ap_s *const record = scan_cache_find_ap(ap->apsel);
+	if (!record || record->core_count == BMDA_SCAN_CACHE_MAX_CORES)
+		return;
+	bmda_scan_cache_core_s *const core = &record->cores[record->core_count++];
+	memset(core, 0, sizeof(*core));
+	core->arch = arch;
+	core->base = base;
+	core->cidr = cidr;
+	scan_cache_core = core;
+	scan_cache_dirty = true;
+}
+
+/* Record which part-specific probe routine (if any) matched the core being probed */
+void bmda_scan_cache_record_probe(const uint32_t cpuid, const char *const probe)
+{
+	if (!scan_cache_core || (scan_cache_core->cpuid == cpuid && !strcmp(scan_cache_core->probe, probe)))
+		return;
+	scan_cache_core->cpuid = cpuid;
+	snprintf(scan_cache_core->probe, sizeof(scan_cache_core->probe), "%s", probe);
+	scan_cache_dirty = true;
+}
+
+/* Finish replaying or recording a DP, writing the cache back out if anything changed */
+void bmda_scan_cache_end(void)
+{
+	if (scan_cache_dirty)
+		scan_cache_save();
+	scan_cache_dp = NULL;
+	scan_cache_core = NULL;
+}
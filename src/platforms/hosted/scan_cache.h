@@ -0,0 +1,86 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_SCAN_CACHE_H
+#define PLATFORMS_HOSTED_SCAN_CACHE_H
+
+#include "general.h"
+#include "adiv5.h"
+
+#define BMDA_SCAN_CACHE_MAX_DPS   16U
+#define BMDA_SCAN_CACHE_MAX_APS   8U
+#define BMDA_SCAN_CACHE_MAX_CORES 4U
+
+/* A core component found while walking an AP's ROM tables, and the target driver that matched it */
+typedef struct bmda_scan_cache_core {
+	/* The arm_arch_e of the component, telling which CPU-generic probe routine to hand it to */
+	uint8_t arch;
+	target_addr64_t base;
+	uint32_t cidr;
+	uint32_t cpuid;
+	/* The name of the part-specific probe routine that matched, empty if none did */
+	char probe[32];
+} bmda_scan_cache_core_s;
+
+typedef struct bmda_scan_cache_ap {
+	uint8_t apsel;
+	uint32_t idr;
+	uint16_t designer_code;
+	uint16_t partno;
+	uint32_t flags;
+	size_t core_count;
+	bmda_scan_cache_core_s cores[BMDA_SCAN_CACHE_MAX_CORES];
+} bmda_scan_cache_ap_s;
+
+typedef struct bmda_scan_cache_dp {
+	uint8_t dev_index;
+	uint32_t dpidr;
+	uint32_t targetid;
+	size_t ap_count;
+	bmda_scan_cache_ap_s aps[BMDA_SCAN_CACHE_MAX_APS];
+} bmda_scan_cache_dp_s;
+
+void bmda_scan_cache_load(const char *path);
+
+/* Functions for replaying a previously recorded DP */
+bmda_scan_cache_dp_s *bmda_scan_cache_lookup(uint8_t dev_index, uint32_t dpidr, uint32_t targetid);
+void bmda_scan_cache_select_core(bmda_scan_cache_core_s *core);
+const char *bmda_scan_cache_probe_name(uint32_t cpuid);
+
+/* Functions for recording a DP as it's discovered */
+void bmda_scan_cache_begin(uint8_t dev_index, uint32_t dpidr, uint32_t targetid);
+void bmda_scan_cache_record_ap(const adiv5_access_port_s *ap);
+void bmda_scan_cache_record_core(const adiv5_access_port_s *ap, uint8_t arch, target_addr64_t base, uint32_t cidr);
+void bmda_scan_cache_record_probe(uint32_t cpuid, const char *probe);
+void bmda_scan_cache_end(void);
+
+#endif /* PLATFORMS_HOSTED_SCAN_CACHE_H */
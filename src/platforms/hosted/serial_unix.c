@@ -21,8 +21,10 @@
 #include "general.h"
 #include "remote.h"
 #include "bmp_hosted.h"
+#include "bmp_remote.h"
 #include "utils.h"
 #include "cortexm.h"
+#include "perf.h"
 
 #include <sys/stat.h>
 #include <sys/select.h>
@@ -299,6 +301,8 @@ void serial_close(void)
 
 bool platform_buffer_write(const void *const data, const size_t length)
 {
+	/* Anything the protocol layer has been holding back has to reach the probe before this does */
+	remote_buffer_flush();
 	DEBUG_WIRE("%s\n", (const char *)data);
 	const ssize_t written = write(fd, data, length);
 	if (written < 0) {
@@ -348,7 +352,7 @@ static ssize_t bmda_read_more_data(void)
 
 /* XXX: We should either return size_t or bool */
 /* XXX: This needs documenting that it can abort the program with exit(), or the error handling fixed */
-int platform_buffer_read(void *const data, const size_t length)
+static int bmda_buffer_read(void *const data, const size_t length)
 {
 	char *const buffer = (char *)data;
 	/* Drain the buffer for the remote till we see a start-of-response byte */
@@ -392,3 +396,14 @@ int platform_buffer_read(void *const data, const size_t length)
 	}
 	return length;
 }
+
+int platform_buffer_read(void *const data, const size_t length)
+{
+	/* Make sure nothing the protocol layer is holding back is still waiting to go out before blocking */
+	remote_buffer_flush();
+	/* The response read is where a request's round trip over the link is spent waiting */
+	const uint32_t start = perf_now();
+	const int result = bmda_buffer_read(data, length);
+	perf_record(PERF_PROBE_ROUND_TRIP, start, result > 0 ? (uint32_t)result : 0U);
+	return result;
+}
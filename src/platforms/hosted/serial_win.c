@@ -27,8 +27,10 @@
 #include <windows.h>
 #include "platform.h"
 #include "remote.h"
+#include "bmp_remote.h"
 #include "cli.h"
 #include "utils.h"
+#include "perf.h"
 
 #include <assert.h>
 #include <string.h>
@@ -355,6 +357,8 @@ void serial_close(void)
 
 bool platform_buffer_write(const void *const data, const size_t length)
 {
+	/* Anything the protocol layer has been holding back has to reach the probe before this does */
+	remote_buffer_flush();
 	const char *const buffer = (const char *)data;
 	DEBUG_WIRE("%s\n", buffer);
 	DWORD written = 0;
@@ -441,7 +445,7 @@ static ssize_t bmda_read_more_data(const uint32_t end_time)
 }
 
 /* XXX: We should either return size_t or bool */
-int platform_buffer_read(void *const data, const size_t length)
+static int bmda_buffer_read(void *const data, const size_t length)
 {
 	char *const buffer = (char *)data;
 	const uint32_t start_time = platform_time_ms();
@@ -492,3 +496,14 @@ int platform_buffer_read(void *const data, const size_t length)
 	}
 	return length;
 }
+
+int platform_buffer_read(void *const data, const size_t length)
+{
+	/* Make sure nothing the protocol layer is holding back is still waiting to go out before blocking */
+	remote_buffer_flush();
+	/* The response read is where a request's round trip over the link is spent waiting */
+	const uint32_t start = perf_now();
+	const int result = bmda_buffer_read(data, length);
+	perf_record(PERF_PROBE_ROUND_TRIP, start, result > 0 ? (uint32_t)result : 0U);
+	return result;
+}
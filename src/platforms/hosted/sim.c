@@ -0,0 +1,1665 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements a simulated probe for BMDA. Rather than talking to hardware, it models
+ * an ADIv5 SW-DP/JTAG-DP with a single AHB-AP, a Cortex-M core and an STM32F1 or STM32F4-like
+ * flash controller in-process, at the level of the SWD/JTAG bit streams the generic ADIv5 code
+ * produces. This gives a deterministic target for the whole BMDA stack that can be benchmarked,
+ * and latency, WAIT and FAULT responses can be injected to see how the stack copes with them.
+ *
+ * The model is selected with `--sim MODEL[,latency=US][,wait=N][,fault=N][,busy=N]` where
+ * latency adds that many microseconds to each probe round trip, wait and fault make every Nth
+ * AP access respond WAIT or FAULT respectively, and busy makes the flash controller report BSY
+ * for N status reads after each operation.
+ */
+
+#include "general.h"
+#include <string.h>
+#include <sys/time.h>
+
+#include "sim.h"
+#include "jtagtap.h"
+#include "cortexm.h"
+#include "jep106.h"
+#include "buffer_utils.h"
+#include "maths_utils.h"
+
+#define SIM_DEFAULT_MODEL "stm32f1"
+
+#define SIM_SWD_LINE_RESET_BITS 50U
+
+/* ARM JTAG-DP instructions */
+#define SIM_IR_ABORT  0x8U
+#define SIM_IR_DPACC  0xaU
+#define SIM_IR_APACC  0xbU
+#define SIM_IR_IDCODE 0xeU
+
+#define SIM_JTAG_ACK_WAIT 0x1U
+#define SIM_JTAG_ACK_OK   0x2U
+
+#define SIM_CTRLSTAT_STICKY_MASK                                                                  \
+	(ADIV5_DP_CTRLSTAT_STICKYERR | ADIV5_DP_CTRLSTAT_STICKYCMP | ADIV5_DP_CTRLSTAT_STICKYORUN | \
+		ADIV5_DP_CTRLSTAT_WDATAERR)
+#define SIM_CTRLSTAT_WRITE_MASK 0xfcfffffdU
+
+#define SIM_ROM_TABLE_BASE 0xe00ff000U
+#define SIM_ITM_BASE       0xe0000000U
+#define SIM_DBGMCU_BASE    0xe0042000U
+
+#define SIM_FLASH_BASE 0x08000000U
+#define SIM_SRAM_BASE  0x20000000U
+#define SIM_CCM_BASE   0x10000000U
+
+#define SIM_FPB_NUM_CODE 6U
+#define SIM_FPB_NUM_LIT  2U
+#define SIM_FPB_COMPS    (SIM_FPB_NUM_CODE + SIM_FPB_NUM_LIT)
+#define SIM_DWT_COMPS    4U
+/* How many DHCSR polls a running core takes to hit an armed breakpoint */
+#define SIM_RUN_POLLS 4U
+
+#define SIM_REG_XPSR 0x10U
+#define SIM_REG_MSP  0x11U
+
+#define SIM_FLASH_KEY1 0x45670123U
+#define SIM_FLASH_KEY2 0xcdef89abU
+
+#define SIM_FPEC_KEYR 0x04U
+#define SIM_FPEC_SR   0x0cU
+#define SIM_FPEC_CR   0x10U
+#define SIM_FPEC_AR   0x14U
+#define SIM_FPEC_OBR  0x1cU
+#define SIM_FPEC_WRPR 0x20U
+
+#define SIM_STM32F1_SR_BSY      (1U << 0U)
+#define SIM_STM32F1_SR_PGERR    (1U << 2U)
+#define SIM_STM32F1_SR_WRPRTERR (1U << 4U)
+#define SIM_STM32F1_SR_EOP      (1U << 5U)
+#define SIM_STM32F1_CR_PG       (1U << 0U)
+#define SIM_STM32F1_CR_PER      (1U << 1U)
+#define SIM_STM32F1_CR_MER      (1U << 2U)
+#define SIM_STM32F1_CR_STRT     (1U << 6U)
+#define SIM_STM32F1_CR_LOCK     (1U << 7U)
+
+#define SIM_STM32F4_FPEC_OPTCR  0x14U
+#define SIM_STM32F4_SR_EOP      (1U << 0U)
+#define SIM_STM32F4_SR_PGPERR   (1U << 6U)
+#define SIM_STM32F4_SR_PGSERR   (1U << 7U)
+#define SIM_STM32F4_SR_ERR_MASK 0xf3U
+#define SIM_STM32F4_SR_BSY      (1U << 16U)
+#define SIM_STM32F4_CR_PG       (1U << 0U)
+#define SIM_STM32F4_CR_SER      (1U << 1U)
+#define SIM_STM32F4_CR_MER      (1U << 2U)
+#define SIM_STM32F4_CR_SNB_MASK (0xfU << 3U)
+#define SIM_STM32F4_CR_SNB_SHIFT 3U
+#define SIM_STM32F4_CR_PSIZE_SHIFT 8U
+#define SIM_STM32F4_CR_STRT     (1U << 16U)
+#define SIM_STM32F4_CR_EOPIE    (1U << 24U)
+#define SIM_STM32F4_CR_LOCK     (1U << 31U)
+
+typedef enum sim_flash_family {
+	SIM_FLASH_STM32F1,
+	SIM_FLASH_STM32F4,
+} sim_flash_family_e;
+
+typedef struct sim_model {
+	const char *name;
+	const char *description;
+	uint32_t dpidr;
+	uint32_t jtag_idcode;
+	uint32_t ap_idr;
+	uint32_t cpuid;
+	uint32_t dbgmcu_idcode;
+	uint16_t scs_partno;
+	bool has_fpu;
+	sim_flash_family_e flash_family;
+	uint32_t fpec_base;
+	uint32_t flash_size;
+	uint32_t flash_page_size;
+	uint32_t sram_size;
+	uint32_t ccm_size;
+	uint32_t sysmem_base;
+	uint32_t sysmem_size;
+	uint32_t flash_size_reg;
+	uint32_t uid_reg;
+	uint32_t option_bytes;
+} sim_model_s;
+
+static const sim_model_s sim_models[] = {
+	{
+		.name = "stm32f1",
+		.description = "STM32F103 medium density",
+		.dpidr = 0x1ba01477U,
+		.jtag_idcode = 0x3ba00477U,
+		.ap_idr = 0x14770011U,
+		.cpuid = 0x411fc231U,
+		.dbgmcu_idcode = 0x20036410U,
+		.scs_partno = 0x000U,
+		.has_fpu = false,
+		.flash_family = SIM_FLASH_STM32F1,
+		.fpec_base = 0x40022000U,
+		.flash_size = 128U * 1024U,
+		.flash_page_size = 1024U,
+		.sram_size = 20U * 1024U,
+		.ccm_size = 0U,
+		.sysmem_base = 0x1ffff000U,
+		.sysmem_size = 0x810U,
+		.flash_size_reg = 0x1ffff7e0U,
+		.uid_reg = 0x1ffff7e8U,
+		.option_bytes = 0x1ffff800U,
+	},
+	{
+		.name = "stm32f4",
+		.description = "STM32F407",
+		.dpidr = 0x2ba01477U,
+		.jtag_idcode = 0x4ba00477U,
+		.ap_idr = 0x24770011U,
+		.cpuid = 0x410fc241U,
+		.dbgmcu_idcode = 0x10076413U,
+		.scs_partno = 0x00cU,
+		.has_fpu = true,
+		.flash_family = SIM_FLASH_STM32F4,
+		.fpec_base = 0x40023c00U,
+		.flash_size = 1024U * 1024U,
+		.flash_page_size = 0U,
+		.sram_size = 128U * 1024U,
+		.ccm_size = 64U * 1024U,
+		.sysmem_base = 0x1fff0000U,
+		.sysmem_size = 0xc010U,
+		.flash_size_reg = 0x1fff7a22U,
+		.uid_reg = 0x1fff7a10U,
+		.option_bytes = 0x1fffc000U,
+	},
+};
+
+typedef enum sim_swd_state {
+	SIM_SWD_LOCKOUT,
+	SIM_SWD_RESET,
+	SIM_SWD_IDLE,
+	SIM_SWD_REQUEST,
+	SIM_SWD_ACK,
+	SIM_SWD_READ_DATA,
+	SIM_SWD_WRITE_DATA,
+} sim_swd_state_e;
+
+typedef enum sim_tap_state {
+	SIM_TAP_RESET,
+	SIM_TAP_IDLE,
+	SIM_TAP_SELECT_DR,
+	SIM_TAP_CAPTURE_DR,
+	SIM_TAP_SHIFT_DR,
+	SIM_TAP_EXIT1_DR,
+	SIM_TAP_PAUSE_DR,
+	SIM_TAP_EXIT2_DR,
+	SIM_TAP_UPDATE_DR,
+	SIM_TAP_SELECT_IR,
+	SIM_TAP_CAPTURE_IR,
+	SIM_TAP_SHIFT_IR,
+	SIM_TAP_EXIT1_IR,
+	SIM_TAP_PAUSE_IR,
+	SIM_TAP_EXIT2_IR,
+	SIM_TAP_UPDATE_IR,
+} sim_tap_state_e;
+
+/* Next TAP state indexed by the current state and TMS */
+static const uint8_t sim_tap_next_state[16][2] = {
+	[SIM_TAP_RESET] = {SIM_TAP_IDLE, SIM_TAP_RESET},
+	[SIM_TAP_IDLE] = {SIM_TAP_IDLE, SIM_TAP_SELECT_DR},
+	[SIM_TAP_SELECT_DR] = {SIM_TAP_CAPTURE_DR, SIM_TAP_SELECT_IR},
+	[SIM_TAP_CAPTURE_DR] = {SIM_TAP_SHIFT_DR, SIM_TAP_EXIT1_DR},
+	[SIM_TAP_SHIFT_DR] = {SIM_TAP_SHIFT_DR, SIM_TAP_EXIT1_DR},
+	[SIM_TAP_EXIT1_DR] = {SIM_TAP_PAUSE_DR, SIM_TAP_UPDATE_DR},
+	[SIM_TAP_PAUSE_DR] = {SIM_TAP_PAUSE_DR, SIM_TAP_EXIT2_DR},
+	[SIM_TAP_EXIT2_DR] = {SIM_TAP_SHIFT_DR, SIM_TAP_UPDATE_DR},
+	[SIM_TAP_UPDATE_DR] = {SIM_TAP_IDLE, SIM_TAP_SELECT_DR},
+	[SIM_TAP_SELECT_IR] = {SIM_TAP_CAPTURE_IR, SIM_TAP_RESET},
+	[SIM_TAP_CAPTURE_IR] = {SIM_TAP_SHIFT_IR, SIM_TAP_EXIT1_IR},
+	[SIM_TAP_SHIFT_IR] = {SIM_TAP_SHIFT_IR, SIM_TAP_EXIT1_IR},
+	[SIM_TAP_EXIT1_IR] = {SIM_TAP_PAUSE_IR, SIM_TAP_UPDATE_IR},
+	[SIM_TAP_PAUSE_IR] = {SIM_TAP_PAUSE_IR, SIM_TAP_EXIT2_IR},
+	[SIM_TAP_EXIT2_IR] = {SIM_TAP_SHIFT_IR, SIM_TAP_UPDATE_IR},
+	[SIM_TAP_UPDATE_IR] = {SIM_TAP_IDLE, SIM_TAP_SELECT_DR},
+};
+
+typedef struct sim_state {
+	const sim_model_s *model;
+
+	/* Fault injection settings */
+	uint32_t latency_us;
+	uint32_t wait_every;
+	uint32_t fault_every;
+	uint32_t busy_reads;
+	uint32_t ap_accesses;
+	sim_stats_s stats;
+
+	/* SW-DP line state */
+	sim_swd_state_e swd_state;
+	uint8_t high_bits;
+	uint8_t request;
+	uint8_t request_bits;
+	bool dpidr_pending;
+	uint32_t read_data;
+
+	/* JTAG-DP TAP state */
+	sim_tap_state_e tap_state;
+	uint8_t ir;
+	uint8_t ir_shift;
+	uint64_t dr_shift;
+	uint8_t dr_length;
+	bool dr_wait;
+	uint32_t jtag_result;
+
+	/* DP and MEM-AP registers */
+	uint32_t ctrlstat;
+	uint32_t select;
+	uint32_t rdbuff;
+	uint32_t csw;
+	uint32_t tar;
+
+	/* Cortex-M core and debug components */
+	uint32_t regs[128];
+	uint32_t dhcsr;
+	uint32_t dcrdr;
+	uint32_t demcr;
+	uint32_t dfsr;
+	uint32_t cpacr;
+	uint32_t ccr;
+	uint32_t fpb_ctrl;
+	uint32_t fpb_comp[SIM_FPB_COMPS];
+	uint32_t dwt_comp[SIM_DWT_COMPS];
+	uint32_t dwt_mask[SIM_DWT_COMPS];
+	uint32_t dwt_func[SIM_DWT_COMPS];
+	uint32_t dbgmcu_cr;
+	uint32_t dbgmcu_apb1_fz;
+	uint32_t dbgmcu_apb2_fz;
+	uint32_t run_polls;
+	bool halted;
+	bool in_reset;
+	bool reset_seen;
+	bool retired;
+	bool nrst;
+
+	/* Flash controller */
+	uint32_t flash_sr;
+	uint32_t flash_cr;
+	uint32_t flash_ar;
+	uint32_t flash_busy;
+	uint8_t flash_key_stage;
+	bool flash_lockout;
+
+	uint8_t *flash;
+	uint8_t *sram;
+	uint8_t *ccm;
+	uint8_t *sysmem;
+
+	uint32_t frequency;
+} sim_state_s;
+
+static sim_state_s sim;
+
+static void sim_latency(void)
+{
+	if (!sim.latency_us)
+		return;
+	timeval_s start;
+	gettimeofday(&start, NULL);
+	/* Busy-wait rather than sleep as the latencies of interest are well below the scheduler's resolution */
+	while (true) {
+		timeval_s now;
+		gettimeofday(&now, NULL);
+		const uint64_t elapsed =
+			(uint64_t)(now.tv_sec - start.tv_sec) * 1000000U + (uint64_t)(now.tv_usec - start.tv_usec);
+		if (elapsed >= sim.latency_us)
+			break;
+	}
+}
+
+static uint8_t *sim_memory(const uint32_t addr)
+{
+	const sim_model_s *const model = sim.model;
+	if (addr >= SIM_FLASH_BASE && addr - SIM_FLASH_BASE < model->flash_size)
+		return sim.flash + (addr - SIM_FLASH_BASE);
+	/* The flash is aliased at address 0 as the part boots from it */
+	if (addr < model->flash_size)
+		return sim.flash + addr;
+	if (addr >= SIM_SRAM_BASE && addr - SIM_SRAM_BASE < model->sram_size)
+		return sim.sram + (addr - SIM_SRAM_BASE);
+	if (model->ccm_size && addr >= SIM_CCM_BASE && addr - SIM_CCM_BASE < model->ccm_size)
+		return sim.ccm + (addr - SIM_CCM_BASE);
+	if (addr >= model->sysmem_base && addr - model->sysmem_base < model->sysmem_size)
+		return sim.sysmem + (addr - model->sysmem_base);
+	return NULL;
+}
+
+/* Return the CoreSight identification registers for a component of the given part, designer and class */
+static uint32_t sim_component_id(const uint16_t offset, const uint16_t partno, const uint16_t designer, const uint8_t cid_class)
+{
+	switch (offset) {
+	case PIDR4_OFFSET:
+		return (designer >> 8U) & 0xfU;
+	case PIDR0_OFFSET:
+		return partno & 0xffU;
+	case PIDR1_OFFSET:
+		return ((designer & 0xfU) << 4U) | ((partno >> 8U) & 0xfU);
+	case PIDR2_OFFSET:
+		/* JEDEC-assigned designer code and revision 0 */
+		return 0x08U | ((designer >> 4U) & 0x7U);
+	case CIDR0_OFFSET:
+		return 0x0dU;
+	case CIDR1_OFFSET:
+		return (uint32_t)cid_class << 4U;
+	case CIDR2_OFFSET:
+		return 0x05U;
+	case CIDR3_OFFSET:
+		return 0xb1U;
+	default:
+		return 0U;
+	}
+}
+
+static void sim_flash_reset(void)
+{
+	sim.flash_cr = sim.model->flash_family == SIM_FLASH_STM32F1 ? SIM_STM32F1_CR_LOCK : SIM_STM32F4_CR_LOCK;
+	sim.flash_sr = 0U;
+	sim.flash_ar = 0U;
+	sim.flash_busy = 0U;
+	sim.flash_key_stage = 0U;
+	sim.flash_lockout = false;
+}
+
+/* Reset the core as it comes out of reset, loading SP and PC from the vector table */
+static void sim_core_reset(void)
+{
+	memset(sim.regs, 0, sizeof(sim.regs));
+	sim.regs[SIM_REG_MSP] = read_le4(sim.flash, 0U);
+	sim.regs[15] = read_le4(sim.flash, 4U) & ~1U;
+	sim.regs[14] = UINT32_MAX;
+	sim.regs[SIM_REG_XPSR] = 0x01000000U;
+	sim.cpacr = 0U;
+	sim.ccr = 0x00000200U;
+	sim.reset_seen = true;
+	sim.run_polls = 0U;
+	sim_flash_reset();
+
+	const bool debug_enabled = sim.dhcsr & CORTEXM_DHCSR_C_DEBUGEN;
+	const bool vector_catch = debug_enabled && (sim.demcr & CORTEXM_DEMCR_VC_CORERESET);
+	sim.halted = vector_catch || (debug_enabled && (sim.dhcsr & CORTEXM_DHCSR_C_HALT));
+	if (vector_catch)
+		sim.dfsr |= CORTEXM_DFSR_VCATCH;
+}
+
+static void sim_core_halt(const uint32_t reason)
+{
+	sim.halted = true;
+	sim.dfsr |= reason;
+}
+
+/* Emulate the core running until it hits an armed breakpoint */
+static void sim_core_poll(void)
+{
+	if (sim.halted || sim.in_reset)
+		return;
+	sim.retired = true;
+	if (!(sim.fpb_ctrl & CORTEXM_FPB_CTRL_ENABLE) || ++sim.run_polls < SIM_RUN_POLLS)
+		return;
+	for (size_t i = 0; i < SIM_FPB_NUM_CODE; ++i) {
+		const uint32_t comp = sim.fpb_comp[i];
+		if (!(comp & 1U))
+			continue;
+		/* REPLACE selects which halfword of the word the breakpoint is on */
+		sim.regs[15] = (comp & 0x1ffffffcU) | ((comp >> 30U) == 2U ? 2U : 0U);
+		sim_core_halt(CORTEXM_DFSR_BKPT);
+		return;
+	}
+}
+
+static uint8_t sim_core_reg_index(const uint32_t regsel)
+{
+	const uint8_t index = regsel & 0x7fU;
+	/* With CONTROL.SPSEL clear, SP is the main stack pointer */
+	return index == 13U ? SIM_REG_MSP : index;
+}
+
+static uint32_t sim_dhcsr_read(void)
+{
+	sim_core_poll();
+	uint32_t value = sim.dhcsr & 0x2fU;
+	if (sim.halted)
+		value |= CORTEXM_DHCSR_S_HALT | CORTEXM_DHCSR_S_REGRDY;
+	else
+		value |= CORTEXM_DHCSR_S_REGRDY;
+	if (sim.reset_seen)
+		value |= CORTEXM_DHCSR_S_RESET_ST;
+	if (sim.retired)
+		value |= CORTEXM_DHCSR_S_RETIRE_ST;
+	sim.reset_seen = sim.in_reset;
+	sim.retired = false;
+	return value;
+}
+
+static void sim_dhcsr_write(const uint32_t value)
+{
+	if ((value & 0xffff0000U) != CORTEXM_DHCSR_DBGKEY)
+		return;
+	sim.dhcsr = value & 0x2fU;
+	if (!(value & CORTEXM_DHCSR_C_DEBUGEN)) {
+		sim.halted = false;
+		return;
+	}
+	if (sim.in_reset)
+		return;
+	if (value & CORTEXM_DHCSR_C_HALT) {
+		if (!sim.halted)
+			sim_core_halt(CORTEXM_DFSR_HALTED);
+	} else if (sim.halted) {
+		sim.retired = true;
+		sim.run_polls = 0U;
+		/* A step retires a single (16-bit) instruction and halts again */
+		if (value & CORTEXM_DHCSR_C_STEP) {
+			sim.regs[15] += 2U;
+			sim.dfsr |= CORTEXM_DFSR_HALTED;
+		} else
+			sim.halted = false;
+	}
+}
+
+static void sim_dcrsr_write(const uint32_t value)
+{
+	if (!sim.halted)
+		return;
+	const uint8_t index = sim_core_reg_index(value);
+	if (value & CORTEXM_DCRSR_REGWnR)
+		sim.regs[index] = sim.dcrdr;
+	else
+		sim.dcrdr = sim.regs[index];
+}
+
+static bool sim_scs_read(const uint16_t offset, uint32_t *const value)
+{
+	switch (offset) {
+	case CORTEXM_CPUID - CORTEXM_SCS_BASE:
+		*value = sim.model->cpuid;
+		break;
+	case CORTEXM_AIRCR - CORTEXM_SCS_BASE:
+		*value = 0xfa050000U;
+		break;
+	case CORTEXM_CCR - CORTEXM_SCS_BASE:
+		*value = sim.ccr;
+		break;
+	case CORTEXM_DFSR - CORTEXM_SCS_BASE:
+		*value = sim.dfsr;
+		break;
+	case CORTEXM_ID_PFR1 - CORTEXM_SCS_BASE:
+		*value = 0x00000200U;
+		break;
+	case CORTEXM_CPACR - CORTEXM_SCS_BASE:
+		*value = sim.cpacr;
+		break;
+	case CORTEXM_DHCSR - CORTEXM_SCS_BASE:
+		*value = sim_dhcsr_read();
+		break;
+	case CORTEXM_DCRDR - CORTEXM_SCS_BASE:
+		*value = sim.dcrdr;
+		break;
+	case CORTEXM_DEMCR - CORTEXM_SCS_BASE:
+		*value = sim.demcr;
+		break;
+	default:
+		*value = sim_component_id(offset, sim.model->scs_partno, JEP106_MANUFACTURER_ARM, cidc_gipc);
+		break;
+	}
+	return true;
+}
+
+static bool sim_scs_write(const uint16_t offset, const uint32_t value)
+{
+	switch (offset) {
+	case CORTEXM_AIRCR - CORTEXM_SCS_BASE:
+		if ((value & 0xffff0000U) == CORTEXM_AIRCR_VECTKEY && (value & CORTEXM_AIRCR_SYSRESETREQ))
+			sim_core_reset();
+		break;
+	case CORTEXM_CCR - CORTEXM_SCS_BASE:
+		sim.ccr = value;
+		break;
+	case CORTEXM_DFSR - CORTEXM_SCS_BASE:
+		sim.dfsr &= ~value;
+		break;
+	case CORTEXM_CPACR - CORTEXM_SCS_BASE:
+		if (sim.model->has_fpu)
+			sim.cpacr = value & 0x00f00000U;
+		break;
+	case CORTEXM_DHCSR - CORTEXM_SCS_BASE:
+		sim_dhcsr_write(value);
+		break;
+	case CORTEXM_DCRSR - CORTEXM_SCS_BASE:
+		sim_dcrsr_write(value);
+		break;
+	case CORTEXM_DCRDR - CORTEXM_SCS_BASE:
+		sim.dcrdr = value;
+		break;
+	case CORTEXM_DEMCR - CORTEXM_SCS_BASE:
+		sim.demcr = value & 0x010f07f1U;
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+static uint32_t sim_fpb_read(const uint16_t offset)
+{
+	if (offset == 0U)
+		return (SIM_FPB_NUM_LIT << 8U) | (SIM_FPB_NUM_CODE << 4U) | (sim.fpb_ctrl & CORTEXM_FPB_CTRL_ENABLE);
+	if (offset >= 8U && offset < 8U + SIM_FPB_COMPS * 4U)
+		return sim.fpb_comp[(offset - 8U) >> 2U];
+	return sim_component_id(offset, 0x003U, JEP106_MANUFACTURER_ARM, cidc_gipc);
+}
+
+static void sim_fpb_write(const uint16_t offset, const uint32_t value)
+{
+	if (offset == 0U && (value & CORTEXM_FPB_CTRL_KEY))
+		sim.fpb_ctrl = value & CORTEXM_FPB_CTRL_ENABLE;
+	else if (offset >= 8U && offset < 8U + SIM_FPB_COMPS * 4U)
+		sim.fpb_comp[(offset - 8U) >> 2U] = value;
+}
+
+static uint32_t sim_dwt_read(const uint16_t offset)
+{
+	if (offset == 0U)
+		return SIM_DWT_COMPS << 28U;
+	if (offset >= 0x20U && offset < 0x20U + SIM_DWT_COMPS * 0x10U) {
+		const size_t index = (offset - 0x20U) >> 4U;
+		switch (offset & 0xcU) {
+		case 0x0U:
+			return sim.dwt_comp[index];
+		case 0x4U:
+			return sim.dwt_mask[index];
+		case 0x8U:
+			return sim.dwt_func[index];
+		default:
+			return 0U;
+		}
+	}
+	return sim_component_id(offset, 0x002U, JEP106_MANUFACTURER_ARM, cidc_gipc);
+}
+
+static void sim_dwt_write(const uint16_t offset, const uint32_t value)
+{
+	if (offset < 0x20U || offset >= 0x20U + SIM_DWT_COMPS * 0x10U)
+		return;
+	const size_t index = (offset - 0x20U) >> 4U;
+	switch (offset & 0xcU) {
+	case 0x0U:
+		sim.dwt_comp[index] = value;
+		break;
+	case 0x4U:
+		sim.dwt_mask[index] = value & 0x1fU;
+		break;
+	case 0x8U:
+		sim.dwt_func[index] = value & ~CORTEXM_DWT_FUNC_MATCHED;
+		break;
+	default:
+		break;
+	}
+}
+
+static uint32_t sim_rom_table_read(const uint16_t offset)
+{
+	/* The ROM table lists the SCS, DWT, FPB and ITM as offsets relative to itself */
+	static const uint32_t entries[] = {
+		((CORTEXM_SCS_BASE - SIM_ROM_TABLE_BASE) & ADIV5_AP_BASE_BASEADDR) | 3U,
+		((CORTEXM_DWT_BASE - SIM_ROM_TABLE_BASE) & ADIV5_AP_BASE_BASEADDR) | 3U,
+		((CORTEXM_FPB_BASE - SIM_ROM_TABLE_BASE) & ADIV5_AP_BASE_BASEADDR) | 3U,
+		((SIM_ITM_BASE - SIM_ROM_TABLE_BASE) & ADIV5_AP_BASE_BASEADDR) | 3U,
+	};
+	if (offset < sizeof(entries))
+		return entries[offset >> 2U];
+	if (offset == ADI_ROM_MEMTYPE)
+		return ADI_ROM_MEMTYPE_SYSMEM;
+	return sim_component_id(offset, sim.model->dbgmcu_idcode & 0xfffU, JEP106_MANUFACTURER_STM, cidc_romtab);
+}
+
+static bool sim_fpec_read(const uint16_t offset, uint32_t *const value)
+{
+	const bool stm32f1 = sim.model->flash_family == SIM_FLASH_STM32F1;
+	switch (offset) {
+	case SIM_FPEC_SR:
+		*value = sim.flash_sr;
+		/* Report the controller busy (and the operation not yet complete) for the configured number of reads */
+		if (sim.flash_busy) {
+			--sim.flash_busy;
+			*value = stm32f1 ? (*value & ~SIM_STM32F1_SR_EOP) | SIM_STM32F1_SR_BSY :
+							   (*value & ~SIM_STM32F4_SR_EOP) | SIM_STM32F4_SR_BSY;
+		}
+		break;
+	case SIM_FPEC_CR:
+		*value = sim.flash_cr;
+		break;
+	case SIM_FPEC_OBR:
+		*value = stm32f1 ? 0x03fffffcU : 0U;
+		break;
+	case SIM_FPEC_WRPR:
+		*value = stm32f1 ? UINT32_MAX : 0U;
+		break;
+	case SIM_STM32F4_FPEC_OPTCR:
+		*value = stm32f1 ? 0U : 0x0fffaaedU;
+		break;
+	default:
+		*value = 0U;
+		break;
+	}
+	return true;
+}
+
+static bool sim_flash_unlock(const uint32_t key)
+{
+	const bool stm32f1 = sim.model->flash_family == SIM_FLASH_STM32F1;
+	const uint32_t lock = stm32f1 ? SIM_STM32F1_CR_LOCK : SIM_STM32F4_CR_LOCK;
+	/* Key writes while unlocked are ignored */
+	if (!(sim.flash_cr & lock))
+		return true;
+	/* A wrong key locks the controller out until the next reset and raises a bus error */
+	if (sim.flash_lockout || key != (sim.flash_key_stage ? SIM_FLASH_KEY2 : SIM_FLASH_KEY1)) {
+		sim.flash_lockout = true;
+		return false;
+	}
+	if (++sim.flash_key_stage == 2U) {
+		sim.flash_key_stage = 0U;
+		sim.flash_cr &= ~lock;
+	}
+	return true;
+}
+
+static void sim_flash_erase(const uint32_t offset, const uint32_t length)
+{
+	if (offset < sim.model->flash_size)
+		memset(sim.flash + offset, 0xff, MIN(length, sim.model->flash_size - offset));
+}
+
+static void sim_stm32f1_cr_write(const uint32_t value)
+{
+	sim.flash_cr = value & ~SIM_STM32F1_CR_STRT;
+	if (!(value & SIM_STM32F1_CR_STRT))
+		return;
+	const uint32_t page_size = sim.model->flash_page_size;
+	if (value & SIM_STM32F1_CR_MER)
+		sim_flash_erase(0U, sim.model->flash_size);
+	else if (value & SIM_STM32F1_CR_PER)
+		sim_flash_erase((sim.flash_ar - SIM_FLASH_BASE) & ~(page_size - 1U), page_size);
+	sim.flash_sr |= SIM_STM32F1_SR_EOP;
+	sim.flash_busy = sim.busy_reads;
+}
+
+/* Return the offset and size of an STM32F4 flash sector: 4x 16kiB, 1x 64kiB, then 128kiB sectors */
+static void sim_stm32f4_sector(const uint8_t sector, uint32_t *const offset, uint32_t *const size)
+{
+	if (sector < 4U) {
+		*offset = sector * 0x4000U;
+		*size = 0x4000U;
+	} else if (sector == 4U) {
+		*offset = 0x10000U;
+		*size = 0x10000U;
+	} else {
+		*offset = (sector - 4U) * 0x20000U;
+		*size = 0x20000U;
+	}
+}
+
+static void sim_stm32f4_cr_write(const uint32_t value)
+{
+	sim.flash_cr = value & ~SIM_STM32F4_CR_STRT;
+	if (!(value & SIM_STM32F4_CR_STRT))
+		return;
+	if (value & SIM_STM32F4_CR_MER)
+		sim_flash_erase(0U, sim.model->flash_size);
+	else if (value & SIM_STM32F4_CR_SER) {
+		uint32_t offset = 0;
+		uint32_t size = 0;
+		sim_stm32f4_sector((value & SIM_STM32F4_CR_SNB_MASK) >> SIM_STM32F4_CR_SNB_SHIFT, &offset, &size);
+		sim_flash_erase(offset, size);
+	}
+	if (value & SIM_STM32F4_CR_EOPIE)
+		sim.flash_sr |= SIM_STM32F4_SR_EOP;
+	sim.flash_busy = sim.busy_reads;
+}
+
+static bool sim_fpec_write(const uint16_t offset, const uint32_t value)
+{
+	const bool stm32f1 = sim.model->flash_family == SIM_FLASH_STM32F1;
+	switch (offset) {
+	case SIM_FPEC_KEYR:
+		return sim_flash_unlock(value);
+	case SIM_FPEC_SR:
+		/* Status flags are write-1-to-clear */
+		sim.flash_sr &= ~(value & (stm32f1 ? (SIM_STM32F1_SR_EOP | SIM_STM32F1_SR_WRPRTERR | SIM_STM32F1_SR_PGERR) :
+											 (SIM_STM32F4_SR_EOP | SIM_STM32F4_SR_ERR_MASK)));
+		break;
+	case SIM_FPEC_CR:
+		/* While locked, the control register ignores writes */
+		if (sim.flash_cr & (stm32f1 ? SIM_STM32F1_CR_LOCK : SIM_STM32F4_CR_LOCK))
+			break;
+		if (stm32f1)
+			sim_stm32f1_cr_write(value);
+		else
+			sim_stm32f4_cr_write(value);
+		break;
+	case SIM_FPEC_AR:
+		if (stm32f1)
+			sim.flash_ar = value;
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+/* Handle a bus write to the flash array, which is only possible while programming is enabled */
+static bool sim_flash_program(const uint32_t offset, const uint8_t size, const uint32_t value)
+{
+	uint8_t *const memory = sim.flash + offset;
+	if (sim.model->flash_family == SIM_FLASH_STM32F1) {
+		/* The STM32F1 FPEC only programs halfwords, any other access faults */
+		if (!(sim.flash_cr & SIM_STM32F1_CR_PG) || size != ALIGN_16BIT)
+			return false;
+		/* Programming a non-erased halfword with anything other than 0 is refused */
+		if (read_le2(memory, 0U) != 0xffffU && value != 0U)
+			sim.flash_sr |= SIM_STM32F1_SR_PGERR;
+		else
+			write_le2(memory, 0U, (uint16_t)value);
+		sim.flash_sr |= SIM_STM32F1_SR_EOP;
+		sim.flash_busy = sim.busy_reads;
+		return true;
+	}
+
+	if (!(sim.flash_cr & SIM_STM32F4_CR_PG)) {
+		sim.flash_sr |= SIM_STM32F4_SR_PGSERR;
+		return true;
+	}
+	/* The access size must match PSIZE, with x64 parallelism being programmed 32 bits at a time */
+	const uint8_t psize = (sim.flash_cr >> SIM_STM32F4_CR_PSIZE_SHIFT) & 3U;
+	if (size != MIN(psize, ALIGN_32BIT)) {
+		sim.flash_sr |= SIM_STM32F4_SR_PGPERR;
+		return true;
+	}
+	for (size_t i = 0; i < (1U << size); ++i)
+		memory[i] &= (uint8_t)(value >> (i * 8U));
+	if (sim.flash_cr & SIM_STM32F4_CR_EOPIE)
+		sim.flash_sr |= SIM_STM32F4_SR_EOP;
+	sim.flash_busy = sim.busy_reads;
+	return true;
+}
+
+static bool sim_dbgmcu_read(const uint16_t offset, uint32_t *const value)
+{
+	switch (offset) {
+	case 0x0U:
+		*value = sim.model->dbgmcu_idcode;
+		break;
+	case 0x4U:
+		*value = sim.dbgmcu_cr;
+		break;
+	case 0x8U:
+		*value = sim.model->flash_family == SIM_FLASH_STM32F4 ? sim.dbgmcu_apb1_fz : 0U;
+		break;
+	case 0xcU:
+		*value = sim.model->flash_family == SIM_FLASH_STM32F4 ? sim.dbgmcu_apb2_fz : 0U;
+		break;
+	default:
+		*value = 0U;
+		break;
+	}
+	return true;
+}
+
+static void sim_dbgmcu_write(const uint16_t offset, const uint32_t value)
+{
+	if (offset == 0x4U)
+		sim.dbgmcu_cr = value;
+	else if (offset == 0x8U)
+		sim.dbgmcu_apb1_fz = value;
+	else if (offset == 0xcU)
+		sim.dbgmcu_apb2_fz = value;
+}
+
+/* Read a word-aligned peripheral or debug register, returning false on a bus error */
+static bool sim_register_read(const uint32_t addr, uint32_t *const value)
+{
+	const uint32_t fpec_base = sim.model->fpec_base;
+	*value = 0U;
+	if (addr >= fpec_base && addr - fpec_base < 0x400U)
+		return sim_fpec_read(addr - fpec_base, value);
+	/* Other peripherals are read-as-zero, write-ignored */
+	if (addr >= 0x40000000U && addr < 0x60000000U)
+		return true;
+	if ((addr & ~0xfffU) == CORTEXM_SCS_BASE)
+		return sim_scs_read(addr & 0xfffU, value);
+	if ((addr & ~0xfffU) == CORTEXM_FPB_BASE)
+		*value = sim_fpb_read(addr & 0xfffU);
+	else if ((addr & ~0xfffU) == CORTEXM_DWT_BASE)
+		*value = sim_dwt_read(addr & 0xfffU);
+	else if ((addr & ~0xfffU) == SIM_ITM_BASE)
+		*value = sim_component_id(addr & 0xfffU, 0x001U, JEP106_MANUFACTURER_ARM, cidc_gipc);
+	else if ((addr & ~0xfffU) == SIM_ROM_TABLE_BASE)
+		*value = sim_rom_table_read(addr & 0xfffU);
+	else if ((addr & ~0xfffU) == SIM_DBGMCU_BASE)
+		return sim_dbgmcu_read(addr & 0xfffU, value);
+	/* Everything else in the private peripheral bus region reads as zero */
+	else if (addr < CORTEXM_PPB_BASE || addr >= SIM_ROM_TABLE_BASE + 0x1000U)
+		return false;
+	return true;
+}
+
+static bool sim_register_write(const uint32_t addr, const uint32_t value)
+{
+	const uint32_t fpec_base = sim.model->fpec_base;
+	if (addr >= fpec_base && addr - fpec_base < 0x400U)
+		return sim_fpec_write(addr - fpec_base, value);
+	if (addr >= 0x40000000U && addr < 0x60000000U)
+		return true;
+	if (addr < CORTEXM_PPB_BASE || addr >= SIM_ROM_TABLE_BASE + 0x1000U)
+		return false;
+	if ((addr & ~0xfffU) == CORTEXM_SCS_BASE)
+		return sim_scs_write(addr & 0xfffU, value);
+	if ((addr & ~0xfffU) == CORTEXM_FPB_BASE)
+		sim_fpb_write(addr & 0xfffU, value);
+	else if ((addr & ~0xfffU) == CORTEXM_DWT_BASE)
+		sim_dwt_write(addr & 0xfffU, value);
+	else if ((addr & ~0xfffU) == SIM_DBGMCU_BASE)
+		sim_dbgmcu_write(addr & 0xfffU, value);
+	return true;
+}
+
+/*
+ * Perform a bus read of (1 << size) bytes at addr. As on AHB, the data is returned in its byte lanes
+ * of the (aligned) 32-bit data bus. Returns false on a bus error.
+ */
+static bool sim_bus_read(const uint32_t addr, const uint8_t size, uint32_t *const value)
+{
+	if (addr & ((1U << size) - 1U))
+		return false;
+	const uint8_t *const memory = sim_memory(addr & ~3U);
+	if (memory) {
+		*value = read_le4(memory, 0U);
+		return true;
+	}
+	return sim_register_read(addr & ~3U, value);
+}
+
+/* Perform a bus write of (1 << size) bytes at addr, taking the data from its byte lanes in value */
+static bool sim_bus_write(const uint32_t addr, const uint8_t size, const uint32_t value)
+{
+	if (addr & ((1U << size) - 1U))
+		return false;
+	const uint8_t lane = (addr & 3U) * 8U;
+	const uint32_t mask = size == ALIGN_32BIT ? UINT32_MAX : ((1U << (8U << size)) - 1U);
+	const uint32_t data = (value >> lane) & mask;
+
+	const sim_model_s *const model = sim.model;
+	if (addr >= SIM_FLASH_BASE && addr - SIM_FLASH_BASE < model->flash_size)
+		return sim_flash_program(addr - SIM_FLASH_BASE, size, data);
+	uint8_t *memory = NULL;
+	if (addr >= SIM_SRAM_BASE && addr - SIM_SRAM_BASE < model->sram_size)
+		memory = sim.sram + (addr - SIM_SRAM_BASE);
+	else if (model->ccm_size && addr >= SIM_CCM_BASE && addr - SIM_CCM_BASE < model->ccm_size)
+		memory = sim.ccm + (addr - SIM_CCM_BASE);
+	if (memory) {
+		for (size_t i = 0; i < (1U << size); ++i)
+			memory[i] = (uint8_t)(data >> (i * 8U));
+		return true;
+	}
+	/* The flash alias and system memory are read-only */
+	if (sim_memory(addr))
+		return false;
+
+	/* Registers are 32-bit, so merge narrower writes into the current value */
+	uint32_t current = value;
+	if (size != ALIGN_32BIT) {
+		if (!sim_register_read(addr & ~3U, &current))
+			return false;
+		current = (current & ~(mask << lane)) | (data << lane);
+	}
+	return sim_register_write(addr & ~3U, current);
+}
+
+static void sim_ap_error(void)
+{
+	sim.ctrlstat |= ADIV5_DP_CTRLSTAT_STICKYERR;
+}
+
+/* Perform a DRW transfer at TAR, splitting it into several bus transfers in packed mode */
+static uint32_t sim_ap_drw_access(const uint8_t rnw, const uint32_t value)
+{
+	const uint8_t size = MIN(sim.csw & ADIV5_AP_CSW_SIZE_MASK, ALIGN_32BIT);
+	const uint32_t addrinc = sim.csw & ADIV5_AP_CSW_ADDRINC_MASK;
+	const size_t transfers = addrinc == ADIV5_AP_CSW_ADDRINC_PACKED && size != ALIGN_32BIT ? 4U >> size : 1U;
+
+	uint32_t result = 0;
+	for (size_t i = 0; i < transfers; ++i) {
+		const uint32_t addr = sim.tar + (i << size);
+		const uint32_t lane_mask = size == ALIGN_32BIT ? UINT32_MAX : ((1U << (8U << size)) - 1U) << ((addr & 3U) * 8U);
+		uint32_t data = 0;
+		if (rnw ? !sim_bus_read(addr, size, &data) : !sim_bus_write(addr, size, value)) {
+			sim_ap_error();
+			return 0;
+		}
+		result |= data & lane_mask;
+	}
+	/* TAR auto-increments within a 1kiB boundary */
+	if (addrinc != ADIV5_AP_CSW_ADDRINC_NONE)
+		sim.tar = (sim.tar & ~0x3ffU) | ((sim.tar + (transfers << size)) & 0x3ffU);
+	return result;
+}
+
+/* Access a register of AP 0 (the only AP the model has) by its 8-bit register address */
+static uint32_t sim_ap_access(const uint8_t apsel, const uint8_t rnw, const uint8_t reg, const uint32_t value)
+{
+	if (apsel != 0U)
+		return 0;
+	switch (reg) {
+	case ADIV5_AP_CSW & 0xffU:
+		if (rnw)
+			return sim.csw | ADIV5_AP_CSW_AP_ENABLED;
+		sim.csw = value & ~(ADIV5_AP_CSW_TRINPROG | ADIV5_AP_CSW_AP_ENABLED);
+		if ((sim.csw & ADIV5_AP_CSW_SIZE_MASK) > ADIV5_AP_CSW_SIZE_WORD)
+			sim.csw = (sim.csw & ~ADIV5_AP_CSW_SIZE_MASK) | ADIV5_AP_CSW_SIZE_WORD;
+		return 0;
+	case ADIV5_AP_TAR_LOW & 0xffU:
+		if (rnw)
+			return sim.tar;
+		sim.tar = value;
+		return 0;
+	case ADIV5_AP_DRW & 0xffU:
+		return sim_ap_drw_access(rnw, value);
+	case ADIV5_AP_DB(0) & 0xffU:
+	case ADIV5_AP_DB(1) & 0xffU:
+	case ADIV5_AP_DB(2) & 0xffU:
+	case ADIV5_AP_DB(3) & 0xffU: {
+		/* The banked data registers map onto the 4 words of the 16-byte block TAR points into */
+		const uint32_t addr = (sim.tar & ~0xfU) | (reg & 0xcU);
+		uint32_t data = 0;
+		if (rnw ? !sim_bus_read(addr, ALIGN_32BIT, &data) : !sim_bus_write(addr, ALIGN_32BIT, value))
+			sim_ap_error();
+		return data;
+	}
+	case ADIV5_AP_BASE_LOW & 0xffU:
+		return rnw ? SIM_ROM_TABLE_BASE | ADIV5_AP_BASE_FORMAT_ADIV5 | ADIV5_AP_BASE_PRESENT : 0U;
+	case ADIV5_AP_IDR & 0xffU:
+		return rnw ? sim.model->ap_idr : 0U;
+	default:
+		return 0;
+	}
+}
+
+static uint32_t sim_dp_ctrlstat(void)
+{
+	uint32_t value = sim.ctrlstat;
+	/* Power and reset requests are acknowledged immediately */
+	if (value & ADIV5_DP_CTRLSTAT_CSYSPWRUPREQ)
+		value |= ADIV5_DP_CTRLSTAT_CSYSPWRUPACK;
+	if (value & ADIV5_DP_CTRLSTAT_CDBGPWRUPREQ)
+		value |= ADIV5_DP_CTRLSTAT_CDBGPWRUPACK;
+	if (value & ADIV5_DP_CTRLSTAT_CDBGRSTREQ)
+		value |= ADIV5_DP_CTRLSTAT_CDBGRSTACK;
+	return value;
+}
+
+static void sim_dp_abort(const uint32_t value)
+{
+	if (value & ADIV5_DP_ABORT_STKERRCLR)
+		sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_STICKYERR;
+	if (value & ADIV5_DP_ABORT_STKCMPCLR)
+		sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_STICKYCMP;
+	if (value & ADIV5_DP_ABORT_ORUNERRCLR)
+		sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_STICKYORUN;
+	if (value & ADIV5_DP_ABORT_WDERRCLR)
+		sim.ctrlstat &= ~ADIV5_DP_CTRLSTAT_WDATAERR;
+}
+
+/* The JTAG-DP is a DPv0 part and so has no DPIDR, and clears the sticky flags by writing 1 to them */
+static uint32_t sim_dp_read(const uint8_t reg, const bool jtag)
+{
+	switch (reg) {
+	case ADIV5_DP_DPIDR:
+		return jtag ? 0U : sim.model->dpidr;
+	case ADIV5_DP_CTRLSTAT:
+		return (sim.select & 0xfU) == ADIV5_DP_BANK0 ? sim_dp_ctrlstat() : 0U;
+	case ADIV5_DP_RDBUFF:
+		return sim.rdbuff;
+	default:
+		return 0U;
+	}
+}
+
+static void sim_dp_write(const uint8_t reg, const uint32_t value, const bool jtag)
+{
+	switch (reg) {
+	case ADIV5_DP_ABORT:
+		if (!jtag)
+			sim_dp_abort(value);
+		break;
+	case ADIV5_DP_CTRLSTAT:
+		if ((sim.select & 0xfU) != ADIV5_DP_BANK0)
+			break;
+		sim.ctrlstat = (sim.ctrlstat & SIM_CTRLSTAT_STICKY_MASK) | (value & SIM_CTRLSTAT_WRITE_MASK);
+		if (jtag)
+			sim.ctrlstat &= ~(value & SIM_CTRLSTAT_STICKY_MASK);
+		break;
+	case ADIV5_DP_SELECT:
+		sim.select = value;
+		break;
+	default:
+		break;
+	}
+}
+
+static inline uint8_t sim_select_apsel(void)
+{
+	return sim.select >> 24U;
+}
+
+static inline uint8_t sim_select_ap_reg(const uint8_t reg)
+{
+	return (sim.select & 0xf0U) | reg;
+}
+
+/* Count an AP access for the fault injection, returning true if it should be answered with WAIT */
+static bool sim_inject_wait(void)
+{
+	++sim.ap_accesses;
+	if (!sim.wait_every || sim.ap_accesses % sim.wait_every)
+		return false;
+	++sim.stats.waits;
+	return true;
+}
+
+static bool sim_inject_fault(void)
+{
+	if (!sim.fault_every || sim.ap_accesses % sim.fault_every)
+		return false;
+	sim_ap_error();
+	return true;
+}
+
+/* Respond to the SWD request just received, performing any read as part of the ACK phase */
+static uint8_t sim_swd_ack(void)
+{
+	const bool ap = sim.request & 0x02U;
+	const uint8_t rnw = (sim.request >> 2U) & 1U;
+	const uint8_t reg = (sim.request >> 1U) & 0x0cU;
+
+	sim_latency();
+	++sim.stats.transactions;
+	++sim.stats.requests;
+	if (ap) {
+		if (sim_inject_wait()) {
+			sim.swd_state = SIM_SWD_IDLE;
+			return SWD_ACK_WAIT;
+		}
+		/* The SW-DP refuses AP accesses with FAULT while any sticky error flag is set */
+		if (sim_inject_fault() || (sim.ctrlstat & SIM_CTRLSTAT_STICKY_MASK)) {
+			if (sim.fault_every)
+				++sim.stats.faults;
+			sim.swd_state = SIM_SWD_IDLE;
+			return SWD_ACK_FAULT;
+		}
+	}
+
+	if (!rnw) {
+		sim.swd_state = SIM_SWD_WRITE_DATA;
+		return SWD_ACK_OK;
+	}
+	/* AP reads are posted: the data phase returns the result of the previous AP read */
+	if (ap) {
+		sim.read_data = sim.rdbuff;
+		sim.rdbuff = sim_ap_access(sim_select_apsel(), rnw, sim_select_ap_reg(reg), 0U);
+	} else
+		sim.read_data = sim_dp_read(reg, false);
+	sim.dpidr_pending = false;
+	sim.swd_state = SIM_SWD_READ_DATA;
+	return SWD_ACK_OK;
+}
+
+static bool sim_swd_request_valid(const uint8_t request)
+{
+	/* Start bit, parity over APnDP, RnW and A[3:2], stop bit and park bit */
+	const bool parity = calculate_odd_parity((request >> 1U) & 0xfU);
+	if (!(request & 0x01U) || ((request >> 5U) & 1U) != parity || (request & 0x40U) || !(request & 0x80U))
+		return false;
+	/* After a line reset the only acceptable request is a DPIDR read */
+	return !sim.dpidr_pending || (request & 0x1eU) == 0x04U;
+}
+
+/* Clock a single host-driven bit into the SW-DP */
+static void sim_swd_clock_out(const bool bit)
+{
+	if (bit) {
+		if (sim.high_bits < SIM_SWD_LINE_RESET_BITS && ++sim.high_bits == SIM_SWD_LINE_RESET_BITS) {
+			sim.swd_state = SIM_SWD_RESET;
+			sim.dpidr_pending = true;
+		}
+	} else
+		sim.high_bits = 0U;
+
+	switch (sim.swd_state) {
+	case SIM_SWD_RESET:
+		if (!bit)
+			sim.swd_state = SIM_SWD_IDLE;
+		break;
+	case SIM_SWD_IDLE:
+		if (bit) {
+			sim.request = 1U;
+			sim.request_bits = 1U;
+			sim.swd_state = SIM_SWD_REQUEST;
+		}
+		break;
+	case SIM_SWD_REQUEST:
+		sim.request |= (uint8_t)(bit << sim.request_bits);
+		if (++sim.request_bits == 8U)
+			sim.swd_state = sim_swd_request_valid(sim.request) ? SIM_SWD_ACK : SIM_SWD_LOCKOUT;
+		break;
+	case SIM_SWD_LOCKOUT:
+		break;
+	default:
+		/* The host drove the line when the target should have: protocol error */
+		sim.swd_state = SIM_SWD_LOCKOUT;
+		break;
+	}
+}
+
+static void sim_swd_seq_out(const uint32_t tms_states, const size_t clock_cycles)
+{
+	for (size_t cycle = 0; cycle < clock_cycles; ++cycle)
+		sim_swd_clock_out((tms_states >> cycle) & 1U);
+}
+
+static void sim_swd_seq_out_parity(const uint32_t tms_states, const size_t clock_cycles)
+{
+	if (sim.swd_state != SIM_SWD_WRITE_DATA) {
+		sim_swd_seq_out(tms_states, clock_cycles);
+		sim_swd_clock_out(calculate_odd_parity(tms_states));
+		return;
+	}
+	const uint8_t reg = (sim.request >> 1U) & 0x0cU;
+	if (sim.request & 0x02U)
+		sim_ap_access(sim_select_apsel(), ADIV5_LOW_WRITE, sim_select_ap_reg(reg), tms_states);
+	else
+		sim_dp_write(reg, tms_states, false);
+	sim.high_bits = 0U;
+	sim.swd_state = SIM_SWD_IDLE;
+}
+
+static uint32_t sim_swd_seq_in(const size_t clock_cycles)
+{
+	if (sim.swd_state == SIM_SWD_ACK && clock_cycles == 3U)
+		return sim_swd_ack();
+	if (sim.swd_state == SIM_SWD_READ_DATA && clock_cycles == 32U) {
+		sim.swd_state = SIM_SWD_IDLE;
+		return sim.read_data;
+	}
+	/* Nobody is driving the line, so the pull-up makes it read high */
+	return clock_cycles >= 32U ? UINT32_MAX : (1U << clock_cycles) - 1U;
+}
+
+static bool sim_swd_seq_in_parity(uint32_t *const ret, const size_t clock_cycles)
+{
+	if (sim.swd_state != SIM_SWD_READ_DATA || clock_cycles != 32U) {
+		*ret = sim_swd_seq_in(clock_cycles);
+		return false;
+	}
+	*ret = sim.read_data;
+	sim.swd_state = SIM_SWD_IDLE;
+	return true;
+}
+
+static void sim_jtag_capture_dr(void)
+{
+	switch (sim.ir) {
+	case SIM_IR_IDCODE:
+		sim.dr_length = 32U;
+		sim.dr_shift = sim.model->jtag_idcode;
+		break;
+	case SIM_IR_DPACC:
+	case SIM_IR_APACC:
+		sim.dr_length = 35U;
+		sim_latency();
+		++sim.stats.transactions;
+		++sim.stats.requests;
+		/* A WAIT is decided at capture time, and the update that follows is then ignored */
+		sim.dr_wait = sim.ir == SIM_IR_APACC && sim_inject_wait();
+		sim.dr_shift = sim.dr_wait ? SIM_JTAG_ACK_WAIT : ((uint64_t)sim.jtag_result << 3U) | SIM_JTAG_ACK_OK;
+		break;
+	case SIM_IR_ABORT:
+		sim.dr_length = 35U;
+		sim.dr_shift = 0U;
+		break;
+	default:
+		sim.dr_length = 1U;
+		sim.dr_shift = 0U;
+		break;
+	}
+}
+
+static void sim_jtag_update_dr(void)
+{
+	const uint8_t rnw = sim.dr_shift & 1U;
+	const uint8_t reg = (sim.dr_shift << 1U) & 0x0cU;
+	const uint32_t value = (uint32_t)(sim.dr_shift >> 3U);
+	switch (sim.ir) {
+	case SIM_IR_ABORT:
+		++sim.stats.transactions;
+		++sim.stats.requests;
+		sim_dp_abort(value);
+		break;
+	case SIM_IR_DPACC:
+		if (sim.dr_wait)
+			break;
+		if (!rnw)
+			sim_dp_write(reg, value, true);
+		/* Reads of RDBUFF are RAZ, the previous result having been returned by their capture */
+		else if (reg == ADIV5_DP_RDBUFF)
+			sim.jtag_result = 0U;
+		else
+			sim.jtag_result = sim_dp_read(reg, true);
+		break;
+	case SIM_IR_APACC:
+		if (sim.dr_wait)
+			break;
+		/* The JTAG-DP has no FAULT response and instead discards AP accesses while a sticky flag is set */
+		if (sim.ctrlstat & SIM_CTRLSTAT_STICKY_MASK) {
+			if (rnw)
+				sim.jtag_result = 0U;
+			break;
+		}
+		if (rnw)
+			sim.jtag_result = sim_ap_access(sim_select_apsel(), rnw, sim_select_ap_reg(reg), 0U);
+		else
+			sim_ap_access(sim_select_apsel(), rnw, sim_select_ap_reg(reg), value);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Clock the JTAG TAP once, returning TDO */
+static bool sim_jtag_clock(const bool tms, const bool tdi)
+{
+	bool tdo = true;
+	if (sim.tap_state == SIM_TAP_SHIFT_DR) {
+		tdo = sim.dr_shift & 1U;
+		sim.dr_shift = (sim.dr_shift >> 1U) | ((uint64_t)tdi << (sim.dr_length - 1U));
+	} else if (sim.tap_state == SIM_TAP_SHIFT_IR) {
+		tdo = sim.ir_shift & 1U;
+		sim.ir_shift = (uint8_t)((sim.ir_shift >> 1U) | (tdi << 3U));
+	}
+
+	sim.tap_state = sim_tap_next_state[sim.tap_state][tms ? 1U : 0U];
+	switch (sim.tap_state) {
+	case SIM_TAP_RESET:
+		sim.ir = SIM_IR_IDCODE;
+		break;
+	case SIM_TAP_CAPTURE_DR:
+		sim_jtag_capture_dr();
+		break;
+	case SIM_TAP_UPDATE_DR:
+		sim_jtag_update_dr();
+		break;
+	case SIM_TAP_CAPTURE_IR:
+		sim.ir_shift = 0x1U;
+		break;
+	case SIM_TAP_UPDATE_IR:
+		sim.ir = sim.ir_shift & 0xfU;
+		break;
+	default:
+		break;
+	}
+	return tdo;
+}
+
+static void sim_jtagtap_reset(void)
+{
+	jtagtap_soft_reset();
+}
+
+static bool sim_jtagtap_next(const bool tms, const bool tdi)
+{
+	return sim_jtag_clock(tms, tdi);
+}
+
+static void sim_jtagtap_tms_seq(uint32_t tms_states, const size_t clock_cycles)
+{
+	for (size_t cycle = 0; cycle < clock_cycles; ++cycle, tms_states >>= 1U)
+		sim_jtag_clock(tms_states & 1U, true);
+}
+
+static void sim_jtagtap_tdi_tdo_seq(
+	uint8_t *const data_out, const bool final_tms, const uint8_t *const data_in, const size_t clock_cycles)
+{
+	for (size_t cycle = 0; cycle < clock_cycles; ++cycle) {
+		const size_t byte = cycle >> 3U;
+		const uint8_t bit = 1U << (cycle & 7U);
+		const bool tms = final_tms && cycle + 1U == clock_cycles;
+		const bool tdo = sim_jtag_clock(tms, !data_in || (data_in[byte] & bit));
+		if (!data_out)
+			continue;
+		if (tdo)
+			data_out[byte] |= bit;
+		else
+			data_out[byte] &= ~bit;
+	}
+}
+
+static void sim_jtagtap_tdi_seq(const bool final_tms, const uint8_t *const data_in, const size_t clock_cycles)
+{
+	sim_jtagtap_tdi_tdo_seq(NULL, final_tms, data_in, clock_cycles);
+}
+
+static void sim_jtagtap_cycle(const bool tms, const bool tdi, const size_t clock_cycles)
+{
+	for (size_t cycle = 0; cycle < clock_cycles; ++cycle)
+		sim_jtag_clock(tms, tdi);
+}
+
+/*
+ * The following implement the ADIv5 acceleration hooks, standing in for what a probe with
+ * high-level memory and register commands does. Each call is counted as one request, along with
+ * the DP/AP transactions the probe would have had to perform for it.
+ */
+
+static void sim_adiv5_bus_error(adiv5_access_port_s *const ap, const char *const func, const uint32_t addr)
+{
+	sim_ap_error();
+	ap->dp->fault = SWD_ACK_FAULT;
+	DEBUG_ERROR("%s error around 0x%08" PRIx32 "\n", func, addr);
+}
+
+static void sim_adiv5_request(const uint64_t transactions)
+{
+	sim_latency();
+	++sim.stats.requests;
+	sim.stats.transactions += transactions;
+}
+
+static uint32_t sim_adiv5_ap_read(adiv5_access_port_s *const ap, const uint16_t addr)
+{
+	/* SELECT, the AP read itself and RDBUFF to fetch the result */
+	sim_adiv5_request(3U);
+	return sim_ap_access(ap->apsel, ADIV5_LOW_READ, addr & 0xffU, 0U);
+}
+
+static void sim_adiv5_ap_write(adiv5_access_port_s *const ap, const uint16_t addr, const uint32_t value)
+{
+	sim_adiv5_request(2U);
+	sim_ap_access(ap->apsel, ADIV5_LOW_WRITE, addr & 0xffU, value);
+}
+
+static void sim_adiv5_mem_read(
+	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t read_length)
+{
+	if (!read_length)
+		return;
+	uint8_t *const data = (uint8_t *)dest;
+	const uint32_t addr = (uint32_t)src;
+	const align_e align = MIN_ALIGN(addr, read_length);
+	const size_t stride = 1U << align;
+	/* CSW and TAR set up, one DRW read per stride, one TAR reload per 1kiB boundary and the trailing RDBUFF */
+	sim_adiv5_request(3U + read_length / stride + ((addr & 0x3ffU) + read_length - 1U) / 1024U);
+	for (size_t offset = 0; offset < read_length; offset += stride) {
+		uint32_t value = 0;
+		if (ap->apsel != 0U || !sim_bus_read(addr + offset, align, &value)) {
+			sim_adiv5_bus_error(ap, __func__, addr + offset);
+			return;
+		}
+		value >>= ((addr + offset) & 3U) * 8U;
+		for (size_t i = 0; i < stride; ++i)
+			data[offset + i] = (uint8_t)(value >> (i * 8U));
+	}
+}
+
+static void sim_adiv5_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src,
+	const size_t write_length, const align_e align)
+{
+	if (!write_length)
+		return;
+	const uint8_t *const data = (const uint8_t *)src;
+	const uint32_t addr = (uint32_t)dest;
+	const size_t stride = 1U << align;
+	sim_adiv5_request(3U + write_length / stride + ((addr & 0x3ffU) + write_length - 1U) / 1024U);
+	for (size_t offset = 0; offset < write_length; offset += stride) {
+		uint32_t value = 0;
+		for (size_t i = 0; i < stride; ++i)
+			value |= (uint32_t)data[offset + i] << (i * 8U);
+		value <<= ((addr + offset) & 3U) * 8U;
+		if (ap->apsel != 0U || !sim_bus_write(addr + offset, align, value)) {
+			sim_adiv5_bus_error(ap, __func__, addr + offset);
+			return;
+		}
+	}
+}
+
+static void sim_adiv5_regs_read(adiv5_access_port_s *const ap, void *const data)
+{
+	(void)ap;
+	uint32_t *const regs = (uint32_t *)data;
+	/* CSW and TAR set up, then a DCRSR write and DCRDR read plus RDBUFF per register */
+	sim_adiv5_request(2U + 21U * 3U);
+	for (size_t i = 0; i < 21U; ++i)
+		regs[i] = sim.regs[sim_core_reg_index(i)];
+}
+
+static uint32_t sim_adiv5_reg_read(adiv5_access_port_s *const ap, const uint8_t reg_num)
+{
+	(void)ap;
+	sim_adiv5_request(5U);
+	return sim.regs[sim_core_reg_index(reg_num)];
+}
+
+static void sim_adiv5_reg_write(adiv5_access_port_s *const ap, const uint8_t reg_num, const uint32_t value)
+{
+	(void)ap;
+	sim_adiv5_request(4U);
+	sim.regs[sim_core_reg_index(reg_num)] = value;
+}
+
+void sim_adiv5_dp_init(adiv5_debug_port_s *const dp)
+{
+	dp->ap_read = sim_adiv5_ap_read;
+	dp->ap_write = sim_adiv5_ap_write;
+	dp->mem_read = sim_adiv5_mem_read;
+	dp->mem_write = sim_adiv5_mem_write;
+	dp->ap_regs_read = sim_adiv5_regs_read;
+	dp->ap_reg_read = sim_adiv5_reg_read;
+	dp->ap_reg_write = sim_adiv5_reg_write;
+}
+
+bool sim_swd_init(void)
+{
+	swd_proc.seq_in = sim_swd_seq_in;
+	swd_proc.seq_in_parity = sim_swd_seq_in_parity;
+	swd_proc.seq_out = sim_swd_seq_out;
+	swd_proc.seq_out_parity = sim_swd_seq_out_parity;
+	sim.swd_state = SIM_SWD_LOCKOUT;
+	sim.high_bits = 0U;
+	return true;
+}
+
+bool sim_jtag_init(void)
+{
+	jtag_proc.jtagtap_reset = sim_jtagtap_reset;
+	jtag_proc.jtagtap_next = sim_jtagtap_next;
+	jtag_proc.jtagtap_tms_seq = sim_jtagtap_tms_seq;
+	jtag_proc.jtagtap_tdi_tdo_seq = sim_jtagtap_tdi_tdo_seq;
+	jtag_proc.jtagtap_tdi_seq = sim_jtagtap_tdi_seq;
+	jtag_proc.jtagtap_cycle = sim_jtagtap_cycle;
+	jtag_proc.tap_idle_cycles = 1U;
+	return true;
+}
+
+const char *sim_target_voltage(void)
+{
+	return "3.3V";
+}
+
+void sim_nrst_set_val(const bool assert)
+{
+	if (assert == sim.nrst)
+		return;
+	sim.nrst = assert;
+	sim.in_reset = assert;
+	if (assert) {
+		sim.halted = false;
+		sim.reset_seen = true;
+	} else
+		sim_core_reset();
+}
+
+bool sim_nrst_get_val(void)
+{
+	return sim.nrst;
+}
+
+void sim_max_frequency_set(const uint32_t frequency)
+{
+	sim.frequency = frequency;
+}
+
+uint32_t sim_max_frequency_get(void)
+{
+	return sim.frequency;
+}
+
+void sim_stats_read(sim_stats_s *const stats)
+{
+	*stats = sim.stats;
+}
+
+static bool sim_parse_options(const char *const spec)
+{
+	const char *const options = strchr(spec, ',');
+	const size_t name_length = options ? (size_t)(options - spec) : strlen(spec);
+	for (size_t i = 0; i < ARRAY_LENGTH(sim_models); ++i) {
+		const char *const name = name_length ? spec : SIM_DEFAULT_MODEL;
+		const size_t length = name_length ? name_length : strlen(SIM_DEFAULT_MODEL);
+		if (strlen(sim_models[i].name) == length && strncmp(sim_models[i].name, name, length) == 0)
+			sim.model = &sim_models[i];
+	}
+	if (!sim.model) {
+		DEBUG_ERROR("Unknown simulator model '%.*s', valid models are:\n", (int)name_length, spec);
+		for (size_t i = 0; i < ARRAY_LENGTH(sim_models); ++i)
+			DEBUG_ERROR("\t%s: %s\n", sim_models[i].name, sim_models[i].description);
+		return false;
+	}
+
+	const struct {
+		const char *name;
+		uint32_t *value;
+	} settings[] = {
+		{"latency", &sim.latency_us},
+		{"wait", &sim.wait_every},
+		{"fault", &sim.fault_every},
+		{"busy", &sim.busy_reads},
+	};
+	for (const char *option = options; option; option = strchr(option + 1U, ',')) {
+		const char *const name = option + 1U;
+		const char *const equals = strchr(name, '=');
+		char *end = NULL;
+		const unsigned long value = equals ? strtoul(equals + 1U, &end, 0) : 0U;
+		size_t setting = 0;
+		for (; equals && setting < ARRAY_LENGTH(settings); ++setting) {
+			if (strlen(settings[setting].name) == (size_t)(equals - name) &&
+				strncmp(settings[setting].name, name, equals - name) == 0)
+				break;
+		}
+		if (!equals || end == equals + 1U || (*end != '\0' && *end != ',') || setting == ARRAY_LENGTH(settings) ||
+			value > UINT32_MAX) {
+			DEBUG_ERROR("Invalid simulator option '%s', expected latency=, wait=, fault= or busy=\n", name);
+			return false;
+		}
+		*settings[setting].value = (uint32_t)value;
+	}
+	return true;
+}
+
+/* Lay out the system memory area: flash size register, unique ID and default (unprotected) option bytes */
+static void sim_sysmem_init(void)
+{
+	const sim_model_s *const model = sim.model;
+	write_le2(sim.sysmem, model->flash_size_reg - model->sysmem_base, (uint16_t)(model->flash_size / 1024U));
+	for (size_t i = 0; i < 12U; ++i)
+		sim.sysmem[model->uid_reg - model->sysmem_base + i] = (uint8_t)(0x30U + i);
+	uint8_t *const option_bytes = sim.sysmem + (model->option_bytes - model->sysmem_base);
+	if (model->flash_family == SIM_FLASH_STM32F1) {
+		/* Each option byte is stored along with its complement */
+		for (size_t i = 0; i < 16U; i += 2U)
+			write_le2(option_bytes, i, 0x00ffU);
+		write_le2(option_bytes, 0U, 0x5aa5U);
+	} else {
+		write_le2(option_bytes, 0U, 0xaaedU);
+		write_le2(option_bytes, 8U, 0x0fffU);
+	}
+}
+
+bool sim_init(const bmda_cli_options_s *const cl_opts)
+{
+	if (!sim_parse_options(cl_opts->opt_sim_model ? cl_opts->opt_sim_model : SIM_DEFAULT_MODEL))
+		return false;
+	const sim_model_s *const model = sim.model;
+
+	sim.flash = malloc(model->flash_size);
+	sim.sram = calloc(1, model->sram_size);
+	sim.ccm = model->ccm_size ? calloc(1, model->ccm_size) : NULL;
+	sim.sysmem = calloc(1, model->sysmem_size);
+	if (!sim.flash || !sim.sram || (model->ccm_size && !sim.ccm) || !sim.sysmem) {
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		free(sim.flash);
+		free(sim.sram);
+		free(sim.ccm);
+		free(sim.sysmem);
+		return false;
+	}
+	memset(sim.flash, 0xff, model->flash_size);
+	sim_sysmem_init();
+
+	/* Power-on reset */
+	sim.csw = 0x03000040U;
+	sim.frequency = 4000000U;
+	sim.tap_state = SIM_TAP_RESET;
+	sim.ir = SIM_IR_IDCODE;
+	sim_core_reset();
+
+	strcpy(bmda_probe_info.manufacturer, "Black Magic Debug");
+	strcpy(bmda_probe_info.product, "Simulator");
+	snprintf(bmda_probe_info.version, sizeof(bmda_probe_info.version), "%s", model->description);
+	strcpy(bmda_probe_info.serial, "SIM");
+	DEBUG_INFO("Simulating %s, latency %" PRIu32 "us, WAIT every %" PRIu32 ", FAULT every %" PRIu32 " AP accesses\n",
+		model->description, sim.latency_us, sim.wait_every, sim.fault_every);
+	return true;
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_SIM_H
+#define PLATFORMS_HOSTED_SIM_H
+
+#include "bmp_hosted.h"
+#include "cli.h"
+#include "adiv5.h"
+
+typedef struct sim_stats {
+	/* Number of DP/AP transactions the simulated wire carried (or a real probe would have) */
+	uint64_t transactions;
+	/* Number of probe round trips those transactions were issued in */
+	uint64_t requests;
+	/* Number of injected WAIT and FAULT responses */
+	uint64_t waits;
+	uint64_t faults;
+} sim_stats_s;
+
+bool sim_init(const bmda_cli_options_s *cl_opts);
+bool sim_swd_init(void);
+bool sim_jtag_init(void);
+void sim_adiv5_dp_init(adiv5_debug_port_s *dp);
+const char *sim_target_voltage(void);
+void sim_nrst_set_val(bool assert);
+bool sim_nrst_get_val(void);
+void sim_max_frequency_set(uint32_t frequency);
+uint32_t sim_max_frequency_get(void);
+void sim_stats_read(sim_stats_s *stats);
+
+#endif /* PLATFORMS_HOSTED_SIM_H */
@@ -261,8 +261,20 @@ static int stlink_write_retry(
 	uint32_t start = platform_time_ms();
 	usb_link_s *link = bmda_probe_info.usb_link;
 	while (true) {
-		bmda_usb_transfer(link, req_buffer, req_len, NULL, 0, BMDA_USB_NO_TIMEOUT);
-		bmda_usb_transfer(link, tx_buffer, tx_len, NULL, 0, BMDA_USB_NO_TIMEOUT);
+		/* Put the command and its data in flight together so the adaptor doesn't sit idle between them */
+		bmda_usb_request_s *const command = bmda_usb_submit(link, req_buffer, req_len, NULL, 0, BMDA_USB_NO_TIMEOUT);
+		if (!command)
+			return STLINK_ERROR_GENERAL;
+		bmda_usb_request_s *data = bmda_usb_submit(link, tx_buffer, tx_len, NULL, 0, BMDA_USB_NO_TIMEOUT);
+		const int command_result = bmda_usb_await(command);
+		/* If there was no room for the data alongside the command, the command completing has made some */
+		if (!data && command_result >= 0)
+			data = bmda_usb_submit(link, tx_buffer, tx_len, NULL, 0, BMDA_USB_NO_TIMEOUT);
+		const int data_result = bmda_usb_await(data);
+		if (command_result < 0 || data_result < 0) {
+			DEBUG_ERROR("stlink_write_retry failed to send the request (%d, %d)\n", command_result, data_result);
+			return STLINK_ERROR_GENERAL;
+		}
 		const int result = stlink_usb_get_rw_status(false);
 		if (result == STLINK_ERROR_OK)
 			return result;
@@ -448,6 +460,10 @@ bool stlink_init(void)
 		DEBUG_ERROR("ST-Link libusb_claim_interface failed %s\n", libusb_strerror(result));
 		return false;
 	}
+	if (!bmda_usb_async_start(link)) {
+		libusb_release_interface(link->device_handle, 0);
+		return false;
+	}
 	stlink_version();
 	if ((stlink.ver_stlink < 3U && stlink.ver_jtag < 32U) || (stlink.ver_stlink == 3U && stlink.ver_jtag < 3U)) {
 		/* Maybe the adapter is in some strange state. Try to reset */
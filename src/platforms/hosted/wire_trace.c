@@ -0,0 +1,1005 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This file implements the wire trace, a compact binary record of every access BMDA makes through the
+ * probe, and a replayer that stands in for a probe and answers the same accesses from such a record. The
+ * accesses are recorded at the ADIv5 DP routines each probe backend provides (DP, AP and memory accesses,
+ * and the error and abort handling), plus nRST, as this is the one layer every probe shares. Each probe
+ * then does its own thing underneath, be that bit-banging SWD, CMSIS-DAP packets or remote protocol
+ * commands, which is what the DEBUG_WIRE and DEBUG_PROBE output describes at much greater cost.
+ *
+ * Records are built on BMDA's thread and put into a lock-free single producer, single consumer ring
+ * buffer, from which a writer thread puts them into the trace file. Only the accesses made from above
+ * the probe layer are recorded, and not the ones a probe's routines make of each other (such as the DP
+ * accesses behind an AP read on a bit-banged probe), as those are what replaying needs to answer. While
+ * recording, the optional batch, streaming, polling and register acceleration routines are not used, so
+ * the accesses are made the same way they will be made while replaying.
+ *
+ * The trace file starts with the 8 byte magic "BMDAWTR" and the format version, 1, followed by records.
+ * Every record starts with an 8 byte header:
+ *   the record type, the DP fault code after the access, the exception raised by the access (or 0),
+ *   an argument byte and the time since the previous record in microseconds as a 32-bit value
+ * and then some of the following, in this order, as the type needs. All values are little endian:
+ *   a 16-bit register address, or a 64-bit memory address and 32-bit length,
+ *   an 8-bit memory access alignment, the 32-bit value written, the 32-bit value read and the memory data
+ */
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "general.h"
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include "wire_trace.h"
+#include "bmp_hosted.h"
+#include "adiv5.h"
+#include "exception.h"
+#include "swd.h"
+#include "buffer_utils.h"
+#include "bmda_thread.h"
+
+#define WIRE_TRACE_MAGIC       "BMDAWTR"
+#define WIRE_TRACE_VERSION     1U
+#define WIRE_TRACE_FILE_HEADER 8U
+#define WIRE_TRACE_HEADER_SIZE 8U
+/* The largest a record can be, less its memory data */
+#define WIRE_TRACE_RECORD_MAX (WIRE_TRACE_HEADER_SIZE + 21U)
+/* Size of the ring buffer records pass through to the writer thread, must be a power of 2 */
+#define WIRE_TRACE_RING_SIZE 1048576U
+/* The number of distinct sets of probe routines that can be wrapped */
+#define WIRE_TRACE_MAX_OPS 8U
+
+/* Fields found in the records of each type, beyond the header */
+#define WIRE_TRACE_REG_ADDR (1U << 0U)
+#define WIRE_TRACE_MEMORY   (1U << 1U)
+#define WIRE_TRACE_ALIGN    (1U << 2U)
+#define WIRE_TRACE_VALUE    (1U << 3U)
+#define WIRE_TRACE_RESULT   (1U << 4U)
+
+typedef enum wire_trace_op {
+	WIRE_TRACE_DP_READ = 0U,
+	WIRE_TRACE_LOW_ACCESS = 1U,
+	WIRE_TRACE_ERROR = 2U,
+	WIRE_TRACE_ABORT = 3U,
+	WIRE_TRACE_READ_NO_CHECK = 4U,
+	WIRE_TRACE_WRITE_NO_CHECK = 5U,
+	WIRE_TRACE_AP_READ = 6U,
+	WIRE_TRACE_AP_WRITE = 7U,
+	WIRE_TRACE_MEM_READ = 8U,
+	WIRE_TRACE_MEM_WRITE = 9U,
+	WIRE_TRACE_NRST_SET = 10U,
+	WIRE_TRACE_NRST_GET = 11U,
+	WIRE_TRACE_OP_COUNT,
+} wire_trace_op_e;
+
+typedef struct wire_trace_record {
+	uint8_t type;
+	uint8_t fault;
+	uint8_t exception;
+	/* Read/not write for raw accesses, APSEL for AP and memory accesses, otherwise the boolean argument or result */
+	uint8_t arg;
+	uint32_t delta_us;
+	/* Register or memory address */
+	uint64_t addr;
+	uint32_t length;
+	uint8_t align;
+	uint32_t value;
+	uint32_t result;
+	const uint8_t *data;
+} wire_trace_record_s;
+
+/* The probe's own routines behind those of the recorder, shared by every DP using the same set */
+typedef struct bmda_wire_trace_ops {
+	uint32_t (*dp_read)(adiv5_debug_port_s *dp, uint16_t addr);
+	uint32_t (*low_access)(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t value);
+	uint32_t (*error)(adiv5_debug_port_s *dp, bool protocol_recovery);
+	void (*abort)(adiv5_debug_port_s *dp, uint32_t abort);
+	uint32_t (*ap_read)(adiv5_access_port_s *ap, uint16_t addr);
+	void (*ap_write)(adiv5_access_port_s *ap, uint16_t addr, uint32_t value);
+	void (*mem_read)(adiv5_access_port_s *ap, void *dest, target_addr64_t src, size_t len);
+	void (*mem_write)(adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t len, align_e align);
+} bmda_wire_trace_ops_s;
+
+static const uint8_t wire_trace_fields[WIRE_TRACE_OP_COUNT] = {
+	[WIRE_TRACE_DP_READ] = WIRE_TRACE_REG_ADDR | WIRE_TRACE_RESULT,
+	[WIRE_TRACE_LOW_ACCESS] = WIRE_TRACE_REG_ADDR | WIRE_TRACE_VALUE | WIRE_TRACE_RESULT,
+	[WIRE_TRACE_ERROR] = WIRE_TRACE_RESULT,
+	[WIRE_TRACE_ABORT] = WIRE_TRACE_VALUE,
+	[WIRE_TRACE_READ_NO_CHECK] = WIRE_TRACE_REG_ADDR | WIRE_TRACE_RESULT,
+	[WIRE_TRACE_WRITE_NO_CHECK] = WIRE_TRACE_REG_ADDR | WIRE_TRACE_VALUE,
+	[WIRE_TRACE_AP_READ] = WIRE_TRACE_REG_ADDR | WIRE_TRACE_RESULT,
+	[WIRE_TRACE_AP_WRITE] = WIRE_TRACE_REG_ADDR | WIRE_TRACE_VALUE,
+	[WIRE_TRACE_MEM_READ] = WIRE_TRACE_MEMORY,
+	[WIRE_TRACE_MEM_WRITE] = WIRE_TRACE_MEMORY | WIRE_TRACE_ALIGN,
+	[WIRE_TRACE_NRST_SET] = 0U,
+	[WIRE_TRACE_NRST_GET] = 0U,
+};
+
+static const char *const wire_trace_op_names[WIRE_TRACE_OP_COUNT] = {
+	"DP read",
+	"raw access",
+	"error clear",
+	"abort",
+	"unchecked read",
+	"unchecked write",
+	"AP read",
+	"AP write",
+	"memory read",
+	"memory write",
+	"nRST set",
+	"nRST read",
+};
+
+static struct {
+	FILE *file;
+	const char *path;
+	bool recording;
+	uint8_t *ring;
+	/* The producer (BMDA's thread) owns head, the writer thread owns tail */
+	bmda_atomic_size_t head;
+	bmda_atomic_size_t tail;
+	bmda_atomic_size_t running;
+	bmda_thread_t writer;
+	/* Signalled whenever head, tail or running change, so neither side has to poll the other */
+	bmda_mutex_t lock;
+	bmda_cond_t changed;
+	bool write_failed;
+	/* How many calls into the probe's routines are presently in progress */
+	size_t depth;
+	uint64_t last_us;
+	size_t records;
+	size_t stalls;
+	uint32_t (*read_no_check)(uint16_t addr);
+	bool (*write_no_check)(uint16_t addr, uint32_t value);
+} wire_trace;
+
+static bmda_wire_trace_ops_s wire_trace_ops[WIRE_TRACE_MAX_OPS];
+static size_t wire_trace_ops_count = 0U;
+
+static struct {
+	uint8_t *trace;
+	size_t size;
+	size_t offset;
+	/* Index of the record presently being replayed, counting from 1 */
+	size_t index;
+	size_t mismatches;
+	uint64_t recorded_us;
+	uint64_t start_us;
+	bool ended;
+} wire_replay;
+
+static uint64_t wire_trace_now_us(void)
+{
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	const uint64_t ticks = (uint64_t)counter.QuadPart;
+	const uint64_t rate = (uint64_t)frequency.QuadPart;
+	return ((ticks / rate) * 1000000U) + (((ticks % rate) * 1000000U) / rate);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U);
+#endif
+}
+
+static size_t wire_trace_encode(const wire_trace_record_s *const record, uint8_t *const buffer)
+{
+	const uint8_t fields = wire_trace_fields[record->type];
+	buffer[0] = record->type;
+	buffer[1] = record->fault;
+	buffer[2] = record->exception;
+	buffer[3] = record->arg;
+	write_le4(buffer, 4U, record->delta_us);
+	size_t offset = WIRE_TRACE_HEADER_SIZE;
+	if (fields & WIRE_TRACE_REG_ADDR) {
+		write_le2(buffer, offset, (uint16_t)record->addr);
+		offset += 2U;
+	}
+	if (fields & WIRE_TRACE_MEMORY) {
+		write_le4(buffer, offset, (uint32_t)record->addr);
+		write_le4(buffer, offset + 4U, (uint32_t)(record->addr >> 32U));
+		write_le4(buffer, offset + 8U, record->length);
+		offset += 12U;
+	}
+	if (fields & WIRE_TRACE_ALIGN)
+		buffer[offset++] = record->align;
+	if (fields & WIRE_TRACE_VALUE) {
+		write_le4(buffer, offset, record->value);
+		offset += 4U;
+	}
+	if (fields & WIRE_TRACE_RESULT) {
+		write_le4(buffer, offset, record->result);
+		offset += 4U;
+	}
+	return offset;
+}
+
+/* Decode the record at the start of the buffer, returning its total length or 0 if it's truncated or invalid */
+static size_t wire_trace_decode(const uint8_t *const buffer, const size_t length, wire_trace_record_s *const record)
+{
+	if (length < WIRE_TRACE_HEADER_SIZE || buffer[0] >= WIRE_TRACE_OP_COUNT)
+		return 0U;
+	const uint8_t fields = wire_trace_fields[buffer[0]];
+	const size_t size = WIRE_TRACE_HEADER_SIZE + ((fields & WIRE_TRACE_REG_ADDR) ? 2U : 0U) +
+		((fields & WIRE_TRACE_MEMORY) ? 12U : 0U) + ((fields & WIRE_TRACE_ALIGN) ? 1U : 0U) +
+		((fields & WIRE_TRACE_VALUE) ? 4U : 0U) + ((fields & WIRE_TRACE_RESULT) ? 4U : 0U);
+	if (length < size)
+		return 0U;
+
+	memset(record, 0, sizeof(*record));
+	record->type = buffer[0];
+	record->fault = buffer[1];
+	record->exception = buffer[2];
+	record->arg = buffer[3];
+	record->delta_us = read_le4(buffer, 4U);
+	size_t offset = WIRE_TRACE_HEADER_SIZE;
+	if (fields & WIRE_TRACE_REG_ADDR) {
+		record->addr = read_le2(buffer, offset);
+		offset += 2U;
+	}
+	if (fields & WIRE_TRACE_MEMORY) {
+		record->addr = read_le4(buffer, offset) | ((uint64_t)read_le4(buffer, offset + 4U) << 32U);
+		record->length = read_le4(buffer, offset + 8U);
+		offset += 12U;
+	}
+	if (fields & WIRE_TRACE_ALIGN)
+		record->align = buffer[offset++];
+	if (fields & WIRE_TRACE_VALUE) {
+		record->value = read_le4(buffer, offset);
+		offset += 4U;
+	}
+	if (fields & WIRE_TRACE_RESULT) {
+		record->result = read_le4(buffer, offset);
+		offset += 4U;
+	}
+	if (fields & WIRE_TRACE_MEMORY) {
+		if (length - offset < record->length)
+			return 0U;
+		record->data = buffer + offset;
+		offset += record->length;
+	}
+	return offset;
+}
+
+/* Let the other side of the ring buffer know something changed */
+static void wire_trace_signal(void)
+{
+	bmda_mutex_lock(&wire_trace.lock);
+	bmda_cond_broadcast(&wire_trace.changed);
+	bmda_mutex_unlock(&wire_trace.lock);
+}
+
+/* Copy data into the ring buffer, waiting on the writer thread if it's full */
+static void wire_trace_push(const uint8_t *data, size_t length)
+{
+	size_t head = bmda_atomic_load(&wire_trace.head);
+	while (length) {
+		const size_t tail = bmda_atomic_load(&wire_trace.tail);
+		const size_t space = WIRE_TRACE_RING_SIZE - (head - tail);
+		if (!space) {
+			++wire_trace.stalls;
+			bmda_mutex_lock(&wire_trace.lock);
+			while (bmda_atomic_load(&wire_trace.tail) == tail)
+				bmda_cond_wait(&wire_trace.changed, &wire_trace.lock);
+			bmda_mutex_unlock(&wire_trace.lock);
+			continue;
+		}
+		const size_t offset = head & (WIRE_TRACE_RING_SIZE - 1U);
+		const size_t amount = MIN(MIN(space, length), WIRE_TRACE_RING_SIZE - offset);
+		memcpy(wire_trace.ring + offset, data, amount);
+		data += amount;
+		length -= amount;
+		head += amount;
+		bmda_atomic_store(&wire_trace.head, head);
+	}
+	wire_trace_signal();
+}
+
+static void *wire_trace_writer(void *const context)
+{
+	(void)context;
+	while (true) {
+		/* Check for being stopped before looking for data, so nothing pushed before stopping gets left behind */
+		const bool stopping = !bmda_atomic_load(&wire_trace.running);
+		const size_t head = bmda_atomic_load(&wire_trace.head);
+		const size_t tail = bmda_atomic_load(&wire_trace.tail);
+		if (head == tail) {
+			if (stopping)
+				break;
+			/* This thread must stay out of the platform layer, so sleep until the producer has more for us */
+			bmda_mutex_lock(&wire_trace.lock);
+			while (bmda_atomic_load(&wire_trace.head) == tail && bmda_atomic_load(&wire_trace.running))
+				bmda_cond_wait(&wire_trace.changed, &wire_trace.lock);
+			bmda_mutex_unlock(&wire_trace.lock);
+			continue;
+		}
+		const size_t offset = tail & (WIRE_TRACE_RING_SIZE - 1U);
+		const size_t amount = MIN(head - tail, WIRE_TRACE_RING_SIZE - offset);
+		if (fwrite(wire_trace.ring + offset, 1U, amount, wire_trace.file) != amount)
+			wire_trace.write_failed = true;
+		bmda_atomic_store(&wire_trace.tail, tail + amount);
+		wire_trace_signal();
+	}
+	return NULL;
+}
+
+bool bmda_wire_trace_open(const char *const path)
+{
+	wire_trace.ring = malloc(WIRE_TRACE_RING_SIZE);
+	if (!wire_trace.ring) {
+		DEBUG_ERROR("malloc: failed in %s\n", __func__);
+		return false;
+	}
+	wire_trace.file = fopen(path, "wb");
+	if (!wire_trace.file) {
+		DEBUG_ERROR("Failed to open wire trace %s: %s\n", path, strerror(errno));
+		free(wire_trace.ring);
+		return false;
+	}
+	const uint8_t header[WIRE_TRACE_FILE_HEADER] = {'B', 'M', 'D', 'A', 'W', 'T', 'R', WIRE_TRACE_VERSION};
+	fwrite(header, 1U, sizeof(header), wire_trace.file);
+
+	wire_trace.path = path;
+	wire_trace.last_us = wire_trace_now_us();
+	bmda_atomic_store(&wire_trace.head, 0U);
+	bmda_atomic_store(&wire_trace.tail, 0U);
+	bmda_atomic_store(&wire_trace.running, true);
+	bmda_mutex_init(&wire_trace.lock);
+	bmda_cond_init(&wire_trace.changed);
+	if (!bmda_thread_create(&wire_trace.writer, wire_trace_writer, NULL)) {
+		DEBUG_ERROR("Failed to start wire trace writer thread\n");
+		bmda_cond_destroy(&wire_trace.changed);
+		bmda_mutex_destroy(&wire_trace.lock);
+		fclose(wire_trace.file);
+		wire_trace.file = NULL;
+		free(wire_trace.ring);
+		return false;
+	}
+	wire_trace.recording = true;
+	return true;
+}
+
+void bmda_wire_trace_close(void)
+{
+	if (!wire_trace.file)
+		return;
+	/* Stop recording first so nothing more is pushed once the writer has been told to finish */
+	wire_trace.recording = false;
+	bmda_atomic_store(&wire_trace.running, false);
+	wire_trace_signal();
+	bmda_thread_join(wire_trace.writer);
+	bmda_cond_destroy(&wire_trace.changed);
+	bmda_mutex_destroy(&wire_trace.lock);
+	const bool failed = fclose(wire_trace.file) != 0 || wire_trace.write_failed;
+	wire_trace.file = NULL;
+	if (failed)
+		DEBUG_ERROR("Failed to write wire trace %s\n", wire_trace.path);
+	else
+		DEBUG_INFO("Wire trace of %zu records written to %s, waited on the writer %zu times\n", wire_trace.records,
+			wire_trace.path, wire_trace.stalls);
+	free(wire_trace.ring);
+	wire_trace.ring = NULL;
+}
+
+static void wire_trace_emit(wire_trace_record_s *const record)
+{
+	const uint64_t now = wire_trace_now_us();
+	const uint64_t delta = now - wire_trace.last_us;
+	record->delta_us = delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+	wire_trace.last_us = now;
+
+	uint8_t buffer[WIRE_TRACE_RECORD_MAX];
+	wire_trace_push(buffer, wire_trace_encode(record, buffer));
+	if (record->data)
+		wire_trace_push(record->data, record->length);
+	++wire_trace.records;
+}
+
+/*
+ * Finish off a call into the probe's routines, recording it if it was made from above the probe layer,
+ * and then pass on any exception it raised. dp is NULL for the unchecked accesses, which have no DP
+ */
+static void wire_trace_end(const adiv5_debug_port_s *const dp, wire_trace_record_s *const record,
+	const uint32_t exception, const char *const message)
+{
+	--wire_trace.depth;
+	if (!wire_trace.depth && wire_trace.recording) {
+		record->fault = dp ? dp->fault : 0U;
+		record->exception = (uint8_t)exception;
+		wire_trace_emit(record);
+	}
+	if (exception)
+		raise_exception(exception, message);
+}
+
+static uint32_t wire_trace_dp_read(adiv5_debug_port_s *const dp, const uint16_t addr)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_DP_READ, .addr = addr};
+	volatile uint32_t result = 0U;
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		result = dp->wire_trace->dp_read(dp, addr);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	record.result = result;
+	wire_trace_end(dp, &record, exception_frame.type, exception_frame.msg);
+	return result;
+}
+
+static uint32_t wire_trace_low_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_LOW_ACCESS, .arg = rnw, .addr = addr, .value = value};
+	volatile uint32_t result = 0U;
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		result = dp->wire_trace->low_access(dp, rnw, addr, value);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	record.result = result;
+	wire_trace_end(dp, &record, exception_frame.type, exception_frame.msg);
+	return result;
+}
+
+static uint32_t wire_trace_error(adiv5_debug_port_s *const dp, const bool protocol_recovery)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_ERROR, .arg = protocol_recovery};
+	volatile uint32_t result = 0U;
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		result = dp->wire_trace->error(dp, protocol_recovery);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	record.result = result;
+	wire_trace_end(dp, &record, exception_frame.type, exception_frame.msg);
+	return result;
+}
+
+static void wire_trace_abort(adiv5_debug_port_s *const dp, const uint32_t abort)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_ABORT, .value = abort};
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		dp->wire_trace->abort(dp, abort);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	wire_trace_end(dp, &record, exception_frame.type, exception_frame.msg);
+}
+
+static uint32_t wire_trace_read_no_check(const uint16_t addr)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_READ_NO_CHECK, .addr = addr};
+	volatile uint32_t result = 0U;
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		result = wire_trace.read_no_check(addr);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	record.result = result;
+	wire_trace_end(NULL, &record, exception_frame.type, exception_frame.msg);
+	return result;
+}
+
+static bool wire_trace_write_no_check(const uint16_t addr, const uint32_t value)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_WRITE_NO_CHECK, .addr = addr, .value = value};
+	volatile bool result = false;
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		result = wire_trace.write_no_check(addr, value);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	record.arg = result;
+	wire_trace_end(NULL, &record, exception_frame.type, exception_frame.msg);
+	return result;
+}
+
+static uint32_t wire_trace_ap_read(adiv5_access_port_s *const ap, const uint16_t addr)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_AP_READ, .arg = ap->apsel, .addr = addr};
+	volatile uint32_t result = 0U;
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		result = ap->dp->wire_trace->ap_read(ap, addr);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	record.result = result;
+	wire_trace_end(ap->dp, &record, exception_frame.type, exception_frame.msg);
+	return result;
+}
+
+static void wire_trace_ap_write(adiv5_access_port_s *const ap, const uint16_t addr, const uint32_t value)
+{
+	wire_trace_record_s record = {.type = WIRE_TRACE_AP_WRITE, .arg = ap->apsel, .addr = addr, .value = value};
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		ap->dp->wire_trace->ap_write(ap, addr, value);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	wire_trace_end(ap->dp, &record, exception_frame.type, exception_frame.msg);
+}
+
+static void wire_trace_mem_read(
+	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t len)
+{
+	wire_trace_record_s record = {
+		.type = WIRE_TRACE_MEM_READ,
+		.arg = ap->apsel,
+		.addr = src,
+		.length = (uint32_t)len,
+		.data = (const uint8_t *)dest,
+	};
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		ap->dp->wire_trace->mem_read(ap, dest, src, len);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	wire_trace_end(ap->dp, &record, exception_frame.type, exception_frame.msg);
+}
+
+static void wire_trace_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src,
+	const size_t len, const align_e align)
+{
+	wire_trace_record_s record = {
+		.type = WIRE_TRACE_MEM_WRITE,
+		.arg = ap->apsel,
+		.addr = dest,
+		.length = (uint32_t)len,
+		.align = (uint8_t)align,
+		.data = (const uint8_t *)src,
+	};
+	++wire_trace.depth;
+	TRY (EXCEPTION_ALL) {
+		ap->dp->wire_trace->mem_write(ap, dest, src, len, align);
+	}
+	CATCH () {
+	default:
+		break;
+	}
+	wire_trace_end(ap->dp, &record, exception_frame.type, exception_frame.msg);
+}
+
+/* Find the stored copy of a set of probe routines, storing it if this is the first time it's been seen */
+static const bmda_wire_trace_ops_s *wire_trace_ops_find(const bmda_wire_trace_ops_s *const ops)
+{
+	for (size_t i = 0U; i < wire_trace_ops_count; ++i) {
+		if (!memcmp(&wire_trace_ops[i], ops, sizeof(*ops)))
+			return &wire_trace_ops[i];
+	}
+	if (wire_trace_ops_count == WIRE_TRACE_MAX_OPS)
+		return NULL;
+	wire_trace_ops[wire_trace_ops_count] = *ops;
+	return &wire_trace_ops[wire_trace_ops_count++];
+}
+
+/*
+ * Put the recorder's routines in front of the probe's on a DP. This is called each time the probe
+ * backend has had a chance to install routines of its own, so picks up any (re)installed since the last
+ * call, and leaves alone the ones already wrapped, including on DPs copied from this one.
+ */
+void bmda_wire_trace_dp_init(adiv5_debug_port_s *const dp)
+{
+	if (!wire_trace.recording)
+		return;
+
+	bmda_wire_trace_ops_s ops = {NULL};
+	if (dp->wire_trace)
+		ops = *dp->wire_trace;
+	if (dp->dp_read && dp->dp_read != wire_trace_dp_read)
+		ops.dp_read = dp->dp_read;
+	if (dp->low_access && dp->low_access != wire_trace_low_access)
+		ops.low_access = dp->low_access;
+	if (dp->error && dp->error != wire_trace_error)
+		ops.error = dp->error;
+	if (dp->abort && dp->abort != wire_trace_abort)
+		ops.abort = dp->abort;
+	if (dp->ap_read && dp->ap_read != wire_trace_ap_read)
+		ops.ap_read = dp->ap_read;
+	if (dp->ap_write && dp->ap_write != wire_trace_ap_write)
+		ops.ap_write = dp->ap_write;
+	if (dp->mem_read && dp->mem_read != wire_trace_mem_read)
+		ops.mem_read = dp->mem_read;
+	if (dp->mem_write && dp->mem_write != wire_trace_mem_write)
+		ops.mem_write = dp->mem_write;
+	const bmda_wire_trace_ops_s *const wrapped = wire_trace_ops_find(&ops);
+	if (!wrapped) {
+		DEBUG_WARN("Too many different DP implementations, not tracing DP %u\n", dp->dev_index);
+		return;
+	}
+
+	dp->wire_trace = wrapped;
+	if (wrapped->dp_read)
+		dp->dp_read = wire_trace_dp_read;
+	if (wrapped->low_access)
+		dp->low_access = wire_trace_low_access;
+	if (wrapped->error)
+		dp->error = wire_trace_error;
+	if (wrapped->abort)
+		dp->abort = wire_trace_abort;
+	if (wrapped->ap_read)
+		dp->ap_read = wire_trace_ap_read;
+	if (wrapped->ap_write)
+		dp->ap_write = wire_trace_ap_write;
+	if (wrapped->mem_read)
+		dp->mem_read = wire_trace_mem_read;
+	if (wrapped->mem_write)
+		dp->mem_write = wire_trace_mem_write;
+	/* The unchecked accesses have no DP to find the probe's routines through, but are the same for every DP */
+	if (dp->read_no_check && dp->read_no_check != wire_trace_read_no_check) {
+		wire_trace.read_no_check = dp->read_no_check;
+		dp->read_no_check = wire_trace_read_no_check;
+	}
+	if (dp->write_no_check && dp->write_no_check != wire_trace_write_no_check) {
+		wire_trace.write_no_check = dp->write_no_check;
+		dp->write_no_check = wire_trace_write_no_check;
+	}
+
+	/* Have everything go through the routines above, as it will while replaying */
+	dp->batch_run = NULL;
+	dp->stream_read = NULL;
+	dp->stream_write = NULL;
+	dp->mem_poll = NULL;
+	dp->mem_txn = NULL;
+	dp->ap_regs_read = NULL;
+	dp->ap_reg_read = NULL;
+	dp->ap_reg_write = NULL;
+	dp->run_stub = NULL;
+	dp->pc_profile = NULL;
+}
+
+void bmda_wire_trace_nrst_set(const bool assert)
+{
+	if (!wire_trace.recording)
+		return;
+	wire_trace_record_s record = {.type = WIRE_TRACE_NRST_SET, .arg = assert};
+	wire_trace_emit(&record);
+}
+
+void bmda_wire_trace_nrst_get(const bool asserted)
+{
+	if (!wire_trace.recording)
+		return;
+	wire_trace_record_s record = {.type = WIRE_TRACE_NRST_GET, .arg = asserted};
+	wire_trace_emit(&record);
+}
+
+bool bmda_wire_replay_init(const char *const path)
+{
+	FILE *const file = fopen(path, "rb");
+	if (!file) {
+		DEBUG_ERROR("Failed to open wire trace %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	wire_replay.trace = size > 0 ? malloc((size_t)size) : NULL;
+	if (!wire_replay.trace) {
+		DEBUG_ERROR("Failed to read wire trace %s\n", path);
+		fclose(file);
+		return false;
+	}
+	wire_replay.size = fread(wire_replay.trace, 1U, (size_t)size, file);
+	fclose(file);
+	if (wire_replay.size < WIRE_TRACE_FILE_HEADER || memcmp(wire_replay.trace, WIRE_TRACE_MAGIC, 7U) != 0 ||
+		wire_replay.trace[7U] != WIRE_TRACE_VERSION) {
+		DEBUG_ERROR("%s is not a version %u wire trace\n", path, WIRE_TRACE_VERSION);
+		free(wire_replay.trace);
+		wire_replay.trace = NULL;
+		return false;
+	}
+	wire_replay.offset = WIRE_TRACE_FILE_HEADER;
+	wire_replay.start_us = wire_trace_now_us();
+
+	strcpy(bmda_probe_info.manufacturer, "Black Magic Debug");
+	strcpy(bmda_probe_info.product, "Wire trace replay");
+	snprintf(bmda_probe_info.version, sizeof(bmda_probe_info.version), "%s", path);
+	strcpy(bmda_probe_info.serial, "REPLAY");
+	return true;
+}
+
+void bmda_wire_replay_close(void)
+{
+	if (!wire_replay.trace)
+		return;
+	const uint64_t elapsed_us = wire_trace_now_us() - wire_replay.start_us;
+	DEBUG_INFO("Replayed %zu records covering %" PRIu64 "ms of probe traffic in %" PRIu64 "ms, %zu mismatched\n",
+		wire_replay.index, wire_replay.recorded_us / 1000U, elapsed_us / 1000U, wire_replay.mismatches);
+	if (wire_replay.offset < wire_replay.size)
+		DEBUG_WARN("%zu bytes of the trace were not replayed\n", wire_replay.size - wire_replay.offset);
+	free(wire_replay.trace);
+	wire_replay.trace = NULL;
+}
+
+/*
+ * Fetch the next record from the trace, which must be for the kind of access being made. If the trace has
+ * run out or gone a different way from the accesses being made, there's no telling what the target would
+ * have done next, so this and every later access is answered as if it had stopped responding.
+ */
+static bool wire_replay_next(
+	adiv5_debug_port_s *const dp, const wire_trace_op_e type, wire_trace_record_s *const record)
+{
+	if (!wire_replay.ended) {
+		const size_t length =
+			wire_trace_decode(wire_replay.trace + wire_replay.offset, wire_replay.size - wire_replay.offset, record);
+		if (!length) {
+			if (wire_replay.offset == wire_replay.size)
+				DEBUG_INFO("End of wire trace reached at %s\n", wire_trace_op_names[type]);
+			else
+				DEBUG_ERROR("Wire trace record %zu is truncated or invalid\n", wire_replay.index + 1U);
+			wire_replay.ended = true;
+		} else if (record->type != type) {
+			DEBUG_ERROR("Wire trace replay diverged at record %zu, which is a %s where a %s was made\n",
+				wire_replay.index + 1U, wire_trace_op_names[record->type], wire_trace_op_names[type]);
+			wire_replay.ended = true;
+		} else {
+			wire_replay.offset += length;
+			++wire_replay.index;
+			wire_replay.recorded_us += record->delta_us;
+			return true;
+		}
+	}
+	if (dp)
+		dp->fault = SWD_ACK_NO_RESPONSE;
+	return false;
+}
+
+static void wire_replay_check(const char *const what, const uint64_t recorded, const uint64_t actual)
+{
+	if (recorded == actual)
+		return;
+	++wire_replay.mismatches;
+	DEBUG_WARN("Wire trace record %zu: %s 0x%" PRIx64 " differs from the 0x%" PRIx64 " recorded\n", wire_replay.index,
+		what, actual, recorded);
+}
+
+/* Reproduce the DP fault state and any exception the recorded access ended in */
+static void wire_replay_finish(adiv5_debug_port_s *const dp, const wire_trace_record_s *const record)
+{
+	if (dp)
+		dp->fault = record->fault;
+	if (record->exception)
+		raise_exception(record->exception, "Exception replayed from wire trace");
+}
+
+static uint32_t wire_replay_dp_read(adiv5_debug_port_s *const dp, const uint16_t addr)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(dp, WIRE_TRACE_DP_READ, &record))
+		return 0U;
+	wire_replay_check("DP read address", record.addr, addr);
+	wire_replay_finish(dp, &record);
+	return record.result;
+}
+
+static uint32_t wire_replay_low_access(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(dp, WIRE_TRACE_LOW_ACCESS, &record))
+		return 0U;
+	wire_replay_check("raw access direction", record.arg, rnw);
+	wire_replay_check("raw access address", record.addr, addr);
+	if (rnw == ADIV5_LOW_WRITE)
+		wire_replay_check("raw access value", record.value, value);
+	wire_replay_finish(dp, &record);
+	return record.result;
+}
+
+static uint32_t wire_replay_error(adiv5_debug_port_s *const dp, const bool protocol_recovery)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(dp, WIRE_TRACE_ERROR, &record))
+		return 0U;
+	wire_replay_check("error clear protocol recovery", record.arg, protocol_recovery);
+	wire_replay_finish(dp, &record);
+	return record.result;
+}
+
+static void wire_replay_abort(adiv5_debug_port_s *const dp, const uint32_t abort)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(dp, WIRE_TRACE_ABORT, &record))
+		return;
+	wire_replay_check("abort value", record.value, abort);
+	wire_replay_finish(dp, &record);
+}
+
+static uint32_t wire_replay_read_no_check(const uint16_t addr)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(NULL, WIRE_TRACE_READ_NO_CHECK, &record))
+		return 0U;
+	wire_replay_check("unchecked read address", record.addr, addr);
+	wire_replay_finish(NULL, &record);
+	return record.result;
+}
+
+static bool wire_replay_write_no_check(const uint16_t addr, const uint32_t value)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(NULL, WIRE_TRACE_WRITE_NO_CHECK, &record))
+		return true;
+	wire_replay_check("unchecked write address", record.addr, addr);
+	wire_replay_check("unchecked write value", record.value, value);
+	wire_replay_finish(NULL, &record);
+	return record.arg;
+}
+
+static uint32_t wire_replay_ap_read(adiv5_access_port_s *const ap, const uint16_t addr)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(ap->dp, WIRE_TRACE_AP_READ, &record))
+		return 0U;
+	wire_replay_check("AP read APSEL", record.arg, ap->apsel);
+	wire_replay_check("AP read address", record.addr, addr);
+	wire_replay_finish(ap->dp, &record);
+	return record.result;
+}
+
+static void wire_replay_ap_write(adiv5_access_port_s *const ap, const uint16_t addr, const uint32_t value)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(ap->dp, WIRE_TRACE_AP_WRITE, &record))
+		return;
+	wire_replay_check("AP write APSEL", record.arg, ap->apsel);
+	wire_replay_check("AP write address", record.addr, addr);
+	wire_replay_check("AP write value", record.value, value);
+	wire_replay_finish(ap->dp, &record);
+}
+
+static void wire_replay_mem_read(
+	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t len)
+{
+	memset(dest, 0, len);
+	wire_trace_record_s record;
+	if (!wire_replay_next(ap->dp, WIRE_TRACE_MEM_READ, &record))
+		return;
+	wire_replay_check("memory read APSEL", record.arg, ap->apsel);
+	wire_replay_check("memory read address", record.addr, src);
+	wire_replay_check("memory read length", record.length, len);
+	memcpy(dest, record.data, MIN(len, (size_t)record.length));
+	wire_replay_finish(ap->dp, &record);
+}
+
+static void wire_replay_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src,
+	const size_t len, const align_e align)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(ap->dp, WIRE_TRACE_MEM_WRITE, &record))
+		return;
+	wire_replay_check("memory write APSEL", record.arg, ap->apsel);
+	wire_replay_check("memory write address", record.addr, dest);
+	wire_replay_check("memory write length", record.length, len);
+	wire_replay_check("memory write alignment", record.align, align);
+	if (record.length == len && memcmp(record.data, src, len) != 0) {
+		++wire_replay.mismatches;
+		DEBUG_WARN("Wire trace record %zu: memory write data differs from that recorded\n", wire_replay.index);
+	}
+	wire_replay_finish(ap->dp, &record);
+}
+
+/* The SWD sequences sent outside of DP accesses (line resets, dormant state changes) have no reply to replay */
+static uint32_t wire_replay_seq_in(const size_t clock_cycles)
+{
+	(void)clock_cycles;
+	return 0U;
+}
+
+static bool wire_replay_seq_in_parity(uint32_t *const ret, const size_t clock_cycles)
+{
+	(void)clock_cycles;
+	*ret = 0U;
+	return true;
+}
+
+static void wire_replay_seq_out(const uint32_t tms_states, const size_t clock_cycles)
+{
+	(void)tms_states;
+	(void)clock_cycles;
+}
+
+bool bmda_wire_replay_swd_init(adiv5_debug_port_s *const dp)
+{
+	swd_proc.seq_in = wire_replay_seq_in;
+	swd_proc.seq_in_parity = wire_replay_seq_in_parity;
+	swd_proc.seq_out = wire_replay_seq_out;
+	swd_proc.seq_out_parity = wire_replay_seq_out;
+	swd_proc.batch = NULL;
+
+	dp->dp_read = wire_replay_dp_read;
+	dp->low_access = wire_replay_low_access;
+	dp->error = wire_replay_error;
+	dp->abort = wire_replay_abort;
+	dp->read_no_check = wire_replay_read_no_check;
+	dp->write_no_check = wire_replay_write_no_check;
+	return true;
+}
+
+void bmda_wire_replay_dp_init(adiv5_debug_port_s *const dp)
+{
+	dp->ap_read = wire_replay_ap_read;
+	dp->ap_write = wire_replay_ap_write;
+	dp->mem_read = wire_replay_mem_read;
+	dp->mem_write = wire_replay_mem_write;
+}
+
+void bmda_wire_replay_nrst_set_val(const bool assert)
+{
+	wire_trace_record_s record;
+	if (wire_replay_next(NULL, WIRE_TRACE_NRST_SET, &record))
+		wire_replay_check("nRST state", record.arg, assert);
+}
+
+bool bmda_wire_replay_nrst_get_val(void)
+{
+	wire_trace_record_s record;
+	if (!wire_replay_next(NULL, WIRE_TRACE_NRST_GET, &record))
+		return false;
+	return record.arg;
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of the Black Magic Debug project.
+ *
+ * Copyright (C) 2026 1BitSquared <info@1bitsquared.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PLATFORMS_HOSTED_WIRE_TRACE_H
+#define PLATFORMS_HOSTED_WIRE_TRACE_H
+
+#include "general.h"
+#include "adiv5.h"
+
+/* Functions for recording a trace of the probe traffic */
+bool bmda_wire_trace_open(const char *path);
+void bmda_wire_trace_close(void);
+void bmda_wire_trace_dp_init(adiv5_debug_port_s *dp);
+void bmda_wire_trace_nrst_set(bool assert);
+void bmda_wire_trace_nrst_get(bool asserted);
+
+/* Functions for replaying a recorded trace in place of a debug probe */
+bool bmda_wire_replay_init(const char *path);
+void bmda_wire_replay_close(void);
+bool bmda_wire_replay_swd_init(adiv5_debug_port_s *dp);
+void bmda_wire_replay_dp_init(adiv5_debug_port_s *dp);
+void bmda_wire_replay_nrst_set_val(bool assert);
+bool bmda_wire_replay_nrst_get_val(void);
+
+#endif /* PLATFORMS_HOSTED_WIRE_TRACE_H */
@@ -35,25 +35,32 @@
 #include "target.h"
 #include "adiv5.h"
 #include "adiv6.h"
+#if defined(CONFIG_CORTEXM) && CONFIG_CORTEXM == 1
+#include "cortexm.h"
+#endif
 #if defined(CONFIG_RISCV_ACCEL) && CONFIG_RISCV_ACCEL == 1
 #include "riscv_debug.h"
 #endif
 #include "version.h"
 #include "exception.h"
 #include "hex_utils.h"
+#if CONFIG_BMDA == 1
+#include "bmp_hosted.h"
+#endif
 
-#if CONFIG_BMDA == 0
 static void remote_packet_process_adiv6(const char *packet, size_t packet_len);
 
 /* hex-ify and send a buffer of data */
 static void remote_send_buf(const void *const buffer, const size_t len)
 {
-	char hex[3] = {0};
+	char hex[32U];
 	const uint8_t *const data = (const uint8_t *)buffer;
-	for (size_t offset = 0; offset < len; ++offset) {
-		hexify(hex, data + offset, 1U);
-		gdb_if_putchar(hex[0], false);
-		gdb_if_putchar(hex[1], false);
+	/* Convert the buffer a chunk at a time so the codec isn't called once per byte */
+	for (size_t offset = 0; offset < len;) {
+		const size_t hex_len = hexify_bulk(hex, sizeof(hex), data + offset, len - offset);
+		for (size_t idx = 0; idx < hex_len; ++idx)
+			gdb_if_putchar(hex[idx], false);
+		offset += hex_len / 2U;
 	}
 }
 
@@ -128,6 +135,41 @@ static adiv5_debug_port_s remote_dp = {
 	.mem_write = adiv5_mem_write_bytes,
 };
 
+#if CONFIG_BMDA == 1
+/*
+ * When BMDA serves the remote protocol, the faked DP is backed by whichever probe BMDA is itself driving.
+ * This puts the ADIv5 routines back to the generic ones, then hands the DP to the probe to install its own
+ * low-level and acceleration routines over the top, replacing swdptap_init()/jtagtap_init() from the firmware.
+ */
+static bool remote_bmda_dp_init(const bool is_jtag)
+{
+	remote_dp.batch_run = NULL;
+	remote_dp.stream_read = NULL;
+	remote_dp.stream_write = NULL;
+	remote_dp.mem_poll = NULL;
+	remote_dp.run_stub = NULL;
+	remote_dp.pc_profile = NULL;
+	remote_dp.mem_txn = NULL;
+	remote_dp.ap_regs_read = NULL;
+	remote_dp.ap_reg_read = NULL;
+	remote_dp.ap_reg_write = NULL;
+	remote_dp.ap_read = adiv5_ap_reg_read;
+	remote_dp.ap_write = adiv5_ap_reg_write;
+	remote_dp.mem_read = adiv5_mem_read_bytes;
+	remote_dp.mem_write = adiv5_mem_write_bytes;
+
+	bmda_probe_info.is_jtag = is_jtag;
+	if (is_jtag) {
+		if (!bmda_jtag_init())
+			return false;
+		bmda_jtag_dp_init(&remote_dp);
+	} else if (!bmda_swd_dp_init(&remote_dp))
+		return false;
+	bmda_adiv5_dp_init(&remote_dp);
+	return true;
+}
+#endif
+
 static void remote_packet_process_swd(const char *const packet, const size_t packet_len)
 {
 	switch (packet[1]) {
@@ -139,7 +181,15 @@ static void remote_packet_process_swd(const char *const packet, const size_t pac
 			remote_dp.error = adiv5_swd_clear_error;
 			remote_dp.low_access = adiv5_swd_raw_access;
 			remote_dp.abort = adiv5_swd_abort;
+#if CONFIG_BMDA == 0
 			swdptap_init();
+#else
+			/* Probes with no bit-level SWD access (ST-Link) can't serve this */
+			if (!remote_bmda_dp_init(false)) {
+				remote_respond(REMOTE_RESP_NOTSUP, 0);
+				break;
+			}
+#endif
 			remote_respond(REMOTE_RESP_OK, 0);
 		} else
 			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_WRONGLEN);
@@ -192,7 +242,14 @@ static void remote_packet_process_jtag(const char *const packet, const size_t pa
 		remote_dp.error = adiv5_jtag_clear_error;
 		remote_dp.low_access = adiv5_jtag_raw_access;
 		remote_dp.abort = adiv5_jtag_abort;
+#if CONFIG_BMDA == 0
 		jtagtap_init();
+#else
+		if (!remote_bmda_dp_init(true)) {
+			remote_respond(REMOTE_RESP_NOTSUP, 0);
+			break;
+		}
+#endif
 		remote_respond(REMOTE_RESP_OK, 0);
 		break;
 
@@ -346,6 +403,10 @@ static void remote_packet_process_high_level(const char *packet, const size_t pa
 		jtag_dev.ir_postscan = hex_string_to_num(2, packet + 12);
 		jtag_dev.current_ir = hex_string_to_num(8, packet + 14);
 		jtag_add_device(index, &jtag_dev);
+#if CONFIG_BMDA == 1
+		/* Let the probe we're backed by know about the device too */
+		bmda_add_jtag_dev(index, &jtag_dev);
+#endif
 		remote_respond(REMOTE_RESP_OK, 0);
 		break;
 	}
@@ -353,7 +414,10 @@ static void remote_packet_process_high_level(const char *packet, const size_t pa
 	case REMOTE_HL_ACCEL: { /* HA = request what accelerations are available */
 		/* Build a response value that depends on what things are built into the firmare */
 		remote_respond(REMOTE_RESP_OK,
-			REMOTE_ACCEL_ADIV5 | REMOTE_ACCEL_ADIV6
+			REMOTE_ACCEL_ADIV5 | REMOTE_ACCEL_ADIV6 | REMOTE_ACCEL_MEM_POLL | REMOTE_ACCEL_MEM_BATCH
+#if defined(CONFIG_CORTEXM) && CONFIG_CORTEXM == 1
+				| REMOTE_ACCEL_RUN_STUB | REMOTE_ACCEL_PC_PROFILE
+#endif
 #if defined(CONFIG_RISCV_ACCEL) && CONFIG_RISCV_ACCEL == 1
 				| REMOTE_ACCEL_RISCV
 #endif
@@ -514,13 +578,153 @@ static void remote_packet_process_adiv5(const char *const packet, const size_t p
 		}
 		/* Get the aligned packet buffer to reuse for the data to write */
 		void *data = gdb_packet_buffer();
-		/* And decode the data from the packet into it */
-		unhexify(data, packet + 40U, length);
+		/* And decode the data from the packet into it, checking it's all valid hex */
+		if (!unhexify_checked(data, packet + 40U, length)) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
 		/* Perform the write and report success/failures */
 		adiv5_mem_write_aligned(&remote_ap, address, data, length, align);
 		remote_adiv5_respond(NULL, 0);
 		break;
 	}
+	case REMOTE_MEM_POLL: { /* AP = Poll memory until a masked value matches */
+		if (packet_len != REMOTE_ADIV5_MEM_POLL_LENGTH) {
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_WRONGLEN);
+			break;
+		}
+		/* Grab the CSW value to use in the access */
+		remote_ap.csw = hex_string_to_num(8, packet + 6);
+		/* Grab the address to poll, what to mask the value read with and what to compare the result against */
+		const target_addr64_t address = hex_string_to_num(16, packet + 14U);
+		const uint32_t mask = hex_string_to_num(8, packet + 30U);
+		const uint32_t expected = hex_string_to_num(8, packet + 38U);
+		/* And how long we may spend doing this */
+		const uint32_t timeout = hex_string_to_num(8, packet + 46U);
+		/* Run the poll loop here and send back the last value read, the host works out if it matched */
+		uint32_t value = 0;
+		adiv5_mem_poll(&remote_ap, address, mask, expected, timeout, &value);
+		remote_adiv5_respond(&value, 4U);
+		break;
+	}
+#if defined(CONFIG_CORTEXM) && CONFIG_CORTEXM == 1
+	case REMOTE_RUN_STUB: { /* AX = Run a Cortex-M stub and wait for it to halt */
+		if (packet_len != REMOTE_ADIV5_RUN_STUB_LENGTH) {
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_WRONGLEN);
+			break;
+		}
+		/* Grab the CSW value to use in the accesses */
+		remote_ap.csw = hex_string_to_num(8, packet + 6);
+		/* Grab where the stub lives and the arguments to run it with */
+		const uint32_t loadaddr = hex_string_to_num(8, packet + 14U);
+		uint32_t args[4];
+		for (size_t idx = 0; idx < 4U; ++idx)
+			args[idx] = hex_string_to_num(8, packet + 22U + (idx * 8U));
+		/* Followed by the request flags and how long the stub may run for */
+		const uint8_t flags = hex_string_to_num(2, packet + 54U);
+		const uint32_t timeout = hex_string_to_num(8, packet + 56U);
+		uint32_t dfsr = 0U;
+		uint16_t instruction = 0U;
+		const bool halted = cortexm_ap_run_stub(
+			&remote_ap, loadaddr, args, flags & REMOTE_RUN_STUB_INVALIDATE_ICACHE, timeout, &dfsr, &instruction);
+		if (!halted && !remote_dp.fault)
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_TIMEOUT);
+		else {
+			/* Pack the reason for halting above the instruction halted on */
+			const uint64_t result = ((uint64_t)dfsr << 16U) | instruction;
+			remote_adiv5_respond(&result, sizeof(result));
+		}
+		break;
+	}
+	case REMOTE_PC_PROFILE: { /* AS = Sample the PC of a running Cortex-M core */
+		if (packet_len != REMOTE_ADIV5_PC_PROFILE_LENGTH) {
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_WRONGLEN);
+			break;
+		}
+		/* Grab the CSW value to use in the accesses and how long to sample for */
+		remote_ap.csw = hex_string_to_num(8, packet + 6);
+		const uint32_t duration = hex_string_to_num(8, packet + 14U);
+		/* The table has to be a power of 2 in size, so use the next one up from what we can send back */
+		static cortexm_pc_bucket_s buckets[64U];
+		cortexm_pc_profile_s profile = {
+			.buckets = buckets,
+			.bucket_count = ARRAY_LENGTH(buckets),
+		};
+		cortexm_ap_pc_profile(&remote_ap, &profile, duration, REMOTE_PC_PROFILE_MAX_BUCKETS);
+		/* Send back the totals, then a PC and count for each of the buckets in use */
+		static uint32_t response[4U + (REMOTE_PC_PROFILE_MAX_BUCKETS * 2U)];
+		response[0] = profile.samples;
+		response[1] = profile.idle;
+		response[2] = profile.dropped;
+		response[3] = profile.duration_ms;
+		size_t length = 4U;
+		for (size_t idx = 0; idx < ARRAY_LENGTH(buckets); ++idx) {
+			if (!buckets[idx].count)
+				continue;
+			response[length++] = buckets[idx].pc;
+			response[length++] = buckets[idx].count;
+		}
+		remote_adiv5_respond(response, length * 4U);
+		break;
+	}
+#endif
+	case REMOTE_MEM_BATCH: { /* AB = Perform a batch of small memory accesses */
+		if (packet_len < REMOTE_ADIV5_MEM_BATCH_LENGTH) {
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_WRONGLEN);
+			break;
+		}
+		/* Grab the CSW value to use in the accesses and how many there are to do */
+		remote_ap.csw = hex_string_to_num(8, packet + 6);
+		const size_t count = hex_string_to_num(2, packet + 14U);
+		if (count > REMOTE_MEM_BATCH_MAX_OPS) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
+		uint32_t results[REMOTE_MEM_BATCH_MAX_OPS];
+		size_t reads = 0U;
+		size_t offset = REMOTE_ADIV5_MEM_BATCH_LENGTH;
+		bool valid = true;
+		/* Run through each of the operations in turn, stopping as soon as one faults */
+		for (size_t idx = 0; idx < count && !remote_dp.fault; ++idx) {
+			/* Check the operation header is all there before decoding it */
+			if (offset + REMOTE_MEM_BATCH_READ_OP_LENGTH > packet_len) {
+				valid = false;
+				break;
+			}
+			const uint8_t flags = hex_string_to_num(2, packet + offset);
+			const target_addr64_t address = hex_string_to_num(16, packet + offset + 2U);
+			const align_e align = flags & REMOTE_MEM_BATCH_ALIGN_MASK;
+			/* Each access has to fit in the 32-bit value it's carried in */
+			if (align > ALIGN_32BIT) {
+				valid = false;
+				break;
+			}
+			const size_t width = 1U << align;
+			if (flags & REMOTE_MEM_BATCH_WRITE) {
+				/* Writes carry the value to write after the address */
+				if (offset + REMOTE_MEM_BATCH_WRITE_OP_LENGTH > packet_len) {
+					valid = false;
+					break;
+				}
+				const uint32_t value = hex_string_to_num(8, packet + offset + 18U);
+				adiv5_mem_write_aligned(&remote_ap, address, &value, width, align);
+				offset += REMOTE_MEM_BATCH_WRITE_OP_LENGTH;
+			} else {
+				results[reads] = 0U;
+				adiv5_mem_read(&remote_ap, results + reads, address, width);
+				++reads;
+				offset += REMOTE_MEM_BATCH_READ_OP_LENGTH;
+			}
+		}
+		/* If the request was malformed, tell the host rather than guessing at what it meant */
+		if (!valid || (!remote_dp.fault && offset != packet_len)) {
+			remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_WRONGLEN);
+			break;
+		}
+		/* Send back everything read */
+		remote_adiv5_respond(reads ? results : NULL, reads * 4U);
+		break;
+	}
 
 	default:
 		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
@@ -612,8 +816,11 @@ static void remote_packet_process_adiv6(const char *const packet, const size_t p
 		}
 		/* Get the aligned packet buffer to reuse for the data to write */
 		void *data = gdb_packet_buffer();
-		/* And decode the data from the packet into it */
-		unhexify(data, packet + 55U, length);
+		/* And decode the data from the packet into it, checking it's all valid hex */
+		if (!unhexify_checked(data, packet + 55U, length)) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
 		/* Perform the write and report success/failures */
 		adiv5_mem_write_aligned(&remote_ap.base, address, data, length, align);
 		remote_adiv5_respond(NULL, 0);
@@ -729,6 +936,7 @@ void remote_packet_process_riscv(const char *const packet, const size_t packet_l
 }
 #endif
 
+#if CONFIG_BMDA == 0
 static void remote_spi_respond(const bool result)
 {
 	if (result)
@@ -808,8 +1016,11 @@ void remote_packet_process_spi(const char *const packet, const size_t packet_len
 		}
 		/* Get the aligned packet buffer to reuse for the data to write */
 		void *data = gdb_packet_buffer();
-		/* And decode the data from the packet into it */
-		unhexify(data, packet + 20U, length);
+		/* And decode the data from the packet into it, checking it's all valid hex */
+		if (!unhexify_checked(data, packet + 20U, length)) {
+			remote_respond(REMOTE_RESP_PARERR, 0);
+			break;
+		}
 		/* Perform the write cycle */
 		bmp_spi_write(spi_bus, spi_device, command, address, data, length);
 		remote_respond(REMOTE_RESP_OK, 0);
@@ -842,6 +1053,7 @@ void remote_packet_process_spi(const char *const packet, const size_t packet_len
 		break;
 	}
 }
+#endif
 
 void remote_packet_process(char *const packet, const size_t packet_length)
 {
@@ -886,13 +1098,14 @@ void remote_packet_process(char *const packet, const size_t packet_length)
 		break;
 #endif
 
+#if CONFIG_BMDA == 0
 	case REMOTE_SPI_PACKET:
 		remote_packet_process_spi(packet, packet_length);
 		break;
+#endif
 
 	default: /* Oh dear, unrecognised, return an error */
 		remote_respond(REMOTE_RESP_ERR, REMOTE_ERROR_UNRECOGNISED);
 		break;
 	}
 }
-#endif
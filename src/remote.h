@@ -59,6 +59,7 @@
 #define REMOTE_ERROR_WRONGLEN     2
 #define REMOTE_ERROR_FAULT        3
 #define REMOTE_ERROR_EXCEPTION    4
+#define REMOTE_ERROR_TIMEOUT      5
 
 /* Start and end of message identifiers */
 #define REMOTE_SOM  '!'
@@ -248,10 +249,14 @@
 	}
 
 /* Remote protocol enabled acceleration bit values */
-#define REMOTE_ACCEL_ADIV5     (1U << 0U)
-#define REMOTE_ACCEL_CORTEX_AR (1U << 1U)
-#define REMOTE_ACCEL_RISCV     (1U << 2U)
-#define REMOTE_ACCEL_ADIV6     (1U << 3U)
+#define REMOTE_ACCEL_ADIV5      (1U << 0U)
+#define REMOTE_ACCEL_CORTEX_AR  (1U << 1U)
+#define REMOTE_ACCEL_RISCV      (1U << 2U)
+#define REMOTE_ACCEL_ADIV6      (1U << 3U)
+#define REMOTE_ACCEL_MEM_POLL   (1U << 4U)
+#define REMOTE_ACCEL_RUN_STUB   (1U << 5U)
+#define REMOTE_ACCEL_MEM_BATCH  (1U << 6U)
+#define REMOTE_ACCEL_PC_PROFILE (1U << 7U)
 
 /* ADIv5 accleration protocol elements */
 #define REMOTE_ADIV5_PACKET     'A'
@@ -263,6 +268,10 @@
 #define REMOTE_MEM_WRITE        'M'
 #define REMOTE_DP_VERSION       'V'
 #define REMOTE_DP_TARGETSEL     'T'
+#define REMOTE_MEM_POLL         'P'
+#define REMOTE_RUN_STUB         'X'
+#define REMOTE_MEM_BATCH        'B'
+#define REMOTE_PC_PROFILE       'S'
 
 #define REMOTE_ADIV5_DEV_INDEX  REMOTE_UINT8
 #define REMOTE_ADIV5_AP_SEL     REMOTE_UINT8
@@ -319,6 +328,89 @@
  * 16 for the address and 8 for the count and one trailer gives 42 bytes request overhead
  */
 #define REMOTE_ADIV5_MEM_WRITE_LENGTH 42U
+/*
+ * Re-read a word until (value & mask) == expected or the timeout in milliseconds passes, responding
+ * with the last value read. Only available when the probe reports REMOTE_ACCEL_MEM_POLL.
+ */
+#define REMOTE_ADIV5_MEM_POLL_STR                                                                      \
+	(char[])                                                                                           \
+	{                                                                                                  \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_MEM_POLL, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL, \
+			REMOTE_ADIV5_CSW, REMOTE_ADIV5_ADDR64, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA,               \
+			REMOTE_UINT32, REMOTE_EOM, 0                                                               \
+	}
+/*
+ * 2 bytes for the packet type + 2 bytes for dev index + 2 bytes for AP select + 8 for CSW + 16 for the address,
+ * 8 each for the mask and expected value and 8 for the timeout gives a 54 byte request
+ */
+#define REMOTE_ADIV5_MEM_POLL_LENGTH 54U
+/*
+ * Load the registers of the Cortex-M core behind an AP (r0-r3 and the PC), resume it and wait up to the timeout
+ * in milliseconds for it to halt, all on the probe. Responds with the core's DFSR and the instruction it halted
+ * on, or REMOTE_ERROR_TIMEOUT if it's still running. Only available when the probe reports REMOTE_ACCEL_RUN_STUB.
+ */
+#define REMOTE_ADIV5_RUN_STUB_STR                                                                         \
+	(char[])                                                                                              \
+	{                                                                                                     \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_RUN_STUB, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL,    \
+			REMOTE_ADIV5_CSW, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA, REMOTE_ADIV5_DATA, \
+			REMOTE_ADIV5_DATA, REMOTE_UINT8, REMOTE_UINT32, REMOTE_EOM, 0                                 \
+	}
+/*
+ * 2 bytes for the packet type + 2 bytes for dev index + 2 bytes for AP select + 8 for CSW + 8 for the load
+ * address, 8 each for r0-r3, 2 for the flags and 8 for the timeout gives a 64 byte request
+ */
+#define REMOTE_ADIV5_RUN_STUB_LENGTH 64U
+/* Run stub request flag asking for the core's instruction cache to be invalidated before resuming */
+#define REMOTE_RUN_STUB_INVALIDATE_ICACHE 1U
+/*
+ * Perform a list of small memory accesses in order, stopping at the first fault. The request header is followed
+ * by count operations, each an 8-bit flags value (the access alignment, with REMOTE_MEM_BATCH_WRITE for writes)
+ * and a 64-bit address, with writes then carrying the 32-bit value to write. Responds with the values read, 4
+ * bytes per read. Only available when the probe reports REMOTE_ACCEL_MEM_BATCH.
+ */
+#define REMOTE_ADIV5_MEM_BATCH_STR                                                                      \
+	(char[])                                                                                            \
+	{                                                                                                   \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_MEM_BATCH, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL, \
+			REMOTE_ADIV5_CSW, REMOTE_UINT8, 0                                                           \
+	}
+#define REMOTE_MEM_BATCH_READ_OP_STR         \
+	(char[])                                 \
+	{                                        \
+		REMOTE_UINT8, REMOTE_ADIV5_ADDR64, 0 \
+	}
+#define REMOTE_MEM_BATCH_WRITE_OP_STR                           \
+	(char[])                                                    \
+	{                                                           \
+		REMOTE_UINT8, REMOTE_ADIV5_ADDR64, REMOTE_ADIV5_DATA, 0 \
+	}
+/* 2 bytes for the packet type + 2 bytes for dev index + 2 bytes for AP select + 8 for CSW + 2 for the count */
+#define REMOTE_ADIV5_MEM_BATCH_LENGTH 16U
+/* 2 bytes for the flags + 16 for the address, and 8 more for the value on writes */
+#define REMOTE_MEM_BATCH_READ_OP_LENGTH  18U
+#define REMOTE_MEM_BATCH_WRITE_OP_LENGTH 26U
+/* Batch operation flag marking the operation as a write, the low bits hold the access alignment */
+#define REMOTE_MEM_BATCH_WRITE      0x80U
+#define REMOTE_MEM_BATCH_ALIGN_MASK 0x03U
+/* Most operations a single batch request may carry */
+#define REMOTE_MEM_BATCH_MAX_OPS 32U
+/*
+ * Sample the PC of the running Cortex-M core behind an AP for up to the given time in milliseconds, all on the
+ * probe. Responds with the total, idle and dropped sample counts and how long sampling ran for, followed by a
+ * PC value and sample count for each distinct PC seen. Sampling stops early if REMOTE_PC_PROFILE_MAX_BUCKETS
+ * distinct PCs are seen. Only available when the probe reports REMOTE_ACCEL_PC_PROFILE.
+ */
+#define REMOTE_ADIV5_PC_PROFILE_STR                                                                      \
+	(char[])                                                                                             \
+	{                                                                                                    \
+		REMOTE_SOM, REMOTE_ADIV5_PACKET, REMOTE_PC_PROFILE, REMOTE_ADIV5_DEV_INDEX, REMOTE_ADIV5_AP_SEL, \
+			REMOTE_ADIV5_CSW, REMOTE_UINT32, REMOTE_EOM, 0                                               \
+	}
+/* 2 bytes for the packet type + 2 bytes for dev index + 2 bytes for AP select + 8 for CSW + 8 for the duration */
+#define REMOTE_ADIV5_PC_PROFILE_LENGTH 22U
+/* Most distinct PCs a PC profile response can carry, chosen so the hex encoded response fits a packet */
+#define REMOTE_PC_PROFILE_MAX_BUCKETS 48U
 #define REMOTE_DP_VERSION_STR                                                                      \
 	(char[])                                                                                       \
 	{                                                                                              \
@@ -40,6 +40,9 @@
 #include "adiv6.h"
 #include "cortex.h"
 #include "cortex_internal.h"
+#if CONFIG_BMDA == 1
+#include "scan_cache.h"
+#endif
 
 /* Used to probe for a protected SAMX5X device */
 #define SAMX5X_DSU_CTRLSTAT 0x41002100U
@@ -47,6 +50,10 @@
 
 #define ID_SAMx5x 0xcd0U
 
+/* ROM tables are read in blocks of up to this many words, with the first block being smaller */
+#define ADI_ROM_TABLE_BLOCK_WORDS       32U
+#define ADI_ROM_TABLE_FIRST_BLOCK_WORDS 8U
+
 #if ENABLE_DEBUG == 1
 #define ARM_COMPONENT_STR(...) __VA_ARGS__
 #else
@@ -472,6 +479,18 @@ static bool adi_configure_mem_ap(adiv5_access_port_s *const ap)
 		return false;
 	}
 
+	/*
+	 * Packed transfers are an optional MEM-AP feature, so probe for them by asking for packed byte
+	 * accesses and checking that both the AddrInc and Size fields read back as written.
+	 */
+	adiv5_ap_write(ap, ADIV5_AP_CSW, ap->csw | ADIV5_AP_CSW_ADDRINC_PACKED | ADIV5_AP_CSW_SIZE_BYTE);
+	const uint32_t csw = adiv5_ap_read(ap, ADIV5_AP_CSW);
+	if ((csw & (ADIV5_AP_CSW_ADDRINC_MASK | ADIV5_AP_CSW_SIZE_MASK)) ==
+		(ADIV5_AP_CSW_ADDRINC_PACKED | ADIV5_AP_CSW_SIZE_BYTE)) {
+		ap->flags |= ADIV5_AP_FLAGS_PACKED;
+		DEBUG_INFO(" PACKED");
+	}
+
 	return true;
 }
 
@@ -510,10 +529,11 @@ void adi_ap_resume_cores(adiv5_access_port_s *const ap)
 	}
 }
 
-/* Program the CSW and TAR for sequential access at a given width */
-void adi_ap_mem_access_setup(adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align)
+/* Program the CSW and TAR for accesses at a given width, using the requested address increment mode */
+static void adi_ap_mem_access_setup_addrinc(
+	adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align, const uint32_t addrinc)
 {
-	uint32_t csw = ap->csw | ADIV5_AP_CSW_ADDRINC_SINGLE;
+	uint32_t csw = ap->csw | addrinc;
 
 	switch (align) {
 	case ALIGN_8BIT:
@@ -535,6 +555,22 @@ void adi_ap_mem_access_setup(adiv5_access_port_s *const ap, const target_addr64_
 	adiv5_dp_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)addr);
 }
 
+/* Program the CSW and TAR for sequential access at a given width */
+void adi_ap_mem_access_setup(adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align)
+{
+	adi_ap_mem_access_setup_addrinc(ap, addr, align, ADIV5_AP_CSW_ADDRINC_SINGLE);
+}
+
+/*
+ * Program the CSW and TAR for packed sequential access at a given width, where each DRW access
+ * moves a full 32 bits as several bus transfers. addr must be 32-bit aligned and the AP must have
+ * ADIV5_AP_FLAGS_PACKED set.
+ */
+void adi_ap_mem_packed_access_setup(adiv5_access_port_s *const ap, const target_addr64_t addr, const align_e align)
+{
+	adi_ap_mem_access_setup_addrinc(ap, addr, align, ADIV5_AP_CSW_ADDRINC_PACKED);
+}
+
 void adi_ap_banked_access_setup(adiv5_access_port_s *base_ap)
 {
 	/* Check which ADI version this is for, v5 only requires we set up the DP's SELECT register */
@@ -552,21 +588,56 @@ void adi_ap_banked_access_setup(adiv5_access_port_s *base_ap)
 	}
 }
 
-static uint32_t adi_ap_read_id(adiv5_access_port_s *ap, uint32_t addr)
+/* Reassemble a 32-bit ID value from the low bytes of the 4 consecutive registers it's split across */
+static uint32_t adi_decode_id(const uint8_t *const data)
 {
 	uint32_t res = 0;
-	uint8_t data[16];
-	adiv5_mem_read(ap, data, addr, sizeof(data));
 	for (size_t i = 0; i < 4U; ++i)
 		res |= (uint32_t)data[4U * i] << (i * 8U);
 	return res;
 }
 
-static uint64_t adi_ap_read_pidr(adiv5_access_port_s *ap, uint32_t addr)
+uint32_t adi_ap_read_id(adiv5_access_port_s *ap, uint32_t addr)
+{
+	uint8_t data[16];
+	adiv5_mem_read(ap, data, addr, sizeof(data));
+	return adi_decode_id(data);
+}
+
+/*
+ * Read a component's entire ID register window (PIDR4-7, PIDR0-3 and CIDR0-3 at 0xfd0-0xfff) in a single
+ * block transfer, rather than one register at a time, and extract the CIDR and PIDR from it
+ */
+static void adi_ap_read_ids(
+	adiv5_access_port_s *const ap, const target_addr64_t base_address, uint32_t *const cidr, uint64_t *const pidr)
+{
+	uint8_t data[(CIDR0_OFFSET + 16U) - PIDR4_OFFSET];
+	adiv5_mem_read(ap, data, base_address + PIDR4_OFFSET, sizeof(data));
+	const uint32_t pidr_upper = adi_decode_id(data);
+	const uint32_t pidr_lower = adi_decode_id(data + (PIDR0_OFFSET - PIDR4_OFFSET));
+	*pidr = ((uint64_t)pidr_upper << 32U) | (uint64_t)pidr_lower;
+	*cidr = adi_decode_id(data + (CIDR0_OFFSET - PIDR4_OFFSET));
+}
+
+/*
+ * Read a run of ROM table words in a single block transfer with a single error check. If that faults,
+ * fall back to reading them one at a time so the caller can tell exactly where the table became
+ * unreadable. Returns how many of the words could be read.
+ */
+static size_t adi_read_rom_table_words(
+	adiv5_access_port_s *const ap, const target_addr64_t address, uint32_t *const words, const size_t count)
 {
-	const uint32_t pidr_upper = adi_ap_read_id(ap, addr + PIDR4_OFFSET);
-	const uint32_t pidr_lower = adi_ap_read_id(ap, addr + PIDR0_OFFSET);
-	return ((uint64_t)pidr_upper << 32U) | (uint64_t)pidr_lower;
+	/* Clear any errors left over from probing the components of the previous block */
+	adiv5_dp_error(ap->dp);
+	adiv5_mem_read(ap, words, address, count * 4U);
+	if (!adiv5_dp_error(ap->dp))
+		return count;
+	for (size_t i = 0; i < count; ++i) {
+		adiv5_mem_read(ap, &words[i], address + (i * 4U), 4U);
+		if (adiv5_dp_error(ap->dp))
+			return i;
+	}
+	return count;
 }
 
 uint32_t adi_mem_read32(adiv5_access_port_s *const ap, const target_addr32_t addr)
@@ -603,6 +674,10 @@ static void adi_parse_adi_rom_table(adiv5_access_port_s *const ap, const target_
 					 * Handle it here, as access only to limited memory region
 					 * is allowed
 					 */
+#if CONFIG_BMDA == 1
+				bmda_scan_cache_record_core(
+					ap, aa_cortexm, base_address, CID_PREAMBLE | ((uint32_t)cidc_romtab << CID_CLASS_SHIFT));
+#endif
 				cortexm_probe(ap);
 				return;
 			}
@@ -619,25 +694,38 @@ static void adi_parse_adi_rom_table(adiv5_access_port_s *const ap, const target_
 			   "%08" PRIx32 ")\n",
 		base_address, memtype, designer_code, part_number, (uint32_t)(pidr >> 32U), (uint32_t)pidr);
 
-	for (uint32_t i = 0; i < 960U; i++) {
-		adiv5_dp_error(ap->dp);
+	/*
+	 * Read the entries in blocks, starting small as most tables only have a handful of entries,
+	 * and growing the blocks for tables that turn out to be larger
+	 */
+	uint32_t entries[ADI_ROM_TABLE_BLOCK_WORDS];
+	size_t block = ADI_ROM_TABLE_FIRST_BLOCK_WORDS;
+	for (uint32_t i = 0; i < 960U; block = MIN(block * 2U, ADI_ROM_TABLE_BLOCK_WORDS)) {
+		const size_t count = MIN(block, 960U - i);
+		const size_t valid = adi_read_rom_table_words(ap, base_address + i * 4U, entries, count);
+		bool end = false;
+		for (size_t idx = 0; idx < valid; ++idx, ++i) {
+			const uint32_t entry = entries[idx];
+			if (entry == 0) {
+				end = true;
+				break;
+			}
 
-		uint32_t entry = adi_mem_read32(ap, base_address + i * 4U);
-		if (adiv5_dp_error(ap->dp)) {
-			DEBUG_ERROR("%sFault reading ROM table entry %" PRIu32 "\n", indent, i);
-			break;
-		}
+			if (!(entry & ADI_ROM_ROMENTRY_PRESENT)) {
+				DEBUG_INFO("%s%" PRIu32 " Entry 0x%08" PRIx32 " -> Not present\n", indent, i, entry);
+				continue;
+			}
 
-		if (entry == 0)
+			/* Clear any fault a previous entry's component left behind, then probe recursively */
+			adiv5_dp_error(ap->dp);
+			adi_ap_component_probe(ap, base_address + (entry & ADI_ROM_ROMENTRY_OFFSET), recursion_depth + 1U, i);
+		}
+		if (end)
+			break;
+		if (valid < count) {
+			DEBUG_ERROR("%sFault reading ROM table entry %" PRIu32 "\n", indent, i);
 			break;
-
-		if (!(entry & ADI_ROM_ROMENTRY_PRESENT)) {
-			DEBUG_INFO("%s%" PRIu32 " Entry 0x%08" PRIx32 " -> Not present\n", indent, i, entry);
-			continue;
 		}
-
-		/* Probe recursively */
-		adi_ap_component_probe(ap, base_address + (entry & ADI_ROM_ROMENTRY_OFFSET), recursion_depth + 1U, i);
 	}
 	DEBUG_INFO("%sROM Table: END\n", indent);
 }
@@ -673,16 +761,6 @@ static bool adi_reset_resources(adiv5_access_port_s *const ap, const target_addr
 	return true;
 }
 
-static inline uint64_t adi_read_coresight_rom_entry(
-	adiv5_access_port_s *const ap, const uint8_t rom_format, const target_addr64_t entry_address)
-{
-	const uint32_t entry_lower = adi_mem_read32(ap, entry_address);
-	if (rom_format == CORESIGHT_ROM_DEVID_FORMAT_32BIT)
-		return entry_lower;
-	const uint32_t entry_upper = adi_mem_read32(ap, entry_address + 4U);
-	return ((uint64_t)entry_upper << 32U) | (uint64_t)entry_lower;
-}
-
 static void adi_parse_coresight_v0_rom_table(adiv5_access_port_s *const ap, const target_addr64_t base_address,
 	const uint64_t recursion_depth, const char *const indent, const uint64_t pidr)
 {
@@ -717,18 +795,37 @@ static void adi_parse_coresight_v0_rom_table(adiv5_access_port_s *const ap, cons
 
 	/* ROM table has at most 512 entries when 32-bit and 256 entries when 64-bit */
 	const uint32_t max_entries = rom_format == CORESIGHT_ROM_DEVID_FORMAT_32BIT ? 512U : 256U;
-	const size_t entry_shift = rom_format == CORESIGHT_ROM_DEVID_FORMAT_32BIT ? 2U : 3U;
-	for (uint32_t index = 0; index < max_entries; ++index) {
-		adiv5_dp_error(ap->dp);
-
-		/* Start by reading out the entry */
-		const uint64_t entry = adi_read_coresight_rom_entry(ap, rom_format, base_address + (index << entry_shift));
-
-		if (adiv5_dp_error(ap->dp)) {
-			DEBUG_ERROR("Fault reading ROM table entry %" PRIu32 "\n", index);
-			break;
+	const size_t entry_words = rom_format == CORESIGHT_ROM_DEVID_FORMAT_32BIT ? 1U : 2U;
+	/* Read the entries in blocks, starting small and growing as with adi_parse_adi_rom_table() */
+	uint32_t words[ADI_ROM_TABLE_BLOCK_WORDS];
+	size_t block_words = ADI_ROM_TABLE_FIRST_BLOCK_WORDS;
+	size_t valid_words = 0U;
+	size_t block_index = 0U;
+	for (uint32_t index = 0; index < max_entries; ++index, block_index += entry_words) {
+		/* If we've run out of entries read, fetch the next block of them */
+		if (block_index == valid_words) {
+			if (valid_words < block_words && index) {
+				DEBUG_ERROR("Fault reading ROM table entry %" PRIu32 "\n", index);
+				break;
+			}
+			if (index)
+				block_words = MIN(block_words * 2U, ADI_ROM_TABLE_BLOCK_WORDS);
+			block_words = MIN(block_words, (max_entries - index) * entry_words);
+			valid_words = adi_read_rom_table_words(ap, base_address + (index * entry_words * 4U), words, block_words);
+			/* Only whole entries are of any use */
+			valid_words -= valid_words % entry_words;
+			block_index = 0U;
+			if (!valid_words) {
+				DEBUG_ERROR("Fault reading ROM table entry %" PRIu32 "\n", index);
+				break;
+			}
 		}
 
+		/* Start by extracting the entry */
+		uint64_t entry = words[block_index];
+		if (entry_words == 2U)
+			entry |= (uint64_t)words[block_index + 1U] << 32U;
+
 		const uint8_t presence = entry & CORESIGHT_ROM_ROMENTRY_ENTRY_MASK;
 		/* Check if the entry is valid */
 		if (presence == CORESIGHT_ROM_ROMENTRY_ENTRY_FINAL)
@@ -768,7 +865,8 @@ static void adi_parse_coresight_v0_rom_table(adiv5_access_port_s *const ap, cons
 			}
 		}
 
-		/* Now recursively probe the component */
+		/* Clear any fault a previous entry's component left behind, then recursively probe the component */
+		adiv5_dp_error(ap->dp);
 		adi_ap_component_probe(ap, base_address + offset, recursion_depth + 1U, index);
 	}
 
@@ -783,7 +881,10 @@ void adi_ap_component_probe(
 	(void)entry_number;
 #endif
 
-	const uint32_t cidr = adi_ap_read_id(ap, base_address + CIDR0_OFFSET);
+	/* Read out the component and peripheral ID registers */
+	uint32_t cidr = 0U;
+	uint64_t pidr = 0U;
+	adi_ap_read_ids(ap, base_address, &cidr, &pidr);
 	if (ap->dp->fault) {
 		DEBUG_ERROR("Error reading CIDR on AP%u: %u\n", ap->apsel, ap->dp->fault);
 		return;
@@ -815,9 +916,6 @@ void adi_ap_component_probe(
 	/* Extract Component ID class nibble */
 	const uint8_t cid_class = (cidr & CID_CLASS_MASK) >> CID_CLASS_SHIFT;
 
-	/* Read out the peripheral ID register */
-	const uint64_t pidr = adi_ap_read_pidr(ap, base_address);
-
 	/* ROM table */
 	if (cid_class == cidc_romtab) {
 		/* Validate that the SIZE field is 0 per the spec */
@@ -861,6 +959,11 @@ void adi_ap_component_probe(
 		if (component == NULL)
 			return;
 
+#if CONFIG_BMDA == 1
+		/* Record where the cores are so later runs can go straight to them */
+		if (component->arch == aa_cortexm || component->arch == aa_cortexa || component->arch == aa_cortexr)
+			bmda_scan_cache_record_core(ap, component->arch, base_address, cidr);
+#endif
 		switch (component->arch) {
 		case aa_cortexm:
 			DEBUG_INFO("%s-> cortexm_probe\n", indent + 1);
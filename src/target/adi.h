@@ -34,6 +34,8 @@ const arm_coresight_component_s *adi_lookup_component(target_addr64_t base_addre
 	const char *indent, uint8_t cid_class, uint64_t pidr, uint8_t dev_type, uint16_t arch_id);
 /* Helper for figuring out what an AP is and configuring it for use */
 bool adi_configure_ap(adiv5_access_port_s *ap);
+/* Helper for reading a CoreSight ID register (CIDR/PIDR) made up of 4 byte-wide registers */
+uint32_t adi_ap_read_id(adiv5_access_port_s *ap, uint32_t addr);
 /* Helper for reading 32-bit registers from an AP's MMIO space */
 uint32_t adi_mem_read32(adiv5_access_port_s *ap, target_addr32_t addr);
 /* Helper for probing a CoreSight debug component */
@@ -44,6 +46,7 @@ void adi_ap_resume_cores(adiv5_access_port_s *ap);
 
 /* Helpers for setting up memory accesses and banked accesses */
 void adi_ap_mem_access_setup(adiv5_access_port_s *ap, target_addr64_t addr, align_e align);
+void adi_ap_mem_packed_access_setup(adiv5_access_port_s *ap, target_addr64_t addr, align_e align);
 void adi_ap_banked_access_setup(adiv5_access_port_s *base_ap);
 
 /*
@@ -31,16 +31,19 @@
 
 #include "general.h"
 #include "target.h"
+#include "target_internal.h"
 #include "target_probe.h"
 #include "jep106.h"
 #include "adi.h"
 #include "adiv5.h"
 #include "adiv6.h"
 #include "cortexm.h"
+#include "cortexar.h"
 #include "cortex_internal.h"
 #include "exception.h"
 #if CONFIG_BMDA == 1
 #include "bmp_hosted.h"
+#include "scan_cache.h"
 #endif
 
 /*
@@ -79,6 +82,10 @@ static void adiv5_dp_unref(adiv5_debug_port_s *dp)
 void adiv5_ap_unref(adiv5_access_port_s *ap)
 {
 	if (--(ap->refcnt) == 0) {
+#if CONFIG_BMDA == 1
+		/* Make sure the probe isn't still holding on to accesses for this AP before it goes away */
+		platform_buffer_flush();
+#endif
 		adiv5_dp_unref(ap->dp);
 		free(ap);
 	}
@@ -174,6 +181,40 @@ static uint32_t cortexm_initial_halt(adiv5_access_port_s *ap)
  * Example errata for STM32F0
  * - fails reading DBGMCU when under reset
  */
+#ifdef CONFIG_CORTEXAR
+/*
+ * Keep track of the best candidate MEM-AP onto the system bus seen while scanning a DP, so it can
+ * be handed to any Cortex-A/R cores found for direct memory access. AXI-APs are preferred over AHB-APs
+ * as on parts with both, the AHB-AP typically belongs to a Cortex-M core with its own view of memory.
+ */
+static void adiv5_note_system_ap(adiv5_access_port_s **const sys_ap, adiv5_access_port_s *const ap)
+{
+	const uint8_t type = ADIV5_AP_IDR_TYPE(ap->idr);
+	const bool is_axi = type == ADIV5_AP_IDR_TYPE_AXI3_4 || type == ADIV5_AP_IDR_TYPE_AXI5;
+	const bool is_ahb =
+		type == ADIV5_AP_IDR_TYPE_AHB3 || type == ADIV5_AP_IDR_TYPE_AHB5 || type == ADIV5_AP_IDR_TYPE_AHB5_HPROT;
+	if (!is_axi && !is_ahb)
+		return;
+	if (*sys_ap) {
+		const uint8_t sys_type = ADIV5_AP_IDR_TYPE((*sys_ap)->idr);
+		if (!is_axi || sys_type == ADIV5_AP_IDR_TYPE_AXI3_4 || sys_type == ADIV5_AP_IDR_TYPE_AXI5)
+			return;
+		adiv5_ap_unref(*sys_ap);
+	}
+	adiv5_ap_ref(ap);
+	*sys_ap = ap;
+}
+
+/* Hand the system bus AP found to the Cortex-A/R cores on the DP, and release our reference to it */
+static void adiv5_assign_system_ap(adiv5_access_port_s *const sys_ap)
+{
+	if (!sys_ap)
+		return;
+	cortexar_add_system_ap(sys_ap);
+	adiv5_ap_unref(sys_ap);
+}
+#endif
+
 static bool cortexm_prepare(adiv5_access_port_s *ap)
 {
 #if CONFIG_BMDA == 1 || ENABLE_DEBUG == 1
@@ -363,6 +404,95 @@ static bool adiv5_power_cycle_aps(adiv5_debug_port_s *const dp)
 	return true;
 }
 
+/* Give the drivers for vendor-specific APs a chance to claim this AP */
+static void adiv5_ap_vendor_probe(adiv5_access_port_s *const ap)
+{
+	kinetis_mdm_probe(ap);
+	nrf51_ctrl_ap_probe(ap);
+	nrf54l_ctrl_ap_probe(ap);
+	efm32_aap_probe(ap);
+	lpc55_dmap_probe(ap);
+}
+
+#if CONFIG_BMDA == 1
+/*
+ * Try to rebuild the APs and targets on a DP from the layout recorded in the scan cache by a previous run.
+ * Every AP's IDR and every core component's CIDR is checked against the record before any targets are
+ * created, so that if the hardware has changed we can fall back to a full scan without leaving stale or
+ * duplicate targets behind.
+ */
+static bool adiv5_dp_scan_cache_replay(adiv5_debug_port_s *const dp, const uint32_t dpidr, const uint32_t targetid)
+{
+	bmda_scan_cache_dp_s *const record = bmda_scan_cache_lookup(dp->dev_index, dpidr, targetid);
+	if (!record)
+		return false;
+
+	adiv5_access_port_s *aps[BMDA_SCAN_CACHE_MAX_APS] = {NULL};
+	bool valid = true;
+	for (size_t i = 0U; valid && i < record->ap_count; ++i) {
+		const bmda_scan_cache_ap_s *const ap_record = &record->aps[i];
+		aps[i] = adiv5_new_ap(dp, ap_record->apsel);
+		valid = aps[i] && aps[i]->idr == ap_record->idr;
+		for (size_t j = 0U; valid && j < ap_record->core_count; ++j) {
+			const bmda_scan_cache_core_s *const core = &ap_record->cores[j];
+			valid = adi_ap_read_id(aps[i], core->base + CIDR0_OFFSET) == core->cidr && !adiv5_dp_error(dp);
+		}
+	}
+	if (!valid) {
+		DEBUG_INFO("Scan cache does not match the DP with DPIDR 0x%08" PRIx32 ", rescanning\n", dpidr);
+		for (size_t i = 0U; i < record->ap_count; ++i) {
+			if (aps[i])
+				adiv5_ap_unref(aps[i]);
+		}
+		adiv5_dp_clear_sticky_errors(dp);
+		return false;
+	}
+
+	DEBUG_INFO("Using scan cache for the DP with DPIDR 0x%08" PRIx32 "\n", dpidr);
+#ifdef CONFIG_CORTEXAR
+	adiv5_access_port_s *sys_ap = NULL;
+#endif
+	for (size_t i = 0U; i < record->ap_count; ++i) {
+		adiv5_access_port_s *const ap = aps[i];
+		bmda_scan_cache_ap_s *const ap_record = &record->aps[i];
+		/* Restore what walking the ROM tables would have told us about the AP */
+		ap->designer_code = ap_record->designer_code;
+		ap->partno = ap_record->partno;
+		ap->flags |= ap_record->flags & ADIV5_AP_FLAGS_HAS_MEM;
+		adiv5_ap_vendor_probe(ap);
+
+		if (ADIV5_AP_IDR_CLASS(ap->idr) == ADIV5_AP_IDR_CLASS_MEM) {
+			if (!ap->apsel && ADIV5_AP_IDR_TYPE(ap->idr) == ARM_AP_TYPE_AHB3) {
+				if (!cortexm_prepare(ap))
+					DEBUG_WARN("adiv5: Failed to prepare AP, results may be unpredictable\n");
+			}
+
+			/* Hand the cores straight to their probe routines */
+			for (size_t j = 0U; j < ap_record->core_count; ++j) {
+				bmda_scan_cache_core_s *const core = &ap_record->cores[j];
+				bmda_scan_cache_select_core(core);
+				if (core->arch == aa_cortexm)
+					cortexm_probe(ap);
+				else if (core->arch == aa_cortexa)
+					cortexa_probe(ap, core->base);
+				else if (core->arch == aa_cortexr)
+					cortexr_probe(ap, core->base);
+			}
+			adi_ap_resume_cores(ap);
+#ifdef CONFIG_CORTEXAR
+			adiv5_note_system_ap(&sys_ap, ap);
+#endif
+		}
+		adiv5_ap_unref(ap);
+	}
+#ifdef CONFIG_CORTEXAR
+	adiv5_assign_system_ap(sys_ap);
+#endif
+	bmda_scan_cache_end();
+	return true;
+}
+#endif
+
 void adiv5_dp_init(adiv5_debug_port_s *const dp)
 {
 	/*
@@ -376,6 +506,8 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 #if CONFIG_BMDA == 1
 	bmda_adiv5_dp_init(dp);
 #endif
+	uint32_t dpidr = 0U;
+	uint32_t targetid = 0U;
 
 	/*
 	 * Unless we've got an ARM SoC-400 JTAG-DP, which must be ADIv5 and so DPv0, we can safely assume
@@ -387,7 +519,7 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 	if (dp->designer_code != JEP106_MANUFACTURER_ARM || dp->partno != JTAG_IDCODE_PARTNO_SOC400_4BIT) {
 		/* Ensure that DPIDR is definitely selected */
 		adiv5_dp_write(dp, ADIV5_DP_SELECT, ADIV5_DP_BANK0);
-		const uint32_t dpidr = adiv5_dp_read_dpidr(dp);
+		dpidr = adiv5_dp_read_dpidr(dp);
 		if (!dpidr) {
 			DEBUG_ERROR("Failed to read DPIDR\n");
 			free(dp);
@@ -442,7 +574,7 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 	if (dp->version >= 2) {
 		/* TARGETID is on bank 2 */
 		adiv5_dp_write(dp, ADIV5_DP_SELECT, ADIV5_DP_BANK2);
-		const uint32_t targetid = adiv5_dp_read(dp, ADIV5_DP_TARGETID);
+		targetid = adiv5_dp_read(dp, ADIV5_DP_TARGETID);
 		adiv5_dp_write(dp, ADIV5_DP_SELECT, ADIV5_DP_BANK0);
 
 		/*
@@ -487,6 +619,9 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 
 	/* Probe for APs on this DP */
 	size_t invalid_aps = 0U;
+#ifdef CONFIG_CORTEXAR
+	adiv5_access_port_s *sys_ap = NULL;
+#endif
 	dp->refcnt++;
 
 	if (dp->target_designer_code == JEP106_MANUFACTURER_FREESCALE) {
@@ -497,6 +632,15 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 		}
 	}
 
+#if CONFIG_BMDA == 1
+	/* If a previous run recorded this DP's layout, use that rather than rediscovering everything */
+	if (adiv5_dp_scan_cache_replay(dp, dpidr, targetid)) {
+		adiv5_dp_unref(dp);
+		return;
+	}
+	bmda_scan_cache_begin(dp->dev_index, dpidr, targetid);
+#endif
+
 	for (size_t i = 0; i < 256U && invalid_aps < 8U; ++i) {
 		adiv5_access_port_s *ap = adiv5_new_ap(dp, i);
 		if (ap == NULL) {
@@ -512,11 +656,10 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 			continue;
 		}
 
-		kinetis_mdm_probe(ap);
-		nrf51_ctrl_ap_probe(ap);
-		nrf54l_ctrl_ap_probe(ap);
-		efm32_aap_probe(ap);
-		lpc55_dmap_probe(ap);
+#if CONFIG_BMDA == 1
+		bmda_scan_cache_record_ap(ap);
+#endif
+		adiv5_ap_vendor_probe(ap);
 
 		if (ADIV5_AP_IDR_CLASS(ap->idr) == ADIV5_AP_IDR_CLASS_MEM) {
 			/* Try to prepare the AP if it seems to be a AHB3 MEM-AP */
@@ -527,8 +670,16 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 
 			/* The rest should only be added after checking ROM table */
 			adi_ap_component_probe(ap, ap->base, 0, 0);
+#if CONFIG_BMDA == 1
+			/* Update the record of the AP with what was learnt walking its ROM tables */
+			bmda_scan_cache_record_ap(ap);
+#endif
 			/* Having completed discovery on this AP, try to resume any halted cores */
 			adi_ap_resume_cores(ap);
+#ifdef CONFIG_CORTEXAR
+			/* Note if this AP could be used by Cortex-A/R cores for direct system bus access */
+			adiv5_note_system_ap(&sys_ap, ap);
+#endif
 
 			/*
 			* Due to the Tiva TM4C1294KCDT (among others) repeating the single AP ad-nauseum,
@@ -536,13 +687,18 @@ void adiv5_dp_init(adiv5_debug_port_s *const dp)
 			*/
 			if (ap->dp->quirks & ADIV5_DP_QUIRK_DUPED_AP) {
 				adiv5_ap_unref(ap);
-				adiv5_dp_unref(dp);
-				return;
+				break;
 			}
 		}
 
 		adiv5_ap_unref(ap);
 	}
+#ifdef CONFIG_CORTEXAR
+	adiv5_assign_system_ap(sys_ap);
+#endif
+#if CONFIG_BMDA == 1
+	bmda_scan_cache_end();
+#endif
 	adiv5_dp_unref(dp);
 }
 
@@ -614,37 +770,224 @@ const void *adiv5_pack_data(
 	return (const uint8_t *)src + (1U << align);
 }
 
+void adiv5_batch_init(adiv5_batch_s *const batch, adiv5_debug_port_s *const dp)
+{
+	batch->dp = dp;
+	batch->count = 0U;
+	batch->failed = false;
+}
+
+static void adiv5_batch_queue(
+	adiv5_batch_s *const batch, const uint8_t rnw, const uint16_t addr, const uint32_t value, uint32_t *const result)
+{
+	/* If the queue is full, run what's in it to make room */
+	if (batch->count == ADIV5_BATCH_MAX_OPS)
+		adiv5_batch_run(batch);
+	adiv5_batch_op_s *const op = &batch->ops[batch->count++];
+	op->addr = addr;
+	op->rnw = rnw;
+	op->value = value;
+	op->result = result;
+}
+
+void adiv5_batch_write(adiv5_batch_s *const batch, const uint16_t addr, const uint32_t value)
+{
+	adiv5_batch_queue(batch, ADIV5_LOW_WRITE, addr, value, NULL);
+}
+
+/* Queue a read, the result is only valid after the batch has been run */
+void adiv5_batch_read(adiv5_batch_s *const batch, const uint16_t addr, uint32_t *const result)
+{
+	adiv5_batch_queue(batch, ADIV5_LOW_READ, addr, 0U, result);
+}
+
+/*
+ * Run all the operations queued in the batch, returning true if they (and any earlier runs of
+ * this batch) succeeded. If the DP has no batch implementation, this falls back to doing
+ * each operation in turn as adiv5_dp_read() and adiv5_dp_write() would.
+ */
+bool adiv5_batch_run(adiv5_batch_s *const batch)
+{
+	adiv5_debug_port_s *const dp = batch->dp;
+	const size_t count = batch->count;
+	batch->count = 0U;
+	if (dp->batch_run) {
+		if (!dp->batch_run(dp, batch->ops, count))
+			batch->failed = true;
+		return !batch->failed;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		const adiv5_batch_op_s *const op = &batch->ops[i];
+		if (op->rnw) {
+			const uint32_t value = adiv5_dp_read(dp, op->addr);
+			if (op->result)
+				*op->result = value;
+		} else
+			adiv5_dp_write(dp, op->addr, op->value);
+	}
+	if (dp->fault)
+		batch->failed = true;
+	return !batch->failed;
+}
+
+/* Queue the TAR reload needed when a sequential transfer crosses a 1kiB auto-increment boundary */
+static void adiv5_batch_tar_reload(
+	adiv5_batch_s *const batch, const adiv5_access_port_s *const ap, const target_addr64_t addr)
+{
+	if (ap->flags & ADIV5_AP_FLAGS_64BIT)
+		adiv5_batch_write(batch, ADIV5_AP_TAR_HIGH, (uint32_t)(addr >> 32));
+	adiv5_batch_write(batch, ADIV5_AP_TAR_LOW, (uint32_t)addr);
+}
+
+/*
+ * Read len bytes from src through DRW, with CSW and TAR already set up. Each DRW access moves
+ * 1U << access bytes of data. The reads are queued up in batches so adaptors that can do so
+ * perform many accesses per round trip, and so AP reads are pipelined rather than each needing
+ * its own RDBUFF read.
+ */
+static void adiv5_mem_read_drw(adiv5_access_port_s *const ap, void *dest, const target_addr64_t src,
+	const size_t len, const align_e access)
+{
+	const target_addr64_t end = src + len;
+	/*
+	 * If the DP can stream whole words, hand it the transfer a TAR auto-increment page at a time so
+	 * it only needs to check for overruns once per page instead of polling each access for WAIT
+	 */
+	if (access == ALIGN_32BIT && ap->dp->stream_read) {
+		uint8_t *data = (uint8_t *)dest;
+		for (target_addr64_t begin = src; begin < end;) {
+			const target_addr64_t page_end = MIN((begin | 0x3ffU) + 1U, end);
+			if (!ap->dp->stream_read(ap, begin, data, (size_t)(page_end - begin) >> 2U))
+				return;
+			data += page_end - begin;
+			begin = page_end;
+		}
+		return;
+	}
+	const uint8_t stride = 1U << access;
+	adiv5_batch_s batch;
+	uint32_t values[ADIV5_BATCH_MAX_OPS] = {0};
+	for (target_addr64_t begin = src; begin < end;) {
+		adiv5_batch_init(&batch, ap->dp);
+		size_t reads = 0U;
+		/* Queue up as many reads as will fit, leaving room for a TAR reload */
+		for (target_addr64_t addr = begin; addr < end && batch.count + 3U <= ADIV5_BATCH_MAX_OPS; addr += stride) {
+			/*
+			 * Check if the address doesn't overflow the 10-bit auto increment bound for TAR,
+			 * if it's not the first transfer (offset == 0)
+			 */
+			if (addr != src && (addr & 0x000003ffU) == 0U)
+				adiv5_batch_tar_reload(&batch, ap, addr);
+			adiv5_batch_read(&batch, ADIV5_AP_DRW, &values[reads++]);
+		}
+		/* If any of the reads faulted, the values are not valid so don't hand them back to the caller */
+		if (!adiv5_batch_run(&batch))
+			return;
+		/* Unpack the data from the chunks read */
+		for (size_t i = 0U; i < reads; ++i, begin += stride)
+			dest = adiv5_unpack_data(dest, begin, values[i], access);
+	}
+}
+
+static void adiv5_mem_read_single(
+	adiv5_access_port_s *const ap, void *const dest, const target_addr64_t src, const size_t len, const align_e align)
+{
+	/* Set up the transfer */
+	adi_ap_mem_access_setup(ap, src, align);
+	/* Now move the data 1 stride at a time from the target */
+	adiv5_mem_read_drw(ap, dest, src, len, align);
+}
+
+/*
+ * Read the 32-bit aligned body of a sub-word transfer using packed transfers. Each DRW access
+ * is turned into 4 byte or 2 halfword bus transfers by the AP, so the access width the target sees
+ * is unchanged while the number of debug link transactions is cut by the same factor.
+ * Packed data arrives in the byte lanes of the addresses it came from, so is already in memory order.
+ */
+static void adiv5_mem_read_packed(adiv5_access_port_s *const ap, uint8_t *const dest, const target_addr64_t src,
+	const size_t len, const align_e align)
+{
+	adi_ap_mem_packed_access_setup(ap, src, align);
+	adiv5_mem_read_drw(ap, dest, src, len, ALIGN_32BIT);
+}
+
 void adiv5_mem_read_bytes(adiv5_access_port_s *const ap, void *dest, const target_addr64_t src, const size_t len)
 {
 	/* Do nothing and return if there's nothing to read */
 	if (len == 0U)
 		return;
-	/* Calculate the extent of the transfer */
-	target_addr64_t begin = src;
-	const target_addr64_t end = begin + len;
 	/* Calculate the alignment of the transfer */
 	const align_e align = MIN_ALIGN(src, len);
-	/* Calculate how much each loop will increment the destination address by */
-	const uint8_t stride = 1U << align;
-	/* Set up the transfer */
-	adi_ap_mem_access_setup(ap, src, align);
-	/* Now loop through the data and move it 1 stride at a time to the target */
-	for (; begin < end; begin += stride) {
+	/* Calculate the 32-bit aligned body of the transfer */
+	const target_addr64_t body_begin = (src + 3U) & ~(target_addr64_t)3U;
+	const target_addr64_t body_end = (src + len) & ~(target_addr64_t)3U;
+	/* If this is a whole-word transfer, or we can't make use of packed transfers, move the data 1 stride at a time */
+	if (align >= ALIGN_32BIT || !(ap->flags & ADIV5_AP_FLAGS_PACKED) || body_begin >= body_end) {
+		adiv5_mem_read_single(ap, dest, src, len, align);
+		return;
+	}
+	/* Otherwise, split the transfer into an unaligned head and tail and a packed body */
+	uint8_t *const data = (uint8_t *)dest;
+	const size_t head = body_begin - src;
+	const size_t tail = (src + len) - body_end;
+	if (head)
+		adiv5_mem_read_single(ap, data, src, head, align);
+	adiv5_mem_read_packed(ap, data + head, body_begin, body_end - body_begin, align);
+	if (tail)
+		adiv5_mem_read_single(ap, data + (len - tail), body_end, tail, align);
+}
+
+/* Write len bytes to dest through DRW, with CSW and TAR already set up, see adiv5_mem_read_drw() */
+static void adiv5_mem_write_drw(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *src,
+	const size_t len, const align_e access)
+{
+	const target_addr64_t end = dest + len;
+	if (access == ALIGN_32BIT && ap->dp->stream_write) {
+		const uint8_t *data = (const uint8_t *)src;
+		for (target_addr64_t begin = dest; begin < end;) {
+			const target_addr64_t page_end = MIN((begin | 0x3ffU) + 1U, end);
+			if (!ap->dp->stream_write(ap, begin, data, (size_t)(page_end - begin) >> 2U))
+				return;
+			data += page_end - begin;
+			begin = page_end;
+		}
+		return;
+	}
+	const uint8_t stride = 1U << access;
+	adiv5_batch_s batch;
+	adiv5_batch_init(&batch, ap->dp);
+	for (target_addr64_t begin = dest; begin < end; begin += stride) {
 		/*
 		 * Check if the address doesn't overflow the 10-bit auto increment bound for TAR,
 		 * if it's not the first transfer (offset == 0)
 		 */
-		if (begin != src && (begin & 0x000003ffU) == 0U) {
-			/* Update TAR to adjust the upper bits */
-			if (ap->flags & ADIV5_AP_FLAGS_64BIT)
-				adiv5_dp_write(ap->dp, ADIV5_AP_TAR_HIGH, (uint32_t)(begin >> 32));
-			adiv5_dp_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)begin);
-		}
-		/* Grab the next chunk of data from the target */
-		const uint32_t value = adiv5_dp_read(ap->dp, ADIV5_AP_DRW);
-		/* Unpack the data from the chunk */
-		dest = adiv5_unpack_data(dest, begin, value, align);
+		if (begin != dest && (begin & 0x000003ffU) == 0U)
+			adiv5_batch_tar_reload(&batch, ap, begin);
+		/* Pack the data for transfer */
+		uint32_t value = 0;
+		src = adiv5_pack_data(begin, src, &value, access);
+		/* And queue the result to be copied to the target */
+		adiv5_batch_write(&batch, ADIV5_AP_DRW, value);
 	}
+	adiv5_batch_run(&batch);
+}
+
+static void adiv5_mem_write_single(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src,
+	const size_t len, const align_e align)
+{
+	/* Set up the transfer */
+	adi_ap_mem_access_setup(ap, dest, align);
+	/* Now move the data 1 stride at a time to the target */
+	adiv5_mem_write_drw(ap, dest, src, len, align);
+}
+
+/* Write the 32-bit aligned body of a sub-word transfer using packed transfers, see adiv5_mem_read_packed() */
+static void adiv5_mem_write_packed(adiv5_access_port_s *const ap, const target_addr64_t dest, const uint8_t *const src,
+	const size_t len, const align_e align)
+{
+	adi_ap_mem_packed_access_setup(ap, dest, align);
+	adiv5_mem_write_drw(ap, dest, src, len, ALIGN_32BIT);
 }
 
 void adiv5_mem_write_bytes(
@@ -653,47 +996,43 @@ void adiv5_mem_write_bytes(
 	/* Do nothing and return if there's nothing to write */
 	if (len == 0U)
 		return;
-	/* Calculate the extent of the transfer */
-	target_addr64_t begin = dest;
-	const target_addr64_t end = begin + len;
-	/* Calculate how much each loop will increment the destination address by */
-	const uint8_t stride = 1U << align;
-	/* Set up the transfer */
-	adi_ap_mem_access_setup(ap, dest, align);
-	/* Now loop through the data and move it 1 stride at a time to the target */
-	for (; begin < end; begin += stride) {
-		/*
-		 * Check if the address doesn't overflow the 10-bit auto increment bound for TAR,
-		 * if it's not the first transfer (offset == 0)
-		 */
-		if (begin != dest && (begin & 0x000003ffU) == 0U) {
-			/* Update TAR to adjust the upper bits */
-			if (ap->flags & ADIV5_AP_FLAGS_64BIT)
-				adiv5_dp_write(ap->dp, ADIV5_AP_TAR_HIGH, (uint32_t)(begin >> 32));
-			adiv5_dp_write(ap->dp, ADIV5_AP_TAR_LOW, (uint32_t)begin);
-		}
-		/* Pack the data for transfer */
-		uint32_t value = 0;
-		src = adiv5_pack_data(begin, src, &value, align);
-		/* And copy the result to the target */
-		adiv5_dp_write(ap->dp, ADIV5_AP_DRW, value);
+	/* Calculate the 32-bit aligned body of the transfer */
+	const target_addr64_t body_begin = (dest + 3U) & ~(target_addr64_t)3U;
+	const target_addr64_t body_end = (dest + len) & ~(target_addr64_t)3U;
+	/* If this is a whole-word transfer, or we can't make use of packed transfers, move the data 1 stride at a time */
+	if (align >= ALIGN_32BIT || !(ap->flags & ADIV5_AP_FLAGS_PACKED) || body_begin >= body_end)
+		adiv5_mem_write_single(ap, dest, src, len, align);
+	else {
+		/* Otherwise, split the transfer into an unaligned head and tail and a packed body */
+		const uint8_t *const data = (const uint8_t *)src;
+		const size_t head = body_begin - dest;
+		const size_t tail = (dest + len) - body_end;
+		if (head)
+			adiv5_mem_write_single(ap, dest, data, head, align);
+		adiv5_mem_write_packed(ap, body_begin, data + head, body_end - body_begin, align);
+		if (tail)
+			adiv5_mem_write_single(ap, body_end, data + (len - tail), tail, align);
 	}
 	/* Make sure this write is complete by doing a dummy read */
 	adiv5_dp_read(ap->dp, ADIV5_DP_RDBUFF);
 }
 
+/*
+ * The AP register access itself goes straight to the DP's routines as adiv5_ap_{read,write}() already account for
+ * it, only the SELECT write is counted as a DP access here
+ */
 void adiv5_ap_reg_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value)
 {
 	adiv5_dp_recoverable_access(
 		ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
-	adiv5_dp_write(ap->dp, addr, value);
+	ap->dp->low_access(ap->dp, ADIV5_LOW_WRITE, addr, value);
 }
 
 uint32_t adiv5_ap_reg_read(adiv5_access_port_s *ap, uint16_t addr)
 {
 	adiv5_dp_recoverable_access(
 		ap->dp, ADIV5_LOW_WRITE, ADIV5_DP_SELECT, ((uint32_t)ap->apsel << 24U) | (addr & 0xf0U));
-	return adiv5_dp_read(ap->dp, addr);
+	return ap->dp->dp_read(ap->dp, addr);
 }
 
 void adiv5_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest, const void *const src, const size_t len)
@@ -702,6 +1041,85 @@ void adiv5_mem_write(adiv5_access_port_s *const ap, const target_addr64_t dest,
 	adiv5_mem_write_aligned(ap, dest, src, len, align);
 }
 
+/*
+ * Re-read the word at src until (value & mask) == expected, returning true if that happened before timeout ms
+ * elapsed. The last value read is always returned through value. If the DP can run the loop itself (such as
+ * when talking to a remote probe), it's handed off so each iteration doesn't cost a round trip over the link.
+ */
+bool adiv5_mem_poll(adiv5_access_port_s *const ap, const target_addr64_t src, const uint32_t mask,
+	const uint32_t expected, const uint32_t timeout, uint32_t *const value)
+{
+	*value = 0U;
+	if (ap->dp->mem_poll)
+		return ap->dp->mem_poll(ap, src, mask, expected, timeout, value);
+
+	platform_timeout_s poll_timeout;
+	platform_timeout_set(&poll_timeout, timeout);
+	while (true) {
+		adiv5_mem_read(ap, value, src, sizeof(*value));
+		/* Stop on any fault so the caller can find out what went wrong */
+		if (ap->dp->fault)
+			return false;
+		if ((*value & mask) == expected)
+			return true;
+		if (platform_timeout_is_expired(&poll_timeout))
+			return false;
+	}
+}
+
+/*
+ * Perform a sequence of word-aligned 32-bit memory accesses in order, returning false if any of them faulted.
+ * Adaptors that can queue memory accesses up do the whole sequence themselves. Otherwise CSW is set up once and
+ * the accesses are queued as a DP batch, through the banked data registers if they all fall in one 16 byte
+ * block (as is typical for core debug registers) or else as a TAR write and DRW access each.
+ */
+bool adiv5_mem_txn(adiv5_access_port_s *const ap, const target_txn_op_s *const ops, const size_t count)
+{
+	adiv5_debug_port_s *const dp = ap->dp;
+	if (!count)
+		return true;
+	if (dp->mem_txn)
+		return dp->mem_txn(ap, ops, count);
+
+	/* Adaptors with their own memory access routines may not give us a usable DRW path, so go one at a time */
+	if (dp->mem_read != adiv5_mem_read_bytes) {
+		for (size_t i = 0; i < count && !dp->fault; ++i) {
+			const target_txn_op_s *const op = &ops[i];
+			if (op->write)
+				adiv5_mem_write(ap, op->addr, &op->value, sizeof(op->value));
+			else
+				adiv5_mem_read(ap, op->result, op->addr, sizeof(*op->result));
+		}
+		return !dp->fault;
+	}
+
+	const target_addr64_t block = ops[0].addr & ~(target_addr64_t)0xfU;
+	bool banked = true;
+	for (size_t i = 1; i < count && banked; ++i)
+		banked = (ops[i].addr & ~(target_addr64_t)0xfU) == block;
+	adi_ap_mem_access_setup(ap, banked ? block : ops[0].addr, ALIGN_32BIT);
+	if (banked)
+		adi_ap_banked_access_setup(ap);
+	/* TAR no longer points where any banked user left it */
+	dp->quirks &= ~ADIV5_AP_ACCESS_BANKED;
+
+	adiv5_batch_s batch;
+	adiv5_batch_init(&batch, dp);
+	for (size_t i = 0; i < count; ++i) {
+		const target_txn_op_s *const op = &ops[i];
+		uint16_t reg = ADIV5_AP_DRW;
+		if (banked)
+			reg = ADIV5_AP_DB((op->addr & 0xfU) >> 2U);
+		else if (i)
+			adiv5_batch_tar_reload(&batch, ap, op->addr);
+		if (op->write)
+			adiv5_batch_write(&batch, reg, op->value);
+		else
+			adiv5_batch_read(&batch, reg, op->result);
+	}
+	return adiv5_batch_run(&batch) && !dp->fault;
+}
+
 #ifndef DEBUG_PROTO_IS_NOOP
 static void decode_dp_access(const uint8_t addr, const uint8_t rnw, const uint32_t value)
 {
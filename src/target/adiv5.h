@@ -186,6 +186,7 @@
 #define ADIV5_AP_FLAGS_HAS_MEM         (1U << 1U)
 #define ADIV6_DP_FLAGS_HAS_PWRCTRL     (1U << 2U)
 #define ADIV6_DP_FLAGS_HAS_SYSRESETREQ (1U << 3U)
+#define ADIV5_AP_FLAGS_PACKED          (1U << 4U)
 
 /* ADIv5 Class 0x1 ROM Table Registers */
 #define ADI_ROM_MEMTYPE          0xfccU
@@ -270,6 +271,10 @@ const void *adiv5_pack_data(target_addr32_t dest, const void *src, uint32_t *dat
 
 /* ADIv5 high-level memory write function */
 void adiv5_mem_write(adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t len);
+/* ADIv5 high-level memory polling function */
+bool adiv5_mem_poll(adiv5_access_port_s *ap, target_addr64_t src, uint32_t mask, uint32_t expected, uint32_t timeout,
+	uint32_t *value);
+bool adiv5_mem_txn(adiv5_access_port_s *ap, const target_txn_op_s *ops, size_t count);
 
 /* ADIv5 low-level logical operation functions for memory access */
 void adiv5_mem_write_bytes(adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t len, align_e align);
@@ -278,6 +283,12 @@ void adiv5_mem_read_bytes(adiv5_access_port_s *ap, void *dest, target_addr64_t s
 void adiv5_ap_reg_write(adiv5_access_port_s *ap, uint16_t addr, uint32_t value);
 uint32_t adiv5_ap_reg_read(adiv5_access_port_s *ap, uint16_t addr);
 
+/* ADIv5 DP operation batching functions */
+void adiv5_batch_init(adiv5_batch_s *batch, adiv5_debug_port_s *dp);
+void adiv5_batch_write(adiv5_batch_s *batch, uint16_t addr, uint32_t value);
+void adiv5_batch_read(adiv5_batch_s *batch, uint16_t addr, uint32_t *result);
+bool adiv5_batch_run(adiv5_batch_s *batch);
+
 /* ADIv5 DP logical operation function for reading DPIDR safely */
 uint32_t adiv5_dp_read_dpidr(adiv5_debug_port_s *dp);
 
@@ -288,6 +299,10 @@ uint32_t adiv5_swd_read(adiv5_debug_port_s *dp, uint16_t addr);
 uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t value);
 uint32_t adiv5_swd_clear_error(adiv5_debug_port_s *dp, bool protocol_recovery);
 void adiv5_swd_abort(adiv5_debug_port_s *dp, uint32_t abort);
+bool adiv5_swd_batch_run(adiv5_debug_port_s *dp, const adiv5_batch_op_s *ops, size_t count);
+bool adiv5_swd_stream_read(adiv5_access_port_s *ap, target_addr64_t src, void *dest, size_t count);
+bool adiv5_swd_stream_write(adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t count);
+void adiv5_swd_batch_init(adiv5_debug_port_s *dp);
 
 /* JTAG low-level ADIv5 routines */
 uint32_t adiv5_jtag_read(adiv5_debug_port_s *dp, uint16_t addr);
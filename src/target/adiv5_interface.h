@@ -26,6 +26,7 @@
 
 #include "adiv5_internal.h"
 #include "exception.h"
+#include "perf.h"
 
 #ifndef DEBUG_PROTO_IS_NOOP
 void decode_access(uint16_t addr, uint8_t rnw, uint8_t apsel, uint32_t value);
@@ -52,7 +53,9 @@ static inline uint32_t adiv5_read_no_check(adiv5_debug_port_s *const dp, const u
 
 static inline uint32_t adiv5_dp_read(adiv5_debug_port_s *const dp, const uint16_t addr)
 {
+	const uint32_t start = perf_now();
 	uint32_t ret = dp->dp_read(dp, addr);
+	perf_record(addr & ADIV5_APnDP ? PERF_AP_ACCESS : PERF_DP_ACCESS, start, 0U);
 #ifndef DEBUG_PROTO_IS_NOOP
 	decode_access(addr, ADIV5_LOW_READ, 0U, 0U);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", ret);
@@ -66,13 +69,19 @@ static inline void adiv5_dp_write(adiv5_debug_port_s *const dp, const uint16_t a
 	decode_access(addr, ADIV5_LOW_WRITE, 0U, value);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", value);
 #endif
+	if (addr == ADIV5_DP_CTRLSTAT)
+		dp->ctrlstat = value;
+	const uint32_t start = perf_now();
 	dp->low_access(dp, ADIV5_LOW_WRITE, addr, value);
+	perf_record(addr & ADIV5_APnDP ? PERF_AP_ACCESS : PERF_DP_ACCESS, start, 0U);
 }
 
 static inline uint32_t adiv5_dp_low_access(
 	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
 {
+	const uint32_t start = perf_now();
 	uint32_t ret = dp->low_access(dp, rnw, addr, value);
+	perf_record(addr & ADIV5_APnDP ? PERF_AP_ACCESS : PERF_DP_ACCESS, start, 0U);
 #ifndef DEBUG_PROTO_IS_NOOP
 	decode_access(addr, rnw, 0U, value);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", rnw ? ret : value);
@@ -95,7 +104,9 @@ static inline void adiv5_dp_abort(adiv5_debug_port_s *const dp, const uint32_t a
 
 static inline uint32_t adiv5_ap_read(adiv5_access_port_s *const ap, const uint16_t addr)
 {
+	const uint32_t start = perf_now();
 	uint32_t ret = ap->dp->ap_read(ap, addr);
+	perf_record(PERF_AP_ACCESS, start, 0U);
 #ifndef DEBUG_PROTO_IS_NOOP
 	decode_access(addr, ADIV5_LOW_READ, ap->apsel, 0U);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", ret);
@@ -109,7 +120,9 @@ static inline void adiv5_ap_write(adiv5_access_port_s *const ap, const uint16_t
 	decode_access(addr, ADIV5_LOW_WRITE, ap->apsel, value);
 	DEBUG_PROTO("0x%08" PRIx32 "\n", value);
 #endif
+	const uint32_t start = perf_now();
 	ap->dp->ap_write(ap, addr, value);
+	perf_record(PERF_AP_ACCESS, start, 0U);
 }
 
 static inline void adiv5_mem_read(
@@ -150,7 +163,9 @@ static inline void adiv5_mem_write_aligned(adiv5_access_port_s *const ap, const
 
 static inline uint32_t adiv5_dp_recoverable_access(adiv5_debug_port_s *dp, uint8_t rnw, uint16_t addr, uint32_t value)
 {
+	const uint32_t start = perf_now();
 	const uint32_t result = dp->low_access(dp, rnw, addr, value);
+	perf_record(addr & ADIV5_APnDP ? PERF_AP_ACCESS : PERF_DP_ACCESS, start, 0U);
 	/* If the access results in the no-response response, retry after clearing the error state */
 	if (dp->fault == SWD_ACK_NO_RESPONSE) {
 		uint32_t response;
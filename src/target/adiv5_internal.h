@@ -192,6 +192,36 @@
 
 typedef struct adiv5_access_port adiv5_access_port_s;
 typedef struct adiv5_debug_port adiv5_debug_port_s;
+/* Memory accesses making up a target transaction, see target_internal.h */
+typedef struct target_txn_op target_txn_op_s;
+/* Histogram of PC samples from a Cortex-M core, see cortexm.h */
+typedef struct cortexm_pc_profile cortexm_pc_profile_s;
+
+/* Maximum number of DP/AP operations queued up in a batch before it is run */
+#if CONFIG_BMDA == 1
+#define ADIV5_BATCH_MAX_OPS 64U
+#else
+#define ADIV5_BATCH_MAX_OPS 16U
+#endif
+
+/* A single queued DP/AP operation */
+typedef struct adiv5_batch_op {
+	uint16_t addr;
+	uint8_t rnw;
+	/* Value to write for write operations */
+	uint32_t value;
+	/* Where to store the result of read operations, may be NULL */
+	uint32_t *result;
+} adiv5_batch_op_s;
+
+/* A queue of DP/AP operations to be run back to back, see adiv5_batch_run() */
+typedef struct adiv5_batch {
+	adiv5_debug_port_s *dp;
+	size_t count;
+	/* Set if a run of the queue (including any run caused by the queue filling up) failed */
+	bool failed;
+	adiv5_batch_op_s ops[ADIV5_BATCH_MAX_OPS];
+} adiv5_batch_s;
 
 struct adiv5_debug_port {
 	int refcnt;
@@ -203,11 +233,28 @@ struct adiv5_debug_port {
 	uint32_t (*error)(adiv5_debug_port_s *dp, bool protocol_recovery);
 	uint32_t (*low_access)(adiv5_debug_port_s *dp, uint8_t RnW, uint16_t addr, uint32_t value);
 	void (*abort)(adiv5_debug_port_s *dp, uint32_t abort);
+	/* Optional, runs a queue of operations in one go. AP reads are posted as for low_access */
+	bool (*batch_run)(adiv5_debug_port_s *dp, const adiv5_batch_op_s *ops, size_t count);
+	/* Optional, streams count whole words through DRW within a single 1kiB TAR page, writing TAR itself */
+	bool (*stream_read)(adiv5_access_port_s *ap, target_addr64_t src, void *dest, size_t count);
+	bool (*stream_write)(adiv5_access_port_s *ap, target_addr64_t dest, const void *src, size_t count);
+	/* Optional, re-reads a word until (value & mask) == expected or timeout ms pass, see adiv5_mem_poll() */
+	bool (*mem_poll)(adiv5_access_port_s *ap, target_addr64_t src, uint32_t mask, uint32_t expected, uint32_t timeout,
+		uint32_t *value);
+	/* Optional, performs a sequence of 32-bit memory accesses in order, see adiv5_mem_txn() */
+	bool (*mem_txn)(adiv5_access_port_s *ap, const target_txn_op_s *ops, size_t count);
 
 #if CONFIG_BMDA == 1
 	void (*ap_regs_read)(adiv5_access_port_s *ap, void *data);
 	uint32_t (*ap_reg_read)(adiv5_access_port_s *ap, uint8_t reg_num);
 	void (*ap_reg_write)(adiv5_access_port_s *ap, uint8_t num, uint32_t value);
+	/* Optional, runs a Cortex-M stub on the probe, see cortexm_ap_run_stub(). Returns false if still running */
+	bool (*run_stub)(adiv5_access_port_s *ap, uint32_t loadaddr, const uint32_t *args, bool invalidate_icache,
+		uint32_t *dfsr, uint16_t *instruction);
+	/* Optional, samples the PC of a Cortex-M core on the probe, adding what it sees to the profile */
+	bool (*pc_profile)(adiv5_access_port_s *ap, cortexm_pc_profile_s *profile, uint32_t duration_ms);
+	/* The probe's own DP, AP and memory routines, when the wire trace recorder has been put in front of them */
+	const struct bmda_wire_trace_ops *wire_trace;
 #endif
 	uint32_t (*ap_read)(adiv5_access_port_s *ap, uint16_t addr);
 	void (*ap_write)(adiv5_access_port_s *ap, uint16_t addr, uint32_t value);
@@ -225,6 +272,8 @@ struct adiv5_debug_port {
 
 	/* DPv2 specific target selection value */
 	uint32_t targetsel;
+	/* The last value written to CTRL/STAT, so its request bits can be restored after overrun detection is toggled */
+	uint32_t ctrlstat;
 
 	/* DP designer (not implementer!) and partno */
 	uint16_t designer_code;
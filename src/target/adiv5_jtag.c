@@ -30,6 +30,7 @@
 #include "jtag_scan.h"
 #include "jtagtap.h"
 #include "morse.h"
+#include "perf.h"
 
 #define JTAG_ACK_WAIT        0x01U
 #define JTAG_ADIv5_ACK_OK    0x02U
@@ -123,6 +124,7 @@ uint32_t adiv5_jtag_raw_access(
 	uint8_t ack;
 
 	/* Set the instruction to the correct one for the kind of access needed */
+	const uint32_t start = perf_now();
 	jtag_dev_write_ir(dp->dev_index, (addr & ADIV5_APnDP) ? IR_APACC : IR_DPACC);
 
 	platform_timeout_s timeout;
@@ -135,7 +137,10 @@ uint32_t adiv5_jtag_raw_access(
 		result = (uint32_t)(response >> 3U);
 		/* Then the acknowledgement code */
 		ack = (uint8_t)(response & 0x07U);
+		if (ack == JTAG_ACK_WAIT)
+			perf_count(PERF_JTAG_WAIT, 0U);
 	} while (!platform_timeout_is_expired(&timeout) && ack == JTAG_ACK_WAIT);
+	perf_record(PERF_JTAG_TRANSACTION, start, 0U);
 
 	/*
 	 * If even after waiting for the 250ms we still get a WAIT response,
@@ -30,6 +30,7 @@
 #include "swd.h"
 #include "target.h"
 #include "target_internal.h"
+#include "perf.h"
 
 uint8_t make_packet_request(const uint8_t rnw, const uint16_t addr)
 {
@@ -175,6 +176,7 @@ bool adiv5_swd_scan(const uint32_t targetid)
 
 #if CONFIG_BMDA == 0
 	swdptap_init();
+	adiv5_swd_batch_init(dp);
 #else
 	if (!bmda_swd_dp_init(dp)) {
 		free(dp);
@@ -398,7 +400,8 @@ uint32_t adiv5_swd_clear_error(adiv5_debug_port_s *const dp, const bool protocol
 			ADIV5_DP_CTRLSTAT_WDATAERR);
 }
 
-uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+static uint32_t adiv5_swd_transaction(
+	adiv5_debug_port_s *const dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
 {
 	if ((addr & ADIV5_APnDP) && dp->fault)
 		return 0;
@@ -411,7 +414,10 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 	do {
 		swd_proc.seq_out(request, 8U);
 		ack = swd_proc.seq_in(3U);
+		if (ack == SWD_ACK_WAIT)
+			perf_count(PERF_SWD_WAIT, 0U);
 		if (ack == SWD_ACK_FAULT) {
+			perf_count(PERF_SWD_FAULT, 0U);
 			DEBUG_ERROR("SWD access resulted in fault, retrying\n");
 			/* On fault, abort the request and repeat */
 			/* Yes, this is self-recursive.. no, we can't think of a better option */
@@ -468,7 +474,394 @@ uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const u
 	return response;
 }
 
+uint32_t adiv5_swd_raw_access(adiv5_debug_port_s *dp, const uint8_t rnw, const uint16_t addr, const uint32_t value)
+{
+	const uint32_t start = perf_now();
+	const uint32_t response = adiv5_swd_transaction(dp, rnw, addr, value);
+	perf_record(PERF_SWD_TRANSACTION, start, 0U);
+	return response;
+}
+
 void adiv5_swd_abort(adiv5_debug_port_s *dp, uint32_t abort)
 {
 	adiv5_dp_write(dp, ADIV5_DP_ABORT, abort);
 }
+
+/* Each op can need an extra RDBUFF read to collect a posted AP read, plus one to collect the last one */
+#define ADIV5_SWD_BATCH_MAX_FRAMES ((ADIV5_BATCH_MAX_OPS * 2U) + 1U)
+
+/*
+ * Turn a run of DP/AP operations into the SWD transactions needed to perform them. AP reads are posted,
+ * so the result of each one is returned by the next AP read. If something other than an AP read follows
+ * (or it's the last operation), the result is instead collected with a read of RDBUFF.
+ */
+static size_t adiv5_swd_batch_frames(
+	const adiv5_batch_op_s *const ops, const size_t count, adiv5_batch_op_s *const frames)
+{
+	size_t frame = 0U;
+	uint32_t *pending = NULL;
+	for (size_t i = 0U; i < count; ++i) {
+		const adiv5_batch_op_s *const op = &ops[i];
+		if (op->rnw && (op->addr & ADIV5_APnDP)) {
+			frames[frame] = *op;
+			frames[frame++].result = pending;
+			pending = op->result;
+			continue;
+		}
+		if (pending) {
+			frames[frame++] = (adiv5_batch_op_s){ADIV5_DP_RDBUFF, ADIV5_LOW_READ, 0U, pending};
+			pending = NULL;
+		}
+		frames[frame++] = *op;
+	}
+	if (pending)
+		frames[frame++] = (adiv5_batch_op_s){ADIV5_DP_RDBUFF, ADIV5_LOW_READ, 0U, pending};
+	return frame;
+}
+
+/* The CTRL/STAT value last written through adiv5_dp_write(), with overrun detection turned on or off */
+static uint32_t adiv5_swd_ctrlstat_value(const adiv5_debug_port_s *const dp, const bool overrun_detect)
+{
+	return (dp->ctrlstat & ~ADIV5_DP_CTRLSTAT_ORUNDETECT) | (overrun_detect ? ADIV5_DP_CTRLSTAT_ORUNDETECT : 0U);
+}
+
+static swd_transaction_s adiv5_swd_ctrlstat_transaction(const adiv5_debug_port_s *const dp, const bool overrun_detect)
+{
+	return (swd_transaction_s){
+		.request = make_packet_request(ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT),
+		.data = adiv5_swd_ctrlstat_value(dp, overrun_detect),
+	};
+}
+
+/* Clear the sticky error flags a failed batch left behind and turn overrun detection back off */
+static void adiv5_swd_batch_recover(const adiv5_debug_port_s *const dp, platform_timeout_s *const timeout)
+{
+	swd_transaction_s transactions[2] = {
+		{
+			.request = make_packet_request(ADIV5_LOW_WRITE, ADIV5_DP_ABORT),
+			.data = ADIV5_DP_ABORT_ORUNERRCLR | ADIV5_DP_ABORT_WDERRCLR | ADIV5_DP_ABORT_STKERRCLR |
+				ADIV5_DP_ABORT_STKCMPCLR,
+		},
+		adiv5_swd_ctrlstat_transaction(dp, false),
+	};
+	/* The CTRL/STAT write can see WAIT if the AP is still busy, so retry until it goes through */
+	do {
+		if (!swd_proc.batch(transactions, 2U))
+			raise_exception(EXCEPTION_ERROR, "SWD batch failed");
+	} while (transactions[1].ack == SWD_ACK_WAIT && !platform_timeout_is_expired(timeout));
+}
+
+/* Report a transaction in a batch that failed for good, in the same way adiv5_swd_raw_access() would */
+static bool adiv5_swd_batch_error(adiv5_debug_port_s *const dp, const uint8_t ack)
+{
+	if (ack == SWD_ACK_WAIT) {
+		DEBUG_ERROR("SWD access resulted in wait, aborting\n");
+		dp->abort(dp, ADIV5_DP_ABORT_DAPABORT);
+		dp->fault = ack;
+		return false;
+	}
+	if (ack == SWD_ACK_FAULT) {
+		DEBUG_ERROR("SWD access resulted in fault\n");
+		dp->fault = ack;
+		return false;
+	}
+	if (ack == SWD_ACK_NO_RESPONSE) {
+		DEBUG_ERROR("SWD access resulted in no response\n");
+		dp->fault = ack;
+		return false;
+	}
+	DEBUG_ERROR("SWD access has invalid ack %x\n", ack);
+	raise_exception(EXCEPTION_ERROR, "SWD invalid ACK");
+	return false;
+}
+
+/*
+ * Run the transactions for a batch with overrun detection turned on for the duration, so the adaptor can
+ * clock them all out without inspecting each ACK. If any transaction does not get an OK, the DP flags an
+ * overrun and ignores everything after it, so we clear that and pick back up from the failed transaction.
+ */
+static bool adiv5_swd_batch_run_overrun(
+	adiv5_debug_port_s *const dp, const adiv5_batch_op_s *const frames, const size_t count)
+{
+	swd_transaction_s transactions[ADIV5_SWD_BATCH_MAX_FRAMES + 2U];
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 250U);
+	bool fault_retried = false;
+	size_t begin = 0U;
+	while (true) {
+		/* Bracket the frames left to do with turning overrun detection on and then back off */
+		size_t total = 0U;
+		transactions[total++] = adiv5_swd_ctrlstat_transaction(dp, true);
+		for (size_t frame = begin; frame < count; ++frame) {
+			transactions[total++] = (swd_transaction_s){
+				.request = make_packet_request(frames[frame].rnw, frames[frame].addr),
+				.data = frames[frame].value,
+			};
+		}
+		transactions[total++] = adiv5_swd_ctrlstat_transaction(dp, false);
+		if (!swd_proc.batch(transactions, total))
+			raise_exception(EXCEPTION_ERROR, "SWD batch failed");
+
+		/* Collect results up to the first transaction that didn't succeed */
+		size_t index = 0U;
+		for (; index < total && transactions[index].ack == SWD_ACK_OK; ++index) {
+			if (index == 0U || index == total - 1U)
+				continue;
+			const adiv5_batch_op_s *const frame = &frames[begin + index - 1U];
+			if (!frame->rnw)
+				continue;
+			if (!transactions[index].parity_ok) {
+				adiv5_swd_batch_recover(dp, &timeout);
+				dp->fault = 1U;
+				DEBUG_ERROR("SWD access resulted in parity error\n");
+				raise_exception(EXCEPTION_ERROR, "SWD parity error");
+			}
+			if (frame->result)
+				*frame->result = transactions[index].data;
+		}
+		if (index == total)
+			return true;
+
+		const uint8_t ack = transactions[index].ack;
+		adiv5_swd_batch_recover(dp, &timeout);
+		/* If it was only turning overrun detection back off that failed, everything else went through */
+		if (index == total - 1U)
+			return true;
+		/* Otherwise, pick back up from the transaction that failed */
+		if (index)
+			begin += index - 1U;
+		if (ack == SWD_ACK_WAIT && !platform_timeout_is_expired(&timeout))
+			continue;
+		if (ack == SWD_ACK_FAULT && !fault_retried) {
+			DEBUG_ERROR("SWD access resulted in fault, retrying\n");
+			fault_retried = true;
+			continue;
+		}
+
+		return adiv5_swd_batch_error(dp, ack);
+	}
+}
+
+/* Run up to ADIV5_BATCH_MAX_OPS operations, see adiv5_swd_batch_run() */
+static bool adiv5_swd_batch_run_chunk(
+	adiv5_debug_port_s *const dp, const adiv5_batch_op_s *const ops, const size_t count)
+{
+	adiv5_batch_op_s frames[ADIV5_SWD_BATCH_MAX_FRAMES];
+	const size_t frame_count = adiv5_swd_batch_frames(ops, count, frames);
+	if (swd_proc.batch)
+		return adiv5_swd_batch_run_overrun(dp, frames, frame_count);
+
+	for (size_t i = 0U; i < frame_count; ++i) {
+		const adiv5_batch_op_s *const frame = &frames[i];
+		const uint32_t value = adiv5_dp_low_access(dp, frame->rnw, frame->addr, frame->value);
+		if (dp->fault)
+			return false;
+		if (frame->result)
+			*frame->result = value;
+	}
+	return true;
+}
+
+/*
+ * Run a batch of DP/AP operations. Adaptors that implement swd_proc.batch get the batch in one go (or in
+ * ADIV5_BATCH_MAX_OPS sized chunks if it is longer than that), otherwise each transaction is performed using
+ * low_access, still saving the RDBUFF read per AP read that going through adiv5_dp_read() would need.
+ */
+bool adiv5_swd_batch_run(adiv5_debug_port_s *const dp, const adiv5_batch_op_s *const ops, const size_t count)
+{
+	if (dp->fault)
+		return false;
+	for (size_t offset = 0U; offset < count; offset += ADIV5_BATCH_MAX_OPS) {
+		if (!adiv5_swd_batch_run_chunk(dp, ops + offset, MIN(count - offset, ADIV5_BATCH_MAX_OPS)))
+			return false;
+	}
+	return true;
+}
+
+/* Number of transactions handed to swd_proc.batch at a time while streaming */
+#define ADIV5_SWD_STREAM_CHUNK (ADIV5_BATCH_MAX_OPS * 2U)
+
+typedef struct adiv5_swd_stream {
+	swd_transaction_s transactions[ADIV5_SWD_STREAM_CHUNK];
+	/* Where the data read by each transaction should be stored, if anywhere */
+	void *results[ADIV5_SWD_STREAM_CHUNK];
+	size_t count;
+	/* How many transactions were run before the ones presently queued */
+	size_t offset;
+	/* The index and ACK of the first transaction that did not get an OK */
+	size_t failed_index;
+	uint8_t failed_ack;
+	/* The index of a transaction whose ACK the caller needs, and that ACK once the transaction has run */
+	size_t check_index;
+	uint8_t check_ack;
+	bool parity_error;
+} adiv5_swd_stream_s;
+
+static void adiv5_swd_stream_init(adiv5_swd_stream_s *const stream)
+{
+	stream->count = 0U;
+	stream->offset = 0U;
+	stream->failed_index = SIZE_MAX;
+	stream->failed_ack = SWD_ACK_OK;
+	stream->check_index = SIZE_MAX;
+	stream->check_ack = SWD_ACK_OK;
+	stream->parity_error = false;
+}
+
+/* Run everything queued on the stream, leaving the transactions in place so the caller can inspect them */
+static void adiv5_swd_stream_flush(adiv5_swd_stream_s *const stream)
+{
+	if (!swd_proc.batch(stream->transactions, stream->count))
+		raise_exception(EXCEPTION_ERROR, "SWD batch failed");
+	for (size_t i = 0U; i < stream->count; ++i) {
+		const swd_transaction_s *const transaction = &stream->transactions[i];
+		/* The chunk this transaction lands in is not known when it is queued, so pick up its ACK here */
+		if (stream->offset + i == stream->check_index)
+			stream->check_ack = transaction->ack;
+		if (transaction->ack != SWD_ACK_OK) {
+			if (stream->failed_index == SIZE_MAX) {
+				stream->failed_index = stream->offset + i;
+				stream->failed_ack = transaction->ack;
+			}
+			continue;
+		}
+		if (!stream->results[i])
+			continue;
+		if (!transaction->parity_ok)
+			stream->parity_error = true;
+		memcpy(stream->results[i], &transaction->data, sizeof(transaction->data));
+	}
+}
+
+static void adiv5_swd_stream_queue(adiv5_swd_stream_s *const stream, const uint8_t rnw, const uint16_t addr,
+	const uint32_t value, void *const result)
+{
+	if (stream->count == ADIV5_SWD_STREAM_CHUNK) {
+		adiv5_swd_stream_flush(stream);
+		stream->offset += stream->count;
+		stream->count = 0U;
+	}
+	stream->transactions[stream->count] = (swd_transaction_s){
+		.request = make_packet_request(rnw, addr),
+		.data = value,
+	};
+	stream->results[stream->count++] = result;
+}
+
+/* Queue turning overrun detection on and pointing TAR at the start of the data to stream */
+static void adiv5_swd_stream_begin(
+	adiv5_swd_stream_s *const stream, const adiv5_access_port_s *const ap, const target_addr64_t addr)
+{
+	adiv5_swd_stream_init(stream);
+	adiv5_swd_stream_queue(stream, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, adiv5_swd_ctrlstat_value(ap->dp, true), NULL);
+	if (ap->flags & ADIV5_AP_FLAGS_64BIT)
+		adiv5_swd_stream_queue(stream, ADIV5_LOW_WRITE, ADIV5_AP_TAR_HIGH, (uint32_t)(addr >> 32U), NULL);
+	adiv5_swd_stream_queue(stream, ADIV5_LOW_WRITE, ADIV5_AP_TAR_LOW, (uint32_t)addr, NULL);
+}
+
+/*
+ * Read count words from addr, which must all be within the same 1kiB TAR auto-increment page, with CSW already
+ * set up. The DRW reads are issued back to back with overrun detection on, then the sticky flags in CTRL/STAT are
+ * checked once for the whole page. If an overrun occurred (some access got a WAIT), the page is read again.
+ */
+bool adiv5_swd_stream_read(
+	adiv5_access_port_s *const ap, const target_addr64_t addr, void *const dest, const size_t count)
+{
+	adiv5_debug_port_s *const dp = ap->dp;
+	if (dp->fault || !count)
+		return !dp->fault;
+	uint8_t *const data = (uint8_t *)dest;
+	adiv5_swd_stream_s stream;
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 250U);
+	while (true) {
+		adiv5_swd_stream_begin(&stream, ap, addr);
+		/* AP reads are posted, so each read returns the data for the one before it, and RDBUFF the last */
+		for (size_t i = 0U; i < count; ++i)
+			adiv5_swd_stream_queue(&stream, ADIV5_LOW_READ, ADIV5_AP_DRW, 0U, i ? data + ((i - 1U) * 4U) : NULL);
+		adiv5_swd_stream_queue(&stream, ADIV5_LOW_READ, ADIV5_DP_RDBUFF, 0U, data + ((count - 1U) * 4U));
+		/* CTRL/STAT can be read even with an overrun flagged, so use it to check the whole page */
+		uint32_t status = 0U;
+		stream.check_index = stream.offset + stream.count;
+		adiv5_swd_stream_queue(&stream, ADIV5_LOW_READ, ADIV5_DP_CTRLSTAT, 0U, &status);
+		adiv5_swd_stream_queue(&stream, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, adiv5_swd_ctrlstat_value(dp, false), NULL);
+		adiv5_swd_stream_flush(&stream);
+
+		/* If we couldn't even read CTRL/STAT, the link is in trouble */
+		const uint8_t status_ack = stream.check_ack;
+		if (status_ack != SWD_ACK_OK) {
+			adiv5_swd_batch_recover(dp, &timeout);
+			return adiv5_swd_batch_error(dp, status_ack);
+		}
+		if (!(status & (ADIV5_DP_CTRLSTAT_STICKYORUN | ADIV5_DP_CTRLSTAT_STICKYERR)) && !stream.parity_error)
+			return true;
+
+		adiv5_swd_batch_recover(dp, &timeout);
+		if (status & ADIV5_DP_CTRLSTAT_STICKYERR)
+			return adiv5_swd_batch_error(dp, SWD_ACK_FAULT);
+		if (platform_timeout_is_expired(&timeout))
+			return adiv5_swd_batch_error(dp, SWD_ACK_WAIT);
+		DEBUG_PROBE("%s: %s, retrying page at %08" PRIx32 "\n", __func__,
+			stream.parity_error ? "parity error" : "overrun", (uint32_t)addr);
+	}
+}
+
+/*
+ * Write count words to addr, which must all be within the same 1kiB TAR auto-increment page, with CSW already
+ * set up. As with adiv5_swd_stream_read() the DRW writes are issued back to back with overrun detection on, however
+ * writes (e.g. to Flash) are not necessarily safe to repeat, so on overrun this restarts from the write that
+ * failed rather than redoing the whole page.
+ */
+bool adiv5_swd_stream_write(
+	adiv5_access_port_s *const ap, const target_addr64_t addr, const void *const src, const size_t count)
+{
+	adiv5_debug_port_s *const dp = ap->dp;
+	if (dp->fault)
+		return false;
+	const uint8_t *const data = (const uint8_t *)src;
+	adiv5_swd_stream_s stream;
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 250U);
+	bool fault_retried = false;
+	size_t written = 0U;
+	while (written < count) {
+		adiv5_swd_stream_begin(&stream, ap, addr + (written * 4U));
+		const size_t header = stream.count;
+		for (size_t i = written; i < count; ++i) {
+			uint32_t value = 0U;
+			memcpy(&value, data + (i * 4U), sizeof(value));
+			adiv5_swd_stream_queue(&stream, ADIV5_LOW_WRITE, ADIV5_AP_DRW, value, NULL);
+		}
+		adiv5_swd_stream_queue(&stream, ADIV5_LOW_WRITE, ADIV5_DP_CTRLSTAT, adiv5_swd_ctrlstat_value(dp, false), NULL);
+		adiv5_swd_stream_flush(&stream);
+		if (stream.failed_index == SIZE_MAX)
+			return true;
+
+		adiv5_swd_batch_recover(dp, &timeout);
+		/* Work out how many of the writes were accepted before the failure */
+		if (stream.failed_index >= header + (count - written))
+			return true;
+		if (stream.failed_index > header)
+			written += stream.failed_index - header;
+		if (stream.failed_ack == SWD_ACK_WAIT && !platform_timeout_is_expired(&timeout))
+			continue;
+		if (stream.failed_ack == SWD_ACK_FAULT && !fault_retried) {
+			DEBUG_ERROR("SWD access resulted in fault, retrying\n");
+			fault_retried = true;
+			continue;
+		}
+		return adiv5_swd_batch_error(dp, stream.failed_ack);
+	}
+	return true;
+}
+
+/* Hook up batched and streamed DP accesses for adaptors driven at the SWD bit level */
+void adiv5_swd_batch_init(adiv5_debug_port_s *const dp)
+{
+	dp->batch_run = adiv5_swd_batch_run;
+	/* Streaming relies on the adaptor being able to run whole batches of transactions without inspecting ACKs */
+	if (swd_proc.batch) {
+		dp->stream_read = adiv5_swd_stream_read;
+		dp->stream_write = adiv5_swd_stream_write;
+	}
+}
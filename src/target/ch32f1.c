@@ -140,17 +140,17 @@ static bool ch32f1_has_fast_unlock(target_s *const target)
 	DEBUG_INFO("CH32: has fast unlock\n");
 	// reset fast unlock
 	ch32f1_flash_ctrl_set(target, FLASH_CR_FLOCK_CH32);
-	platform_delay(1); // The flash controller is timing sensitive
+	target_paced_delay(1); // The flash controller is timing sensitive
 	if (!(target_mem32_read32(target, FLASH_CR) & FLASH_CR_FLOCK_CH32))
 		return false;
 	// send unlock sequence
 	target_mem32_write32(target, FLASH_KEYR, KEY1);
 	target_mem32_write32(target, FLASH_KEYR, KEY2);
-	platform_delay(1); // The flash controller is timing sensitive
+	target_paced_delay(1); // The flash controller is timing sensitive
 	// send fast unlock sequence
 	target_mem32_write32(target, FLASH_MODEKEYR_CH32, KEY1);
 	target_mem32_write32(target, FLASH_MODEKEYR_CH32, KEY2);
-	platform_delay(1); // The flash controller is timing sensitive
+	target_paced_delay(1); // The flash controller is timing sensitive
 	return !(target_mem32_read32(target, FLASH_CR) & FLASH_CR_FLOCK_CH32);
 }
 
@@ -268,7 +268,7 @@ static bool ch32f1_wait_flash_ready(target_s *const target, const target_addr32_
 {
 	uint32_t flash_val = 0;
 	/* Certain ch32f103c8t6 MCU's found on Blue Pill boards need some uninterrupted time (no SWD link activity) */
-	platform_delay(2);
+	target_paced_delay(2);
 	for (size_t attempts = 0; attempts < 32U && flash_val != 0xffffffffU; ++attempts)
 		flash_val = target_mem32_read32(target, addr);
 	if (flash_val != 0xffffffffU) {
@@ -59,6 +59,10 @@
 
 #include <assert.h>
 
+#define CORTEXAR_TRANSLATION_CACHE_SIZE 8U
+#define CORTEXAR_PAGE_SIZE              0x1000U
+#define CORTEXAR_PAGE_MASK              0xfffff000U
+
 typedef struct cortexar_priv {
 	/* Base core information */
 	cortex_priv_s base;
@@ -78,6 +82,21 @@ typedef struct cortexar_priv {
 
 	/* Control and status information */
 	uint8_t core_status;
+
+	/* MEM-AP onto the system bus, if one was found on the same DP, for accessing memory without the core */
+	adiv5_access_port_s *sys_ap;
+	/* Whether the MMU was on when the core last halted (always assumed on for VMSA until known) */
+	bool mmu_enabled;
+
+	/* Page-granular virtual to physical translation cache, only valid while the core remains halted */
+	struct {
+		uint32_t virt_page;
+		uint32_t phys_page;
+		/* Whether the page was translated for writing (and so is known to be writable) */
+		bool writable;
+	} translations[CORTEXAR_TRANSLATION_CACHE_SIZE];
+	uint8_t translation_count;
+	uint8_t translation_next;
 } cortexar_priv_s;
 
 #define CORTEXAR_DBG_IDR   0x000U /* ID register */
@@ -293,6 +312,7 @@ static const uint16_t cortexar_spsr_encodings[5] = {
 
 /* Instruction encodings for synchronisation barriers */
 #define ARM_ISB_INSN 0xe57ff06fU
+#define ARM_DSB_INSN 0xf57ff04fU
 
 /* Coprocessor register definitions */
 
@@ -314,8 +334,14 @@ static const uint16_t cortexar_spsr_encodings[5] = {
 #define CORTEXAR_ICIALLU 15U, ENCODE_CP_REG(7U, 5U, 0U, 0U)
 /* Data Cache Clean + Invalidate by Set/Way to Unification */
 #define CORTEXAR_DCCISW 15U, ENCODE_CP_REG(7U, 14U, 0U, 2U)
+/* Data Cache Clean by MVA to Point of Coherency */
+#define CORTEXAR_DCCMVAC 15U, ENCODE_CP_REG(7U, 10U, 0U, 1U)
+/* Data Cache Clean + Invalidate by MVA to Point of Coherency */
+#define CORTEXAR_DCCIMVAC 15U, ENCODE_CP_REG(7U, 14U, 0U, 1U)
 /* Address Translate Stage 1 Current state PL1 Read */
 #define CORTEXAR_ATS1CPR 15U, ENCODE_CP_REG(7U, 8U, 0U, 0U)
+/* Address Translate Stage 1 Current state PL1 Write */
+#define CORTEXAR_ATS1CPW 15U, ENCODE_CP_REG(7U, 8U, 0U, 1U)
 
 /* SCTLR System Control Register */
 #define CORTEXAR_SCTLR 15U, ENCODE_CP_REG(1U, 0U, 0U, 0U)
@@ -628,6 +654,48 @@ static uint32_t cortexar_coproc_read(target_s *const target, const uint8_t copro
 	return result;
 }
 
+static inline void cortexar_translation_cache_flush(cortexar_priv_s *const priv)
+{
+	priv->translation_count = 0U;
+	priv->translation_next = 0U;
+}
+
+static bool cortexar_translation_cache_lookup(const cortexar_priv_s *const priv, const target_addr_t virt_addr,
+	const bool write, target_addr_t *const phys_addr)
+{
+	const uint32_t virt_page = virt_addr & CORTEXAR_PAGE_MASK;
+	for (uint8_t i = 0U; i < priv->translation_count; ++i) {
+		/* A page only translated for reading may still fault on write, so that needs a fresh translation */
+		if (priv->translations[i].virt_page == virt_page && (priv->translations[i].writable || !write)) {
+			*phys_addr = priv->translations[i].phys_page | (virt_addr & ~CORTEXAR_PAGE_MASK);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void cortexar_translation_cache_insert(
+	cortexar_priv_s *const priv, const target_addr_t virt_addr, const target_addr_t phys_addr, const bool writable)
+{
+	const uint32_t virt_page = virt_addr & CORTEXAR_PAGE_MASK;
+	/* If the page is already present (translated for reading), upgrade that entry */
+	for (uint8_t i = 0U; i < priv->translation_count; ++i) {
+		if (priv->translations[i].virt_page == virt_page) {
+			priv->translations[i].phys_page = phys_addr & CORTEXAR_PAGE_MASK;
+			priv->translations[i].writable |= writable;
+			return;
+		}
+	}
+	/* Otherwise replace entries round-robin once the cache is full */
+	const uint8_t slot = priv->translation_next;
+	priv->translations[slot].virt_page = virt_page;
+	priv->translations[slot].phys_page = phys_addr & CORTEXAR_PAGE_MASK;
+	priv->translations[slot].writable = writable;
+	priv->translation_next = (slot + 1U) % CORTEXAR_TRANSLATION_CACHE_SIZE;
+	if (priv->translation_count < CORTEXAR_TRANSLATION_CACHE_SIZE)
+		++priv->translation_count;
+}
+
 static void cortexar_coproc_write(target_s *const target, const uint8_t coproc, const uint16_t op, const uint32_t value)
 {
 	DEBUG_PROTO("%s: coproc %u (%04x): %08" PRIx32 "\n", __func__, coproc, op, value);
@@ -643,13 +711,29 @@ static void cortexar_coproc_write(target_s *const target, const uint8_t coproc,
 	cortexar_run_insn(target,
 		ARM_MCR_INSN |
 			ENCODE_CP_ACCESS(coproc & 0xfU, (op >> 8U) & 0x7U, 0U, (op >> 4U) & 0xfU, op & 0xfU, (op >> 12U) & 0x7U));
+
+	/*
+	 * Writes to the system control (c1), translation table base/control (c2), domain access (c3),
+	 * TLB maintenance (c8) and context ID (c13) registers can all change the address translation
+	 * regime, so make sure we don't use any stale translations after one.
+	 */
+	const uint8_t crn = (op >> 4U) & 0xfU;
+	if (coproc == 15U && (crn == 1U || crn == 2U || crn == 3U || crn == 8U || crn == 13U)) {
+		cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+		cortexar_translation_cache_flush(priv);
+		/* If SCTLR was written we can no longer be sure if the MMU is off */
+		if (crn == 1U && (target->target_options & TOPT_FLAVOUR_VIRT_MEM))
+			priv->mmu_enabled = true;
+	}
 }
 
 /*
- * Perform a virtual to physical address translation.
+ * Perform a virtual to physical address translation, checking the page can be written if write is true.
+ * Translations are cached per 4KiB page until the core is next resumed or reset, or
+ * the translation regime is changed, so only the first access to each page costs a lookup.
  * NB: Halts target if needed to ensure operations succeed. Trashes r0.
  */
-static target_addr_t cortexar_virt_to_phys(target_s *const target, const target_addr_t virt_addr)
+static target_addr_t cortexar_virt_to_phys(target_s *const target, const target_addr_t virt_addr, const bool write)
 {
 	/* Check if the target is PMSA and return early if it is */
 	if (!(target->target_options & TOPT_FLAVOUR_VIRT_MEM))
@@ -658,44 +742,68 @@ static target_addr_t cortexar_virt_to_phys(target_s *const target, const target_
 	/* Halt if not already halted to ensure coproc read/write operations succeed */
 	const bool halted_in_function = cortexar_halt_and_wait(target);
 
-	/* Check if MMU is turned on; if not, return the virt_addr as-is. */
-	const uint32_t sctlr = cortexar_coproc_read(target, CORTEXAR_SCTLR);
-	if (!(sctlr & CORTEXAR_SCTLR_MMU_ENABLED)) {
-		/* Ensure we resume if we halted above, prior to returning. */
-		if (halted_in_function)
-			cortexar_halt_resume(target, false);
-		return virt_addr;
-	}
-
-	/*
-	 * Now we know the target is VMSA and so has the address translation machinery,
-	 * start by loading r0 with the VA to translate and request its translation
-	 */
-	cortexar_core_reg_write(target, 0U, virt_addr);
-	cortexar_coproc_write(target, CORTEXAR_ATS1CPR, 0U);
-	/*
-	 * Ensure that's complete with a sync barrier, then read the result back
-	 * from the physical address register into r0 so we can extract the result
-	 */
-	cortexar_run_insn(target, ARM_ISB_INSN);
-	cortexar_coproc_read(target, CORTEXAR_PAR32);
+	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	/* Check if MMU is turned on (as recorded at halt); if not, return the virt_addr as-is. */
+	target_addr_t address = virt_addr;
+	if (priv->mmu_enabled && !cortexar_translation_cache_lookup(priv, virt_addr, write, &address)) {
+		/*
+		 * Now we know the target is VMSA and so has the address translation machinery,
+		 * start by loading r0 with the VA to translate and request its translation
+		 */
+		cortexar_core_reg_write(target, 0U, virt_addr);
+		if (write)
+			cortexar_coproc_write(target, CORTEXAR_ATS1CPW, 0U);
+		else
+			cortexar_coproc_write(target, CORTEXAR_ATS1CPR, 0U);
+		/*
+		 * Ensure that's complete with a sync barrier, then read the result back
+		 * from the physical address register into r0 so we can extract the result
+		 */
+		cortexar_run_insn(target, ARM_ISB_INSN);
+		cortexar_coproc_read(target, CORTEXAR_PAR32);
 
-	const uint32_t phys_addr = cortexar_core_reg_read(target, 0U);
-	/* Check if the MMU indicated a translation failure, marking a fault if it did */
-	if (phys_addr & CORTEXAR_PAR32_FAULT) {
-		cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
-		priv->core_status |= CORTEXAR_STATUS_MMU_FAULT;
+		const uint32_t phys_addr = cortexar_core_reg_read(target, 0U);
+		/* Form the physical address from the top 20 bits of PAR and the bottom 12 of the virtual one */
+		address = (phys_addr & CORTEXAR_PAGE_MASK) | (virt_addr & ~CORTEXAR_PAGE_MASK);
+		/* Check if the MMU indicated a translation failure, marking a fault if it did, otherwise cache the result */
+		if (phys_addr & CORTEXAR_PAR32_FAULT)
+			priv->core_status |= CORTEXAR_STATUS_MMU_FAULT;
+		else
+			cortexar_translation_cache_insert(priv, virt_addr, address, write);
 	}
 
-	/* Convert the physical address to a virtual one using the top 20 bits of PAR and the bottom 12 of the virtual. */
-	const target_addr_t address = (phys_addr & 0xfffff000U) | (virt_addr & 0x00000fffU);
-
 	if (halted_in_function)
 		cortexar_halt_resume(target, false);
 
 	return address;
 }
 
+static void cortexar_priv_free(void *const priv)
+{
+	cortexar_priv_s *const cortexar_priv = (cortexar_priv_s *)priv;
+	if (cortexar_priv->sys_ap)
+		adiv5_ap_unref(cortexar_priv->sys_ap);
+	cortex_priv_free(priv);
+}
+
+/*
+ * Hand a system bus MEM-AP found on a DP to the Cortex-A/R cores on that same DP, so their
+ * memory accesses can go straight to the bus rather than being run as instructions on the core.
+ */
+void cortexar_add_system_ap(adiv5_access_port_s *const ap)
+{
+	for (target_s *target = target_list; target; target = target->next) {
+		if (target->priv_free != cortexar_priv_free)
+			continue;
+		cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+		if (priv->sys_ap || priv->base.ap->dp != ap->dp)
+			continue;
+		adiv5_ap_ref(ap);
+		priv->sys_ap = ap;
+		DEBUG_INFO("%s: Using AP %u for system bus memory access\n", target->driver, ap->apsel);
+	}
+}
+
 static bool cortexar_oslock_unlock(target_s *const target)
 {
 	const uint32_t lock_status = cortex_dbg_read32(target, CORTEXAR_DBG_OSLSR);
@@ -782,9 +890,11 @@ static target_s *cortexar_probe(
 
 	target->driver = core_type;
 	target->priv = priv;
-	target->priv_free = cortex_priv_free;
+	target->priv_free = cortexar_priv_free;
 	priv->base.ap = ap;
 	priv->base.base_addr = base_address;
+	/* Until the core halts and we can check, assume any MMU present is on */
+	priv->mmu_enabled = true;
 
 	target->reset = cortexar_reset;
 	target->halt_request = cortexar_halt_request;
@@ -1094,38 +1204,141 @@ static void cortexar_mem_handle_fault(target_s *const target, const char *const
 	}
 }
 
+/*
+ * Perform D-cache maintenance by MVA over a range of memory about to be accessed via the system bus AP.
+ * NB: This requires the core to be halted. Trashes r0.
+ */
+static void cortexar_sys_cache_maintain(
+	target_s *const target, const target_addr_t addr, const size_t len, const uint8_t coproc, const uint16_t op)
+{
+	const cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	if (!priv->base.dcache_line_length || !len)
+		return;
+	const target_addr_t line_length = priv->base.dcache_line_length << 2U;
+	const target_addr_t end = addr + len;
+	for (target_addr_t line = addr & ~(line_length - 1U); line < end; line += line_length)
+		cortexar_coproc_write(target, coproc, op, line);
+	/* Make sure the maintenance has completed before the access goes out on the bus */
+	cortexar_run_insn(target, ARM_DSB_INSN);
+}
+
+/*
+ * Read memory through the system bus AP, cleaning the D-cache lines involved first if clean is true.
+ * With the MMU on, this goes a page at a time, translating each page's address first and only touching
+ * the cache for it once that has succeeded. NB: This requires the core to be halted if the MMU is on
+ * or clean is true. Trashes r0.
+ */
+static void cortexar_sys_mem_read(
+	target_s *const target, void *const dest, const target_addr_t src, const size_t len, const bool clean)
+{
+	const cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	/* With the MMU off (or absent), the system bus sees the same addresses as the core */
+	if (!(target->target_options & TOPT_FLAVOUR_VIRT_MEM) || !priv->mmu_enabled) {
+		if (clean)
+			cortexar_sys_cache_maintain(target, src, len, CORTEXAR_DCCMVAC);
+		/* Make sure the DP isn't left in banked mode from DCC accesses to the debug unit */
+		priv->sys_ap->dp->quirks &= ~ADIV5_AP_ACCESS_BANKED;
+		adiv5_mem_read(priv->sys_ap, dest, src, len);
+		return;
+	}
+
+	uint8_t *const data = (uint8_t *)dest;
+	for (size_t offset = 0U; offset < len;) {
+		const target_addr_t virt_addr = src + offset;
+		const size_t amount = MIN(len - offset, CORTEXAR_PAGE_SIZE - (virt_addr & ~CORTEXAR_PAGE_MASK));
+		const target_addr_t phys_addr = cortexar_virt_to_phys(target, virt_addr, false);
+		/* If the page isn't mapped, stop here - the fault will be reported via check_error */
+		if (priv->core_status & CORTEXAR_STATUS_MMU_FAULT)
+			return;
+		if (clean)
+			cortexar_sys_cache_maintain(target, virt_addr, amount, CORTEXAR_DCCMVAC);
+		priv->sys_ap->dp->quirks &= ~ADIV5_AP_ACCESS_BANKED;
+		adiv5_mem_read(priv->sys_ap, data + offset, phys_addr, amount);
+		offset += amount;
+	}
+}
+
+/*
+ * Write memory through the system bus AP, cleaning and invalidating the D-cache lines involved first.
+ * Addresses are translated a page at a time as for reads, checking each page can be written.
+ * NB: This requires the core to be halted. Trashes r0.
+ */
+static void cortexar_sys_mem_write(
+	target_s *const target, const target_addr_t dest, const void *const src, const size_t len)
+{
+	const cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	if (!(target->target_options & TOPT_FLAVOUR_VIRT_MEM) || !priv->mmu_enabled) {
+		cortexar_sys_cache_maintain(target, dest, len, CORTEXAR_DCCIMVAC);
+		priv->sys_ap->dp->quirks &= ~ADIV5_AP_ACCESS_BANKED;
+		adiv5_mem_write(priv->sys_ap, dest, src, len);
+		return;
+	}
+
+	const uint8_t *const data = (const uint8_t *)src;
+	for (size_t offset = 0U; offset < len;) {
+		const target_addr_t virt_addr = dest + offset;
+		const size_t amount = MIN(len - offset, CORTEXAR_PAGE_SIZE - (virt_addr & ~CORTEXAR_PAGE_MASK));
+		const target_addr_t phys_addr = cortexar_virt_to_phys(target, virt_addr, true);
+		if (priv->core_status & CORTEXAR_STATUS_MMU_FAULT)
+			return;
+		cortexar_sys_cache_maintain(target, virt_addr, amount, CORTEXAR_DCCIMVAC);
+		priv->sys_ap->dp->quirks &= ~ADIV5_AP_ACCESS_BANKED;
+		adiv5_mem_write(priv->sys_ap, phys_addr, data + offset, amount);
+		offset += amount;
+	}
+}
+
 /*
  * This reads memory by jumping from the debug unit bus to the system bus.
  * NB: This requires the core to be halted! Uses instruction launches on
  * the core and requires we're in debug mode to work. Trashes r0.
  * If core is not halted, temporarily halts target and resumes at the end
- * of the function.
+ * of the function. When a system bus AP is available, the access is
+ * instead done through that AP, translating addresses if the MMU is on.
  */
 static void cortexar_mem_read(target_s *const target, void *const dest, const target_addr64_t src, const size_t len)
 {
+	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+	/*
+	 * PMSA parts always deal in physical addresses, so if we have a system bus AP, read through
+	 * it directly - this works without having to halt the core, allowing live memory inspection.
+	 * If the core is running, any dirty lines in its D-cache are not visible to us this way.
+	 */
+	if (priv->sys_ap && !(target->target_options & TOPT_FLAVOUR_VIRT_MEM)) {
+		const bool halted = cortex_dbg_read32(target, CORTEXAR_DBG_DSCR) & CORTEXAR_DBG_DSCR_HALTED;
+		cortexar_sys_mem_read(target, dest, src, len, halted);
+		return;
+	}
+
 	/* If system is not halted, halt temporarily within this function. */
 	const bool halted_in_function = cortexar_halt_and_wait(target);
 
-	cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
-	/* Cache DFSR and DFAR in case we wind up triggering a data fault */
-	if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
-		priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
-		priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
-		priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
-	}
-	/* Clear any existing fault state */
-	priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
+	/* With the core halted, read through the system bus AP if we have one */
+	if (priv->sys_ap) {
+		/* Clear any existing fault state */
+		priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
+		cortexar_sys_mem_read(target, dest, src, len, true);
+	} else {
+		/* Cache DFSR and DFAR in case we wind up triggering a data fault */
+		if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
+			priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
+			priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
+			priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
+		}
+		/* Clear any existing fault state */
+		priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
 
-	/* Move the start address into the core's r0 */
-	cortexar_core_reg_write(target, 0U, src);
+		/* Move the start address into the core's r0 */
+		cortexar_core_reg_write(target, 0U, src);
 
-	/* If the address is 32-bit aligned and we're reading 32 bits at a time, use the fast path */
-	if ((src & 3U) == 0U && (len & 3U) == 0U)
-		cortexar_mem_read_fast(target, (uint32_t *)dest, len >> 2U);
-	else
-		cortexar_mem_read_slow(target, (uint8_t *)dest, src, len);
-	/* Deal with any data faults that occurred */
-	cortexar_mem_handle_fault(target, __func__);
+		/* If the address is 32-bit aligned and we're reading 32 bits at a time, use the fast path */
+		if ((src & 3U) == 0U && (len & 3U) == 0U)
+			cortexar_mem_read_fast(target, (uint32_t *)dest, len >> 2U);
+		else
+			cortexar_mem_read_slow(target, (uint8_t *)dest, src, len);
+		/* Deal with any data faults that occurred */
+		cortexar_mem_handle_fault(target, __func__);
+	}
 
 	DEBUG_PROTO("%s: Reading %zu bytes @0x%" PRIx64 ":", __func__, len, src);
 #ifndef DEBUG_PROTO_IS_NOOP
@@ -1221,7 +1434,8 @@ static bool cortexar_mem_write_slow(
  * NB: This requires the core to be halted! Uses instruction launches on
  * the core and requires we're in debug mode to work. Trashes r0.
  * If core is not halted, temporarily halts target and resumes at the end
- * of the function.
+ * of the function. When a system bus AP is available, the access is
+ * instead done through that AP, translating addresses if the MMU is on.
  */
 static void cortexar_mem_write(
 	target_s *const target, const target_addr64_t dest, const void *const src, const size_t len)
@@ -1243,25 +1457,36 @@ static void cortexar_mem_write(
 		DEBUG_PROTO(" ...");
 	DEBUG_PROTO("\n");
 
-	/* Cache DFSR and DFAR in case we wind up triggering a data fault */
-	if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
-		priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
-		priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
-		priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
-	}
-	/* Clear any existing fault state */
-	priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
+	/*
+	 * If we have a system bus AP, write through it instead, cleaning and invalidating the
+	 * D-cache lines involved first and then the I-cache after so the core sees the new data.
+	 */
+	if (priv->sys_ap) {
+		priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
+		cortexar_sys_mem_write(target, dest, src, len);
+		if (priv->base.icache_line_length)
+			cortexar_coproc_write(target, CORTEXAR_ICIALLU, 0U);
+	} else {
+		/* Cache DFSR and DFAR in case we wind up triggering a data fault */
+		if (!(priv->core_status & CORTEXAR_STATUS_FAULT_CACHE_VALID)) {
+			priv->fault_status = cortexar_coproc_read(target, CORTEXAR_DFSR);
+			priv->fault_address = cortexar_coproc_read(target, CORTEXAR_DFAR);
+			priv->core_status |= CORTEXAR_STATUS_FAULT_CACHE_VALID;
+		}
+		/* Clear any existing fault state */
+		priv->core_status &= ~(CORTEXAR_STATUS_DATA_FAULT | CORTEXAR_STATUS_MMU_FAULT);
 
-	/* Move the start address into the core's r0 */
-	cortexar_core_reg_write(target, 0U, dest);
+		/* Move the start address into the core's r0 */
+		cortexar_core_reg_write(target, 0U, dest);
 
-	/* If the address is 32-bit aligned and we're writing 32 bits at a time, use the fast path */
-	if ((dest & 3U) == 0U && (len & 3U) == 0U)
-		cortexar_mem_write_fast(target, (const uint32_t *)src, len >> 2U);
-	else
-		cortexar_mem_write_slow(target, dest, (const uint8_t *)src, len);
-	/* Deal with any data faults that occurred */
-	cortexar_mem_handle_fault(target, __func__);
+		/* If the address is 32-bit aligned and we're writing 32 bits at a time, use the fast path */
+		if ((dest & 3U) == 0U && (len & 3U) == 0U)
+			cortexar_mem_write_fast(target, (const uint32_t *)src, len >> 2U);
+		else
+			cortexar_mem_write_slow(target, dest, (const uint8_t *)src, len);
+		/* Deal with any data faults that occurred */
+		cortexar_mem_handle_fault(target, __func__);
+	}
 
 	if (halted_in_function)
 		cortexar_halt_resume(target, false);
@@ -1355,6 +1580,7 @@ static size_t cortexar_reg_write(target_s *const target, const uint32_t reg, con
 
 static void cortexar_reset(target_s *const target)
 {
+	cortexar_translation_cache_flush((cortexar_priv_s *)target->priv);
 	/* Read PRSR here to clear DBG_PRSR.SR before reset */
 	cortex_dbg_read32(target, CORTEXAR_DBG_PRSR);
 	/* If the physical reset pin is not inhibited, use it */
@@ -1434,6 +1660,12 @@ static target_halt_reason_e cortexar_halt_poll(target_s *const target, target_ad
 
 	/* Save the target core's registers as debugging operations clobber them */
 	cortexar_regs_save(target);
+	/* On VMSA parts, note if the MMU is on so we know whether the system bus can be used for memory access */
+	if (target->target_options & TOPT_FLAVOUR_VIRT_MEM) {
+		cortexar_priv_s *const priv = (cortexar_priv_s *)target->priv;
+		priv->mmu_enabled = cortexar_coproc_read(target, CORTEXAR_SCTLR) & CORTEXAR_SCTLR_MMU_ENABLED;
+		cortexar_translation_cache_flush(priv);
+	}
 
 	target_halt_reason_e reason = TARGET_HALT_FAULT;
 	/* Determine why we halted exactly from the Method Of Entry bits */
@@ -1497,8 +1729,9 @@ static void cortexar_halt_resume(target_s *const target, const bool step)
 	/* Invalidate all the instruction caches if we're on a VMSA model device */
 	if (target->target_options & TOPT_FLAVOUR_VIRT_MEM)
 		cortexar_coproc_write(target, CORTEXAR_ICIALLU, 0U);
-	/* Mark the fault status and address cache invalid */
+	/* Mark the fault status and address cache invalid, and drop any cached translations */
 	priv->core_status &= ~CORTEXAR_STATUS_FAULT_CACHE_VALID;
+	cortexar_translation_cache_flush(priv);
 
 	cortex_dbg_write32(target, CORTEXAR_DBG_DSCR, dscr & ~CORTEXAR_DBG_DSCR_ITR_ENABLE);
 	/* Ask to resume the core */
@@ -1611,7 +1844,7 @@ static void cortexar_config_breakpoint(
 		mode |= CORTEXAR_DBG_BCR_BYTE_SELECT_ALL;
 
 	/* Configure the breakpoint slot */
-	cortex_dbg_write32(target, CORTEXAR_DBG_BVR + (slot << 2U), cortexar_virt_to_phys(target, addr & ~3U));
+	cortex_dbg_write32(target, CORTEXAR_DBG_BVR + (slot << 2U), cortexar_virt_to_phys(target, addr & ~3U, false));
 	cortex_dbg_write32(
 		target, CORTEXAR_DBG_BCR + (slot << 2U), CORTEXAR_DBG_BCR_ENABLE | CORTEXAR_DBG_BCR_ALL_MODES | (mode & ~7U));
 }
@@ -1643,7 +1876,8 @@ static void cortexar_config_watchpoint(target_s *const target, const size_t slot
 	const uint32_t mode = cortexar_watchpoint_mode(breakwatch->type) | CORTEXAR_DBG_WCR_BYTE_SELECT(byte_mask);
 
 	/* Configure the watchpoint slot */
-	cortex_dbg_write32(target, CORTEXAR_DBG_WVR + (slot << 2U), cortexar_virt_to_phys(target, breakwatch->addr & ~3U));
+	cortex_dbg_write32(
+		target, CORTEXAR_DBG_WVR + (slot << 2U), cortexar_virt_to_phys(target, breakwatch->addr & ~3U, false));
 	cortex_dbg_write32(
 		target, CORTEXAR_DBG_WCR + (slot << 2U), CORTEXAR_DBG_WCR_ENABLE | CORTEXAR_DBG_WCR_ALL_MODES | mode);
 }
@@ -35,7 +35,9 @@
 #define TARGET_CORTEXAR_H
 
 #include "general.h"
+#include "adiv5.h"
 
 void cortexar_invalidate_all_caches(target_s *target);
+void cortexar_add_system_ap(adiv5_access_port_s *ap);
 
 #endif /* TARGET_CORTEXAR_H */
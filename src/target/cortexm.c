@@ -44,13 +44,18 @@
 #include "semihosting.h"
 #include "platform.h"
 #include "maths_utils.h"
+#if CONFIG_BMDA == 1
+#include "scan_cache.h"
+#endif
 
 #include <assert.h>
 
 static bool cortexm_vector_catch(target_s *target, int argc, const char **argv);
+static bool cortexm_cmd_profile(target_s *target, int argc, const char **argv);
 
 const command_s cortexm_cmd_list[] = {
 	{"vector_catch", cortexm_vector_catch, "Catch exception vectors"},
+	{"profile", cortexm_cmd_profile, "Sample the PC while running to build a profile: profile [duration_ms]"},
 	{NULL, NULL, NULL},
 };
 
@@ -84,6 +89,9 @@ typedef struct cortexm_priv {
 	uint8_t flash_patch_revision;
 	/* Copy of DEMCR for vector-catch */
 	uint32_t demcr;
+	/* Shadow of the FPB comparators: what each should hold, and what was last written to the hardware */
+	uint32_t flash_patch_comp[CORTEX_MAX_BREAKPOINTS];
+	uint32_t flash_patch_comp_written[CORTEX_MAX_BREAKPOINTS];
 } cortexm_priv_s;
 
 /* Register number tables */
@@ -230,6 +238,20 @@ static void cortexm_mem_write(target_s *target, target_addr64_t dest, const void
 	adiv5_mem_write(cortex_ap(target), dest, src, len);
 }
 
+static bool cortexm_mem_poll(target_s *const target, const target_addr64_t src, const uint32_t mask,
+	const uint32_t expected, const uint32_t timeout, uint32_t *const value)
+{
+	return adiv5_mem_poll(cortex_ap(target), src, mask, expected, timeout, value);
+}
+
+static bool cortexm_mem_txn(target_s *const target, const target_txn_op_s *const ops, const size_t count)
+{
+	/* Keep the data cache coherent with each access just as the single access routines do */
+	for (size_t i = 0; i < count; ++i)
+		cortexm_cache_clean(target, ops[i].addr, sizeof(uint32_t), ops[i].write);
+	return adiv5_mem_txn(cortex_ap(target), ops, count);
+}
+
 bool target_is_cortexm(const target_s *target)
 {
 	return target != NULL && target->regs_description == cortexm_target_description;
@@ -248,6 +270,159 @@ void cortexm_demcr_write(target_s *target, uint32_t demcr)
 	target_mem32_write32(target, CORTEXM_DEMCR, demcr);
 }
 
+#if CONFIG_BMDA == 1
+/*
+ * Under BMDA, the part-specific probe routines can be restricted to just the one named by only,
+ * which the scan cache uses to go straight to the driver that matched a part on a previous run.
+ * Whichever routine matches is then recorded in the scan cache for next time.
+ */
+#undef PROBE
+#define PROBE(x)                                                            \
+	do {                                                                    \
+		if (!only || !strcmp(only, STRINGIFY(x))) {                         \
+			DEBUG_TARGET("Calling " STRINGIFY(x) "\n");                     \
+			if ((x)(target)) {                                              \
+				bmda_scan_cache_record_probe(target->cpuid, STRINGIFY(x)); \
+				return true;                                                \
+			}                                                               \
+			target_check_error(target);                                     \
+		}                                                                   \
+	} while (0)
+#endif
+
+/* Try each of the part-specific probe routines that could match this Cortex-M until one does */
+static bool cortexm_probe_drivers(target_s *const target, const char *const only)
+{
+#if CONFIG_BMDA == 0
+	(void)only;
+#endif
+	switch (target->designer_code) {
+	case JEP106_MANUFACTURER_FREESCALE:
+		PROBE(imxrt_probe);
+		PROBE(kinetis_probe);
+		PROBE(s32k3xx_probe);
+		PROBE(ke04_probe);
+		break;
+	case JEP106_MANUFACTURER_GIGADEVICE:
+		PROBE(gd32f1_probe);
+		PROBE(gd32f4_probe);
+		break;
+	case JEP106_MANUFACTURER_STM:
+		PROBE(stm32f1_probe);
+		PROBE(stm32f4_probe);
+		PROBE(stm32h5_probe);
+		PROBE(stm32h7_probe);
+		PROBE(stm32mp15_cm4_probe);
+		PROBE(stm32l0_probe);
+		PROBE(stm32l1_probe);
+		PROBE(stm32l4_probe);
+		PROBE(stm32g0_probe);
+		PROBE(stm32wb0_probe);
+		break;
+	case JEP106_MANUFACTURER_CYPRESS:
+		DEBUG_WARN("Unhandled Cypress device\n");
+		break;
+	case JEP106_MANUFACTURER_INFINEON:
+		DEBUG_WARN("Unhandled Infineon device\n");
+		break;
+	case JEP106_MANUFACTURER_NORDIC:
+		PROBE(nrf51_probe);
+		PROBE(nrf54l_probe);
+		PROBE(nrf91_probe);
+		break;
+	case JEP106_MANUFACTURER_ATMEL:
+		PROBE(samx7x_probe);
+		PROBE(sam4l_probe);
+		PROBE(samd_probe);
+		PROBE(samx5x_probe);
+		break;
+	case JEP106_MANUFACTURER_ENERGY_MICRO:
+		PROBE(efm32_probe);
+		break;
+	case JEP106_MANUFACTURER_TEXAS:
+		PROBE(msp432p4_probe);
+		PROBE(mspm0_probe);
+		break;
+	case JEP106_MANUFACTURER_SPECULAR:
+		PROBE(lpc11xx_probe); /* LPC845 */
+		break;
+	case JEP106_MANUFACTURER_RASPBERRY:
+		PROBE(rp2040_probe);
+		PROBE(rp2350_probe);
+		break;
+	case JEP106_MANUFACTURER_RENESAS:
+		PROBE(renesas_ra_probe);
+		break;
+	case JEP106_MANUFACTURER_WCH:
+		PROBE(ch579_probe);
+		break;
+	case JEP106_MANUFACTURER_NXP:
+		if ((target->cpuid & CORTEX_CPUID_PARTNO_MASK) == CORTEX_M33)
+			PROBE(lpc55xx_probe);
+		else
+			DEBUG_WARN("Unhandled NXP device\n");
+		break;
+	case JEP106_MANUFACTURER_ARM_CHINA:
+		PROBE(mm32f3xx_probe); /* MindMotion Star-MC1 */
+		break;
+	case JEP106_MANUFACTURER_ARM:
+		/*
+		 * All of these have braces as a brake from the standard so they're completely
+		 * consistent and easier to add new probe calls to.
+		 */
+		if (target->part_id == 0x4c0U) {        /* Cortex-M0+ ROM */
+			PROBE(lpc11xx_probe);               /* LPC8 */
+			PROBE(hc32l110_probe);              /* HDSC HC32L110 */
+			PROBE(puya_probe);                  /* Puya PY32 */
+		} else if (target->part_id == 0x4c1U) { /* NXP Cortex-M0+ ROM */
+			PROBE(lpc11xx_probe);               /* newer LPC11U6x */
+		} else if (target->part_id == 0x4c3U) { /* Cortex-M3 ROM */
+			PROBE(lmi_probe);
+			PROBE(ch32f1_probe);
+			PROBE(stm32f1_probe);               /* Care for other STM32F1 clones (?) */
+			PROBE(lpc15xx_probe);               /* Thanks to JojoS for testing */
+			PROBE(mm32f3xx_probe);              /* MindMotion MM32 */
+		} else if (target->part_id == 0x471U) { /* Cortex-M0 ROM */
+			PROBE(lpc11xx_probe);               /* LPC24C11 */
+			PROBE(lpc43xx_probe);
+			PROBE(mm32l0xx_probe);              /* MindMotion MM32 */
+		} else if (target->part_id == 0x4c4U) { /* Cortex-M4 ROM */
+			PROBE(sam3x_probe);
+			PROBE(lmi_probe);
+			PROBE(apollo_3_probe);
+			/*
+			 * The LPC546xx and LPC43xx parts present with the same AP ROM part number,
+			 * so we need to probe both. Unfortunately, when probing for the LPC43xx
+			 * when the target is actually an LPC546xx, the memory location checked
+			 * is illegal for the LPC546xx and puts the chip into lockup, requiring a
+			 * reset pulse to recover. Instead, make sure to probe for the LPC546xx first,
+			 * which experimentally doesn't harm LPC43xx detection.
+			 */
+			PROBE(lpc546xx_probe);
+			PROBE(lpc43xx_probe);
+			PROBE(at32f40x_probe);
+			PROBE(at32f43x_probe); /* AT32F435 doesn't survive LPC40xx IAP */
+			PROBE(lpc40xx_probe);
+			PROBE(kinetis_probe); /* Older K-series */
+			PROBE(msp432e4_probe);
+		} else if (target->part_id == 0x4cbU) { /* Cortex-M23 ROM */
+			PROBE(gd32f1_probe);                /* GD32E23x uses GD32F1 peripherals */
+		}
+		break;
+	case ASCII_CODE_FLAG:
+		/*
+		 * these devices enumerate an AP with an empty ascii code,
+		 * and have no available designer code elsewhere
+		 */
+		PROBE(sam3x_probe);
+		PROBE(ke04_probe);
+		PROBE(lpc17xx_probe);
+		PROBE(lpc11xx_probe); /* LPC1343 */
+		break;
+	}
+	return false;
+}
+
 bool cortexm_probe(adiv5_access_port_s *ap)
 {
 	target_s *target = target_new();
@@ -284,6 +459,8 @@ bool cortexm_probe(adiv5_access_port_s *ap)
 	target->check_error = cortex_check_error;
 	target->mem_read = cortexm_mem_read;
 	target->mem_write = cortexm_mem_write;
+	target->mem_poll = cortexm_mem_poll;
+	target->mem_txn = cortexm_mem_txn;
 
 	target->driver = "ARM Cortex-M";
 
@@ -376,133 +553,19 @@ bool cortexm_probe(adiv5_access_port_s *ap)
 
 	DEBUG_TARGET("%s: Examining Part ID 0x%04x, AP Part ID: 0x%04x\n", __func__, target->part_id, ap->partno);
 
-	switch (target->designer_code) {
-	case JEP106_MANUFACTURER_FREESCALE:
-		PROBE(imxrt_probe);
-		PROBE(kinetis_probe);
-		PROBE(s32k3xx_probe);
-		PROBE(ke04_probe);
-		break;
-	case JEP106_MANUFACTURER_GIGADEVICE:
-		PROBE(gd32f1_probe);
-		PROBE(gd32f4_probe);
-		break;
-	case JEP106_MANUFACTURER_STM:
-		PROBE(stm32f1_probe);
-		PROBE(stm32f4_probe);
-		PROBE(stm32h5_probe);
-		PROBE(stm32h7_probe);
-		PROBE(stm32mp15_cm4_probe);
-		PROBE(stm32l0_probe);
-		PROBE(stm32l1_probe);
-		PROBE(stm32l4_probe);
-		PROBE(stm32g0_probe);
-		PROBE(stm32wb0_probe);
-		break;
-	case JEP106_MANUFACTURER_CYPRESS:
-		DEBUG_WARN("Unhandled Cypress device\n");
-		break;
-	case JEP106_MANUFACTURER_INFINEON:
-		DEBUG_WARN("Unhandled Infineon device\n");
-		break;
-	case JEP106_MANUFACTURER_NORDIC:
-		PROBE(nrf51_probe);
-		PROBE(nrf54l_probe);
-		PROBE(nrf91_probe);
-		break;
-	case JEP106_MANUFACTURER_ATMEL:
-		PROBE(samx7x_probe);
-		PROBE(sam4l_probe);
-		PROBE(samd_probe);
-		PROBE(samx5x_probe);
-		break;
-	case JEP106_MANUFACTURER_ENERGY_MICRO:
-		PROBE(efm32_probe);
-		break;
-	case JEP106_MANUFACTURER_TEXAS:
-		PROBE(msp432p4_probe);
-		PROBE(mspm0_probe);
-		break;
-	case JEP106_MANUFACTURER_SPECULAR:
-		PROBE(lpc11xx_probe); /* LPC845 */
-		break;
-	case JEP106_MANUFACTURER_RASPBERRY:
-		PROBE(rp2040_probe);
-		PROBE(rp2350_probe);
-		break;
-	case JEP106_MANUFACTURER_RENESAS:
-		PROBE(renesas_ra_probe);
-		break;
-	case JEP106_MANUFACTURER_WCH:
-		PROBE(ch579_probe);
-		break;
-	case JEP106_MANUFACTURER_NXP:
-		if ((target->cpuid & CORTEX_CPUID_PARTNO_MASK) == CORTEX_M33)
-			PROBE(lpc55xx_probe);
-		else
-			DEBUG_WARN("Unhandled NXP device\n");
-		break;
-	case JEP106_MANUFACTURER_ARM_CHINA:
-		PROBE(mm32f3xx_probe); /* MindMotion Star-MC1 */
-		break;
-	case JEP106_MANUFACTURER_ARM:
-		/*
-		 * All of these have braces as a brake from the standard so they're completely
-		 * consistent and easier to add new probe calls to.
-		 */
-		if (target->part_id == 0x4c0U) {        /* Cortex-M0+ ROM */
-			PROBE(lpc11xx_probe);               /* LPC8 */
-			PROBE(hc32l110_probe);              /* HDSC HC32L110 */
-			PROBE(puya_probe);                  /* Puya PY32 */
-		} else if (target->part_id == 0x4c1U) { /* NXP Cortex-M0+ ROM */
-			PROBE(lpc11xx_probe);               /* newer LPC11U6x */
-		} else if (target->part_id == 0x4c3U) { /* Cortex-M3 ROM */
-			PROBE(lmi_probe);
-			PROBE(ch32f1_probe);
-			PROBE(stm32f1_probe);               /* Care for other STM32F1 clones (?) */
-			PROBE(lpc15xx_probe);               /* Thanks to JojoS for testing */
-			PROBE(mm32f3xx_probe);              /* MindMotion MM32 */
-		} else if (target->part_id == 0x471U) { /* Cortex-M0 ROM */
-			PROBE(lpc11xx_probe);               /* LPC24C11 */
-			PROBE(lpc43xx_probe);
-			PROBE(mm32l0xx_probe);              /* MindMotion MM32 */
-		} else if (target->part_id == 0x4c4U) { /* Cortex-M4 ROM */
-			PROBE(sam3x_probe);
-			PROBE(lmi_probe);
-			PROBE(apollo_3_probe);
-			/*
-			 * The LPC546xx and LPC43xx parts present with the same AP ROM part number,
-			 * so we need to probe both. Unfortunately, when probing for the LPC43xx
-			 * when the target is actually an LPC546xx, the memory location checked
-			 * is illegal for the LPC546xx and puts the chip into lockup, requiring a
-			 * reset pulse to recover. Instead, make sure to probe for the LPC546xx first,
-			 * which experimentally doesn't harm LPC43xx detection.
-			 */
-			PROBE(lpc546xx_probe);
-			PROBE(lpc43xx_probe);
-			PROBE(at32f40x_probe);
-			PROBE(at32f43x_probe); /* AT32F435 doesn't survive LPC40xx IAP */
-			PROBE(lpc40xx_probe);
-			PROBE(kinetis_probe); /* Older K-series */
-			PROBE(msp432e4_probe);
-		} else if (target->part_id == 0x4cbU) { /* Cortex-M23 ROM */
-			PROBE(gd32f1_probe);                /* GD32E23x uses GD32F1 peripherals */
-		}
-		break;
-	case ASCII_CODE_FLAG:
-		/*
-		 * these devices enumerate an AP with an empty ascii code,
-		 * and have no available designer code elsewhere
-		 */
-		PROBE(sam3x_probe);
-		PROBE(ke04_probe);
-		PROBE(lpc17xx_probe);
-		PROBE(lpc11xx_probe); /* LPC1343 */
-		break;
-	}
+#if CONFIG_BMDA == 1
+	/* If a previous run recorded which driver matched this part, try that one alone first */
+	const char *const cached_probe = bmda_scan_cache_probe_name(target->cpuid);
+	if (cached_probe && cortexm_probe_drivers(target, cached_probe))
+		return true;
+#endif
+	if (cortexm_probe_drivers(target, NULL))
+		return true;
 #if CONFIG_BMDA == 0
 	gdb_outf("Please report unknown device with Designer 0x%x Part ID 0x%x\n", target->designer_code, target->part_id);
 #else
+	/* Remember that no driver matched, so the next run doesn't think it's a different core */
+	bmda_scan_cache_record_probe(target->cpuid, "");
 	DEBUG_WARN(
 		"Please report unknown device with Designer 0x%x Part ID 0x%x\n", target->designer_code, target->part_id);
 #endif
@@ -555,6 +618,8 @@ bool cortexm_attach(target_s *target)
 	priv->base.breakpoints_mask = 0;
 	for (size_t i = 0; i < priv->base.breakpoints_available; i++)
 		target_mem32_write32(target, CORTEXM_FPB_COMP(i), 0);
+	memset(priv->flash_patch_comp, 0, sizeof(priv->flash_patch_comp));
+	memset(priv->flash_patch_comp_written, 0, sizeof(priv->flash_patch_comp_written));
 
 	/* Clear any stale watchpoints */
 	priv->base.watchpoints_mask = 0;
@@ -589,6 +654,8 @@ void cortexm_detach(target_s *target)
 	/* Clear any stale breakpoints */
 	for (size_t i = 0; i < priv->base.breakpoints_available; i++)
 		target_mem32_write32(target, CORTEXM_FPB_COMP(i), 0);
+	memset(priv->flash_patch_comp, 0, sizeof(priv->flash_patch_comp));
+	memset(priv->flash_patch_comp_written, 0, sizeof(priv->flash_patch_comp_written));
 
 	/* Clear any stale watchpoints */
 	for (size_t i = 0; i < priv->base.watchpoints_available; i++)
@@ -613,8 +680,8 @@ enum {
 static void cortexm_regs_read(target_s *const target, void *const data)
 {
 	uint32_t *const regs = data;
-	adiv5_access_port_s *const ap = cortex_ap(target);
 #if CONFIG_BMDA == 1
+	adiv5_access_port_s *const ap = cortex_ap(target);
 	if (ap->dp->ap_regs_read && ap->dp->ap_reg_read) {
 		uint32_t core_regs[21U];
 		ap->dp->ap_regs_read(ap, core_regs);
@@ -629,34 +696,33 @@ static void cortexm_regs_read(target_s *const target, void *const data)
 	} else {
 #endif
 		/*
-		 * Map the AP's banked data registers (0x10-0x1c) to the
-		 * debug registers DHCSR, DCRSR, DCRDR and DEMCR respectively
-		 * and do so for 32-bit access
+		 * Queue up the register reads as a transaction. The accesses all fall in the DHCSR/DCRSR/DCRDR/DEMCR block
+		 * so adaptors without a native implementation use the AP's banked data registers to do them.
 		 */
-		adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
-		adi_ap_banked_access_setup(ap);
-
+		target_txn_s txn;
+		target_txn_begin(&txn, target);
 		/* Walk the regnum_cortex_m array, reading the registers it specifies */
 		for (size_t i = 0U; i < CORTEXM_GENERAL_REG_COUNT; ++i) {
-			adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), regnum_cortex_m[i]);
-			regs[i] = adiv5_dp_read(ap->dp, ADIV5_AP_DB(DB_DCRDR));
+			target_txn_write32(&txn, CORTEXM_DCRSR, regnum_cortex_m[i]);
+			target_txn_read32(&txn, CORTEXM_DCRDR, &regs[i]);
 		}
 		size_t offset = CORTEXM_GENERAL_REG_COUNT;
 		/* If the core implements TrustZone, pull out the extra stack pointers */
 		if (target->target_options & CORTEXM_TOPT_TRUSTZONE) {
 			for (size_t i = 0U; i < CORTEXM_TRUSTZONE_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), regnum_cortex_m_trustzone[i]);
-				regs[offset + i] = adiv5_dp_read(ap->dp, ADIV5_AP_DB(DB_DCRDR));
+				target_txn_write32(&txn, CORTEXM_DCRSR, regnum_cortex_m_trustzone[i]);
+				target_txn_read32(&txn, CORTEXM_DCRDR, &regs[offset + i]);
 			}
 			offset += CORTEXM_TRUSTZONE_REG_COUNT;
 		}
 		/* If the core has a FPU, also walk the regnum_cortex_mf array */
 		if (target->target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) {
 			for (size_t i = 0U; i < CORTEX_FLOAT_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), regnum_cortex_mf[i]);
-				regs[offset + i] = adiv5_dp_read(ap->dp, ADIV5_AP_DB(DB_DCRDR));
+				target_txn_write32(&txn, CORTEXM_DCRSR, regnum_cortex_mf[i]);
+				target_txn_read32(&txn, CORTEXM_DCRDR, &regs[offset + i]);
 			}
 		}
+		target_txn_commit(&txn);
 #if CONFIG_BMDA == 1
 	}
 #endif
@@ -665,8 +731,8 @@ static void cortexm_regs_read(target_s *const target, void *const data)
 static void cortexm_regs_write(target_s *const target, const void *const data)
 {
 	const uint32_t *const regs = data;
-	adiv5_access_port_s *const ap = cortex_ap(target);
 #if CONFIG_BMDA == 1
+	adiv5_access_port_s *const ap = cortex_ap(target);
 	if (ap->dp->ap_reg_write) {
 		for (size_t i = 0; i < CORTEXM_GENERAL_REG_COUNT; ++i)
 			ap->dp->ap_reg_write(ap, regnum_cortex_m[i], regs[i]);
@@ -678,35 +744,31 @@ static void cortexm_regs_write(target_s *const target, const void *const data)
 		}
 	} else {
 #endif
-		/*
-		 * Map the banked data registers (0x10-0x1c) to the
-		 * debug registers DHCSR, DCRSR, DCRDR and DEMCR respectively
-		 * and do so for 32-bit access
-		 */
-		adi_ap_mem_access_setup(ap, CORTEXM_DHCSR, ALIGN_32BIT);
-		adi_ap_banked_access_setup(ap);
-
+		/* Queue up the register writes as a transaction, which can use the banked data registers just as reads do */
+		target_txn_s txn;
+		target_txn_begin(&txn, target);
 		/* Walk the regnum_cortex_m array, writing the registers it specifies */
 		for (size_t i = 0U; i < CORTEXM_GENERAL_REG_COUNT; ++i) {
-			adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), regs[i]);
-			adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | regnum_cortex_m[i]);
+			target_txn_write32(&txn, CORTEXM_DCRDR, regs[i]);
+			target_txn_write32(&txn, CORTEXM_DCRSR, CORTEXM_DCRSR_REG_WRITE | regnum_cortex_m[i]);
 		}
 		size_t offset = CORTEXM_GENERAL_REG_COUNT;
 		/* If the core implements TrustZone, write in the extra stack pointers */
 		if (target->target_options & CORTEXM_TOPT_TRUSTZONE) {
 			for (size_t i = 0U; i < CORTEXM_TRUSTZONE_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), regs[offset + i]);
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | regnum_cortex_m_trustzone[i]);
+				target_txn_write32(&txn, CORTEXM_DCRDR, regs[offset + i]);
+				target_txn_write32(&txn, CORTEXM_DCRSR, CORTEXM_DCRSR_REG_WRITE | regnum_cortex_m_trustzone[i]);
 			}
 			offset += CORTEXM_TRUSTZONE_REG_COUNT;
 		}
 		/* If the core has a FPU, also walk the regnum_cortex_mf array */
 		if (target->target_options & CORTEXM_TOPT_FLAVOUR_FLOAT) {
 			for (size_t i = 0U; i < CORTEX_FLOAT_REG_COUNT; ++i) {
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRDR), regs[offset + i]);
-				adiv5_dp_write(ap->dp, ADIV5_AP_DB(DB_DCRSR), CORTEXM_DCRSR_REG_WRITE | regnum_cortex_mf[i]);
+				target_txn_write32(&txn, CORTEXM_DCRDR, regs[offset + i]);
+				target_txn_write32(&txn, CORTEXM_DCRSR, CORTEXM_DCRSR_REG_WRITE | regnum_cortex_mf[i]);
 			}
 		}
+		target_txn_commit(&txn);
 #if CONFIG_BMDA == 1
 	}
 #endif
@@ -851,13 +913,17 @@ static target_halt_reason_e cortexm_halt_poll(target_s *target, target_addr64_t
 	if (!(dhcsr & CORTEXM_DHCSR_S_HALT))
 		return TARGET_HALT_RUNNING;
 
-	/* Read out the status register to determine why */
-	const uint32_t dfsr = target_mem32_read32(target, CORTEXM_DFSR);
+	/* Read out the status register to determine why, and check what caches are currently enabled */
+	uint32_t dfsr = 0U;
+	uint32_t ccr = 0U;
+	target_txn_s txn;
+	target_txn_begin(&txn, target);
+	target_txn_read32(&txn, CORTEXM_DFSR, &dfsr);
+	target_txn_read32(&txn, CORTEXM_CCR, &ccr);
+	target_txn_commit(&txn);
 	/* Write the same value back to clear the register */
 	target_mem32_write32(target, CORTEXM_DFSR, dfsr);
 
-	/* Check what caches are currently enabled */
-	const uint32_t ccr = target_mem32_read32(target, CORTEXM_CCR);
 	priv->dcache_enabled = ccr & CORTEXM_CCR_DCACHE_ENABLE;
 	priv->icache_enabled = ccr & CORTEXM_CCR_ICACHE_ENABLE;
 
@@ -894,9 +960,35 @@ static target_halt_reason_e cortexm_halt_poll(target_s *target, target_addr64_t
 	return TARGET_HALT_BREAKPOINT;
 }
 
+/*
+ * Bring the break-/watchpoint hardware up to date before letting the core run. Removals GDB made while
+ * halted are committed, then the FPB comparators that differ from their shadow are written back. The
+ * comparators are contiguous, so the span from the first to the last that changed goes out as one block write.
+ */
+static void cortexm_breakwatch_sync(target_s *const target)
+{
+	target_breakwatch_commit(target);
+	cortexm_priv_s *const priv = (cortexm_priv_s *)target->priv;
+	size_t first = priv->base.breakpoints_available;
+	size_t last = 0U;
+	for (size_t slot = 0U; slot < priv->base.breakpoints_available; ++slot) {
+		if (priv->flash_patch_comp[slot] == priv->flash_patch_comp_written[slot])
+			continue;
+		if (first == priv->base.breakpoints_available)
+			first = slot;
+		last = slot;
+	}
+	if (first == priv->base.breakpoints_available)
+		return;
+	const size_t length = (last - first + 1U) * sizeof(uint32_t);
+	target_mem32_write(target, CORTEXM_FPB_COMP(first), &priv->flash_patch_comp[first], length);
+	memcpy(&priv->flash_patch_comp_written[first], &priv->flash_patch_comp[first], length);
+}
+
 void cortexm_halt_resume(target_s *const target, const bool step)
 {
 	cortexm_priv_s *priv = target->priv;
+	cortexm_breakwatch_sync(target);
 	/* Begin building the new DHCSR value to resume the core with */
 	uint32_t dhcsr = CORTEXM_DHCSR_DBGKEY | CORTEXM_DHCSR_C_DEBUGEN;
 
@@ -990,32 +1082,118 @@ static int cortexm_fault_unwind(target_s *target)
 	return 0;
 }
 
-bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+/*
+ * Run a stub on the core behind ap using nothing but memory accesses through that AP, so it can be done without
+ * a target structure (as the remote protocol needs). The general purpose registers are loaded with args as r0-r3
+ * and loadaddr as the PC, everything else being zeroed, then the core is resumed. Returns true if the core halted
+ * again within timeout ms, in which case dfsr holds why and instruction is the halfword the core halted on.
+ * If the core did not halt in time, it's left running for the caller to decide what to do.
+ */
+bool cortexm_ap_run_stub(adiv5_access_port_s *const ap, const uint32_t loadaddr, const uint32_t *const args,
+	const bool invalidate_icache, const uint32_t timeout, uint32_t *const dfsr, uint16_t *const instruction)
 {
-	uint32_t regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT] = {0};
-
-	regs[0] = r0;
-	regs[1] = r1;
-	regs[2] = r2;
-	regs[3] = r3;
-	regs[15] = loadaddr;
-	regs[CORTEX_REG_XPSR] = CORTEXM_XPSR_THUMB;
-	regs[19] = 0;
+	for (size_t i = 0U; i < CORTEXM_GENERAL_REG_COUNT; ++i) {
+		uint32_t value = 0U;
+		if (i < 4U)
+			value = args[i];
+		else if (i == CORTEX_REG_PC)
+			value = loadaddr;
+		else if (i == CORTEX_REG_XPSR)
+			value = CORTEXM_XPSR_THUMB;
+		const uint32_t dcrsr = CORTEXM_DCRSR_REG_WRITE | regnum_cortex_m[i];
+		adiv5_mem_write(ap, CORTEXM_DCRDR, &value, sizeof(value));
+		adiv5_mem_write(ap, CORTEXM_DCRSR, &dcrsr, sizeof(dcrsr));
+	}
 
-	cortexm_regs_write(target, regs);
+	/* Clear any stale halt reasons so we can tell why the stub stops */
+	const uint32_t dfsr_reset = CORTEXM_DFSR_RESETALL;
+	adiv5_mem_write(ap, CORTEXM_DFSR, &dfsr_reset, sizeof(dfsr_reset));
+	if (invalidate_icache) {
+		const uint32_t iciallu = 0U;
+		adiv5_mem_write(ap, CORTEXM_ICIALLU, &iciallu, sizeof(iciallu));
+	}
+	const uint32_t resume = CORTEXM_DHCSR_DBGKEY | CORTEXM_DHCSR_C_DEBUGEN;
+	adiv5_mem_write(ap, CORTEXM_DHCSR, &resume, sizeof(resume));
 
-	if (target_check_error(target))
+	uint32_t dhcsr = 0U;
+	if (!adiv5_mem_poll(ap, CORTEXM_DHCSR, CORTEXM_DHCSR_S_HALT, CORTEXM_DHCSR_S_HALT, timeout, &dhcsr))
 		return false;
 
-	/* Execute the stub */
+	/* Find out why the core halted, clearing the reasons, and then what it halted on */
+	adiv5_mem_read(ap, dfsr, CORTEXM_DFSR, sizeof(*dfsr));
+	adiv5_mem_write(ap, CORTEXM_DFSR, dfsr, sizeof(*dfsr));
+	const uint32_t dcrsr = CORTEX_REG_PC;
+	adiv5_mem_write(ap, CORTEXM_DCRSR, &dcrsr, sizeof(dcrsr));
+	uint32_t program_counter = 0U;
+	adiv5_mem_read(ap, &program_counter, CORTEXM_DCRDR, sizeof(program_counter));
+	adiv5_mem_read(ap, instruction, program_counter, sizeof(*instruction));
+	return true;
+}
+
+bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3)
+{
 	target_halt_reason_e reason = TARGET_HALT_RUNNING;
+	platform_timeout_s timeout;
+	bool running = false;
 #if defined(PLATFORM_HAS_DEBUG)
-	uint32_t arm_regs_start[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT];
-	target_regs_read(target, arm_regs_start);
+	uint32_t arm_regs_start[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT] = {0};
 #endif
-	cortexm_halt_resume(target, 0);
-	platform_timeout_s timeout;
-	platform_timeout_set(&timeout, 5000);
+
+#if CONFIG_BMDA == 1
+	/* If the probe can run the stub for us in one go, hand it off and only wait here if it's still running */
+	cortexm_priv_s *const priv = (cortexm_priv_s *)target->priv;
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	if (ap->dp->run_stub && !priv->stepping) {
+		/* The probe resumes the core itself, so make sure no stale comparators can stop the stub */
+		cortexm_breakwatch_sync(target);
+		platform_timeout_set(&timeout, 5000);
+		const uint32_t args[4] = {r0, r1, r2, r3};
+		uint32_t dfsr = 0U;
+		uint16_t instruction = 0U;
+		const bool halted =
+			ap->dp->run_stub(ap, loadaddr, args, priv->base.icache_line_length != 0U, &dfsr, &instruction);
+		if (target_check_error(target))
+			return false;
+		if (halted) {
+			if (!(dfsr & CORTEXM_DFSR_BKPT)) {
+				DEBUG_WARN(" DFSR %08" PRIx32 "\n", dfsr);
+				return false;
+			}
+			priv->on_bkpt = true;
+			if (instruction >> 8U != 0xbeU)
+				return false;
+			return instruction & 0xffU;
+		}
+		running = true;
+	}
+#endif
+
+	if (!running) {
+		uint32_t regs[CORTEXM_GENERAL_REG_COUNT + CORTEX_FLOAT_REG_COUNT] = {0};
+
+		regs[0] = r0;
+		regs[1] = r1;
+		regs[2] = r2;
+		regs[3] = r3;
+		regs[15] = loadaddr;
+		regs[CORTEX_REG_XPSR] = CORTEXM_XPSR_THUMB;
+		regs[19] = 0;
+
+		cortexm_regs_write(target, regs);
+
+		if (target_check_error(target))
+			return false;
+
+		/* Execute the stub */
+#if defined(PLATFORM_HAS_DEBUG)
+		target_regs_read(target, arm_regs_start);
+#endif
+		cortexm_halt_resume(target, 0);
+		platform_timeout_set(&timeout, 5000);
+		/* Wait for the core to halt with a single poll of DHCSR so the probe can run the loop if it's able */
+		target_mem32_poll(target, CORTEXM_DHCSR, CORTEXM_DHCSR_S_HALT, CORTEXM_DHCSR_S_HALT, 5000U, NULL);
+	}
+
 	while (reason == TARGET_HALT_RUNNING) {
 		if (platform_timeout_is_expired(&timeout)) {
 			cortexm_halt_request(target);
@@ -1132,9 +1310,9 @@ static int cortexm_breakpoint_set(target_s *const target, breakwatch_s *const br
 	if (slot == priv->base.breakpoints_available)
 		return -1;
 
-	/* Otherwise, mark the slot chosen as used, and write it with the computed value */
+	/* Otherwise, mark the slot chosen as used, and record the computed value to be written before the core runs */
 	priv->base.breakpoints_mask |= 1U << slot;
-	target_mem32_write32(target, CORTEXM_FPB_COMP(slot), breakpoint);
+	priv->flash_patch_comp[slot] = breakpoint;
 	breakwatch->reserved[0] = slot;
 	return 0;
 }
@@ -1156,15 +1334,20 @@ static int cortexm_watchpoint_set(target_s *const target, breakwatch_s *const br
 
 	/* Otherwise, mark the slot chosen as used */
 	priv->base.watchpoints_mask |= 1U << slot;
-	/* Then set the watchpoint hardware up to observe the requested address in the requested way */
-	if ((target->target_options & CORTEXM_TOPT_FLAVOUR_V8M)) {
-		target_mem32_write32(target, CORTEXM_DWT_COMP(slot), breakwatch->addr);
-		target_mem32_write32(target, CORTEXM_DWT_FUNC(slot), cortexm_dwtv2_func(breakwatch->type, breakwatch->size));
-	} else {
-		target_mem32_write32(target, CORTEXM_DWT_COMP(slot), breakwatch->addr);
-		target_mem32_write32(target, CORTEXM_DWT_MASK(slot), cortexm_dwt_mask(breakwatch->size));
-		target_mem32_write32(target, CORTEXM_DWT_FUNC(slot), cortexm_dwt_func(target, breakwatch->type));
+	/*
+	 * Then set the watchpoint hardware up to observe the requested address in the requested way.
+	 * The comparator's registers share a 16 byte block, so this can go out as a single transaction
+	 */
+	target_txn_s txn;
+	target_txn_begin(&txn, target);
+	target_txn_write32(&txn, CORTEXM_DWT_COMP(slot), breakwatch->addr);
+	if ((target->target_options & CORTEXM_TOPT_FLAVOUR_V8M))
+		target_txn_write32(&txn, CORTEXM_DWT_FUNC(slot), cortexm_dwtv2_func(breakwatch->type, breakwatch->size));
+	else {
+		target_txn_write32(&txn, CORTEXM_DWT_MASK(slot), cortexm_dwt_mask(breakwatch->size));
+		target_txn_write32(&txn, CORTEXM_DWT_FUNC(slot), cortexm_dwt_func(target, breakwatch->type));
 	}
+	target_txn_commit(&txn);
 	breakwatch->reserved[0] = slot;
 	return 0;
 }
@@ -1197,9 +1380,9 @@ static int cortexm_breakwatch_clear(target_s *const target, breakwatch_s *const
 		 * Disable the breakpoint, but also crucially make sure we keep the Flash patch system disabled(!).
 		 * BE is bit 0, FE is bit 31. Bits 29 and 30 are reserved and must be zero when BE is 0.
 		 * The ARMv8-M ARM requires this be a write to 0, specifically, as called out in §D1.2.107, FP_COMPn,
-		 * Flash Patch Comparator Register, pg1653
+		 * Flash Patch Comparator Register, pg1653. This is written out with the other comparators before the core runs.
 		 */
-		target_mem32_write32(target, CORTEXM_FPB_COMP(slot), 0U);
+		priv->flash_patch_comp[slot] = 0U;
 		return 0;
 	case TARGET_WATCH_WRITE:
 	case TARGET_WATCH_READ:
@@ -1269,6 +1452,135 @@ static bool cortexm_vector_catch(target_s *target, int argc, const char **argv)
 	return true;
 }
 
+/* Linear probing is bounded so a near-full table doesn't slow sampling to a crawl */
+#define CORTEXM_PROFILE_MAX_PROBES 16U
+
+/* Find the bucket holding a PC value, or the empty one it should go in, or NULL if neither is close enough */
+static cortexm_pc_bucket_s *cortexm_profile_bucket(const cortexm_pc_profile_s *const profile, const uint32_t pc)
+{
+	const size_t mask = profile->bucket_count - 1U;
+	/* Thumb instructions are at least 2-byte aligned, so drop bit 0 before spreading the PC over the table */
+	size_t index = (size_t)((pc >> 1U) * 2654435761U) & mask;
+	for (size_t probe = 0U; probe < CORTEXM_PROFILE_MAX_PROBES; ++probe) {
+		cortexm_pc_bucket_s *const bucket = &profile->buckets[index];
+		if (bucket->count == 0U || bucket->pc == pc)
+			return bucket;
+		index = (index + 1U) & mask;
+	}
+	return NULL;
+}
+
+/* Add count samples of a PC value to the histogram, returning false if the table is too full to hold it */
+bool cortexm_pc_profile_add(cortexm_pc_profile_s *const profile, const uint32_t pc, const uint32_t count)
+{
+	cortexm_pc_bucket_s *const bucket = cortexm_profile_bucket(profile, pc);
+	if (!bucket)
+		return false;
+	if (bucket->count == 0U) {
+		bucket->pc = pc;
+		++profile->used;
+	}
+	bucket->count += count;
+	return true;
+}
+
+static void cortexm_profile_reset(cortexm_pc_profile_s *const profile)
+{
+	memset(profile->buckets, 0, sizeof(*profile->buckets) * profile->bucket_count);
+	profile->samples = 0U;
+	profile->idle = 0U;
+	profile->dropped = 0U;
+	profile->duration_ms = 0U;
+	profile->used = 0U;
+}
+
+/*
+ * Statistically profile the running core behind an AP by reading the DWT's PC sample register as fast as
+ * the debug link allows, building a histogram of the PC values seen. Sampling stops once the time is up, or
+ * once max_used distinct PC values have been seen so the histogram fits in whatever it has to be sent on in.
+ * Returns false if the AP faulted.
+ */
+bool cortexm_ap_pc_profile(adiv5_access_port_s *const ap, cortexm_pc_profile_s *const profile,
+	const uint32_t duration_ms, const size_t max_used)
+{
+	cortexm_profile_reset(profile);
+	const uint32_t start = platform_time_ms();
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, duration_ms);
+	while (profile->used < max_used && !platform_timeout_is_expired(&timeout)) {
+		uint32_t pc = 0U;
+		adiv5_mem_read(ap, &pc, CORTEXM_DWT_PCSR, sizeof(pc));
+		if (ap->dp->fault)
+			return false;
+		++profile->samples;
+		/* PCSR reads as all 1's when the core is not executing code */
+		if (pc == 0xffffffffU)
+			++profile->idle;
+		else if (!cortexm_pc_profile_add(profile, pc, 1U))
+			++profile->dropped;
+	}
+	profile->duration_ms = platform_time_ms() - start;
+	return true;
+}
+
+/*
+ * Statistically profile a running core for the given time. If the probe can do the sampling itself, it
+ * is left to do so and hands back its histogram, otherwise each sample is read over the debug link.
+ * Returns false if the target faulted or does not implement PC sampling.
+ */
+bool cortexm_pc_profile(target_s *const target, cortexm_pc_profile_s *const profile, const uint32_t duration_ms)
+{
+	adiv5_access_port_s *const ap = cortex_ap(target);
+	bool result = false;
+#if CONFIG_BMDA == 1
+	if (ap->dp->pc_profile) {
+		cortexm_profile_reset(profile);
+		result = ap->dp->pc_profile(ap, profile, duration_ms);
+	} else
+#endif
+		result = cortexm_ap_pc_profile(ap, profile, duration_ms, SIZE_MAX);
+	if (target_check_error(target) || !result)
+		return false;
+	/* An unimplemented PCSR reads as 0, so if that's all we got, PC sampling is not available */
+	const cortexm_pc_bucket_s *const zeros = cortexm_profile_bucket(profile, 0U);
+	return profile->samples && (!zeros || zeros->count != profile->samples);
+}
+
+static bool cortexm_cmd_profile(target_s *const target, const int argc, const char **const argv)
+{
+	const uint32_t duration_ms = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000U;
+	cortexm_pc_profile_s profile = {
+		.buckets = calloc(CORTEXM_PROFILE_BUCKETS, sizeof(cortexm_pc_bucket_s)),
+		.bucket_count = CORTEXM_PROFILE_BUCKETS,
+	};
+	if (!profile.buckets) { /* calloc failed: heap exhaustion */
+		DEBUG_ERROR("calloc: failed in %s\n", __func__);
+		return false;
+	}
+
+	/* Let the core run while sampling, then halt it again as GDB expects */
+	target_halt_resume(target, false);
+	const bool result = cortexm_pc_profile(target, &profile, duration_ms);
+	target_halt_request(target);
+	platform_timeout_s timeout;
+	platform_timeout_set(&timeout, 250);
+	while (target_halt_poll(target, NULL) == TARGET_HALT_RUNNING && !platform_timeout_is_expired(&timeout))
+		continue;
+
+	if (result) {
+		tc_printf(target, "%" PRIu32 " samples in %" PRIu32 "ms, %" PRIu32 " idle, %" PRIu32 " dropped\n",
+			profile.samples, profile.duration_ms, profile.idle, profile.dropped);
+		/* One line per PC seen, giving the PC and its sample count */
+		for (size_t i = 0U; i < profile.bucket_count; ++i) {
+			if (profile.buckets[i].count)
+				tc_printf(target, "%08" PRIx32 " %" PRIu32 "\n", profile.buckets[i].pc, profile.buckets[i].count);
+		}
+	} else
+		tc_printf(target, "PC sampling failed or is not implemented on this core\n");
+	free(profile.buckets);
+	return result;
+}
+
 static bool cortexm_hostio_request(target_s *const target)
 {
 	/* Read out the information from the target needed to complete the request */
@@ -65,6 +65,7 @@ extern unsigned cortexm_wait_timeout;
 #define CORTEXM_DWT_BASE (CORTEXM_PPB_BASE + 0x1000U)
 
 #define CORTEXM_DWT_CTRL    (CORTEXM_DWT_BASE + 0x000U)
+#define CORTEXM_DWT_PCSR    (CORTEXM_DWT_BASE + 0x01cU)
 #define CORTEXM_DWT_COMP(i) (CORTEXM_DWT_BASE + 0x020U + (0x10U * (i)))
 #define CORTEXM_DWT_MASK(i) (CORTEXM_DWT_BASE + 0x024U + (0x10U * (i)))
 #define CORTEXM_DWT_FUNC(i) (CORTEXM_DWT_BASE + 0x028U + (0x10U * (i)))
@@ -192,9 +193,39 @@ bool cortexm_attach(target_s *target);
 void cortexm_detach(target_s *target);
 void cortexm_halt_resume(target_s *target, bool step);
 bool cortexm_run_stub(target_s *target, uint32_t loadaddr, uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+bool cortexm_ap_run_stub(adiv5_access_port_s *ap, uint32_t loadaddr, const uint32_t *args, bool invalidate_icache,
+	uint32_t timeout, uint32_t *dfsr, uint16_t *instruction);
 int cortexm_mem_write_aligned(target_s *target, target_addr_t dest, const void *src, size_t len, align_e align);
 uint32_t cortexm_demcr_read(const target_s *target);
 void cortexm_demcr_write(target_s *target, uint32_t demcr);
 bool target_is_cortexm(const target_s *target);
 
+/* Number of distinct PC values a profile can hold, must be a power of 2 */
+#if CONFIG_BMDA == 1
+#define CORTEXM_PROFILE_BUCKETS 16384U
+#else
+#define CORTEXM_PROFILE_BUCKETS 256U
+#endif
+
+typedef struct cortexm_pc_bucket {
+	uint32_t pc;
+	uint32_t count;
+} cortexm_pc_bucket_s;
+
+/* Histogram of the PC values sampled from a running core, kept as an open addressed hash table */
+typedef struct cortexm_pc_profile {
+	cortexm_pc_bucket_s *buckets;
+	size_t bucket_count;
+	uint32_t samples;     /* Total number of samples taken */
+	uint32_t idle;        /* Samples taken while the core was halted, sleeping or in reset */
+	uint32_t dropped;     /* Samples that could not be recorded as the table was too full */
+	uint32_t duration_ms; /* How long the sampling actually ran for */
+	size_t used;          /* Number of buckets holding a PC value */
+} cortexm_pc_profile_s;
+
+bool cortexm_pc_profile(target_s *target, cortexm_pc_profile_s *profile, uint32_t duration_ms);
+bool cortexm_ap_pc_profile(
+	adiv5_access_port_s *ap, cortexm_pc_profile_s *profile, uint32_t duration_ms, size_t max_used);
+bool cortexm_pc_profile_add(cortexm_pc_profile_s *profile, uint32_t pc, uint32_t count);
+
 #endif /* TARGET_CORTEXM_H */
@@ -45,7 +45,6 @@ static void jtag_display_idcodes(void);
 static bool jtag_read_irs(void);
 static bool jtag_sanity_check(void);
 
-#if CONFIG_BMDA == 0
 void jtag_add_device(const uint32_t dev_index, const jtag_dev_s *jtag_dev)
 {
 	if (dev_index == 0)
@@ -53,7 +52,6 @@ void jtag_add_device(const uint32_t dev_index, const jtag_dev_s *jtag_dev)
 	memcpy(&jtag_devs[dev_index], jtag_dev, sizeof(jtag_dev_s));
 	jtag_dev_count = dev_index + 1U;
 }
-#endif
 
 /*
  * This scans the JTAG interface for any possible device chain attached.
@@ -571,7 +571,7 @@ static void rp_flash_exit_xip(target_s *const target)
 		target_mem32_write32(target, RP_PADS_QSPI_GPIO_SD3, padctrl_tmp);
 
 		// Brief delay (~6000 cyc) for pulls to take effect
-		platform_delay(10);
+		target_paced_delay(10);
 
 		rp_flash_put_get(target, NULL, NULL, 4, 0);
 
@@ -246,7 +246,7 @@ static void rp2350_flash_exit_xip(target_s *const target)
 		target_mem32_write32(target, RP2350_PADS_QSPI_SD2, padctrl_tmp);
 		target_mem32_write32(target, RP2350_PADS_QSPI_SD3, padctrl_tmp);
 		/* Wait a brief delay for the pulls to take effect */
-		platform_delay(10U);
+		target_paced_delay(10U);
 
 		/* Now run those 32 cycles */
 		target_mem32_write32(target, RP2350_QMI_DIRECT_CSR | RP2350_REG_ACCESS_WRITE_ATOMIC_BITSET,
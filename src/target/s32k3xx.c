@@ -192,7 +192,7 @@ static bool s32k3xx_flash_trigger_mcr(target_flash_s *const flash, uint32_t mcr_
 	 */
 	platform_timeout_s wait_timeout;
 	platform_timeout_set(&wait_timeout, 60);
-	platform_delay(1);
+	target_paced_delay(1);
 	while (
 		!(target_mem32_read32(flash->t, C40ASF_MCRS) & C40ASF_MCRS_DONE) && !platform_timeout_is_expired(&wait_timeout))
 		platform_delay(10);
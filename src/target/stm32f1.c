@@ -172,6 +172,8 @@ const command_s stm32f1_cmd_list[] = {
 static bool stm32f1_attach(target_s *target);
 static void stm32f1_detach(target_s *target);
 static bool stm32f1_flash_erase(target_flash_s *flash, target_addr_t addr, size_t len);
+static bool stm32f1_flash_erase_start(target_flash_s *flash, target_addr_t addr);
+static flash_poll_result_e stm32f1_flash_erase_poll(target_flash_s *flash, target_addr_t addr);
 static bool stm32f1_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
 static bool stm32f1_mass_erase(target_s *target, platform_timeout_s *print_progess);
 
@@ -188,6 +190,8 @@ static void stm32f1_add_flash(target_s *target, uint32_t addr, size_t length, si
 	flash->blocksize = erasesize;
 	flash->writesize = 1024U;
 	flash->erase = stm32f1_flash_erase;
+	flash->erase_start = stm32f1_flash_erase_start;
+	flash->erase_poll = stm32f1_flash_erase_poll;
 	flash->write = stm32f1_flash_write;
 	flash->erased = 0xff;
 	target_add_flash(target, flash);
@@ -1087,10 +1091,11 @@ static uint32_t stm32f1_bank_offset_for(target_addr_t addr)
 	return FLASH_BANK1_OFFSET;
 }
 
-static bool stm32f1_flash_erase(target_flash_s *flash, target_addr_t addr, size_t length)
+/* Start erasing the page at addr, leaving the controller busy with it */
+static bool stm32f1_flash_erase_start(target_flash_s *const flash, const target_addr_t addr)
 {
 	target_s *target = flash->t;
-	target_addr_t end = addr + length - 1U;
+	target_addr_t end = addr + flash->blocksize - 1U;
 	DEBUG_TARGET("%s: at %08" PRIx32 "\n", __func__, addr);
 
 	/* Unlocked an appropriate flash bank */
@@ -1108,9 +1113,33 @@ static bool stm32f1_flash_erase(target_flash_s *flash, target_addr_t addr, size_
 	target_mem32_write32(target, FLASH_AR + bank_offset, addr);
 	/* Flash page erase start instruction */
 	target_mem32_write32(target, FLASH_CR + bank_offset, FLASH_CR_STRT | FLASH_CR_PER);
+	return !target_check_error(target);
+}
 
-	/* Wait for completion or an error */
-	return stm32f1_flash_busy_wait(target, bank_offset, NULL);
+static flash_poll_result_e stm32f1_flash_erase_poll(target_flash_s *const flash, const target_addr_t addr)
+{
+	target_s *const target = flash->t;
+	/* As in stm32f1_flash_busy_wait(), EOP is only meaningful because erase start cleared it */
+	const uint32_t status = target_mem32_read32(target, FLASH_SR + stm32f1_bank_offset_for(addr));
+	if (target_check_error(target)) {
+		DEBUG_ERROR("Lost communications with target");
+		return FLASH_POLL_ERROR;
+	}
+	if (!(status & SR_EOP) && (status & FLASH_SR_BSY))
+		return FLASH_POLL_BUSY;
+	if (status & SR_ERROR_MASK) {
+		DEBUG_ERROR("stm32f1 flash error 0x%" PRIx32 "\n", status);
+		return FLASH_POLL_ERROR;
+	}
+	return FLASH_POLL_DONE;
+}
+
+static bool stm32f1_flash_erase(target_flash_s *const flash, const target_addr_t addr, const size_t length)
+{
+	(void)length;
+	/* Erase the requested page and wait for completion or an error */
+	return stm32f1_flash_erase_start(flash, addr) &&
+		stm32f1_flash_busy_wait(flash->t, stm32f1_bank_offset_for(addr), NULL);
 }
 
 static size_t stm32f1_bank1_length(target_addr_t addr, size_t len)
@@ -150,6 +150,8 @@ static bool gd32f4_attach(target_s *target);
 #endif
 static void stm32f4_detach(target_s *target);
 static bool stm32f4_flash_erase(target_flash_s *target_flash, target_addr_t addr, size_t len);
+static bool stm32f4_flash_erase_start(target_flash_s *target_flash, target_addr_t addr);
+static flash_poll_result_e stm32f4_flash_erase_poll(target_flash_s *target_flash, target_addr_t addr);
 static bool stm32f4_flash_write(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
 static bool stm32f4_mass_erase(target_s *target, platform_timeout_s *print_progess);
 
@@ -170,6 +172,8 @@ static void stm32f4_add_flash(target_s *const target, const uint32_t addr, const
 	target_flash->length = length;
 	target_flash->blocksize = blocksize;
 	target_flash->erase = stm32f4_flash_erase;
+	target_flash->erase_start = stm32f4_flash_erase_start;
+	target_flash->erase_poll = stm32f4_flash_erase_poll;
 	target_flash->write = stm32f4_flash_write;
 	target_flash->writesize = 1024;
 	target_flash->erased = 0xffU;
@@ -539,11 +543,12 @@ static void stm32f4_flash_unlock(target_s *target)
 
 static bool stm32f4_flash_busy_wait(target_s *const target, platform_timeout_s *const timeout)
 {
-	/* Read FLASH_SR to poll for BSY bit */
-	uint32_t status = FLASH_SR_BSY;
-	while (status & FLASH_SR_BSY) {
-		status = target_mem32_read32(target, FLASH_SR);
-		if ((status & SR_ERROR_MASK) || target_check_error(target)) {
+	/* Poll FLASH_SR for the BSY bit to clear */
+	uint32_t status = 0;
+	target_poll_result_e result = TARGET_POLL_TIMEOUT;
+	while (result == TARGET_POLL_TIMEOUT) {
+		result = target_mem32_poll(target, FLASH_SR, FLASH_SR_BSY, 0U, TARGET_POLL_SLICE_MS, &status);
+		if ((status & SR_ERROR_MASK) || result == TARGET_POLL_ERROR) {
 			DEBUG_ERROR("stm32f4 flash error 0x%" PRIx32 "\n", status);
 			return false;
 		}
@@ -553,24 +558,55 @@ static bool stm32f4_flash_busy_wait(target_s *const target, platform_timeout_s *
 	return true;
 }
 
+static void stm32f4_flash_erase_sector(target_s *const target, const uint8_t sector)
+{
+	const align_e psize = ((const stm32f4_priv_s *)target->target_storage)->psize;
+	const uint32_t cr = FLASH_CR_EOPIE | FLASH_CR_ERRIE | FLASH_CR_SER | (psize * FLASH_CR_PSIZE16) | (sector << 3U);
+	/* Flash page erase instruction */
+	target_mem32_write32(target, FLASH_CR, cr);
+	/* write address to FMA */
+	target_mem32_write32(target, FLASH_CR, cr | FLASH_CR_STRT);
+}
+
+/* Start erasing the single sector at addr, leaving the controller busy with it */
+static bool stm32f4_flash_erase_start(target_flash_s *const target_flash, const target_addr_t addr)
+{
+	target_s *const target = target_flash->t;
+	const stm32f4_flash_s *const flash = (stm32f4_flash_s *)target_flash;
+	stm32f4_flash_unlock(target);
+
+	/* Number the sector the same way stepping through them in stm32f4_flash_erase() does */
+	uint8_t sector = flash->base_sector + ((addr - target_flash->start) / target_flash->blocksize);
+	if (flash->bank_split && flash->base_sector < flash->bank_split && sector >= flash->bank_split)
+		sector += 16U - flash->bank_split;
+	stm32f4_flash_erase_sector(target, sector);
+	return !target_check_error(target);
+}
+
+static flash_poll_result_e stm32f4_flash_erase_poll(target_flash_s *const target_flash, const target_addr_t addr)
+{
+	(void)addr;
+	target_s *const target = target_flash->t;
+	const uint32_t status = target_mem32_read32(target, FLASH_SR);
+	if (target_check_error(target) || (status & SR_ERROR_MASK)) {
+		DEBUG_ERROR("stm32f4 flash error 0x%" PRIx32 "\n", status);
+		return FLASH_POLL_ERROR;
+	}
+	return (status & FLASH_SR_BSY) ? FLASH_POLL_BUSY : FLASH_POLL_DONE;
+}
+
 static bool stm32f4_flash_erase(target_flash_s *target_flash, target_addr_t addr, size_t len)
 {
 	target_s *target = target_flash->t;
 	stm32f4_flash_s *flash = (stm32f4_flash_s *)target_flash;
 	stm32f4_flash_unlock(target);
 
-	align_e psize = ((const stm32f4_priv_s *)target->target_storage)->psize;
-
 	/* No address translation is needed here, as we erase by sector number */
 	uint8_t sector = flash->base_sector + ((addr - target_flash->start) / target_flash->blocksize);
 
 	/* Erase the requested chunk of flash, one sector at a time. */
 	for (size_t offset = 0; offset < len; offset += target_flash->blocksize) {
-		uint32_t cr = FLASH_CR_EOPIE | FLASH_CR_ERRIE | FLASH_CR_SER | (psize * FLASH_CR_PSIZE16) | (sector << 3U);
-		/* Flash page erase instruction */
-		target_mem32_write32(target, FLASH_CR, cr);
-		/* write address to FMA */
-		target_mem32_write32(target, FLASH_CR, cr | FLASH_CR_STRT);
+		stm32f4_flash_erase_sector(target, sector);
 
 		/* Wait for completion or an error */
 		if (!stm32f4_flash_busy_wait(target, NULL))
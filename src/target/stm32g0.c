@@ -352,8 +352,10 @@ static void stm32g0_flash_lock(target_s *target)
 
 static bool stm32g0_wait_busy(target_s *const target, platform_timeout_s *const timeout)
 {
-	while (target_mem32_read32(target, FLASH_SR) & FLASH_SR_BSY_MASK) {
-		if (target_check_error(target))
+	target_poll_result_e result = TARGET_POLL_TIMEOUT;
+	while (result == TARGET_POLL_TIMEOUT) {
+		result = target_mem32_poll(target, FLASH_SR, FLASH_SR_BSY_MASK, 0U, TARGET_POLL_SLICE_MS, NULL);
+		if (result == TARGET_POLL_ERROR)
 			return false;
 		if (timeout)
 			target_print_progress(timeout);
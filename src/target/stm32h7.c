@@ -173,6 +173,10 @@
 #define STM32H74xxG_FLASH_SIZE      0x00100000U
 #define NUM_SECTOR_PER_BANK         8U
 #define FLASH_SECTOR_SIZE           0x20000U
+#define STM32H7_FLASH_WORD_SIZE     32U
+/* How many Flash words to write between checks that the write queue has room, and how long to wait for that */
+#define STM32H7_FLASH_QUEUE_WORDS      4U
+#define STM32H7_FLASH_QUEUE_TIMEOUT_MS 100U
 
 #define ID_STM32H74x 0x450U /* RM0433, RM0399 */
 #define ID_STM32H7Bx 0x480U /* RM0455 */
@@ -208,6 +212,8 @@ const command_s stm32h7_cmd_list[] = {
 static bool stm32h7_attach(target_s *target);
 static void stm32h7_detach(target_s *target);
 static bool stm32h7_flash_erase(target_flash_s *target_flash, target_addr_t addr, size_t len);
+static bool stm32h7_flash_erase_start(target_flash_s *target_flash, target_addr_t addr);
+static flash_poll_result_e stm32h7_flash_erase_poll(target_flash_s *target_flash, target_addr_t addr);
 static bool stm32h7_flash_write(target_flash_s *target_flash, target_addr_t dest, const void *src, size_t len);
 static bool stm32h7_flash_prepare(target_flash_s *target_flash);
 static bool stm32h7_flash_done(target_flash_s *target_flash);
@@ -233,12 +239,16 @@ static void stm32h7_add_flash(target_s *target, uint32_t addr, size_t length, si
 	target_flash->length = length;
 	target_flash->blocksize = blocksize;
 	target_flash->erase = stm32h7_flash_erase;
+	target_flash->erase_start = stm32h7_flash_erase_start;
+	target_flash->erase_poll = stm32h7_flash_erase_poll;
 	target_flash->write = stm32h7_flash_write;
 	target_flash->prepare = stm32h7_flash_prepare;
 	target_flash->done = stm32h7_flash_done;
 	target_flash->writesize = 2048;
 	target_flash->erased = 0xffU;
 	flash->regbase = stm32h7_flash_bank_base(addr);
+	/* Each bank has its own controller, so erases in one can run alongside those in the other */
+	target_flash->bank = flash->regbase == STM32H7_FPEC1_BASE ? 1U : 2U;
 	flash->psize = ALIGN_64BIT;
 	target_add_flash(target, target_flash);
 }
@@ -517,10 +527,9 @@ static uint32_t stm32h7_flash_cr(uint32_t sector_size, const uint32_t ctrl, cons
 	return command;
 }
 
-static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_t addr, const size_t len)
+/* Start erasing the sector at addr, leaving the bank's controller busy with it */
+static bool stm32h7_flash_erase_start(target_flash_s *const target_flash, const target_addr_t addr)
 {
-	(void)len;
-	/* Erases are always done one sector at a time - the target Flash API guarantees this */
 	target_s *target = target_flash->t;
 	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
 
@@ -531,9 +540,37 @@ static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_
 		target, flash->regbase + STM32H7_FLASH_CTRL, stm32h7_flash_cr(target_flash->blocksize, ctrl, sector));
 	target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL,
 		stm32h7_flash_cr(target_flash->blocksize, ctrl | STM32H7_FLASH_CTRL_START, sector));
+	return !target_check_error(target);
+}
+
+static flash_poll_result_e stm32h7_flash_erase_poll(target_flash_s *const target_flash, const target_addr_t addr)
+{
+	(void)addr;
+	target_s *target = target_flash->t;
+	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
+	/* This is one iteration of stm32h7_flash_wait_complete() */
+	const uint32_t status = target_mem32_read32(target, flash->regbase + STM32H7_FLASH_STATUS);
+	if (target_check_error(target)) {
+		DEBUG_ERROR("%s: error reading status\n", __func__);
+		return FLASH_POLL_ERROR;
+	}
+	if (!(status & STM32H7_FLASH_STATUS_EOP) && (status & STM32H7_FLASH_STATUS_QUEUE_WAIT))
+		return FLASH_POLL_BUSY;
+	if (status & STM32H7_FLASH_STATUS_ERROR_MASK)
+		DEBUG_ERROR("%s: Flash error: %08" PRIx32 "\n", __func__, status);
+	target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CLEAR_CTRL,
+		status & (STM32H7_FLASH_STATUS_ERROR_MASK | STM32H7_FLASH_STATUS_EOP));
+	return status & STM32H7_FLASH_STATUS_ERROR_MASK ? FLASH_POLL_ERROR : FLASH_POLL_DONE;
+}
 
+static bool stm32h7_flash_erase(target_flash_s *const target_flash, target_addr_t addr, const size_t len)
+{
+	(void)len;
+	/* Erases are always done one sector at a time - the target Flash API guarantees this */
+	const stm32h7_flash_s *const flash = (stm32h7_flash_s *)target_flash;
 	/* Wait for the operation to complete and report errors */
-	return stm32h7_flash_wait_complete(target, flash->regbase);
+	return stm32h7_flash_erase_start(target_flash, addr) &&
+		stm32h7_flash_wait_complete(target_flash->t, flash->regbase);
 }
 
 static bool stm32h7_flash_write(
@@ -547,19 +584,30 @@ static bool stm32h7_flash_write(
 		target_flash->blocksize, (flash->psize << STM32H7_FLASH_CTRL_PSIZE_SHIFT) | STM32H7_FLASH_CTRL_PROGRAM, 0);
 	target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL, ctrl);
 
-	/* Write the data to the Flash */
-	for (size_t offset = 0U; offset < len; offset += 32U) {
-		const size_t amount = MIN(len - offset, 32U);
+	/*
+	 * Write the whole Flash words a few at a time rather than waiting for QW to clear after each. The controller
+	 * holds off the bus while its write queue is full, but how long an adaptor puts up with that before giving up
+	 * varies, so check the queue has drained between chunks rather than rely on it
+	 */
+	const size_t whole_words = len & ~(STM32H7_FLASH_WORD_SIZE - 1U);
+	for (size_t offset = 0U; offset < whole_words; offset += STM32H7_FLASH_QUEUE_WORDS * STM32H7_FLASH_WORD_SIZE) {
+		const size_t amount = MIN(whole_words - offset, STM32H7_FLASH_QUEUE_WORDS * STM32H7_FLASH_WORD_SIZE);
 		target_mem32_write(target, dest + offset, ((const uint8_t *)src) + offset, amount);
-		/*
-		 * If this is the final chunk and the amount is not a multiple of 32 bytes,
-		 * make sure the write is forced to complete per RM0468 §4.3.9 "Single write sequence" pg164
-		 */
-		if (amount < 32U)
-			target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL,
-				stm32h7_flash_cr(target_flash->blocksize, ctrl | STM32H7_FLASH_CTRL_FORCE_WRITE, 0U));
-		while (target_mem32_read32(target, flash->regbase + STM32H7_FLASH_STATUS) & STM32H7_FLASH_STATUS_QUEUE_WAIT)
-			continue;
+		if (target_mem32_poll(target, flash->regbase + STM32H7_FLASH_STATUS, STM32H7_FLASH_STATUS_QUEUE_WAIT, 0U,
+				STM32H7_FLASH_QUEUE_TIMEOUT_MS, NULL) != TARGET_POLL_MATCH) {
+			DEBUG_ERROR("%s: timed out waiting for the write queue at %08" PRIx32 "\n", __func__,
+				(uint32_t)(dest + offset));
+			return false;
+		}
+	}
+	/*
+	 * If the amount is not a multiple of 32 bytes, write the remainder and make sure the write is
+	 * forced to complete per RM0468 §4.3.9 "Single write sequence" pg164
+	 */
+	if (whole_words < len) {
+		target_mem32_write(target, dest + whole_words, ((const uint8_t *)src) + whole_words, len - whole_words);
+		target_mem32_write32(target, flash->regbase + STM32H7_FLASH_CTRL,
+			stm32h7_flash_cr(target_flash->blocksize, ctrl | STM32H7_FLASH_CTRL_FORCE_WRITE, 0U));
 	}
 
 	/* Wait for the operation to complete and report errors */
@@ -870,11 +870,14 @@ static void stm32l4_flash_unlock(target_s *const target)
 
 static bool stm32l4_flash_busy_wait(target_s *const target, platform_timeout_s *const print_progess)
 {
-	/* Read FLASH_SR to poll for BSY bit */
-	uint32_t status = FLASH_SR_BSY;
-	while (status & FLASH_SR_BSY) {
-		status = stm32l4_flash_read32(target, FLASH_SR);
-		if ((status & FLASH_SR_ERROR_MASK) || target_check_error(target)) {
+	const stm32l4_priv_s *const priv = (const stm32l4_priv_s *)target->target_storage;
+	const target_addr32_t status_reg = priv->device->flash_regs_map[FLASH_SR];
+	/* Poll FLASH_SR for the BSY bit to clear */
+	uint32_t status = 0;
+	target_poll_result_e result = TARGET_POLL_TIMEOUT;
+	while (result == TARGET_POLL_TIMEOUT) {
+		result = target_mem32_poll(target, status_reg, FLASH_SR_BSY, 0U, TARGET_POLL_SLICE_MS, &status);
+		if ((status & FLASH_SR_ERROR_MASK) || result == TARGET_POLL_ERROR) {
 			DEBUG_ERROR("stm32l4 Flash error: status 0x%" PRIx32 "\n", status);
 			return false;
 		}
@@ -22,6 +22,7 @@
 #include "target_internal.h"
 #include "gdb_packet.h"
 #include "command.h"
+#include "perf.h"
 
 #include <stdarg.h>
 #include <assert.h>
@@ -42,6 +43,8 @@
 target_s *target_list = NULL;
 
 #define FLASH_WRITE_BUFFER_CEILING 1024U
+/* Shortest aligned body for which it's worth splitting a read into head, body and tail */
+#define TARGET_MEM_SPLIT_MIN_BODY 32U
 
 static bool target_cmd_mass_erase(target_s *target, int argc, const char **argv);
 static bool target_cmd_range_erase(target_s *target, int argc, const char **argv);
@@ -141,6 +144,11 @@ void target_list_free(void)
 			free(target->bw_list);
 			target->bw_list = next;
 		}
+		while (target->bw_removed_list) {
+			void *next = target->bw_removed_list->next;
+			free(target->bw_removed_list);
+			target->bw_removed_list = next;
+		}
 		free(target);
 		target = next_target;
 	}
@@ -242,6 +250,16 @@ bool target_enter_flash_mode_stub(target_s *target)
 	return true;
 }
 
+/* Wait for the given time once everything accessed so far has actually reached the target */
+void target_paced_delay(const uint32_t ms)
+{
+#if CONFIG_BMDA == 1
+	/* BMDA can hold back small writes to send them together, which would otherwise land after the delay */
+	platform_buffer_flush();
+#endif
+	platform_delay(ms);
+}
+
 static ssize_t map_ram(char *buf, size_t len, target_ram_s *ram)
 {
 	return snprintf(buf, len, "<memory type=\"ram\" start=\"0x%08" PRIx32 "\" length=\"0x%" PRIx32 "\"/>", ram->start,
@@ -285,6 +303,7 @@ void target_print_progress(platform_timeout_s *const timeout)
 void target_detach(target_s *target)
 {
 	DEBUG_TARGET("Detaching from target\n");
+	target_breakwatch_commit(target);
 	if (target->detach)
 		target->detach(target);
 	platform_target_clk_output_enable(false);
@@ -302,6 +321,41 @@ bool target_check_error(target_s *target)
 }
 
 /* Memory access functions */
+/*
+ * Memory access backends pick a single access width for a whole transfer based on its worst-case
+ * alignment, so a long read starting at an odd address or with an odd length would be done entirely
+ * as byte accesses. Work out how to split such a transfer into an unaligned head, a 32-bit aligned body
+ * and an unaligned tail so the bulk of it runs at full width. Splitting costs a transfer setup for
+ * each of the head and tail, so is only done when the body is long enough to more than make up for
+ * that. Returns the length of the body, or 0 if the transfer should be done as-is.
+ */
+static size_t target_mem_split(const target_addr64_t addr, const size_t len, size_t *const head)
+{
+	/* Transfers that are already aligned at both ends need no help */
+	if (MIN_ALIGN(addr, len) >= ALIGN_32BIT)
+		return 0U;
+	const target_addr64_t body_begin = (addr + 3U) & ~(target_addr64_t)3U;
+	const target_addr64_t body_end = (addr + len) & ~(target_addr64_t)3U;
+	/* Transfers too short to contain enough aligned words to be worth splitting are left to the backend */
+	if (body_begin >= body_end || body_end - body_begin < TARGET_MEM_SPLIT_MIN_BODY)
+		return 0U;
+	*head = body_begin - addr;
+	return body_end - body_begin;
+}
+
+/*
+ * Splitting a write turns byte and halfword writes into word writes, which peripheral registers can
+ * react to differently, so writes are only split when they land entirely within one of the target's RAM regions
+ */
+static bool target_mem_in_ram(const target_s *const target, const target_addr64_t addr, const size_t len)
+{
+	for (const target_ram_s *ram = target->ram; ram; ram = ram->next) {
+		if (addr >= ram->start && addr + len <= (target_addr64_t)ram->start + ram->length)
+			return true;
+	}
+	return false;
+}
+
 bool target_mem32_read(target_s *const target, void *const dest, const target_addr_t src, const size_t len)
 {
 	return target_mem64_read(target, dest, src, len);
@@ -318,8 +372,22 @@ bool target_mem64_read(target_s *const target, void *const dest, const target_ad
 		return false;
 	}
 	/* Otherwise if the target defines a memory read function, call that instead and check for errors */
-	if (target->mem_read)
-		target->mem_read(target, dest, src, len);
+	if (target->mem_read) {
+		const uint32_t start = perf_now();
+		size_t head = 0;
+		const size_t body = target_mem_split(src, len, &head);
+		/* If the transfer is not aligned at both ends, do the unaligned head and tail separately to the body */
+		if (body) {
+			uint8_t *const data = (uint8_t *)dest;
+			if (head)
+				target->mem_read(target, data, src, head);
+			target->mem_read(target, data + head, src + head, body);
+			if (head + body < len)
+				target->mem_read(target, data + head + body, src + head + body, len - (head + body));
+		} else
+			target->mem_read(target, dest, src, len);
+		perf_record(PERF_MEM_READ, start, len);
+	}
 	return target_check_error(target);
 }
 
@@ -339,8 +407,22 @@ bool target_mem64_write(target_s *const target, const target_addr64_t dest, cons
 		return false;
 	}
 	/* Otherwise if the target defines a memory write function, call that instead and check for errors */
-	if (target->mem_write)
-		target->mem_write(target, dest, src, len);
+	if (target->mem_write) {
+		const uint32_t start = perf_now();
+		size_t head = 0;
+		const size_t body = target_mem_in_ram(target, dest, len) ? target_mem_split(dest, len, &head) : 0U;
+		/* As for reads, do the unaligned head and tail of the transfer separately to the body */
+		if (body) {
+			const uint8_t *const data = (const uint8_t *)src;
+			if (head)
+				target->mem_write(target, dest, data, head);
+			target->mem_write(target, dest + head, data + head, body);
+			if (head + body < len)
+				target->mem_write(target, dest + head + body, data + head + body, len - (head + body));
+		} else
+			target->mem_write(target, dest, src, len);
+		perf_record(PERF_MEM_WRITE, start, len);
+	}
 	return target_check_error(target);
 }
 
@@ -389,6 +471,7 @@ void target_regs_write(target_s *target, const void *data)
 void target_reset(target_s *target)
 {
 	DEBUG_TARGET("Resetting target\n");
+	target_breakwatch_commit(target);
 	if (target->reset)
 		target->reset(target);
 }
@@ -441,6 +524,7 @@ target_halt_reason_e target_halt_poll(target_s *target, target_addr64_t *watch)
 void target_halt_resume(target_s *target, bool step)
 {
 	DEBUG_TARGET("%s target\n", step ? "Single stepping" : "Resuming");
+	target_breakwatch_commit(target);
 	if (target->halt_resume)
 		target->halt_resume(target, step);
 }
@@ -469,9 +553,29 @@ void target_set_heapinfo(target_s *target, target_addr_t heap_base, target_addr_
 	target->heapinfo[3] = stack_limit;
 }
 
-/* Break-/watchpoint functions */
+/*
+ * Break-/watchpoint functions
+ *
+ * GDB removes and reinserts every break-/watchpoint around each stop. To avoid reprogramming the
+ * comparators each time, removals are only recorded while the target is halted, and a removed
+ * break-/watchpoint that gets reinserted is simply brought back. Whatever is still removed gets
+ * cleared from the target by target_breakwatch_commit() before it resumes, resets or is detached from.
+ */
 int target_breakwatch_set(target_s *target, target_breakwatch_e type, target_addr_t addr, size_t len)
 {
+	/* If this break-/watchpoint was removed but is still programmed, reinstate it */
+	for (breakwatch_s *bwp = NULL, *bw = target->bw_removed_list; bw; bwp = bw, bw = bw->next) {
+		if (bw->type == type && bw->addr == addr && bw->size == len) {
+			if (bwp == NULL)
+				target->bw_removed_list = bw->next;
+			else
+				bwp->next = bw->next;
+			bw->next = target->bw_list;
+			target->bw_list = bw;
+			return 0;
+		}
+	}
+
 	breakwatch_s bw = {
 		.type = type,
 		.addr = addr,
@@ -479,8 +583,14 @@ int target_breakwatch_set(target_s *target, target_breakwatch_e type, target_add
 	};
 	int ret = 1;
 
-	if (target->breakwatch_set)
+	if (target->breakwatch_set) {
 		ret = target->breakwatch_set(target, &bw);
+		/* If that failed, it may be for want of comparators held by removed entries, so free those and retry */
+		if (ret != 0 && target->bw_removed_list) {
+			target_breakwatch_commit(target);
+			ret = target->breakwatch_set(target, &bw);
+		}
+	}
 
 	if (ret == 0) {
 		/* Success, make a heap copy */
@@ -510,18 +620,49 @@ int target_breakwatch_clear(target_s *target, target_breakwatch_e type, target_a
 	if (bw == NULL)
 		return -1;
 
-	int ret = 1;
-	if (target->breakwatch_clear)
-		ret = target->breakwatch_clear(target, bw);
+	if (!target->breakwatch_clear)
+		return 1;
+
+	if (bwp == NULL)
+		target->bw_list = bw->next;
+	else
+		bwp->next = bw->next;
+
+	/* Software breakpoints alter target memory, so must be cleared right away; hardware ones can wait */
+	if (type == TARGET_BREAK_SOFT) {
+		const int ret = target->breakwatch_clear(target, bw);
+		if (ret == 0)
+			free(bw);
+		else {
+			bw->next = target->bw_list;
+			target->bw_list = bw;
+		}
+		return ret;
+	}
 
-	if (ret == 0) {
-		if (bwp == NULL)
-			target->bw_list = bw->next;
-		else
-			bwp->next = bw->next;
-		free(bw);
+	bw->next = target->bw_removed_list;
+	target->bw_removed_list = bw;
+	return 0;
+}
+
+/*
+ * Clear anything still on the removed list from the target. This must be done before the core runs,
+ * so as well as on resume, reset and detach, drivers call it before any resume of their own (such as to run a stub)
+ */
+void target_breakwatch_commit(target_s *const target)
+{
+	while (target->bw_removed_list) {
+		breakwatch_s *const bw = target->bw_removed_list;
+		target->bw_removed_list = bw->next;
+		if (target->breakwatch_clear(target, bw) == 0)
+			free(bw);
+		else {
+			/* It could not be cleared, so is still active on the target */
+			DEBUG_WARN("Failed to clear break-/watchpoint at 0x%08" PRIx32 "\n", (uint32_t)bw->addr);
+			bw->next = target->bw_list;
+			target->bw_list = bw;
+		}
 	}
-	return ret;
 }
 
 /* Target-specific commands */
@@ -587,6 +728,105 @@ uint32_t target_mem32_read32(target_s *target, target_addr32_t addr)
 	return result;
 }
 
+/*
+ * Re-read the word at addr until (value & mask) == expected or timeout ms pass. The last value read is returned
+ * through value if it's not NULL. Targets able to hand the loop off to the probe do so, otherwise this polls here.
+ */
+target_poll_result_e target_mem32_poll(target_s *const target, const target_addr32_t addr, const uint32_t mask,
+	const uint32_t expected, const uint32_t timeout, uint32_t *const value)
+{
+	uint32_t status = 0;
+	target_poll_result_e result = TARGET_POLL_TIMEOUT;
+	if (target->mem_poll) {
+		const bool matched = target->mem_poll(target, addr, mask, expected, timeout, &status);
+		if (target_check_error(target))
+			result = TARGET_POLL_ERROR;
+		else if (matched)
+			result = TARGET_POLL_MATCH;
+	} else {
+		platform_timeout_s poll_timeout;
+		platform_timeout_set(&poll_timeout, timeout);
+		while (true) {
+			if (target_mem32_read(target, &status, addr, sizeof(status))) {
+				result = TARGET_POLL_ERROR;
+				break;
+			}
+			if ((status & mask) == expected) {
+				result = TARGET_POLL_MATCH;
+				break;
+			}
+			if (platform_timeout_is_expired(&poll_timeout))
+				break;
+		}
+	}
+	if (value)
+		*value = status;
+	return result;
+}
+
+void target_txn_begin(target_txn_s *const txn, target_s *const target)
+{
+	txn->target = target;
+	txn->count = 0U;
+	txn->failed = false;
+}
+
+/* Perform the accesses queued so far, skipping them if an earlier part of the transaction already failed */
+static void target_txn_flush(target_txn_s *const txn)
+{
+	target_s *const target = txn->target;
+	const size_t count = txn->count;
+	txn->count = 0U;
+	if (!count || txn->failed)
+		return;
+	if (target->mem_txn) {
+		if (!target->mem_txn(target, txn->ops, count) || target_check_error(target))
+			txn->failed = true;
+		return;
+	}
+
+	/* Targets without a native implementation get each access done in turn, stopping at the first failure */
+	for (size_t i = 0; i < count && !txn->failed; ++i) {
+		const target_txn_op_s *const op = &txn->ops[i];
+		if (op->write)
+			txn->failed = target_mem32_write32(target, op->addr, op->value);
+		else
+			txn->failed = target_mem32_read(target, op->result, op->addr, sizeof(*op->result));
+	}
+}
+
+static void target_txn_queue(
+	target_txn_s *const txn, const bool write, const target_addr32_t addr, const uint32_t value, uint32_t *const result)
+{
+	/* If the queue is full, perform what's in it to make room */
+	if (txn->count == TARGET_TXN_MAX_OPS)
+		target_txn_flush(txn);
+	target_txn_op_s *const op = &txn->ops[txn->count++];
+	op->addr = addr;
+	op->write = write;
+	op->value = value;
+	op->result = result;
+}
+
+/* Queue a read of the word at addr, value is only filled in once the transaction is committed */
+void target_txn_read32(target_txn_s *const txn, const target_addr32_t addr, uint32_t *const value)
+{
+	*value = 0U;
+	target_txn_queue(txn, false, addr, 0U, value);
+}
+
+void target_txn_write32(target_txn_s *const txn, const target_addr32_t addr, const uint32_t value)
+{
+	target_txn_queue(txn, true, addr, value, NULL);
+}
+
+/* Perform all the accesses queued in the transaction, returning true if they all succeeded */
+bool target_txn_commit(target_txn_s *const txn)
+{
+	target_txn_flush(txn);
+	return !txn->failed;
+}
+
 bool target_mem32_write32(target_s *target, target_addr32_t addr, uint32_t value)
 {
 	return target_mem32_write(target, addr, &value, sizeof(value));
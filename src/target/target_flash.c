@@ -37,8 +37,15 @@
 
 #include "general.h"
 #include "target_internal.h"
+#include "perf.h"
 
 static bool flash_done(target_flash_s *flash);
+static size_t flash_erase_split_banks(
+	target_s *target, target_addr_t addr, size_t len, target_flash_erase_s *erases, uint8_t *banks);
+static bool flash_erase_background(target_s *target, const target_flash_erase_s *erases, const uint8_t *banks,
+	size_t count);
+static bool flash_erase_pending_step(target_s *target);
+static bool flash_erase_pending_finish(target_s *target, uint8_t bank);
 
 target_flash_s *target_flash_for_addr(target_s *target, uint32_t addr)
 {
@@ -131,7 +138,12 @@ static bool flash_done(target_flash_s *flash)
 	return result;
 }
 
-bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
+/*
+ * Erase the given range. Where the range sits behind several independent Flash controllers, the banks are
+ * erased alongside each other. If defer is set, those erases are left running in the background, to be
+ * seen through by whatever next needs their banks (see target_flash_erase_deferred())
+ */
+static bool flash_erase(target_s *const target, target_addr_t addr, size_t len, const bool defer)
 {
 	if (!target_enter_flash_mode(target))
 		return false;
@@ -140,6 +152,18 @@ bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 	if (!active_flash)
 		return false;
 
+	/* If the range is all in Flash that sits behind its own controller, keep each of the banks busy at once */
+	target_flash_erase_s bank_erases[FLASH_MAX_CONCURRENT_BANKS];
+	uint8_t banks[FLASH_MAX_CONCURRENT_BANKS];
+	const size_t bank_count = flash_erase_split_banks(target, addr, len, bank_erases, banks);
+	if (bank_count) {
+		const bool result = flash_erase_background(target, bank_erases, banks, bank_count);
+		return (defer || flash_erase_pending_finish(target, 0U)) && result;
+	}
+	/* Otherwise any erases still running have to be seen through first */
+	if (!flash_erase_pending_finish(target, 0U))
+		return false;
+
 	bool result = true; /* Catch false returns with &= */
 	while (len) {
 		target_flash_s *flash = target_flash_for_addr(target, addr);
@@ -170,8 +194,10 @@ bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 
 		DEBUG_TARGET("%s: %08" PRIx32 "+%" PRIu32 "\n", __func__, local_start_addr, local_end_addr - local_start_addr);
 		/* Erase flash, either a single aligned block size or a full mass erase */
+		const uint32_t start = perf_now();
 		result &= can_use_mass_erase ? flash->mass_erase(flash, NULL) :
 									   flash->erase(flash, local_start_addr, flash->blocksize);
+		perf_record(PERF_FLASH_ERASE, start, local_end_addr - local_start_addr);
 		if (!result) {
 			DEBUG_ERROR("Erase failed at %" PRIx32 "\n", local_start_addr);
 			break;
@@ -186,11 +212,206 @@ bool target_flash_erase(target_s *target, target_addr_t addr, size_t len)
 	return result;
 }
 
+/* Erase the given range, returning once it is completely erased */
+bool target_flash_erase(target_s *const target, const target_addr_t addr, const size_t len)
+{
+	return flash_erase(target, addr, len, false);
+}
+
+/*
+ * Erase the given range, but where it's on Flash with its own controller, return as soon as the erase is
+ * started. The erase carries on while other banks are erased or written, and is waited on by the next write
+ * to its bank, any other erase, or target_flash_complete(). This means an erase failure is reported by
+ * whichever of those runs into it, so this must only be used by callers that go on to write the range and
+ * then call target_flash_complete().
+ */
+bool target_flash_erase_deferred(target_s *const target, const target_addr_t addr, const size_t len)
+{
+	return flash_erase(target, addr, len, true);
+}
+
+bool target_flash_erase_begin(
+	target_flash_erase_s *const erase, target_s *const target, const target_addr_t addr, const size_t len)
+{
+	erase->target = target;
+	erase->flash = NULL;
+	erase->addr = addr;
+	erase->len = len;
+	erase->started = false;
+	return target_enter_flash_mode(target);
+}
+
+/* Move an erase on past the block containing its current address */
+static void flash_erase_advance(target_flash_erase_s *const erase)
+{
+	const target_addr_t block_end = (erase->addr & ~(erase->flash->blocksize - 1U)) + erase->flash->blocksize;
+	erase->len -= MIN(block_end - erase->addr, erase->len);
+	erase->addr = block_end;
+}
+
+static flash_poll_result_e flash_erase_failed(target_flash_erase_s *const erase)
+{
+	DEBUG_ERROR("Erase failed at %" PRIx32 "\n", erase->addr);
+	if (erase->flash)
+		flash_done(erase->flash);
+	erase->flash = NULL;
+	erase->len = 0U;
+	return FLASH_POLL_ERROR;
+}
+
+/*
+ * Do the next piece of work on an erase set up by target_flash_erase_begin(), returning FLASH_POLL_BUSY
+ * while there's more to do. Flash that can start erasing a block without waiting on it only has the block
+ * started or its progress checked each step, otherwise each step erases one whole block.
+ */
+flash_poll_result_e target_flash_erase_step(target_flash_erase_s *const erase)
+{
+	if (erase->started) {
+		const target_addr_t block_addr = erase->addr & ~(erase->flash->blocksize - 1U);
+		const flash_poll_result_e result = erase->flash->erase_poll(erase->flash, block_addr);
+		if (result == FLASH_POLL_BUSY)
+			return result;
+		erase->started = false;
+		if (result == FLASH_POLL_ERROR)
+			return flash_erase_failed(erase);
+		perf_record(PERF_FLASH_ERASE, erase->start_time, erase->flash->blocksize);
+		flash_erase_advance(erase);
+	}
+
+	/* Once everything's erased, finish up the Flash operation */
+	if (!erase->len) {
+		if (erase->flash && !flash_done(erase->flash))
+			return FLASH_POLL_ERROR;
+		erase->flash = NULL;
+		return FLASH_POLL_DONE;
+	}
+
+	target_flash_s *const flash = target_flash_for_addr(erase->target, erase->addr);
+	if (!flash) {
+		DEBUG_ERROR("Requested address is outside the valid range 0x%06" PRIx32 "\n", erase->addr);
+		return flash_erase_failed(erase);
+	}
+	/* Terminate flash operations if we're not in the same target flash */
+	if (erase->flash && flash != erase->flash && !flash_done(erase->flash))
+		return flash_erase_failed(erase);
+	erase->flash = flash;
+	if (!flash_prepare(flash, FLASH_OPERATION_ERASE))
+		return flash_erase_failed(erase);
+
+	const target_addr_t block_addr = erase->addr & ~(flash->blocksize - 1U);
+	DEBUG_TARGET("%s: %08" PRIx32 "+%zu\n", __func__, block_addr, flash->blocksize);
+	if (flash->erase_start && flash->erase_poll) {
+		erase->start_time = perf_now();
+		if (!flash->erase_start(flash, block_addr))
+			return flash_erase_failed(erase);
+		erase->started = true;
+		return FLASH_POLL_BUSY;
+	}
+	const uint32_t start = perf_now();
+	if (!flash->erase(flash, block_addr, flash->blocksize))
+		return flash_erase_failed(erase);
+	perf_record(PERF_FLASH_ERASE, start, flash->blocksize);
+	flash_erase_advance(erase);
+	return FLASH_POLL_BUSY;
+}
+
+/*
+ * Split an erase into one piece per Flash bank, returning how many banks it covers. If any of the range
+ * is in a region that does not declare its bank or can't start a block erase without waiting on it,
+ * or a bank would need more than one piece, 0 is returned and the erase has to be done serially.
+ */
+static size_t flash_erase_split_banks(target_s *const target, target_addr_t addr, size_t len,
+	target_flash_erase_s *const erases, uint8_t *const banks)
+{
+	size_t count = 0U;
+	while (len) {
+		target_flash_s *const flash = target_flash_for_addr(target, addr);
+		if (!flash || !flash->bank || !flash->erase_start || !flash->erase_poll || flash->mass_erase)
+			return 0U;
+		const size_t local_len = MIN(len, flash->start + flash->length - addr);
+		/* Neighbouring regions on the same bank get erased by the same piece */
+		if (count && banks[count - 1U] == flash->bank)
+			erases[count - 1U].len += local_len;
+		else {
+			for (size_t idx = 0U; idx < count; ++idx) {
+				if (banks[idx] == flash->bank)
+					return 0U;
+			}
+			if (count == FLASH_MAX_CONCURRENT_BANKS)
+				return 0U;
+			banks[count] = flash->bank;
+			if (!target_flash_erase_begin(&erases[count], target, addr, local_len))
+				return 0U;
+			++count;
+		}
+		addr += local_len;
+		len -= local_len;
+	}
+	return count;
+}
+
+/*
+ * Hand the per-bank pieces of an erase over to the target to run in the background, first seeing through
+ * any erase already running on the same bank
+ */
+static bool flash_erase_background(target_s *const target, const target_flash_erase_s *const erases,
+	const uint8_t *const banks, const size_t count)
+{
+	bool result = true;
+	for (size_t idx = 0U; idx < count; ++idx) {
+		result &= flash_erase_pending_finish(target, banks[idx]);
+		if (target->flash_erases_pending == FLASH_MAX_CONCURRENT_BANKS)
+			result &= flash_erase_pending_finish(target, 0U);
+		target->flash_erases[target->flash_erases_pending] = erases[idx];
+		target->flash_erase_banks[target->flash_erases_pending] = banks[idx];
+		++target->flash_erases_pending;
+	}
+	/* Get the first block erasing on each bank */
+	return flash_erase_pending_step(target) && result;
+}
+
+/* Step every erase running in the background once, dropping those that have finished */
+static bool flash_erase_pending_step(target_s *const target)
+{
+	bool result = true;
+	size_t kept = 0U;
+	for (size_t idx = 0U; idx < target->flash_erases_pending; ++idx) {
+		const flash_poll_result_e state = target_flash_erase_step(&target->flash_erases[idx]);
+		if (state == FLASH_POLL_BUSY) {
+			target->flash_erases[kept] = target->flash_erases[idx];
+			target->flash_erase_banks[kept] = target->flash_erase_banks[idx];
+			++kept;
+		} else
+			result &= state == FLASH_POLL_DONE;
+	}
+	target->flash_erases_pending = kept;
+	return result;
+}
+
+/*
+ * Step the background erases round-robin until none are left on the bank given (or on any bank if that's 0),
+ * so each controller starts its next block as soon as it's free
+ */
+static bool flash_erase_pending_finish(target_s *const target, const uint8_t bank)
+{
+	bool result = true;
+	for (bool busy = true; busy;) {
+		busy = false;
+		for (size_t idx = 0U; idx < target->flash_erases_pending; ++idx)
+			busy |= !bank || target->flash_erase_banks[idx] == bank;
+		if (busy)
+			result &= flash_erase_pending_step(target);
+	}
+	return result;
+}
+
 static inline bool flash_manual_mass_erase(target_flash_s *const flash, platform_timeout_s *const print_progess)
 {
 	for (target_addr_t addr = flash->start; addr < flash->start + flash->length; addr += flash->blocksize) {
+		const uint32_t start = perf_now();
 		if (!flash->erase(flash, addr, flash->blocksize))
 			return false;
+		perf_record(PERF_FLASH_ERASE, start, flash->blocksize);
 		target_print_progress(print_progess);
 	}
 	return true;
@@ -199,7 +420,7 @@ static inline bool flash_manual_mass_erase(target_flash_s *const flash, platform
 /* Run specialized target mass erase if available, otherwise erase all flash' */
 bool target_flash_mass_erase(target_s *const target)
 {
-	if (!target_enter_flash_mode(target))
+	if (!target_enter_flash_mode(target) || !flash_erase_pending_finish(target, 0U))
 		return false;
 
 	/* Setup progress printout */
@@ -264,8 +485,9 @@ static bool flash_buffered_flush(target_flash_s *flash)
 	bool result = true; /* Catch false returns with &= */
 	if (flash->buf && flash->buf_addr_base != UINT32_MAX && flash->buf_addr_low != UINT32_MAX &&
 		flash->buf_addr_low < flash->buf_addr_high) {
-		/* Write buffer to flash */
-
+		/* Write buffer to flash, once anything erasing on the same bank is done */
+		if (flash->bank && !flash_erase_pending_finish(flash->t, flash->bank))
+			return false;
 		if (!flash_prepare(flash, FLASH_OPERATION_WRITE))
 			return false;
 
@@ -273,8 +495,13 @@ static bool flash_buffered_flush(target_flash_s *flash)
 		const uint8_t *src = flash->buf + (aligned_addr - flash->buf_addr_base);
 		const uint32_t length = flash->buf_addr_high - aligned_addr;
 
-		for (size_t offset = 0; offset < length; offset += flash->writesize)
+		for (size_t offset = 0; offset < length; offset += flash->writesize) {
+			const uint32_t start = perf_now();
 			result &= flash->write(flash, aligned_addr + offset, src + offset, flash->writesize);
+			perf_record(PERF_FLASH_WRITE, start, flash->writesize);
+			/* Keep the other banks moving on to their next block while this one is programmed */
+			result &= flash_erase_pending_step(flash->t);
+		}
 
 		flash->buf_addr_base = UINT32_MAX;
 		flash->buf_addr_low = UINT32_MAX;
@@ -374,7 +601,7 @@ bool target_flash_complete(target_s *target)
 	if (!target || !target->flash_mode)
 		return false;
 
-	bool result = true; /* Catch false returns with &= */
+	bool result = flash_erase_pending_finish(target, 0U); /* Catch false returns with &= */
 	for (target_flash_s *flash = target->flash; flash; flash = flash->next) {
 		result &= flash_buffered_flush(flash);
 		result &= flash_done(flash);
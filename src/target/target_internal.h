@@ -40,6 +40,13 @@ typedef enum flash_operation {
 	FLASH_OPERATION_WRITE,
 } flash_operation_e;
 
+/* Outcome of checking on a Flash operation that was started without waiting for it to complete */
+typedef enum flash_poll_result {
+	FLASH_POLL_DONE,
+	FLASH_POLL_BUSY,
+	FLASH_POLL_ERROR,
+} flash_poll_result_e;
+
 typedef struct target_ram target_ram_s;
 
 struct target_ram {
@@ -56,27 +63,32 @@ typedef bool (*flash_erase_func)(target_flash_s *flash, target_addr_t addr, size
 typedef bool (*flash_mass_erase_func)(target_flash_s *flash, platform_timeout_s *print_progess);
 typedef bool (*flash_write_func)(target_flash_s *flash, target_addr_t dest, const void *src, size_t len);
 typedef bool (*flash_done_func)(target_flash_s *flash);
+typedef bool (*flash_erase_start_func)(target_flash_s *flash, target_addr_t addr);
+typedef flash_poll_result_e (*flash_erase_poll_func)(target_flash_s *flash, target_addr_t addr);
 
 struct target_flash {
 	/* XXX: This needs adjusting for 64-bit operations */
-	target_s *t;                      /* Target this flash is attached to */
-	target_addr32_t start;            /* Start address of flash */
-	size_t length;                    /* Flash length */
-	size_t blocksize;                 /* Erase block size */
-	size_t writesize;                 /* Write operation size, must be <= blocksize/writebufsize */
-	size_t writebufsize;              /* Size of write buffer, this is calculated and not set in target code */
-	uint8_t erased;                   /* Byte erased state */
-	uint8_t operation;                /* Current Flash operation (none means it's idle/unprepared) */
-	flash_prepare_func prepare;       /* Prepare for flash operations */
-	flash_erase_func erase;           /* Erase a range of flash */
-	flash_mass_erase_func mass_erase; /* Mass erase flash (this flash only¹) */
-	flash_write_func write;           /* Write to flash */
-	flash_done_func done;             /* Finish flash operations */
-	uint8_t *buf;                     /* Buffer for flash operations */
-	target_addr32_t buf_addr_base;    /* Address of block this buffer is for */
-	target_addr32_t buf_addr_low;     /* Address of lowest byte written */
-	target_addr32_t buf_addr_high;    /* Address of highest byte written */
-	target_flash_s *next;             /* Next flash in list */
+	target_s *t;                        /* Target this flash is attached to */
+	target_addr32_t start;              /* Start address of flash */
+	size_t length;                      /* Flash length */
+	size_t blocksize;                   /* Erase block size */
+	size_t writesize;                   /* Write operation size, must be <= blocksize/writebufsize */
+	size_t writebufsize;                /* Size of write buffer, this is calculated and not set in target code */
+	uint8_t erased;                     /* Byte erased state */
+	uint8_t operation;                  /* Current Flash operation (none means it's idle/unprepared) */
+	uint8_t bank;                       /* Optional, non-zero ID of the controller this region is behind */
+	flash_prepare_func prepare;         /* Prepare for flash operations */
+	flash_erase_func erase;             /* Erase a range of flash */
+	flash_mass_erase_func mass_erase;   /* Mass erase flash (this flash only¹) */
+	flash_write_func write;             /* Write to flash */
+	flash_done_func done;               /* Finish flash operations */
+	flash_erase_start_func erase_start; /* Optional, start erasing a single block without waiting on it */
+	flash_erase_poll_func erase_poll;   /* Check on a block erase begun by erase_start */
+	uint8_t *buf;                       /* Buffer for flash operations */
+	target_addr32_t buf_addr_base;      /* Address of block this buffer is for */
+	target_addr32_t buf_addr_low;       /* Address of lowest byte written */
+	target_addr32_t buf_addr_high;      /* Address of highest byte written */
+	target_flash_s *next;               /* Next flash in list */
 };
 
 /*
@@ -84,6 +96,22 @@ struct target_flash {
  * consider using the target mass_erase method instead for such cases
  */
 
+/*
+ * State for an erase performed a block at a time by target_flash_erase_step(), so erases on several
+ * targets can be interleaved with other work while the Flash controllers are busy.
+ */
+typedef struct target_flash_erase {
+	target_s *target;
+	target_flash_s *flash; /* Flash the block being erased belongs to */
+	target_addr_t addr;    /* Next address to erase */
+	size_t len;            /* Bytes left to erase from addr */
+	bool started;          /* Set while a block erase begun with erase_start is running */
+	uint32_t start_time;   /* When that block erase was started, for the performance counters */
+} target_flash_erase_s;
+
+/* Upper limit on how many independently controlled Flash banks can be erasing at once */
+#define FLASH_MAX_CONCURRENT_BANKS 2U
+
 typedef bool (*cmd_handler_fn)(target_s *target, int argc, const char **argv);
 
 typedef struct command {
@@ -117,6 +145,36 @@ struct breakwatch {
 #endif
 };
 
+/* Maximum number of memory accesses a transaction queues up before they have to be performed */
+#if CONFIG_BMDA == 1
+#define TARGET_TXN_MAX_OPS 32U
+#else
+#define TARGET_TXN_MAX_OPS 16U
+#endif
+
+/* A single 32-bit memory access queued up in a transaction */
+typedef struct target_txn_op {
+	target_addr64_t addr;
+	bool write;
+	/* Value to write for write operations */
+	uint32_t value;
+	/* Where to store the value read for read operations */
+	uint32_t *result;
+} target_txn_op_s;
+
+/*
+ * A sequence of memory accesses queued up with target_txn_read32() and target_txn_write32() that are
+ * performed in order when the transaction is committed, so backends able to do several accesses per round
+ * trip can do so. Values read are only valid once target_txn_commit() has been called.
+ */
+typedef struct target_txn {
+	target_s *target;
+	size_t count;
+	/* Set if performing the queued accesses (including any flush caused by the queue filling up) failed */
+	bool failed;
+	target_txn_op_s ops[TARGET_TXN_MAX_OPS];
+} target_txn_s;
+
 #define MAX_CMDLINE 81
 
 typedef void (*priv_free_func)(void *flash);
@@ -132,6 +190,11 @@ struct target {
 	/* Memory access functions */
 	void (*mem_read)(target_s *target, void *dest, target_addr64_t src, size_t len);
 	void (*mem_write)(target_s *target, target_addr64_t dest, const void *src, size_t len);
+	/* Optional, re-reads a word until (value & mask) == expected or timeout ms pass, see target_mem32_poll() */
+	bool (*mem_poll)(target_s *target, target_addr64_t src, uint32_t mask, uint32_t expected, uint32_t timeout,
+		uint32_t *value);
+	/* Optional, performs a sequence of 32-bit memory accesses in order, see target_txn_commit() */
+	bool (*mem_txn)(target_s *target, const target_txn_op_s *ops, size_t count);
 
 	/* Register access functions */
 	size_t regs_size;
@@ -152,6 +215,8 @@ struct target {
 	int (*breakwatch_set)(target_s *target, breakwatch_s *);
 	int (*breakwatch_clear)(target_s *target, breakwatch_s *);
 	breakwatch_s *bw_list;
+	/* Break-/watchpoints removed since the target halted but still programmed, cleared on resume */
+	breakwatch_s *bw_removed_list;
 
 	/* Recovery functions */
 	bool (*mass_erase)(target_s *target, platform_timeout_s *print_progess); /* Mass erase all target flash */
@@ -175,6 +240,10 @@ struct target {
 
 	target_ram_s *ram;
 	target_flash_s *flash;
+	/* Erases left running on Flash banks while others are written to, and the banks they're on */
+	target_flash_erase_s flash_erases[FLASH_MAX_CONCURRENT_BANKS];
+	uint8_t flash_erase_banks[FLASH_MAX_CONCURRENT_BANKS];
+	uint8_t flash_erases_pending;
 
 	/* Other stuff */
 	const char *driver;
@@ -204,15 +273,21 @@ void target_ram_map_free(target_s *target);
 void target_flash_map_free(target_s *target);
 void target_mem_map_free(target_s *target);
 void target_add_commands(target_s *target, const command_s *cmds, const char *name);
+void target_breakwatch_commit(target_s *target);
 void target_add_ram32(target_s *target, target_addr32_t start, uint32_t len);
 void target_add_ram64(target_s *target, target_addr64_t start, uint64_t len);
 void target_add_flash(target_s *target, target_flash_s *flash);
 
 /* No-op stub for enter flash mode */
 bool target_enter_flash_mode_stub(target_s *target);
+/* For drivers that pace their accesses with delays */
+void target_paced_delay(uint32_t ms);
 
 target_flash_s *target_flash_for_addr(target_s *target, uint32_t addr);
 
+bool target_flash_erase_begin(target_flash_erase_s *erase, target_s *target, target_addr_t addr, size_t len);
+flash_poll_result_e target_flash_erase_step(target_flash_erase_s *erase);
+
 /* Convenience function for MMIO access */
 uint32_t target_mem32_read32(target_s *target, target_addr32_t addr);
 uint16_t target_mem32_read16(target_s *target, target_addr32_t addr);
@@ -228,6 +303,24 @@ bool target_mem64_write16(target_s *target, target_addr64_t addr, uint16_t value
 bool target_mem64_write8(target_s *target, target_addr64_t addr, uint8_t value);
 bool target_check_error(target_s *target);
 
+/* Outcome of polling a location with target_mem32_poll() */
+typedef enum target_poll_result {
+	TARGET_POLL_MATCH,
+	TARGET_POLL_TIMEOUT,
+	TARGET_POLL_ERROR,
+} target_poll_result_e;
+
+/* How long to poll for at a time in loops that also need to print progress */
+#define TARGET_POLL_SLICE_MS 500U
+
+target_poll_result_e target_mem32_poll(
+	target_s *target, target_addr32_t addr, uint32_t mask, uint32_t expected, uint32_t timeout, uint32_t *value);
+
+void target_txn_begin(target_txn_s *txn, target_s *target);
+void target_txn_read32(target_txn_s *txn, target_addr32_t addr, uint32_t *value);
+void target_txn_write32(target_txn_s *txn, target_addr32_t addr, uint32_t value);
+bool target_txn_commit(target_txn_s *txn);
+
 #if defined(__MINGW32__) || defined(__MINGW64__) || defined(__CYGWIN__)
 #define TC_FORMAT_ATTR __attribute__((format(__MINGW_PRINTF_FORMAT, 2, 3)))
 #elif defined(__GNUC__) || defined(__clang__)